@@ -0,0 +1,590 @@
+/*-------------------------------------------------------------------------
+ *
+ * aggregate.c
+ *	  group rows by values of column
+ *
+ * Portions Copyright (c) 2017-2021 Pavel Stehule
+ *
+ * IDENTIFICATION
+ *	  src/aggregate.c
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include <float.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pspg.h"
+
+#ifndef offsetof
+#define offsetof(type, field)	((long) &((type *)0)->field)
+#endif							/* offsetof */
+
+#define AGG_INIT_SLOTS			1024
+#define AGG_AVG_SCALE			6
+
+/*
+ * Group of rows with same value. The value is stored in data
+ * of group table.
+ */
+typedef struct
+{
+	bool		used;
+	bool		isnull;
+	uint32_t	hash;
+	size_t		offset;				/* start of value in data of group table */
+	int			size;
+	int			first_lineno;		/* line of first row of group */
+	long		count;
+	long		nvalues;			/* number of not null aggregated values */
+	double		sum;
+	double		sum_comp;			/* lost low-order bits of sum */
+} AggGroup;
+
+/*
+ * Hash table with open addressing. Number of slots is power of two.
+ */
+typedef struct
+{
+	AggGroup   *slots;
+	int			nslots;
+	int			ngroups;
+	char	   *data;
+	size_t		data_size;
+	size_t		data_allocated;
+} AggTable;
+
+typedef struct
+{
+	DataDesc   *desc;
+	ColumnValues *cv;				/* values of aggregated column or NULL */
+	int			colno;
+	int			last_data_row;
+	AggTable	table;
+} AggWorker;
+
+/*
+ * FNV-1a hash
+ */
+static uint32_t
+hash_value(const char *str, int size)
+{
+	uint32_t	hash = 2166136261u;
+
+	while (size-- > 0)
+	{
+		hash ^= (unsigned char) *str++;
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
+static void
+init_table(AggTable *t)
+{
+	memset(t, 0, sizeof(AggTable));
+
+	t->nslots = AGG_INIT_SLOTS;
+	t->slots = smalloc(t->nslots * sizeof(AggGroup));
+}
+
+static void
+free_table(AggTable *t)
+{
+	free(t->slots);
+	free(t->data);
+}
+
+/*
+ * Double number of slots, when the table is half full
+ */
+static void
+grow_table(AggTable *t)
+{
+	AggGroup   *slots = t->slots;
+	int			nslots = t->nslots;
+	int			i;
+
+	t->nslots *= 2;
+	t->slots = smalloc(t->nslots * sizeof(AggGroup));
+
+	for (i = 0; i < nslots; i++)
+	{
+		if (slots[i].used)
+		{
+			int			pos = slots[i].hash & (t->nslots - 1);
+
+			while (t->slots[pos].used)
+				pos = (pos + 1) & (t->nslots - 1);
+
+			t->slots[pos] = slots[i];
+		}
+	}
+
+	free(slots);
+}
+
+/*
+ * Returns group for value. When the group doesn't exist, then new
+ * group is created, and the value is copied (the rows can be released
+ * from block cache).
+ */
+static AggGroup *
+lookup_group(AggTable *t, const char *str, int size, bool isnull, uint32_t hash)
+{
+	AggGroup   *g;
+	int			pos;
+
+	if (t->ngroups * 2 >= t->nslots)
+		grow_table(t);
+
+	pos = hash & (t->nslots - 1);
+
+	while (t->slots[pos].used)
+	{
+		g = &t->slots[pos];
+
+		if (g->hash == hash && g->isnull == isnull &&
+			g->size == size && memcmp(t->data + g->offset, str, size) == 0)
+			return g;
+
+		pos = (pos + 1) & (t->nslots - 1);
+	}
+
+	if (t->data_size + size > t->data_allocated)
+	{
+		size_t		newsize = t->data_allocated > 0 ? t->data_allocated : 4096;
+
+		while (newsize < t->data_size + size)
+			newsize *= 2;
+
+		t->data = srealloc(t->data, newsize);
+		t->data_allocated = newsize;
+	}
+
+	g = &t->slots[pos];
+
+	g->used = true;
+	g->isnull = isnull;
+	g->hash = hash;
+	g->offset = t->data_size;
+	g->size = size;
+	g->first_lineno = -1;
+
+	memcpy(t->data + t->data_size, str, size);
+	t->data_size += size;
+	t->ngroups += 1;
+
+	return g;
+}
+
+/*
+ * Neumaier variant of Kahan summation, so sum of many decimal
+ * values doesn't accumulate rounding errors.
+ */
+static void
+add_value(AggGroup *g, double value)
+{
+	double		t = g->sum + value;
+
+	if (fabs(g->sum) >= fabs(value))
+		g->sum_comp += (g->sum - t) + value;
+	else
+		g->sum_comp += (value - t) + g->sum;
+
+	g->sum = t;
+}
+
+/*
+ * Aggregate first lines of rows of one line buffer. When peek_only is
+ * true, then the line buffer is not loaded, and only line buffers in
+ * memory or rows of column store can be processed.
+ */
+static bool
+agg_block(void *arg, LineBuffer *lb, bool peek_only)
+{
+	AggWorker  *aw = (AggWorker *) arg;
+	DataDesc   *desc = aw->desc;
+	bool		has_lines = !peek_only || lb_peek_row(lb, 0);
+	int			i;
+
+	/* not formatted values of column store can be used without lines */
+	if (!has_lines && !desc->colstore)
+		return false;
+
+	for (i = 0; i < lb->nrows; i++)
+	{
+		int			lineno = lb->first_row + i;
+		const char *line = NULL;
+		const char *str;
+		int			size;
+		AggGroup   *g;
+
+		if (lineno < desc->first_data_row || lineno > aw->last_data_row)
+			continue;
+
+		if (desc->has_multilines && lb_is_continual_row(lb, i))
+			continue;
+
+		if (is_filtered_row(desc, lineno))
+			continue;
+
+		if (has_lines)
+			line = peek_only ? lb_peek_row(lb, i) : lb_get_row(lb, i, NULL);
+
+		str = get_field_value(desc, line, lineno, aw->colno, &size);
+
+		if (str)
+			g = lookup_group(&aw->table, str, size, false, hash_value(str, size));
+		else
+			g = lookup_group(&aw->table, "", 0, true, 0);
+
+		/* blocks are processed in order by one worker */
+		if (g->first_lineno == -1)
+			g->first_lineno = lineno;
+
+		g->count += 1;
+
+		if (aw->cv && !aw->cv->isnull[lineno])
+		{
+			g->nvalues += 1;
+			add_value(g, aw->cv->values[lineno]);
+		}
+	}
+
+	return true;
+}
+
+/*
+ * Merge groups of table src to table dest
+ */
+static void
+merge_table(AggTable *dest, AggTable *src)
+{
+	int			i;
+
+	for (i = 0; i < src->nslots; i++)
+	{
+		AggGroup   *sg = &src->slots[i];
+		AggGroup   *g;
+
+		if (!sg->used)
+			continue;
+
+		g = lookup_group(dest, src->data + sg->offset, sg->size, sg->isnull, sg->hash);
+
+		if (g->first_lineno == -1 || sg->first_lineno < g->first_lineno)
+			g->first_lineno = sg->first_lineno;
+
+		g->count += sg->count;
+		g->nvalues += sg->nvalues;
+		g->sum_comp += sg->sum_comp;
+		add_value(g, sg->sum);
+	}
+}
+
+/*
+ * Most frequent values are first, groups with same count are
+ * in order of first occurrence.
+ */
+static int
+compare_groups(const void *a, const void *b)
+{
+	const AggGroup *g1 = *((const AggGroup **) a);
+	const AggGroup *g2 = *((const AggGroup **) b);
+
+	if (g1->count != g2->count)
+		return g1->count > g2->count ? -1 : 1;
+
+	return g1->first_lineno < g2->first_lineno ? -1 : 1;
+}
+
+/*
+ * Aggregate rows in parallel. Every worker has own hash table, and
+ * these tables are merged.
+ */
+static void
+agg_rows(DataDesc *desc, int colno, ColumnValues *cv, AggTable *result)
+{
+	AggWorker  *workers;
+	void	  **args;
+	int			nworkers = lb_get_parallel_workers();
+	int			i;
+
+	workers = smalloc((nworkers + 1) * sizeof(AggWorker));
+	args = smalloc((nworkers + 1) * sizeof(void *));
+
+	for (i = 0; i <= nworkers; i++)
+	{
+		AggWorker  *aw = &workers[i];
+
+		aw->desc = desc;
+		aw->cv = cv;
+		aw->colno = colno;
+		aw->last_data_row = get_unfiltered_last_data_row(desc);
+
+		init_table(&aw->table);
+
+		args[i] = aw;
+	}
+
+	lb_process_parallel(desc, agg_block, args, nworkers);
+
+	init_table(result);
+
+	for (i = 0; i <= nworkers; i++)
+	{
+		merge_table(result, &workers[i].table);
+		free_table(&workers[i].table);
+	}
+
+	free(workers);
+	free(args);
+}
+
+/*
+ * Writes name of column to buffer. When the name is not known, then
+ * the number of column is used.
+ */
+void
+get_column_name(DataDesc *desc, int colno, char *buffer, int size)
+{
+	CRange	   *cr = &desc->cranges[colno];
+
+	if (desc->namesline && cr->name_offset != -1)
+		snprintf(buffer, size, "%.*s", cr->name_size, desc->namesline + cr->name_offset);
+	else
+		snprintf(buffer, size, "column %d", colno + 1);
+}
+
+/*
+ * Writes number rounded to scale digits after decimal point without
+ * useless zeros. Digits over precision of double are not displayed.
+ */
+void
+format_number(double d, int scale, char *buffer, int size)
+{
+	char	   *ptr;
+
+	if (d != 0.0 && isfinite(d))
+	{
+		int			maxscale = DBL_DIG - ((int) floor(log10(fabs(d))) + 1);
+
+		if (scale > maxscale)
+			scale = maxscale > 0 ? maxscale : 0;
+	}
+
+	snprintf(buffer, size, "%.*f", scale, d);
+
+	if (scale == 0)
+		return;
+
+	ptr = buffer + strlen(buffer) - 1;
+	while (*ptr == '0')
+		*ptr-- = '\0';
+
+	if (*ptr == '.')
+		*ptr = '\0';
+}
+
+/*
+ * Append row to row buckets. All fields are copied to one allocated
+ * string (starts by first field), like rows of query result.
+ */
+static RowBucketType *
+append_row(RowBucketType *rb, char **fields, int *sizes, int nfields)
+{
+	RowType	   *row;
+	char	   *ptr;
+	int			size = 0;
+	int			i;
+
+	if (rb->nrows >= 1000)
+	{
+		RowBucketType *new = smalloc(sizeof(RowBucketType));
+
+		new->allocated = true;
+		rb->next_bucket = new;
+		rb = new;
+	}
+
+	for (i = 0; i < nfields; i++)
+		size += sizes[i] + 1;
+
+	row = smalloc(offsetof(RowType, fields) + nfields * sizeof(char *));
+	row->nfields = nfields;
+
+	ptr = smalloc(size);
+
+	for (i = 0; i < nfields; i++)
+	{
+		row->fields[i] = ptr;
+
+		memcpy(ptr, fields[i], sizes[i]);
+		ptr[sizes[i]] = '\0';
+		ptr += sizes[i] + 1;
+	}
+
+	rb->rows[rb->nrows] = row;
+	rb->multilines[rb->nrows++] = false;
+
+	return rb;
+}
+
+/*
+ * Creates table of distinct values of column colno with number of rows,
+ * and with sum and average of numeric column aggcolno (when it is not -1).
+ * Rows hidden by filter are not aggregated. Returns false, when the table
+ * cannot be created. Error message is available by current_state->errstr.
+ */
+bool
+group_by_column(Options *opts, DataDesc *desc, int colno, int aggcolno, DataDesc *result)
+{
+	ColumnValues *cv = NULL;
+	ColumnType	coltypes[4];
+	RowBucketType rowbuckets;
+	RowBucketType *rb = &rowbuckets;
+	AggTable	table;
+	AggGroup  **groups;
+	char		name[256];
+	char		aggname[256];
+	char		header[2][300];
+	char		sum[64];
+	char		avg[64];
+	char	   *fields[4];
+	int			sizes[4];
+	int			nfields = aggcolno != -1 ? 4 : 2;
+	bool		is_integer = false;
+	int			scale = 0;
+	int			n = 0;
+	int			i;
+
+	if (desc->columns == 0 || !desc->headline_transl || desc->is_expanded_mode)
+	{
+		format_error("columns are not detected");
+		return false;
+	}
+
+	/* multilines should be detected before aggregation */
+	multilines_detection(opts, desc);
+
+	coltypes[0] = get_column_values(opts, desc, colno)->type;
+	if (coltypes[0] == COLUMN_TYPE_UNKNOWN)
+		coltypes[0] = COLUMN_TYPE_TEXT;
+
+	coltypes[1] = COLUMN_TYPE_INTEGER;
+
+	if (aggcolno != -1)
+	{
+		/* values are parsed before workers are started */
+		cv = get_column_values(opts, desc, aggcolno);
+
+		if (cv->type != COLUMN_TYPE_INTEGER &&
+			cv->type != COLUMN_TYPE_DECIMAL &&
+			cv->type != COLUMN_TYPE_SIZE)
+		{
+			format_error("column %d is not numeric", aggcolno + 1);
+			return false;
+		}
+
+		is_integer = cv->type != COLUMN_TYPE_DECIMAL;
+		if (!is_integer)
+			scale = cv->scale;
+
+		coltypes[2] = is_integer ? COLUMN_TYPE_INTEGER : COLUMN_TYPE_DECIMAL;
+		coltypes[3] = COLUMN_TYPE_DECIMAL;
+	}
+
+	agg_rows(desc, colno, cv, &table);
+
+	groups = smalloc((table.ngroups + 1) * sizeof(AggGroup *));
+
+	for (i = 0; i < table.nslots; i++)
+		if (table.slots[i].used)
+			groups[n++] = &table.slots[i];
+
+	qsort(groups, n, sizeof(AggGroup *), compare_groups);
+
+	memset(&rowbuckets, 0, sizeof(RowBucketType));
+
+	/* first row is header */
+	get_column_name(desc, colno, name, sizeof(name));
+	fields[0] = name;
+	fields[1] = "count";
+
+	if (aggcolno != -1)
+	{
+		get_column_name(desc, aggcolno, aggname, sizeof(aggname));
+
+		snprintf(header[0], sizeof(header[0]), "sum(%s)", aggname);
+		snprintf(header[1], sizeof(header[1]), "avg(%s)", aggname);
+
+		fields[2] = header[0];
+		fields[3] = header[1];
+	}
+
+	for (i = 0; i < nfields; i++)
+		sizes[i] = strlen(fields[i]);
+
+	rb = append_row(rb, fields, sizes, nfields);
+
+	for (i = 0; i < n; i++)
+	{
+		AggGroup   *g = groups[i];
+		char		count[32];
+
+		fields[0] = table.data + g->offset;
+		sizes[0] = g->size;
+
+		snprintf(count, sizeof(count), "%ld", g->count);
+		fields[1] = count;
+		sizes[1] = strlen(count);
+
+		if (aggcolno != -1)
+		{
+			/* aggregates of only null values are null */
+			if (g->nvalues > 0)
+			{
+				double		total = g->sum + g->sum_comp;
+
+				format_number(total, scale, sum, sizeof(sum));
+				format_number(total / g->nvalues, AGG_AVG_SCALE, avg, sizeof(avg));
+			}
+			else
+			{
+				sum[0] = '\0';
+				avg[0] = '\0';
+			}
+
+			fields[2] = sum;
+			sizes[2] = strlen(sum);
+			fields[3] = avg;
+			sizes[3] = strlen(avg);
+		}
+
+		rb = append_row(rb, fields, sizes, nfields);
+	}
+
+	free(groups);
+	free_table(&table);
+
+	format_rows(opts, result, &rowbuckets, coltypes, nfields);
+
+	if (!translate_headline(opts, result))
+	{
+		/* should not be, the table is formatted by pspg */
+		lb_free(result);
+		cs_free(result->colstore);
+		free(result->source_types);
+
+		format_error("cannot to detect columns of grouped rows");
+		return false;
+	}
+
+	return true;
+}
@@ -104,6 +104,16 @@ static struct option long_options[] =
 	{"no-sleep", no_argument, 0, 43},
 	{"querystream", no_argument, 0, 44},
 	{"menu-always", no_argument, 0, 45},
+	{"stats-file", required_argument, 0, 46},
+	{"compress-threshold", required_argument, 0, 47},
+	{"memory-limit", required_argument, 0, 48},
+	{"insert-batch-size", required_argument, 0, 49},
+	{"regex-search", no_argument, 0, 50},
+	{"incremental-search", no_argument, 0, 51},
+	{"querystream-history", required_argument, 0, 52},
+	{"stream-max-rows", required_argument, 0, 53},
+	{"stream-max-size", required_argument, 0, 54},
+	{"querystream-pipeline", no_argument, 0, 55},
 	{0, 0, 0, 0}
 };
 
@@ -304,8 +314,11 @@ readargs(char **argv,
 					fprintf(stdout, "  -F, --quit-if-one-screen\n");
 					fprintf(stdout, "                           quit if content is one screen\n");
 					fprintf(stdout, "  --clipboard-app=NUM      specify app used by copy to clipboard (1, 2, 3)\n");
+					fprintf(stdout, "  --compress-threshold=MB  compress data in memory over MB (0 disables)\n");
 					fprintf(stdout, "  --hold-stream=NUM        can reopen closed FIFO (0, 1, 2)\n");
+					fprintf(stdout, "  --insert-batch-size=NUM  rows per statement of multirow INSERT export\n");
 					fprintf(stdout, "  --interactive            force interactive mode\n");
+					fprintf(stdout, "  --memory-limit=MB        move data over MB to temporary file (0 is no limit)\n");
 					fprintf(stdout, "  --ignore_file_suffix     don't try to deduce format from file suffix\n");
 					fprintf(stdout, "  --ni                     not interactive mode (only for csv and query)\n");
 					fprintf(stdout, "  --no-watch-file          don't watch inotify event of file\n");
@@ -318,9 +331,13 @@ readargs(char **argv,
 					fprintf(stdout, "  --on-sigint-exit         exit on sigint(CTRL C or Escape)\n");
 					fprintf(stdout, "  --pgcli-fix              try to fix some pgcli related issues\n");
 					fprintf(stdout,  "  --querystream            read queries from stream forever\n");
+					fprintf(stdout, "  --querystream-history=N  number of stored results of query stream\n");
+					fprintf(stdout, "  --querystream-pipeline   execute queries from stream in pipeline mode\n");
 					fprintf(stdout, "  --quit-on-f3             exit on F3 like mc viewers\n");
 					fprintf(stdout, "  --rr=ROWNUM              rows reserved for specific purposes\n");
 					fprintf(stdout, "  --stream                 read input forever\n");
+					fprintf(stdout, "  --stream-max-rows=N      remove oldest rows of stream over N rows\n");
+					fprintf(stdout, "  --stream-max-size=MB     remove oldest rows of stream over MB\n");
 					fprintf(stdout, "  -X, --reprint-on-exit    preserve content after exit\n");
 					fprintf(stdout, "\nOutput format options:\n");
 					fprintf(stdout, "  -a, --ascii              force ascii\n");
@@ -338,6 +355,8 @@ readargs(char **argv,
 					fprintf(stdout, "                           don't highlight lines for searches\n");
 					fprintf(stdout, "  -i --ignore-case         ignore case in searches that do not contain uppercase\n");
 					fprintf(stdout, "  -I --IGNORE-CASE         ignore case in all searches\n");
+					fprintf(stdout, "  --incremental-search     search while the pattern is typed\n");
+					fprintf(stdout, "  --regex-search           search patterns are regular expressions\n");
 					fprintf(stdout, "\nInterface options:\n");
 					fprintf(stdout, "  -c, --freezecols=N       freeze N columns (0..9)\n");
 					fprintf(stdout, "  --less-status-bar        status bar like less pager\n");
@@ -368,6 +387,7 @@ readargs(char **argv,
 					fprintf(stdout, "  -W, --password           force password prompt\n");
 					fprintf(stdout, "\nDebug options:\n");
 					fprintf(stdout, "  --log=FILE               log debug info to file\n");
+					fprintf(stdout, "  --stats-file=FILE        periodically write performance counters to file\n");
 					fprintf(stdout, "  --wait=NUM               wait NUM seconds to allow attach from a debugger\n");
 					fprintf(stdout, "\n");
 					fprintf(stdout, "pspg shares lot of key commands with less pager or vi editor.\n");
@@ -650,6 +670,91 @@ readargs(char **argv,
 
 #endif
 
+			case 46:
+				opts->stats_pathname = sstrdup(optarg);
+				break;
+			case 47:
+				{
+					long	mb = strtol(optarg, NULL, 10);
+
+					if (mb < 0 || mb > 1024 * 1024)
+					{
+						format_error("compress threshold should be between 0 and 1048576");
+						return false;
+					}
+					opts->compress_threshold = mb;
+				}
+				break;
+			case 48:
+				{
+					long	mb = strtol(optarg, NULL, 10);
+
+					if (mb < 0 || mb > 1024 * 1024)
+					{
+						format_error("memory limit should be between 0 and 1048576");
+						return false;
+					}
+					opts->memory_limit = mb;
+				}
+				break;
+			case 49:
+				{
+					long	n = strtol(optarg, NULL, 10);
+
+					if (n < 1 || n > MAX_INSERT_BATCH_SIZE)
+					{
+						format_error("insert batch size should be between 1 and %d", MAX_INSERT_BATCH_SIZE);
+						return false;
+					}
+					opts->insert_batch_size = n;
+				}
+				break;
+			case 50:
+				opts->regex_search = true;
+				break;
+			case 51:
+				opts->incremental_search = true;
+				break;
+			case 52:
+				{
+					long	n = strtol(optarg, NULL, 10);
+
+					if (n < 1 || n > 1000)
+					{
+						format_error("query stream history should be between 1 and 1000");
+						return false;
+					}
+					opts->querystream_history = n;
+				}
+				break;
+			case 53:
+				{
+					long	n = strtol(optarg, NULL, 10);
+
+					if (n < 0 || n > 1000000000)
+					{
+						format_error("stream max rows should be between 0 and 1000000000");
+						return false;
+					}
+					opts->stream_max_rows = n;
+				}
+				break;
+			case 54:
+				{
+					long	mb = strtol(optarg, NULL, 10);
+
+					if (mb < 0 || mb > 1024 * 1024)
+					{
+						format_error("stream max size should be between 0 and 1048576");
+						return false;
+					}
+					opts->stream_max_size = mb;
+				}
+				break;
+			case 55:
+				opts->querystream_pipeline = true;
+				break;
+
 			default:
 				{
 					format_error("Try %s --help\n", argv[0]);
@@ -732,6 +837,12 @@ args_are_consistent(Options *opts, StateData *state)
 		return false;
 	}
 
+	if (opts->querystream_pipeline && !opts->querystream)
+	{
+		state->errstr = "option --querystream-pipeline requires option --querystream";
+		return false;
+	}
+
 	if (opts->csv_format && opts->tsv_format)
 	{
 		state->errstr = "option --csv and --tsv cannot be used together";
@@ -764,5 +875,20 @@ args_are_consistent(Options *opts, StateData *state)
 			opts->tsv_format = true;
 	}
 
+	if (opts->stream_max_rows || opts->stream_max_size)
+	{
+		if (!state->stream_mode)
+		{
+			state->errstr = "option --stream-max-rows or --stream-max-size requires option --stream";
+			return false;
+		}
+
+		if (opts->csv_format || opts->tsv_format || opts->querystream)
+		{
+			state->errstr = "option --stream-max-rows or --stream-max-size can be used only for tabular data";
+			return false;
+		}
+	}
+
 	return true;
 }
@@ -0,0 +1,1035 @@
+/*-------------------------------------------------------------------------
+ *
+ * arrow.c
+ *	  writer of Apache Arrow IPC file format
+ *
+ * Portions Copyright (c) 2017-2021 Pavel Stehule
+ *
+ * IDENTIFICATION
+ *	  src/arrow.c
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include <errno.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include "pspg.h"
+
+/*
+ * The file starts and ends by magic string. Between there are schema
+ * message, record batch messages and footer. The metadata are stored
+ * in flatbuffers format. Only few tables are used, so there is simple
+ * own flatbuffers builder (instead of dependency on flatcc).
+ */
+#define ARROW_MAGIC				"ARROW1"
+
+/* rows of one record batch, and max size of strings of record batch */
+#define ARROW_BATCH_ROWS		65536
+#define ARROW_BATCH_BYTES		(64 * 1024 * 1024)
+
+#define ARROW_METADATA_V5		4
+
+/* ids of MessageHeader union */
+#define ARROW_HEADER_SCHEMA			1
+#define ARROW_HEADER_RECORD_BATCH	3
+
+/* ids of Type union */
+#define ARROW_TYPE_INT			2
+#define ARROW_TYPE_FLOAT		3
+#define ARROW_TYPE_UTF8			5
+#define ARROW_TYPE_BOOL			6
+#define ARROW_TYPE_DATE			8
+#define ARROW_TYPE_TIMESTAMP	10
+#define ARROW_TYPE_DURATION		18
+
+#define ARROW_PRECISION_DOUBLE	2
+#define ARROW_DATEUNIT_DAY		0
+#define ARROW_TIMEUNIT_MICRO	2
+
+#define FB_MAX_FIELDS			8
+
+#define NUMBER_MAX_SIZE			100
+
+typedef struct
+{
+	char	   *data;
+	int			len;
+	int			alloc;
+} ArrowBuffer;
+
+typedef struct
+{
+	char	   *name;
+	ColumnType	type;
+	bool		utc;				/* timestamps are in UTC */
+	ArrowBuffer	validity;			/* bitmap of not null values */
+	ArrowBuffer	values;				/* values or offsets of strings */
+	ArrowBuffer	data;				/* content of strings */
+	int			null_count;
+	bool		has_value;			/* value of current row was added */
+} ArrowColumn;
+
+/*
+ * Block describes position of record batch in file
+ */
+typedef struct
+{
+	int64_t		offset;
+	int32_t		metadata_length;
+	int32_t		padding;
+	int64_t		body_length;
+} ArrowBlock;
+
+struct ArrowWriter
+{
+	FILE	   *fp;
+	long long	filepos;			/* number of written bytes */
+	int			columns;
+	ArrowColumn *cols;
+	int			nrows;				/* rows of current record batch */
+	bool		schema_written;
+	ArrowBlock *blocks;
+	int			nblocks;
+	int			maxblocks;
+};
+
+/*
+ * Description of field of flatbuffers table. Fields with
+ * zero size are not stored. Offsets are set later by fb_set_offset.
+ */
+typedef struct
+{
+	int			size;
+	int64_t		value;
+	int			pos;				/* position of stored field */
+} FBField;
+
+static void
+buf_reserve(ArrowBuffer *buf, int size)
+{
+	if (buf->len + size > buf->alloc)
+	{
+		int		alloc = buf->alloc > 0 ? buf->alloc : 1024;
+
+		while (buf->len + size > alloc)
+			alloc *= 2;
+
+		buf->data = srealloc(buf->data, alloc);
+		buf->alloc = alloc;
+	}
+}
+
+/*
+ * Append data (or zeroes when data is NULL) and returns start of data
+ */
+static int
+buf_append(ArrowBuffer *buf, const void *data, int size)
+{
+	int		pos = buf->len;
+
+	buf_reserve(buf, size);
+
+	if (data)
+		memcpy(buf->data + pos, data, size);
+	else
+		memset(buf->data + pos, 0, size);
+
+	buf->len += size;
+
+	return pos;
+}
+
+/*
+ * Append zeroes until (len + offset) is multiple of align
+ */
+static void
+buf_pad(ArrowBuffer *buf, int align, int offset)
+{
+	int		padding = (align - (buf->len + offset) % align) % align;
+
+	if (padding > 0)
+		buf_append(buf, NULL, padding);
+}
+
+static void
+buf_free(ArrowBuffer *buf)
+{
+	free(buf->data);
+
+	buf->data = NULL;
+	buf->len = 0;
+	buf->alloc = 0;
+}
+
+/*
+ * Flatbuffers are little endian every time
+ */
+static void
+fb_write_scalar(ArrowBuffer *fb, int pos, int size, int64_t value)
+{
+	int		i;
+
+	for (i = 0; i < size; i++)
+		fb->data[pos + i] = (char) ((uint64_t) value >> (i * 8));
+}
+
+/*
+ * Store table with vtable placed before table. Fields are aligned
+ * to their size. Returns position of table.
+ */
+static int
+fb_table(ArrowBuffer *fb, FBField *fields, int nfields)
+{
+	int			offsets[FB_MAX_FIELDS];
+	int			table_size = 4;
+	int			vtable_size = (2 + nfields) * 2;
+	int			vtable_pos;
+	int			table_pos;
+	int			i;
+
+	for (i = 0; i < nfields; i++)
+	{
+		if (fields[i].size > 0)
+		{
+			table_size = (table_size + fields[i].size - 1) / fields[i].size * fields[i].size;
+			offsets[i] = table_size;
+			table_size += fields[i].size;
+		}
+		else
+			offsets[i] = 0;
+	}
+
+	buf_pad(fb, 2, 0);
+	vtable_pos = buf_append(fb, NULL, vtable_size);
+
+	fb_write_scalar(fb, vtable_pos, 2, vtable_size);
+	fb_write_scalar(fb, vtable_pos + 2, 2, table_size);
+
+	for (i = 0; i < nfields; i++)
+		fb_write_scalar(fb, vtable_pos + 4 + i * 2, 2, offsets[i]);
+
+	/* table start is aligned to 8, so fields are aligned too */
+	buf_pad(fb, 8, 0);
+	table_pos = buf_append(fb, NULL, table_size);
+
+	/* signed offset from table to vtable */
+	fb_write_scalar(fb, table_pos, 4, table_pos - vtable_pos);
+
+	for (i = 0; i < nfields; i++)
+	{
+		if (fields[i].size > 0)
+		{
+			fields[i].pos = table_pos + offsets[i];
+			fb_write_scalar(fb, fields[i].pos, fields[i].size, fields[i].value);
+		}
+		else
+			fields[i].pos = -1;
+	}
+
+	return table_pos;
+}
+
+/*
+ * Store vector (elements are aligned to 8). When data is NULL,
+ * then the elements are zeroed (offsets can be set later).
+ */
+static int
+fb_vector(ArrowBuffer *fb, int count, int elemsize, const void *data)
+{
+	int		pos;
+
+	buf_pad(fb, 8, 4);
+	pos = buf_append(fb, NULL, 4);
+	fb_write_scalar(fb, pos, 4, count);
+
+	buf_append(fb, data, count * elemsize);
+
+	return pos;
+}
+
+static int
+fb_string(ArrowBuffer *fb, const char *str)
+{
+	int		size = strlen(str);
+	int		pos;
+
+	pos = fb_vector(fb, size, 1, str);
+	buf_append(fb, NULL, 1);
+
+	return pos;
+}
+
+/*
+ * Set offset stored on pos to target. Flatbuffers offsets are
+ * unsigned, so target should be after pos.
+ */
+static void
+fb_set_offset(ArrowBuffer *fb, int pos, int target)
+{
+	fb_write_scalar(fb, pos, 4, target - pos);
+}
+
+static bool
+is_little_endian(void)
+{
+	uint16_t	value = 1;
+
+	return *((char *) &value) == 1;
+}
+
+/*
+ * Store type table for column's type. Returns position of table,
+ * and id of type in union.
+ */
+static int
+fb_column_type(ArrowBuffer *fb, ColumnType type, bool utc, int *type_id)
+{
+	FBField		fields[2];
+	int			pos;
+
+	memset(fields, 0, sizeof(fields));
+
+	switch (type)
+	{
+		case COLUMN_TYPE_INTEGER:
+			/* bitWidth, is_signed */
+			fields[0].size = 4;
+			fields[0].value = 64;
+			fields[1].size = 1;
+			fields[1].value = 1;
+			*type_id = ARROW_TYPE_INT;
+			return fb_table(fb, fields, 2);
+
+		case COLUMN_TYPE_DECIMAL:
+		case COLUMN_TYPE_SIZE:
+			/* precision */
+			fields[0].size = 2;
+			fields[0].value = ARROW_PRECISION_DOUBLE;
+			*type_id = ARROW_TYPE_FLOAT;
+			return fb_table(fb, fields, 1);
+
+		case COLUMN_TYPE_BOOLEAN:
+			*type_id = ARROW_TYPE_BOOL;
+			return fb_table(fb, fields, 0);
+
+		case COLUMN_TYPE_DATE:
+			/* unit */
+			fields[0].size = 2;
+			fields[0].value = ARROW_DATEUNIT_DAY;
+			*type_id = ARROW_TYPE_DATE;
+			return fb_table(fb, fields, 1);
+
+		case COLUMN_TYPE_TIMESTAMP:
+			/* unit, timezone (values with offset are in UTC) */
+			fields[0].size = 2;
+			fields[0].value = ARROW_TIMEUNIT_MICRO;
+			*type_id = ARROW_TYPE_TIMESTAMP;
+
+			if (!utc)
+				return fb_table(fb, fields, 1);
+
+			fields[1].size = 4;
+			pos = fb_table(fb, fields, 2);
+			fb_set_offset(fb, fields[1].pos, fb_string(fb, "UTC"));
+
+			return pos;
+
+		case COLUMN_TYPE_INTERVAL:
+			/* unit */
+			fields[0].size = 2;
+			fields[0].value = ARROW_TIMEUNIT_MICRO;
+			*type_id = ARROW_TYPE_DURATION;
+			return fb_table(fb, fields, 1);
+
+		default:
+			*type_id = ARROW_TYPE_UTF8;
+			return fb_table(fb, fields, 0);
+	}
+}
+
+/*
+ * Store Schema table
+ */
+static int
+fb_schema(ArrowWriter *aw, ArrowBuffer *fb)
+{
+	FBField		schema[2];
+	int			schema_pos;
+	int			vector_pos;
+	int			i;
+
+	memset(schema, 0, sizeof(schema));
+
+	/* endianness, fields */
+	schema[0].size = 2;
+	schema[0].value = is_little_endian() ? 0 : 1;
+	schema[1].size = 4;
+
+	schema_pos = fb_table(fb, schema, 2);
+
+	vector_pos = fb_vector(fb, aw->columns, 4, NULL);
+	fb_set_offset(fb, schema[1].pos, vector_pos);
+
+	for (i = 0; i < aw->columns; i++)
+	{
+		FBField		field[6];
+		int			field_pos;
+		int			type_pos;
+		int			type_id;
+		int			pos;
+		char		name[20];
+
+		memset(field, 0, sizeof(field));
+
+		/* name, nullable, type_type, type, dictionary, children */
+		field[0].size = 4;
+		field[1].size = 1;
+		field[1].value = 1;
+		field[2].size = 1;
+		field[3].size = 4;
+		field[5].size = 4;
+
+		field_pos = fb_table(fb, field, 6);
+		fb_set_offset(fb, vector_pos + 4 + i * 4, field_pos);
+
+		if (!aw->cols[i].name)
+			snprintf(name, sizeof(name), "column%d", i + 1);
+
+		pos = fb_string(fb, aw->cols[i].name ? aw->cols[i].name : name);
+		fb_set_offset(fb, field[0].pos, pos);
+
+		type_pos = fb_column_type(fb, aw->cols[i].type, aw->cols[i].utc, &type_id);
+		fb_write_scalar(fb, field[2].pos, 1, type_id);
+		fb_set_offset(fb, field[3].pos, type_pos);
+
+		pos = fb_vector(fb, 0, 4, NULL);
+		fb_set_offset(fb, field[5].pos, pos);
+	}
+
+	return schema_pos;
+}
+
+/*
+ * Store Message table with header and returns position of header's field
+ */
+static int
+fb_message(ArrowBuffer *fb, int header_type, int64_t body_length)
+{
+	FBField		message[4];
+
+	memset(message, 0, sizeof(message));
+
+	/* space for root offset */
+	buf_append(fb, NULL, 4);
+
+	/* version, header_type, header, bodyLength */
+	message[0].size = 2;
+	message[0].value = ARROW_METADATA_V5;
+	message[1].size = 1;
+	message[1].value = header_type;
+	message[2].size = 4;
+	message[3].size = 8;
+	message[3].value = body_length;
+
+	fb_set_offset(fb, 0, fb_table(fb, message, 4));
+
+	return message[2].pos;
+}
+
+static bool
+write_data(ArrowWriter *aw, const void *data, int size)
+{
+	if (size > 0 && fwrite(data, size, 1, aw->fp) != 1)
+	{
+		format_error("%s", strerror(errno));
+		log_row("Cannot write (%s)", current_state->errstr);
+
+		return false;
+	}
+
+	aw->filepos += size;
+
+	return true;
+}
+
+/*
+ * Write data padded to 8 bytes
+ */
+static bool
+write_padded(ArrowWriter *aw, const void *data, int size)
+{
+	static const char zeroes[8];
+
+	if (!write_data(aw, data, size))
+		return false;
+
+	return write_data(aw, zeroes, (8 - size % 8) % 8);
+}
+
+/*
+ * Write encapsulated message - continuation marker, size of metadata
+ * and metadata. Returns size of written data.
+ */
+static int
+write_message(ArrowWriter *aw, ArrowBuffer *fb)
+{
+	char		prefix[8];
+
+	buf_pad(fb, 8, 0);
+
+	memset(prefix, 0xff, 4);
+	prefix[4] = fb->len & 0xff;
+	prefix[5] = (fb->len >> 8) & 0xff;
+	prefix[6] = (fb->len >> 16) & 0xff;
+	prefix[7] = (fb->len >> 24) & 0xff;
+
+	if (!write_data(aw, prefix, 8) ||
+		!write_data(aw, fb->data, fb->len))
+		return -1;
+
+	return 8 + fb->len;
+}
+
+static bool
+write_schema(ArrowWriter *aw)
+{
+	ArrowBuffer fb;
+	char		magic[8];
+	bool		result;
+
+	memset(&fb, 0, sizeof(fb));
+
+	memset(magic, 0, sizeof(magic));
+	memcpy(magic, ARROW_MAGIC, strlen(ARROW_MAGIC));
+
+	if (!write_data(aw, magic, sizeof(magic)))
+		return false;
+
+	fb_set_offset(&fb,
+				  fb_message(&fb, ARROW_HEADER_SCHEMA, 0),
+				  fb_schema(aw, &fb));
+
+	result = write_message(aw, &fb) != -1;
+
+	buf_free(&fb);
+
+	aw->schema_written = true;
+
+	return result;
+}
+
+/*
+ * Returns list of buffers of column (validity, values, data). Only
+ * strings has data buffer.
+ */
+static int
+column_buffers(ArrowColumn *col, ArrowBuffer **buffers)
+{
+	buffers[0] = &col->validity;
+	buffers[1] = &col->values;
+	buffers[2] = &col->data;
+
+	return col->type == COLUMN_TYPE_TEXT || col->type == COLUMN_TYPE_UNKNOWN ? 3 : 2;
+}
+
+/*
+ * Write collected rows as record batch
+ */
+static bool
+write_record_batch(ArrowWriter *aw)
+{
+	FBField		batch[3];
+	ArrowBuffer fb;
+	ArrowBlock *block;
+	int64_t	   *nodes;
+	int64_t	   *bufs;
+	int64_t		body_length = 0;
+	int			nbufs = 0;
+	int			metadata_length;
+	int			pos;
+	int			i, j;
+
+	if (!aw->schema_written && !write_schema(aw))
+		return false;
+
+	nodes = smalloc(aw->columns * 2 * sizeof(int64_t));
+	bufs = smalloc(aw->columns * 3 * 2 * sizeof(int64_t));
+
+	for (i = 0; i < aw->columns; i++)
+	{
+		ArrowColumn *col = &aw->cols[i];
+		ArrowBuffer *buffers[3];
+		int			n = column_buffers(col, buffers);
+
+		/* FieldNode is pair of length and null_count */
+		nodes[i * 2] = aw->nrows;
+		nodes[i * 2 + 1] = col->null_count;
+
+		/* Buffer is pair of offset and length */
+		for (j = 0; j < n; j++)
+		{
+			bufs[nbufs * 2] = body_length;
+			bufs[nbufs * 2 + 1] = buffers[j]->len;
+			body_length += (buffers[j]->len + 7) / 8 * 8;
+			nbufs += 1;
+		}
+	}
+
+	if (!is_little_endian())
+	{
+		/* vectors of structs are stored like flatbuffers scalars */
+		char	   *ptr = (char *) nodes;
+
+		for (i = 0; i < aw->columns * 2; i++)
+		{
+			int64_t		value = nodes[i];
+
+			for (j = 0; j < 8; j++)
+				*ptr++ = (char) ((uint64_t) value >> (j * 8));
+		}
+
+		ptr = (char *) bufs;
+		for (i = 0; i < nbufs * 2; i++)
+		{
+			int64_t		value = bufs[i];
+
+			for (j = 0; j < 8; j++)
+				*ptr++ = (char) ((uint64_t) value >> (j * 8));
+		}
+	}
+
+	memset(&fb, 0, sizeof(fb));
+	memset(batch, 0, sizeof(batch));
+
+	pos = fb_message(&fb, ARROW_HEADER_RECORD_BATCH, body_length);
+
+	/* length, nodes, buffers */
+	batch[0].size = 8;
+	batch[0].value = aw->nrows;
+	batch[1].size = 4;
+	batch[2].size = 4;
+
+	fb_set_offset(&fb, pos, fb_table(&fb, batch, 3));
+	fb_set_offset(&fb, batch[1].pos, fb_vector(&fb, aw->columns, 16, nodes));
+	fb_set_offset(&fb, batch[2].pos, fb_vector(&fb, nbufs, 16, bufs));
+
+	free(nodes);
+	free(bufs);
+
+	if (aw->nblocks == aw->maxblocks)
+	{
+		aw->maxblocks = aw->maxblocks > 0 ? aw->maxblocks * 2 : 16;
+		aw->blocks = srealloc(aw->blocks, aw->maxblocks * sizeof(ArrowBlock));
+	}
+
+	block = &aw->blocks[aw->nblocks++];
+	block->offset = aw->filepos;
+	block->padding = 0;
+	block->body_length = body_length;
+
+	metadata_length = write_message(aw, &fb);
+	buf_free(&fb);
+
+	if (metadata_length == -1)
+		return false;
+
+	block->metadata_length = metadata_length;
+
+	/* body */
+	for (i = 0; i < aw->columns; i++)
+	{
+		ArrowColumn *col = &aw->cols[i];
+		ArrowBuffer *buffers[3];
+		int			n = column_buffers(col, buffers);
+
+		for (j = 0; j < n; j++)
+		{
+			if (!write_padded(aw, buffers[j]->data, buffers[j]->len))
+				return false;
+
+			buffers[j]->len = 0;
+		}
+
+		col->null_count = 0;
+	}
+
+	aw->nrows = 0;
+
+	return true;
+}
+
+/*
+ * Set n-th bit of bitmap. The bitmap is extended when it is necessary.
+ */
+static void
+bitmap_append(ArrowBuffer *bitmap, int n, bool value)
+{
+	if (n % 8 == 0)
+		buf_append(bitmap, NULL, 1);
+
+	if (value)
+		bitmap->data[n / 8] |= 1 << (n % 8);
+}
+
+static void
+append_null(ArrowWriter *aw, ArrowColumn *col)
+{
+	bitmap_append(&col->validity, aw->nrows, false);
+
+	switch (col->type)
+	{
+		case COLUMN_TYPE_BOOLEAN:
+			bitmap_append(&col->values, aw->nrows, false);
+			break;
+
+		case COLUMN_TYPE_DATE:
+			buf_append(&col->values, NULL, sizeof(int32_t));
+			break;
+
+		case COLUMN_TYPE_TEXT:
+		case COLUMN_TYPE_UNKNOWN:
+			{
+				int32_t		offset = col->data.len;
+
+				buf_append(&col->values, &offset, sizeof(int32_t));
+				break;
+			}
+
+		default:
+			buf_append(&col->values, NULL, sizeof(int64_t));
+	}
+
+	col->null_count += 1;
+}
+
+/*
+ * Float columns can holds special values NaN and infinity
+ */
+static bool
+parse_special_float(const char *str, int size, double *d)
+{
+	const char *ptr = str;
+	int			sign = 1;
+
+	if (size == 3 && strncasecmp(str, "NaN", 3) == 0)
+	{
+		*d = NAN;
+		return true;
+	}
+
+	if (size > 0 && (*ptr == '-' || *ptr == '+'))
+	{
+		sign = *ptr == '-' ? -1 : 1;
+		ptr++;
+		size--;
+	}
+
+	if ((size == 3 && strncasecmp(ptr, "inf", 3) == 0) ||
+		(size == 8 && strncasecmp(ptr, "infinity", 8) == 0))
+	{
+		*d = sign * HUGE_VAL;
+		return true;
+	}
+
+	return false;
+}
+
+/*
+ * Create writer. The types of columns should be known before first
+ * row, because the type of column cannot be changed in Arrow file.
+ */
+ArrowWriter *
+arrow_writer_create(FILE *fp, int columns, ColumnType *types, bool *utc)
+{
+	ArrowWriter *aw;
+	int			i;
+
+	aw = smalloc(sizeof(ArrowWriter));
+
+	aw->fp = fp;
+	aw->columns = columns;
+	aw->cols = smalloc(columns * sizeof(ArrowColumn));
+
+	for (i = 0; i < columns; i++)
+	{
+		aw->cols[i].type = types[i];
+		aw->cols[i].utc = utc[i];
+
+		/* first offset of strings */
+		if (types[i] == COLUMN_TYPE_TEXT || types[i] == COLUMN_TYPE_UNKNOWN)
+			buf_append(&aw->cols[i].values, NULL, sizeof(int32_t));
+	}
+
+	return aw;
+}
+
+void
+arrow_set_column_name(ArrowWriter *aw, int colno, const char *name, int size)
+{
+	if (colno >= aw->columns)
+		return;
+
+	free(aw->cols[colno].name);
+	aw->cols[colno].name = sstrndup(name, size);
+}
+
+/*
+ * Add value of field of current row. Values that cannot be converted
+ * to column's type are stored as NULL.
+ */
+void
+arrow_add_value(ArrowWriter *aw, int colno, const char *str, int size, bool isnull)
+{
+	ArrowColumn *col;
+	ColumnType	t = COLUMN_TYPE_TEXT;
+	double		d = 0.0;
+
+	if (colno >= aw->columns)
+		return;
+
+	col = &aw->cols[colno];
+	if (col->has_value)
+		return;
+
+	col->has_value = true;
+
+	if (isnull)
+	{
+		append_null(aw, col);
+		return;
+	}
+
+	if (col->type == COLUMN_TYPE_TEXT || col->type == COLUMN_TYPE_UNKNOWN)
+	{
+		int32_t		offset;
+
+		buf_append(&col->data, str, size);
+
+		offset = col->data.len;
+		buf_append(&col->values, &offset, sizeof(int32_t));
+		bitmap_append(&col->validity, aw->nrows, true);
+
+		return;
+	}
+
+	if (size > 0)
+		t = parse_typed_value(str, size, &d);
+
+	switch (col->type)
+	{
+		case COLUMN_TYPE_INTEGER:
+			if (t == COLUMN_TYPE_INTEGER && size <= NUMBER_MAX_SIZE)
+			{
+				char		buffer[NUMBER_MAX_SIZE + 1];
+				int64_t		value;
+
+				/* double has not enough precision for bigint */
+				memcpy(buffer, str, size);
+				buffer[size] = '\0';
+				value = strtoll(buffer, NULL, 10);
+
+				buf_append(&col->values, &value, sizeof(int64_t));
+			}
+			else
+			{
+				append_null(aw, col);
+				return;
+			}
+			break;
+
+		case COLUMN_TYPE_DECIMAL:
+		case COLUMN_TYPE_SIZE:
+			if ((t >= COLUMN_TYPE_INTEGER && t <= COLUMN_TYPE_SIZE) ||
+				parse_special_float(str, size, &d))
+				buf_append(&col->values, &d, sizeof(double));
+			else
+			{
+				append_null(aw, col);
+				return;
+			}
+			break;
+
+		case COLUMN_TYPE_BOOLEAN:
+			if (t == COLUMN_TYPE_BOOLEAN)
+				bitmap_append(&col->values, aw->nrows, d != 0.0);
+			else
+			{
+				append_null(aw, col);
+				return;
+			}
+			break;
+
+		case COLUMN_TYPE_DATE:
+			if (t == COLUMN_TYPE_DATE || t == COLUMN_TYPE_TIMESTAMP)
+			{
+				int32_t		days = (int32_t) floor(d / 86400.0);
+
+				buf_append(&col->values, &days, sizeof(int32_t));
+			}
+			else
+			{
+				append_null(aw, col);
+				return;
+			}
+			break;
+
+		case COLUMN_TYPE_TIMESTAMP:
+		case COLUMN_TYPE_INTERVAL:
+			if (t == col->type ||
+				(col->type == COLUMN_TYPE_TIMESTAMP && t == COLUMN_TYPE_DATE))
+			{
+				int64_t		usecs = llround(d * 1000000.0);
+
+				buf_append(&col->values, &usecs, sizeof(int64_t));
+			}
+			else
+			{
+				append_null(aw, col);
+				return;
+			}
+			break;
+
+		default:
+			break;
+	}
+
+	bitmap_append(&col->validity, aw->nrows, true);
+}
+
+/*
+ * Close current row. Missing values are NULL. When the record batch
+ * is full, then it is written.
+ */
+bool
+arrow_end_row(ArrowWriter *aw)
+{
+	int		i;
+	int		bytes = 0;
+
+	for (i = 0; i < aw->columns; i++)
+	{
+		ArrowColumn *col = &aw->cols[i];
+
+		if (!col->has_value)
+			append_null(aw, col);
+
+		col->has_value = false;
+
+		if (col->data.len > bytes)
+			bytes = col->data.len;
+	}
+
+	aw->nrows += 1;
+
+	if (aw->nrows >= ARROW_BATCH_ROWS || bytes >= ARROW_BATCH_BYTES)
+	{
+		if (!write_record_batch(aw))
+			return false;
+
+		/* offsets of strings of new batch starts again from zero */
+		for (i = 0; i < aw->columns; i++)
+		{
+			ArrowColumn *col = &aw->cols[i];
+
+			if (col->type == COLUMN_TYPE_TEXT || col->type == COLUMN_TYPE_UNKNOWN)
+				buf_append(&col->values, NULL, sizeof(int32_t));
+		}
+	}
+
+	return true;
+}
+
+/*
+ * Write last record batch and footer
+ */
+bool
+arrow_writer_finish(ArrowWriter *aw)
+{
+	FBField		footer[4];
+	ArrowBuffer fb;
+	int			footer_length;
+	bool		result;
+	int			i;
+
+	if (aw->nrows > 0)
+	{
+		if (!write_record_batch(aw))
+			return false;
+	}
+	else if (!aw->schema_written)
+	{
+		if (!write_schema(aw))
+			return false;
+	}
+
+	if (!is_little_endian())
+	{
+		for (i = 0; i < aw->nblocks; i++)
+		{
+			ArrowBlock	block = aw->blocks[i];
+			char	   *ptr = (char *) &aw->blocks[i];
+			int			j;
+
+			for (j = 0; j < 8; j++)
+				ptr[j] = (char) ((uint64_t) block.offset >> (j * 8));
+			for (j = 0; j < 4; j++)
+				ptr[8 + j] = (char) ((uint32_t) block.metadata_length >> (j * 8));
+			for (j = 0; j < 8; j++)
+				ptr[16 + j] = (char) ((uint64_t) block.body_length >> (j * 8));
+		}
+	}
+
+	memset(&fb, 0, sizeof(fb));
+	memset(footer, 0, sizeof(footer));
+
+	/* space for root offset */
+	buf_append(&fb, NULL, 4);
+
+	/* version, schema, dictionaries, recordBatches */
+	footer[0].size = 2;
+	footer[0].value = ARROW_METADATA_V5;
+	footer[1].size = 4;
+	footer[2].size = 4;
+	footer[3].size = 4;
+
+	fb_set_offset(&fb, 0, fb_table(&fb, footer, 4));
+	fb_set_offset(&fb, footer[1].pos, fb_schema(aw, &fb));
+	fb_set_offset(&fb, footer[2].pos, fb_vector(&fb, 0, sizeof(ArrowBlock), NULL));
+	fb_set_offset(&fb, footer[3].pos,
+				  fb_vector(&fb, aw->nblocks, sizeof(ArrowBlock), aw->blocks));
+
+	footer_length = fb.len;
+
+	/* footer length (little endian) and magic */
+	buf_append(&fb, NULL, 4);
+	fb_write_scalar(&fb, footer_length, 4, footer_length);
+	buf_append(&fb, ARROW_MAGIC, strlen(ARROW_MAGIC));
+
+	result = write_data(aw, fb.data, fb.len);
+
+	buf_free(&fb);
+
+	return result;
+}
+
+void
+arrow_writer_free(ArrowWriter *aw)
+{
+	int		i;
+
+	for (i = 0; i < aw->columns; i++)
+	{
+		free(aw->cols[i].name);
+		buf_free(&aw->cols[i].validity);
+		buf_free(&aw->cols[i].values);
+		buf_free(&aw->cols[i].data);
+	}
+
+	free(aw->cols);
+	free(aw->blocks);
+	free(aw);
+}
@@ -0,0 +1,260 @@
+/*-------------------------------------------------------------------------
+ *
+ * colstore.c
+ *	  store of not formatted values by columns
+ *
+ * Portions Copyright (c) 2017-2021 Pavel Stehule
+ *
+ * IDENTIFICATION
+ *	  src/colstore.c
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "pspg.h"
+
+#define CS_DATA_INIT_SIZE		(4 * 1024)
+#define CS_ROWS_INIT			1024
+
+ColumnStore *
+cs_create(int ncolumns)
+{
+	ColumnStore *cs = smalloc2(sizeof(ColumnStore), "create column store");
+
+	cs->ncolumns = ncolumns;
+	cs->columns = smalloc2(ncolumns * sizeof(ColumnData), "create column store");
+
+	return cs;
+}
+
+/*
+ * Ensure space for next row
+ */
+static void
+cs_grow_rows(ColumnStore *cs)
+{
+	int		newsize;
+	int		i;
+
+	newsize = cs->allocated_rows > 0 ? cs->allocated_rows * 2 : CS_ROWS_INIT;
+
+	if (cs->linenos)
+	{
+		cs->linenos = realloc(cs->linenos, newsize * sizeof(int));
+		if (!cs->linenos)
+			leave("out of memory");
+	}
+
+	for (i = 0; i < cs->ncolumns; i++)
+	{
+		ColumnData *cd = &cs->columns[i];
+
+		cd->offsets = realloc(cd->offsets, newsize * sizeof(uint32_t));
+		if (!cd->offsets)
+			leave("out of memory");
+
+		if (cd->nulls)
+		{
+			cd->nulls = realloc(cd->nulls, (newsize + 7) / 8);
+			if (!cd->nulls)
+				leave("out of memory");
+
+			memset(cd->nulls + (cs->allocated_rows + 7) / 8, 0,
+				   (newsize + 7) / 8 - (cs->allocated_rows + 7) / 8);
+		}
+	}
+
+	cs->allocated_rows = newsize;
+}
+
+/*
+ * Copy value to blob of column
+ */
+static void
+cs_append_value(ColumnStore *cs, ColumnData *cd, const char *str)
+{
+	size_t		size;
+
+	cd->offsets[cs->nrows] = cd->size;
+
+	if (!str)
+	{
+		if (!cd->nulls)
+			cd->nulls = smalloc2((cs->allocated_rows + 7) / 8, "append value to column store");
+
+		cd->nulls[cs->nrows / 8] |= 1 << (cs->nrows % 8);
+
+		str = "";
+	}
+
+	size = strlen(str) + 1;
+
+	if ((size_t) cd->size + size > UINT32_MAX)
+		leave("too long data in column store");
+
+	if (cd->size + size > cd->allocated)
+	{
+		size_t		newsize = cd->allocated > 0 ? cd->allocated : CS_DATA_INIT_SIZE;
+
+		while (newsize < cd->size + size)
+			newsize *= 2;
+
+		if (newsize > UINT32_MAX)
+			newsize = UINT32_MAX;
+
+		cd->data = realloc(cd->data, newsize);
+		if (!cd->data)
+			leave("out of memory");
+
+		cd->allocated = newsize;
+	}
+
+	memcpy(cd->data + cd->size, str, size);
+	cd->size += size;
+}
+
+/*
+ * Append visible fields of row. The row starts on formatted line
+ * lineno. The rows should be appended in order of lines.
+ */
+void
+cs_append_row(ColumnStore *cs, RowType *row, int *columns_map, int lineno)
+{
+	int		i;
+
+	if (cs->nrows == cs->allocated_rows)
+		cs_grow_rows(cs);
+
+	for (i = 0; i < cs->ncolumns; i++)
+	{
+		int		colno = columns_map ? columns_map[i] : i;
+
+		cs_append_value(cs, &cs->columns[i],
+						colno < row->nfields ? row->fields[colno] : NULL);
+	}
+
+	/*
+	 * Usually rows are on following lines, and then line numbers
+	 * are not stored (multiline rows or skipped rows break it).
+	 */
+	if (cs->nrows == 0)
+		cs->first_lineno = lineno;
+	else if (!cs->linenos && lineno != cs->first_lineno + cs->nrows)
+	{
+		cs->linenos = smalloc2(cs->allocated_rows * sizeof(int), "append row to column store");
+
+		for (i = 0; i < cs->nrows; i++)
+			cs->linenos[i] = cs->first_lineno + i;
+	}
+
+	if (cs->linenos)
+		cs->linenos[cs->nrows] = lineno;
+
+	cs->nrows += 1;
+}
+
+/*
+ * All rows are stored, unused memory can be released. New rows
+ * cannot be appended after.
+ */
+void
+cs_freeze(ColumnStore *cs)
+{
+	int		i;
+
+	for (i = 0; i < cs->ncolumns; i++)
+	{
+		ColumnData *cd = &cs->columns[i];
+		char	   *data;
+		uint32_t   *offsets;
+
+		if (cd->size < cd->allocated && (data = realloc(cd->data, cd->size)))
+		{
+			cd->data = data;
+			cd->allocated = cd->size;
+		}
+
+		if (cs->nrows > 0 && cs->nrows < cs->allocated_rows &&
+			(offsets = realloc(cd->offsets, cs->nrows * sizeof(uint32_t))))
+			cd->offsets = offsets;
+	}
+}
+
+/*
+ * Returns row that starts on line lineno, or -1, when there
+ * is not any row (line is border or continuation of multiline row).
+ */
+int
+cs_find_row(ColumnStore *cs, int lineno)
+{
+	int		low = 0;
+	int		high = cs->nrows - 1;
+
+	if (!cs->linenos)
+		return lineno >= cs->first_lineno && lineno - cs->first_lineno < cs->nrows ?
+				lineno - cs->first_lineno : -1;
+
+	while (low <= high)
+	{
+		int		mid = (low + high) / 2;
+
+		if (cs->linenos[mid] == lineno)
+			return mid;
+		else if (cs->linenos[mid] < lineno)
+			low = mid + 1;
+		else
+			high = mid - 1;
+	}
+
+	return -1;
+}
+
+/*
+ * Returns value or NULL, when the value is missing.
+ */
+const char *
+cs_get_value(ColumnStore *cs, int rowno, int colno, int *size)
+{
+	ColumnData *cd;
+
+	if (rowno < 0 || rowno >= cs->nrows || colno < 0 || colno >= cs->ncolumns)
+		return NULL;
+
+	cd = &cs->columns[colno];
+
+	if (cd->nulls && (cd->nulls[rowno / 8] & (1 << (rowno % 8))))
+		return NULL;
+
+	if (size)
+	{
+		uint32_t	end = rowno + 1 < cs->nrows ? cd->offsets[rowno + 1] : cd->size;
+
+		*size = end - cd->offsets[rowno] - 1;
+	}
+
+	return cd->data + cd->offsets[rowno];
+}
+
+void
+cs_free(ColumnStore *cs)
+{
+	int		i;
+
+	if (!cs)
+		return;
+
+	for (i = 0; i < cs->ncolumns; i++)
+	{
+		free(cs->columns[i].data);
+		free(cs->columns[i].offsets);
+		free(cs->columns[i].nulls);
+	}
+
+	free(cs->columns);
+	free(cs->linenos);
+	free(cs->pdesc);
+	free(cs);
+}
@@ -0,0 +1,485 @@
+/*-------------------------------------------------------------------------
+ *
+ * coltypes.c
+ *	  detection of column types and parsing of typed values
+ *
+ * Portions Copyright (c) 2017-2021 Pavel Stehule
+ *
+ * IDENTIFICATION
+ *	  src/coltypes.c
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include <ctype.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include "pspg.h"
+
+#define NUMBER_MAX_SIZE			100
+
+#define SECS_PER_DAY			86400.0
+#define SECS_PER_MONTH			(30 * SECS_PER_DAY)
+#define SECS_PER_YEAR			(365.25 * SECS_PER_DAY)
+
+/*
+ * Returns true when the string (with size) is same like pattern
+ * (case insensitive).
+ */
+static bool
+str_is(const char *str, const char *end, const char *pattern)
+{
+	size_t		len = strlen(pattern);
+
+	return (size_t) (end - str) == len && strncasecmp(str, pattern, len) == 0;
+}
+
+/*
+ * Read sequence of digits. Returns pointer after last digit or NULL.
+ */
+static const char *
+parse_digits(const char *str, const char *end, int mindigits, int maxdigits, int *value)
+{
+	int			ndigits = 0;
+
+	*value = 0;
+
+	while (str < end && isdigit(*str) && ndigits < maxdigits)
+	{
+		*value = *value * 10 + (*str++ - '0');
+		ndigits += 1;
+	}
+
+	return ndigits >= mindigits ? str : NULL;
+}
+
+/*
+ * Try to parse number with optional sign, decimal point (or comma)
+ * and exponent. Returns pointer after number or NULL.
+ */
+static const char *
+parse_number(const char *str, const char *end, double *d, bool *is_integer)
+{
+	char		buffer[NUMBER_MAX_SIZE + 1];
+	const char *ptr = str;
+	bool		has_digits = false;
+	bool		has_point = false;
+	bool		has_exponent = false;
+	int			len;
+	int			i;
+
+	if (ptr < end && (*ptr == '-' || *ptr == '+'))
+		ptr++;
+
+	while (ptr < end && isdigit(*ptr))
+	{
+		has_digits = true;
+		ptr++;
+	}
+
+	if (ptr < end && (*ptr == '.' || *ptr == ','))
+	{
+		has_point = true;
+		ptr++;
+
+		while (ptr < end && isdigit(*ptr))
+		{
+			has_digits = true;
+			ptr++;
+		}
+	}
+
+	if (!has_digits)
+		return NULL;
+
+	if (ptr < end && (*ptr == 'e' || *ptr == 'E'))
+	{
+		const char *aux = ptr + 1;
+
+		if (aux < end && (*aux == '-' || *aux == '+'))
+			aux++;
+
+		if (aux < end && isdigit(*aux))
+		{
+			while (aux < end && isdigit(*aux))
+				aux++;
+
+			has_exponent = true;
+			ptr = aux;
+		}
+	}
+
+	len = ptr - str;
+	if (len > NUMBER_MAX_SIZE)
+		return NULL;
+
+	memcpy(buffer, str, len);
+	buffer[len] = '\0';
+
+	for (i = 0; i < len; i++)
+		if (buffer[i] == ',')
+			buffer[i] = '.';
+
+	errno = 0;
+	*d = strtod(buffer, NULL);
+	if (errno != 0)
+		return NULL;
+
+	*is_integer = !has_point && !has_exponent;
+
+	return ptr;
+}
+
+/*
+ * Days from 1970-01-01 (proleptic Gregorian calendar)
+ */
+static long
+days_from_civil(int y, int m, int d)
+{
+	long		era;
+	long		yoe, doy, doe;
+
+	y -= m <= 2;
+	era = (y >= 0 ? y : y - 399) / 400;
+	yoe = y - era * 400;
+	doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+	doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+
+	return era * 146097 + doe - 719468;
+}
+
+/*
+ * Parse time in format HH:MM[:SS[.FFF]]. Returns pointer after
+ * time or NULL. Hours can be higher than 23 (intervals).
+ */
+static const char *
+parse_time(const char *str, const char *end, double *secs)
+{
+	int			h, m, s = 0;
+	double		frac = 0.0;
+
+	str = parse_digits(str, end, 1, 9, &h);
+	if (!str || str >= end || *str != ':')
+		return NULL;
+
+	str = parse_digits(str + 1, end, 2, 2, &m);
+	if (!str || m > 59)
+		return NULL;
+
+	if (str < end && *str == ':')
+	{
+		str = parse_digits(str + 1, end, 2, 2, &s);
+		if (!str || s > 60)
+			return NULL;
+
+		if (str < end && *str == '.')
+		{
+			double		w = 0.1;
+
+			str++;
+			if (str >= end || !isdigit(*str))
+				return NULL;
+
+			while (str < end && isdigit(*str))
+			{
+				frac += (*str++ - '0') * w;
+				w /= 10;
+			}
+		}
+	}
+
+	*secs = h * 3600.0 + m * 60.0 + s + frac;
+
+	return str;
+}
+
+/*
+ * Parse date YYYY-MM-DD or timestamp YYYY-MM-DD HH:MM[:SS[.FFF]][TZ].
+ * The result is number of seconds from 1970-01-01.
+ */
+static ColumnType
+parse_timestamp(const char *str, const char *end, double *d)
+{
+	int			y, m, day;
+	double		secs;
+
+	str = parse_digits(str, end, 4, 6, &y);
+	if (!str || str >= end || *str != '-')
+		return COLUMN_TYPE_TEXT;
+
+	str = parse_digits(str + 1, end, 2, 2, &m);
+	if (!str || str >= end || *str != '-' || m < 1 || m > 12)
+		return COLUMN_TYPE_TEXT;
+
+	str = parse_digits(str + 1, end, 2, 2, &day);
+	if (!str || day < 1 || day > 31)
+		return COLUMN_TYPE_TEXT;
+
+	*d = days_from_civil(y, m, day) * SECS_PER_DAY;
+
+	if (str == end)
+		return COLUMN_TYPE_DATE;
+
+	if (*str != ' ' && *str != 'T')
+		return COLUMN_TYPE_TEXT;
+
+	str = parse_time(str + 1, end, &secs);
+	if (!str)
+		return COLUMN_TYPE_TEXT;
+
+	*d += secs;
+
+	/* optional time zone */
+	if (str < end)
+	{
+		if (*str == 'Z' && str + 1 == end)
+			return COLUMN_TYPE_TIMESTAMP;
+
+		if (*str == '+' || *str == '-')
+		{
+			int			sign = *str == '-' ? -1 : 1;
+			int			tzh, tzm = 0;
+
+			str = parse_digits(str + 1, end, 2, 2, &tzh);
+			if (!str)
+				return COLUMN_TYPE_TEXT;
+
+			if (str < end && *str == ':')
+				str = parse_digits(str + 1, end, 2, 2, &tzm);
+
+			if (!str || str != end)
+				return COLUMN_TYPE_TEXT;
+
+			*d -= sign * (tzh * 3600.0 + tzm * 60.0);
+
+			return COLUMN_TYPE_TIMESTAMP;
+		}
+
+		return COLUMN_TYPE_TEXT;
+	}
+
+	return COLUMN_TYPE_TIMESTAMP;
+}
+
+/*
+ * Parse interval in Postgres format like "1 year 2 mons -3 days 04:05:06"
+ * or just time "04:05:06". The result is in seconds.
+ */
+static ColumnType
+parse_interval(const char *str, const char *end, double *d)
+{
+	bool		has_item = false;
+
+	*d = 0.0;
+
+	while (str < end)
+	{
+		const char *ptr;
+		double		value;
+		bool		is_integer;
+
+		/* time part */
+		ptr = (*str == '-' || *str == '+') ? str + 1 : str;
+		if (ptr < end && isdigit(*ptr))
+		{
+			double		secs;
+			const char *aux = parse_time(ptr, end, &secs);
+
+			if (aux)
+			{
+				*d += *str == '-' ? -secs : secs;
+
+				/* time should be last part of interval */
+				return aux == end ? COLUMN_TYPE_INTERVAL : COLUMN_TYPE_TEXT;
+			}
+		}
+
+		ptr = parse_number(str, end, &value, &is_integer);
+		if (!ptr || ptr >= end || *ptr != ' ')
+			return COLUMN_TYPE_TEXT;
+
+		str = ++ptr;
+		while (ptr < end && isalpha(*ptr))
+			ptr++;
+
+		if (str_is(str, ptr, "year") || str_is(str, ptr, "years"))
+			*d += value * SECS_PER_YEAR;
+		else if (str_is(str, ptr, "mon") || str_is(str, ptr, "mons"))
+			*d += value * SECS_PER_MONTH;
+		else if (str_is(str, ptr, "day") || str_is(str, ptr, "days"))
+			*d += value * SECS_PER_DAY;
+		else if (str_is(str, ptr, "hour") || str_is(str, ptr, "hours"))
+			*d += value * 3600.0;
+		else if (str_is(str, ptr, "min") || str_is(str, ptr, "mins"))
+			*d += value * 60.0;
+		else if (str_is(str, ptr, "sec") || str_is(str, ptr, "secs"))
+			*d += value;
+		else
+			return COLUMN_TYPE_TEXT;
+
+		has_item = true;
+
+		if (ptr < end)
+		{
+			if (*ptr != ' ')
+				return COLUMN_TYPE_TEXT;
+
+			ptr++;
+		}
+
+		str = ptr;
+	}
+
+	return has_item ? COLUMN_TYPE_INTERVAL : COLUMN_TYPE_TEXT;
+}
+
+/*
+ * Detects type of value and returns its binary (double) value. The
+ * string should be trimmed. Returns COLUMN_TYPE_TEXT, when the value
+ * has not any known format.
+ */
+ColumnType
+parse_typed_value(const char *str, int size, double *d)
+{
+	const char *end = str + size;
+	const char *ptr;
+	bool		is_integer;
+	ColumnType	result;
+
+	if (size <= 0)
+		return COLUMN_TYPE_TEXT;
+
+	if (str_is(str, end, "t") || str_is(str, end, "true"))
+	{
+		*d = 1.0;
+		return COLUMN_TYPE_BOOLEAN;
+	}
+	else if (str_is(str, end, "f") || str_is(str, end, "false"))
+	{
+		*d = 0.0;
+		return COLUMN_TYPE_BOOLEAN;
+	}
+
+	ptr = parse_number(str, end, d, &is_integer);
+	if (ptr)
+	{
+		const char *unit = ptr;
+
+		if (ptr == end)
+			return is_integer ? COLUMN_TYPE_INTEGER : COLUMN_TYPE_DECIMAL;
+
+		/* size units used by pg_size_pretty */
+		if (*unit == ' ')
+			unit++;
+
+		if (str_is(unit, end, "bytes"))
+			return COLUMN_TYPE_SIZE;
+		else if (str_is(unit, end, "kB"))
+		{
+			*d *= 1024.0;
+			return COLUMN_TYPE_SIZE;
+		}
+		else if (str_is(unit, end, "MB"))
+		{
+			*d *= 1024.0 * 1024;
+			return COLUMN_TYPE_SIZE;
+		}
+		else if (str_is(unit, end, "GB"))
+		{
+			*d *= 1024.0 * 1024 * 1024;
+			return COLUMN_TYPE_SIZE;
+		}
+		else if (str_is(unit, end, "TB"))
+		{
+			*d *= 1024.0 * 1024 * 1024 * 1024;
+			return COLUMN_TYPE_SIZE;
+		}
+
+		/* date starts by number too */
+		if (*ptr == '-')
+		{
+			result = parse_timestamp(str, end, d);
+			if (result != COLUMN_TYPE_TEXT)
+				return result;
+		}
+	}
+
+	return parse_interval(str, end, d);
+}
+
+/*
+ * Returns true, when the timestamp (already detected by parse_typed_value)
+ * has time zone. The value of such timestamp is in UTC.
+ */
+bool
+timestamp_has_time_zone(const char *str, int size)
+{
+	const char *end = str + size;
+	const char *ptr = memchr(str, ':', size);
+
+	if (size > 0 && end[-1] == 'Z')
+		return true;
+
+	/* sign of offset follows time */
+	if (ptr)
+	{
+		while (++ptr < end)
+			if (*ptr == '+' || *ptr == '-')
+				return true;
+	}
+
+	return false;
+}
+
+/*
+ * Returns number of digits after decimal point of number (already
+ * detected by parse_typed_value). The exponent is calculated too.
+ */
+int
+number_scale(const char *str, int size)
+{
+	const char *end = str + size;
+	const char *ptr = str;
+	int			scale = 0;
+
+	while (ptr < end && *ptr != '.' && *ptr != ',' &&
+		   *ptr != 'e' && *ptr != 'E')
+		ptr++;
+
+	if (ptr < end && (*ptr == '.' || *ptr == ','))
+	{
+		while (++ptr < end && isdigit(*ptr))
+			scale++;
+	}
+
+	if (ptr < end && (*ptr == 'e' || *ptr == 'E'))
+		scale -= atoi(ptr + 1);
+
+	return scale > 0 ? scale : 0;
+}
+
+/*
+ * Returns common type of column's values
+ */
+ColumnType
+merge_column_types(ColumnType t1, ColumnType t2)
+{
+	if (t1 == COLUMN_TYPE_UNKNOWN || t1 == t2)
+		return t2;
+
+	if (t2 == COLUMN_TYPE_UNKNOWN)
+		return t1;
+
+	/* integer, decimal and sizes are numbers */
+	if (t1 <= COLUMN_TYPE_SIZE && t2 <= COLUMN_TYPE_SIZE)
+		return t1 > t2 ? t1 : t2;
+
+	if ((t1 == COLUMN_TYPE_DATE || t1 == COLUMN_TYPE_TIMESTAMP) &&
+		(t2 == COLUMN_TYPE_DATE || t2 == COLUMN_TYPE_TIMESTAMP))
+		return COLUMN_TYPE_TIMESTAMP;
+
+	return COLUMN_TYPE_TEXT;
+}
@@ -118,6 +118,10 @@ cmd_string(int cmd)
 			return "CISearchSet";
 		case cmd_USSearchSet:
 			return "USSearchSet";
+		case cmd_RegexSearchToggle:
+			return "RegexSearchToggle";
+		case cmd_IncrementalSearchToggle:
+			return "IncrementalSearchToggle";
 		case cmd_HighlightLines:
 			return "HighlightLines";
 		case cmd_HighlightValues:
@@ -260,6 +264,8 @@ cmd_string(int cmd)
 
 		case cmd_ShowScrollbar:
 			return "ShowScrollBar";
+		case cmd_ShowStats:
+			return "ShowStats";
 
 		case cmd_SortAsc:
 			return "SortAsc";
@@ -267,9 +273,31 @@ cmd_string(int cmd)
 			return "SortDesc";
 		case cmd_OriginalSort:
 			return "OriginalSort";
+		case cmd_SetFilter:
+			return "SetFilter";
+		case cmd_ToggleFilter:
+			return "ToggleFilter";
+		case cmd_SetColumns:
+			return "SetColumns";
+		case cmd_HideColumn:
+			return "HideColumn";
+		case cmd_MoveColumnLeft:
+			return "MoveColumnLeft";
+		case cmd_MoveColumnRight:
+			return "MoveColumnRight";
+		case cmd_ShowAllColumns:
+			return "ShowAllColumns";
+		case cmd_GroupBy:
+			return "GroupBy";
+		case cmd_SampleColumn:
+			return "SampleColumn";
 
 		case cmd_TogglePause:
 			return "TogglePause";
+		case cmd_PrevResult:
+			return "PrevResult";
+		case cmd_NextResult:
+			return "NextResult";
 
 		case cmd_Refresh:
 			return "Refresh";
@@ -289,6 +317,12 @@ cmd_string(int cmd)
 			return "UseClipboardFormatINSERT";
 		case cmd_UseClipboard_INSERT_with_comments:
 			return "UseClipboardFormatINSERTwithcomments";
+		case cmd_UseClipboard_INSERT_batch:
+			return "UseClipboardFormatINSERTbatch";
+		case cmd_UseClipboard_COPY:
+			return "UseClipboardFormatCOPY";
+		case cmd_UseClipboard_ARROW:
+			return "UseClipboardFormatArrow";
 		case cmd_TogleEmptyStringIsNULL:
 			return "TogleEmptyStringIsNULL";
 		case cmd_Copy:
@@ -348,6 +382,8 @@ translate_event(int c, bool alt, Options *opts, int *nested_command)
 				return cmd_BoldLabelsToggle;
 			case 'c':
 				return cmd_ShowCursor;
+			case 'f':
+				return cmd_ToggleFilter;
 			case 'l':
 				return cmd_GotoLine;
 			case 'm':
@@ -356,6 +392,8 @@ translate_event(int c, bool alt, Options *opts, int *nested_command)
 				return cmd_RowNumToggle;
 			case 'o':
 				return cmd_FlushBookmarks;
+			case 'p':
+				return cmd_ShowStats;
 			case 'k':
 				return cmd_ToggleBookmark;
 			case 'i':
@@ -366,6 +404,10 @@ translate_event(int c, bool alt, Options *opts, int *nested_command)
 				return cmd_RawOutputQuit;
 			case 'v':
 				return cmd_ShowVerticalCursor;
+			case 'x':
+				return cmd_ShowAllColumns;
+			case '=':
+				return cmd_SampleColumn;
 			case '2':
 				return cmd_SaveData;
 			case '3':
@@ -489,9 +531,25 @@ translate_event(int c, bool alt, Options *opts, int *nested_command)
 				return cmd_SortDesc;
 			case 'u':
 				return cmd_OriginalSort;
+			case '&':
+				return cmd_SetFilter;
+			case '|':
+				return cmd_SetColumns;
+			case 'x':
+				return cmd_HideColumn;
+			case '{':
+				return cmd_MoveColumnLeft;
+			case '}':
+				return cmd_MoveColumnRight;
+			case '=':
+				return cmd_GroupBy;
 			case 'R':
 			case 12:	/* CTRL L */
 				return cmd_Refresh;
+			case '<':
+				return cmd_PrevResult;
+			case '>':
+				return cmd_NextResult;
 
 			case KEY_SR:
 				*nested_command = cmd_CursorUp;
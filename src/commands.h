@@ -42,6 +42,8 @@ typedef enum PspgCommand
 	cmd_CSSearchSet,
 	cmd_CISearchSet,
 	cmd_USSearchSet,
+	cmd_RegexSearchToggle,
+	cmd_IncrementalSearchToggle,
 	cmd_HighlightLines,
 	cmd_HighlightValues,
 	cmd_NoHighlight,
@@ -112,10 +114,22 @@ typedef enum PspgCommand
 	cmd_BoldLabelsToggle,
 	cmd_BoldCursorToggle,
 	cmd_ShowScrollbar,
+	cmd_ShowStats,
 	cmd_SortAsc,
 	cmd_SortDesc,
 	cmd_OriginalSort,
+	cmd_SetFilter,
+	cmd_ToggleFilter,
+	cmd_SetColumns,
+	cmd_HideColumn,
+	cmd_MoveColumnLeft,
+	cmd_MoveColumnRight,
+	cmd_ShowAllColumns,
+	cmd_GroupBy,
+	cmd_SampleColumn,
 	cmd_TogglePause,
+	cmd_PrevResult,
+	cmd_NextResult,
 	cmd_Refresh,
 	cmd_SetCopyFile,
 	cmd_SetCopyClipboard,
@@ -124,6 +138,9 @@ typedef enum PspgCommand
 	cmd_UseClipboard_text,
 	cmd_UseClipboard_INSERT,
 	cmd_UseClipboard_INSERT_with_comments,
+	cmd_UseClipboard_INSERT_batch,
+	cmd_UseClipboard_COPY,
+	cmd_UseClipboard_ARROW,
 	cmd_TogleEmptyStringIsNULL,
 
 	cmd_Copy,
@@ -0,0 +1,254 @@
+/*-------------------------------------------------------------------------
+ *
+ * compress.c
+ *	  simple and fast LZ77 compression used for cold line buffers
+ *
+ * Portions Copyright (c) 2017-2021 Pavel Stehule
+ *
+ * IDENTIFICATION
+ *	  src/compress.c
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include <string.h>
+
+#include "pspg.h"
+
+/*
+ * The format is similar to LZ4 block format. Compressed data is a sequence
+ * of tokens. The high nibble of token is length of literals, the low nibble
+ * is length of match (minus LZ_MIN_MATCH). When the value is 15, then the
+ * length continues in next bytes (255 means next byte follows). Literals
+ * follows the token, then two bytes of match offset (little endian) and
+ * optional match length bytes. Last token has only literals.
+ */
+#define LZ_HASH_BITS			14
+#define LZ_MIN_MATCH			4
+#define LZ_MAX_OFFSET			65535
+#define LZ_LAST_LITERALS		5
+
+static inline uint32_t
+read32(const unsigned char *ptr)
+{
+	uint32_t	result;
+
+	memcpy(&result, ptr, sizeof(uint32_t));
+
+	return result;
+}
+
+static inline uint32_t
+hash32(uint32_t value)
+{
+	return (value * 2654435761U) >> (32 - LZ_HASH_BITS);
+}
+
+static unsigned char *
+write_length(unsigned char *op, int length)
+{
+	length -= 15;
+
+	while (length >= 255)
+	{
+		*op++ = 255;
+		length -= 255;
+	}
+
+	*op++ = length;
+
+	return op;
+}
+
+/*
+ * Returns size of buffer that is enough for compressed data every time
+ */
+int
+lz_compress_bound(int size)
+{
+	return size + size / 255 + 16;
+}
+
+/*
+ * Returns size of compressed data or -1 when the compressed data
+ * doesn't fit to dest.
+ */
+int
+lz_compress(const char *src, int size, char *dest, int dest_size)
+{
+	const unsigned char *base = (const unsigned char *) src;
+	const unsigned char *ip = base;
+	const unsigned char *anchor = base;
+	const unsigned char *iend = base + size;
+	const unsigned char *mflimit = iend - (LZ_LAST_LITERALS + LZ_MIN_MATCH);
+	unsigned char *op = (unsigned char *) dest;
+	unsigned char *oend = op + dest_size;
+	uint32_t	table[1 << LZ_HASH_BITS];
+	int			litlen;
+	int			misses = 0;
+
+	memset(table, 0, sizeof(table));
+
+	if (size > LZ_LAST_LITERALS + LZ_MIN_MATCH)
+	{
+		while (ip < mflimit)
+		{
+			uint32_t	seq = read32(ip);
+			uint32_t	h = hash32(seq);
+			const unsigned char *ref = base + table[h];
+
+			table[h] = ip - base;
+
+			if (ref < ip && ip - ref <= LZ_MAX_OFFSET && read32(ref) == seq)
+			{
+				const unsigned char *mp = ip + LZ_MIN_MATCH;
+				const unsigned char *rp = ref + LZ_MIN_MATCH;
+				const unsigned char *matchlimit = iend - LZ_LAST_LITERALS;
+				unsigned char *token;
+				int			matchlen;
+				int			offset;
+
+				while (mp < matchlimit && *mp == *rp)
+				{
+					mp++;
+					rp++;
+				}
+
+				litlen = ip - anchor;
+				matchlen = mp - ip - LZ_MIN_MATCH;
+				offset = ip - ref;
+
+				if (op + 1 + litlen + litlen / 255 + 1 + 2 + matchlen / 255 + 1 > oend)
+					return -1;
+
+				token = op++;
+				*token = ((litlen >= 15 ? 15 : litlen) << 4) | (matchlen >= 15 ? 15 : matchlen);
+
+				if (litlen >= 15)
+					op = write_length(op, litlen);
+
+				memcpy(op, anchor, litlen);
+				op += litlen;
+
+				*op++ = offset & 0xff;
+				*op++ = offset >> 8;
+
+				if (matchlen >= 15)
+					op = write_length(op, matchlen);
+
+				ip = mp;
+				anchor = ip;
+				misses = 0;
+			}
+			else
+			{
+				/* step is increased in not compressible data */
+				ip += 1 + (misses++ >> 6);
+			}
+		}
+	}
+
+	/* last literals */
+	litlen = iend - anchor;
+
+	if (op + 1 + litlen + litlen / 255 + 1 > oend)
+		return -1;
+
+	*op++ = (litlen >= 15 ? 15 : litlen) << 4;
+
+	if (litlen >= 15)
+		op = write_length(op, litlen);
+
+	memcpy(op, anchor, litlen);
+	op += litlen;
+
+	return op - (unsigned char *) dest;
+}
+
+/*
+ * Returns size of decompressed data or -1 when data are broken
+ */
+int
+lz_decompress(const char *src, int size, char *dest, int dest_size)
+{
+	const unsigned char *ip = (const unsigned char *) src;
+	const unsigned char *iend = ip + size;
+	unsigned char *op = (unsigned char *) dest;
+	unsigned char *oend = op + dest_size;
+
+	while (ip < iend)
+	{
+		int			token = *ip++;
+		int			litlen = token >> 4;
+		int			matchlen = token & 0x0f;
+		int			offset;
+		int			b;
+
+		if (litlen == 15)
+		{
+			do
+			{
+				if (ip >= iend)
+					return -1;
+
+				b = *ip++;
+				litlen += b;
+			}
+			while (b == 255);
+		}
+
+		if (litlen > iend - ip || litlen > oend - op)
+			return -1;
+
+		memcpy(op, ip, litlen);
+		op += litlen;
+		ip += litlen;
+
+		/* last token has only literals */
+		if (ip >= iend)
+			break;
+
+		if (iend - ip < 2)
+			return -1;
+
+		offset = ip[0] | (ip[1] << 8);
+		ip += 2;
+
+		if (offset == 0 || offset > op - (unsigned char *) dest)
+			return -1;
+
+		if (matchlen == 15)
+		{
+			do
+			{
+				if (ip >= iend)
+					return -1;
+
+				b = *ip++;
+				matchlen += b;
+			}
+			while (b == 255);
+		}
+
+		matchlen += LZ_MIN_MATCH;
+
+		if (matchlen > oend - op)
+			return -1;
+
+		if (offset >= matchlen)
+		{
+			memcpy(op, op - offset, matchlen);
+			op += matchlen;
+		}
+		else
+		{
+			unsigned char *ref = op - offset;
+
+			/* overlapped copy */
+			while (matchlen-- > 0)
+				*op++ = *ref++;
+		}
+	}
+
+	return op - (unsigned char *) dest;
+}
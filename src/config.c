@@ -17,6 +17,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 static bool
 parse_cfg(char *line, char *key, bool *bool_val, int *int_val)
@@ -95,6 +96,8 @@ save_config(char *path, Options *opts)
 	SAFE_SAVE_BOOL_OPTION("bold_cursor", opts->bold_cursor);
 	SAFE_SAVE_BOOL_OPTION("ignore_case", opts->ignore_case);
 	SAFE_SAVE_BOOL_OPTION("ignore_lower_case", opts->ignore_lower_case);
+	SAFE_SAVE_BOOL_OPTION("regex_search", opts->regex_search);
+	SAFE_SAVE_BOOL_OPTION("incremental_search", opts->incremental_search);
 	SAFE_SAVE_BOOL_OPTION("no_cursor", opts->no_cursor);
 	SAFE_SAVE_BOOL_OPTION("no_sound", opts->no_sound);
 	SAFE_SAVE_BOOL_OPTION("no_mouse", opts->no_mouse);
@@ -131,6 +134,14 @@ save_config(char *path, Options *opts)
 	if (result < 0)
 		return false;
 
+	result = fprintf(f, "insert_batch_size = %d\n", opts->insert_batch_size);
+	if (result < 0)
+		return false;
+
+	result = fprintf(f, "detected_clipboard_app = %d\n", opts->detected_clipboard_app);
+	if (result < 0)
+		return false;
+
 	result = fclose(f);
 	if (result != 0)
 		return false;
@@ -173,6 +184,10 @@ load_config(char *path, Options *opts)
 				opts->ignore_case = bool_val;
 			else if (strcmp(key, "ignore_lower_case") == 0)
 				opts->ignore_lower_case = bool_val;
+			else if (strcmp(key, "regex_search") == 0)
+				opts->regex_search = bool_val;
+			else if (strcmp(key, "incremental_search") == 0)
+				opts->incremental_search = bool_val;
 			else if (strcmp(key, "no_sound") == 0)
 				opts->no_sound = bool_val;
 			else if (strcmp(key, "no_cursor") == 0)
@@ -214,14 +229,24 @@ load_config(char *path, Options *opts)
 				opts->pgcli_fix = bool_val;
 			else if (strcmp(key, "default_clipboard_format") == 0)
 			{
-				if (int_val > 0 && int_val <= CLIPBOARD_FORMAT_INSERT_WITH_COMMENTS)
+				if (int_val > 0 && int_val <= CLIPBOARD_FORMAT_ARROW)
 					opts->clipboard_format = int_val;
 			}
+			else if (strcmp(key, "insert_batch_size") == 0)
+			{
+				if (int_val > 0 && int_val <= MAX_INSERT_BATCH_SIZE)
+					opts->insert_batch_size = int_val;
+			}
 			else if (strcmp(key, "clipboard_app") == 0)
 			{
 				if (int_val > 0 && int_val <= 3)
 					opts->clipboard_app = int_val;
 			}
+			else if (strcmp(key, "detected_clipboard_app") == 0)
+			{
+				if (int_val >= 0 && int_val <= 3)
+					opts->detected_clipboard_app = int_val;
+			}
 			else if (strcmp(key, "xterm_mouse_mode") == 0)
 				opts->xterm_mouse_mode = bool_val;
 			else if (strcmp(key, "show_scrollbar") == 0)
@@ -238,3 +263,68 @@ load_config(char *path, Options *opts)
 
 	return true;
 }
+
+/*
+ * Replace (or append) one integer option in config file. Other lines
+ * are not changed. It is used for saving values detected in runtime,
+ * so the new file is written to temp file first, and then renamed.
+ */
+bool
+save_config_int_value(char *path, const char *name, int value)
+{
+	FILE	   *f;
+	FILE	   *newf;
+	char		tmppath[4096];
+	char	   *line = NULL;
+	size_t		len = 0;
+	bool		write_error = false;
+
+	snprintf(tmppath, sizeof(tmppath), "%s.tmp", path);
+
+	errno = 0;
+	newf = fopen(tmppath, "w");
+	if (newf == NULL)
+		return false;
+
+	f = fopen(path, "r");
+	if (f)
+	{
+		while (getline(&line, &len, f) != -1)
+		{
+			char	key[100];
+			bool	bool_val;
+			int		int_val;
+
+			if (parse_cfg(line, key, &bool_val, &int_val) &&
+				strcmp(key, name) == 0)
+				continue;
+
+			if (fputs(line, newf) < 0)
+			{
+				write_error = true;
+				break;
+			}
+		}
+
+		free(line);
+		fclose(f);
+	}
+
+	if (!write_error && fprintf(newf, "%s = %d\n", name, value) < 0)
+		write_error = true;
+
+	/* don't replace original config by partially written file */
+	if (fclose(newf) != 0 || write_error)
+	{
+		unlink(tmppath);
+		return false;
+	}
+
+	if (rename(tmppath, path) != 0)
+	{
+		unlink(tmppath);
+		return false;
+	}
+
+	return true;
+}
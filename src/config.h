@@ -18,17 +18,24 @@
 
 #define MAX_STYLE					22
 
+#define MAX_INSERT_BATCH_SIZE		1000000
+
 typedef enum
 {
 	CLIPBOARD_FORMAT_CSV,
 	CLIPBOARD_FORMAT_TSVC,
 	CLIPBOARD_FORMAT_TEXT,
 	CLIPBOARD_FORMAT_INSERT,
-	CLIPBOARD_FORMAT_INSERT_WITH_COMMENTS
+	CLIPBOARD_FORMAT_INSERT_WITH_COMMENTS,
+	CLIPBOARD_FORMAT_INSERT_BATCH,
+	CLIPBOARD_FORMAT_COPY,
+	CLIPBOARD_FORMAT_ARROW
 } ClipboardFormat;
 
 #define DSV_FORMAT_TYPE(f)		(f == CLIPBOARD_FORMAT_CSV || f == CLIPBOARD_FORMAT_TSVC)
-#define INSERT_FORMAT_TYPE(f)	(f == CLIPBOARD_FORMAT_INSERT || f == CLIPBOARD_FORMAT_INSERT_WITH_COMMENTS)
+#define INSERT_FORMAT_TYPE(f)	(f == CLIPBOARD_FORMAT_INSERT || f == CLIPBOARD_FORMAT_INSERT_WITH_COMMENTS || \
+								 f == CLIPBOARD_FORMAT_INSERT_BATCH)
+#define SQL_FORMAT_TYPE(f)		(INSERT_FORMAT_TYPE(f) || f == CLIPBOARD_FORMAT_COPY)
 
 typedef enum
 {
@@ -40,8 +47,11 @@ typedef struct
 {
 	char   *pathname;
 	char   *log_pathname;
+	char   *stats_pathname;
 	bool	ignore_case;
 	bool	ignore_lower_case;
+	bool	regex_search;
+	bool	incremental_search;
 	bool	no_sound;
 	bool	no_mouse;
 	bool	less_status_bar;
@@ -55,6 +65,7 @@ typedef struct
 	bool	no_cursor;
 	bool	vertical_cursor;
 	bool	show_scrollbar;
+	bool	show_stats;
 	bool	tabular_cursor;
 	bool	force_ascii_art;
 	int		theme;
@@ -88,12 +99,21 @@ typedef struct
 	bool	empty_string_is_null;
 	bool	xterm_mouse_mode;
 	int		clipboard_app;
+	int		detected_clipboard_app;	/* cached result of clipboard app detection */
+	int		insert_batch_size;	/* rows per statement of multirow INSERT */
+	int		compress_threshold;	/* in MB, 0 disables compression */
+	int		memory_limit;		/* in MB, 0 means without limit */
 	bool	no_sleep;
 	bool	querystream;
+	bool	querystream_pipeline;	/* send queries of query stream in pipeline mode */
+	int		querystream_history;	/* number of stored results of query stream */
+	int		stream_max_rows;	/* retained rows of stream, 0 means without limit */
+	int		stream_max_size;	/* retained data of stream in MB, 0 means without limit */
 	bool	menu_always;
 } Options;
 
 extern bool save_config(char *path, Options *opts);
 extern bool load_config(char *path, Options *opts);
+extern bool save_config_int_value(char *path, const char *name, int value);
 
 #endif
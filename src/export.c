@@ -19,83 +19,8 @@
 #include "commands.h"
 #include "unicode.h"
 
-/*
- * Ensure correct formatting of CSV value. Can returns
- * malloc ed string when value should be quoted.
- */
-static char *
-csv_format(char *str, int *slen, bool force8bit, bool empty_string_is_null)
-{
-	char   *ptr = str;
-	char   *result;
-	bool	needs_quoting = false;
-	int		_slen;
-
-	/* Detect NULL symbol ∅ */
-	if (!force8bit &&
-		*slen == 3 && strncmp(str, "\342\210\205", 3) == 0)
-	{
-		*slen = 0;
-		return NULL;
-	}
-
-	if (*slen == 0)
-	{
-		if (empty_string_is_null)
-			return NULL;
-
-		*slen = 2;
-		return sstrdup("\"\"");
-	}
-
-	_slen = *slen;
-	while (_slen > 0)
-	{
-		int		size;
-
-		if (*ptr == '"' || *ptr == ',' ||
-			*ptr == '\t' || *ptr == '\r' || *ptr == '\n')
-		{
-			needs_quoting = true;
-			break;
-		}
-
-		size = force8bit ? 1 : utf8charlen(*ptr);
-
-		ptr += size;
-		_slen -= size;
-	}
-
-	if (!needs_quoting)
-		return str;
-
-	result = ptr = smalloc2(*slen * 2 + 2 + 1,
-							"CSV format output buffer allocation");
-
-	*ptr++ = '"';
-
-	_slen = *slen;
-	*slen = 1;
-	while (_slen > 0)
-	{
-		int		size = force8bit ? 1 : utf8charlen(*ptr);
-
-		if (*str == '"')
-			*ptr++ = '"';
-
-		_slen -= size;
-		*slen += size;
-
-		while (size--)
-			*ptr++ = *str++;
-	}
-
-	*ptr++ = '"';
-	*ptr = '\0';
-	*slen += 1;
-
-	return result;
-}
+/* how often (in lines) is progress of export updated */
+#define EXPORT_PROGRESS_STEP		4096
 
 /*
  * Ensure correct format for SQL identifier
@@ -170,107 +95,13 @@ quote_sql_identifier(char *str, int *slen, bool force8bit)
 	return result;
 }
 
-static char *
-quote_sql_literal(char *str,
-				  int *slen,
-				  bool force8bit,
-				  bool empty_string_is_null)
-{
-	char   *ptr = str;
-	char   *result;
-	int		_slen = *slen;
-	bool	has_dot = false;
-
-	bool	needs_quoting = false;
-
-	if (*slen == 0)
-	{
-		if (empty_string_is_null)
-		{
-			*slen = 4;
-			return sstrdup("NULL");
-		}
-		else
-		{
-			*slen = 2;
-			return sstrdup("''");
-		}
-	}
-
-	if (*slen == 4 &&
-		(strncmp(str, "NULL", *slen) == 0 ||
-		 strncmp(str, "null", *slen) == 0))
-		return str;
-
-	if (!force8bit &&
-		*slen == 3 && strncmp(str, "\342\210\205", 3) == 0)
-	{
-		*slen = 4;
-		return sstrdup("NULL");
-	}
-
-	while (*ptr && _slen > 0)
-	{
-		int		size = force8bit ? 1 : utf8charlen(*ptr);
-
-		if (*ptr == '.')
-		{
-			if (has_dot)
-			{
-				needs_quoting = true;
-				break;
-			}
-			else
-				has_dot = true;
-		}
-		else if (!(*ptr >= '0' && *ptr <= '9'))
-		{
-			needs_quoting = true;
-			break;
-		}
-
-		ptr += size;
-		_slen -= size;
-	}
-
-	if (!needs_quoting)
-		return str;
-
-	result = ptr = smalloc2(*slen * 2 + 2 + 1,
-							"SQL literal output buffer allocation");
-
-	*ptr++ = '\'';
-
-	_slen = *slen;
-	*slen = 1;
-
-	while (_slen > 0)
-	{
-		int		size = force8bit ? 1 : utf8charlen(*ptr);
-
-		if (*str == '\'')
-			*ptr++ = '\'';
-
-		_slen -= size;
-		*slen += size;
-
-		while (size--)
-			*ptr++ = *str++;
-	}
-
-	*ptr++ = '\'';
-	*ptr = '\0';
-	*slen += 1;
-
-	return result;
-}
-
 /*
  * Iterator over data string with format specified by headline
  */
 typedef struct
 {
 	char	   *row;
+	char	   *end;
 	char	   *headline;
 	bool		force8bit;
 	int			xpos;
@@ -288,7 +119,7 @@ next_char(FmtLineIter *iter,
 	if (!iter->row || !iter->headline)
 		return NULL;
 
-	if (*iter->row == '\0' || *iter->headline == '\n')
+	if (iter->row >= iter->end || *iter->headline == '\n')
 		return NULL;
 
 	*typ = *(iter->headline);
@@ -329,8 +160,262 @@ typedef struct
 	char	  **colnames;
 	ExtStr	   *lines;
 	char		linestyle;
+	bool		source_values;		/* fields are not formatted values */
+	int			batch_size;			/* rows per multirow INSERT */
+	int			batch_rows;			/* rows of current multirow INSERT */
+	bool		copy_started;		/* COPY command was written already */
+	ArrowWriter *arrow;				/* writer used by Apache Arrow format */
 } ExportState;
 
+/*
+ * Returns true, when the value should be exported as NULL. The NULL
+ * is displayed by symbol ∅ or by empty string.
+ */
+static bool
+is_null_value(ExportState *expstate, const char *str, int size)
+{
+	if (size == 0)
+		return expstate->empty_string_is_null;
+
+	return !expstate->force8bit &&
+		   size == 3 && strncmp(str, "\342\210\205", 3) == 0;
+}
+
+/*
+ * Write CSV value. The value is quoted when it is necessary. The escaping
+ * is done on the fly (without temporary buffer). Searched chars are ASCII,
+ * so byte search is safe for UTF8 strings.
+ */
+static void
+fput_csv_value(ExportState *expstate, const char *str, int size)
+{
+	FILE	   *fp = expstate->fp;
+	const char *quote;
+	bool		needs_quoting = false;
+	int			i;
+
+	/* Detect NULL symbol ∅ */
+	if (!expstate->force8bit &&
+		size == 3 && strncmp(str, "\342\210\205", 3) == 0)
+		return;
+
+	if (size == 0)
+	{
+		if (!expstate->empty_string_is_null)
+			fputs("\"\"", fp);
+
+		return;
+	}
+
+	for (i = 0; i < size; i++)
+	{
+		char	c = str[i];
+
+		if (c == '"' || c == ',' || c == '\t' || c == '\r' || c == '\n')
+		{
+			needs_quoting = true;
+			break;
+		}
+	}
+
+	if (!needs_quoting)
+	{
+		fwrite(str, size, 1, fp);
+		return;
+	}
+
+	fputc('"', fp);
+
+	while ((quote = memchr(str, '"', size)))
+	{
+		int		len = quote - str + 1;
+
+		/* write string with quote, and repeat quote */
+		fwrite(str, len, 1, fp);
+		fputc('"', fp);
+
+		str += len;
+		size -= len;
+	}
+
+	if (size > 0)
+		fwrite(str, size, 1, fp);
+
+	fputc('"', fp);
+}
+
+/*
+ * Write SQL literal. Numbers and NULL are written without quotes.
+ */
+static void
+fput_sql_literal(ExportState *expstate, const char *str, int size)
+{
+	FILE	   *fp = expstate->fp;
+	const char *quote;
+
+	if (size == 0)
+	{
+		if (expstate->empty_string_is_null)
+			fputs("NULL", fp);
+		else
+			fputs("''", fp);
+
+		return;
+	}
+
+	if (size == 4 &&
+		(strncmp(str, "NULL", size) == 0 ||
+		 strncmp(str, "null", size) == 0))
+	{
+		fwrite(str, size, 1, fp);
+		return;
+	}
+
+	if (!expstate->force8bit &&
+		size == 3 && strncmp(str, "\342\210\205", 3) == 0)
+	{
+		fputs("NULL", fp);
+		return;
+	}
+
+	/* numbers (with sign or exponent) are not quoted, comma cannot be used */
+	if (memchr(str, ',', size) == NULL)
+	{
+		double		d;
+		ColumnType	t = parse_typed_value(str, size, &d);
+
+		if (t == COLUMN_TYPE_INTEGER || t == COLUMN_TYPE_DECIMAL)
+		{
+			fwrite(str, size, 1, fp);
+			return;
+		}
+	}
+
+	fputc('\'', fp);
+
+	while ((quote = memchr(str, '\'', size)))
+	{
+		int		len = quote - str + 1;
+
+		fwrite(str, len, 1, fp);
+		fputc('\'', fp);
+
+		str += len;
+		size -= len;
+	}
+
+	if (size > 0)
+		fwrite(str, size, 1, fp);
+
+	fputc('\'', fp);
+}
+
+/*
+ * Write value in text format of COPY command. NULL is written as \N.
+ */
+static void
+fput_copy_value(ExportState *expstate, const char *str, int size)
+{
+	FILE	   *fp = expstate->fp;
+	const char *start = str;
+	const char *end = str + size;
+
+	if (is_null_value(expstate, str, size))
+	{
+		fputs("\\N", fp);
+		return;
+	}
+
+	while (str < end)
+	{
+		const char *escaped = NULL;
+
+		switch (*str)
+		{
+			case '\\':
+				escaped = "\\\\";
+				break;
+			case '\t':
+				escaped = "\\t";
+				break;
+			case '\n':
+				escaped = "\\n";
+				break;
+			case '\r':
+				escaped = "\\r";
+				break;
+		}
+
+		if (escaped)
+		{
+			if (str > start)
+				fwrite(start, str - start, 1, fp);
+
+			fputs(escaped, fp);
+			start = str + 1;
+		}
+
+		str += 1;
+	}
+
+	if (str > start)
+		fwrite(start, str - start, 1, fp);
+}
+
+/*
+ * Save quoted column name. The names are used by INSERT or COPY commands.
+ */
+static void
+save_column_name(ExportState *expstate, char *field, int size)
+{
+	char   *_field;
+
+	if (!expstate->colnames)
+	{
+		expstate->colnames = smalloc(sizeof(char *) * expstate->columns);
+		memset(expstate->colnames, 0, sizeof(char *) * expstate->columns);
+	}
+
+	if (!expstate->source_values)
+		field = trim_str(field, &size, expstate->force8bit);
+	_field = quote_sql_identifier(field, &size, expstate->force8bit);
+
+	if (!_field)
+		expstate->colnames[expstate->colno] = sstrdup("");
+	else if (_field != field)
+		expstate->colnames[expstate->colno] = _field;
+	else
+		expstate->colnames[expstate->colno] = sstrndup(field, size);
+
+	expstate->colno += 1;
+}
+
+/*
+ * Write target table name and list of columns
+ */
+static void
+fput_target_table(ExportState *expstate)
+{
+	int		i;
+
+	fputs(expstate->table_name, expstate->fp);
+
+	if (!expstate->colnames)
+		return;
+
+	fputc('(', expstate->fp);
+
+	for (i = 0; i < expstate->columns && expstate->colnames[i]; i++)
+	{
+		if (i > 0)
+			fputs(", ", expstate->fp);
+
+		fputs(expstate->colnames[i], expstate->fp);
+	}
+
+	fputc(')', expstate->fp);
+}
+
 /*
  * Export one segment of format (decoration or field) to output file.
  */
@@ -393,6 +478,17 @@ process_item(ExportState *expstate,
 		{
 			if (expstate->format == CLIPBOARD_FORMAT_INSERT)
 				fputs(");\n", expstate->fp);
+			else if (expstate->format == CLIPBOARD_FORMAT_INSERT_BATCH)
+			{
+				fputc(')', expstate->fp);
+
+				/* close statement, when batch is full */
+				if (++expstate->batch_rows >= expstate->batch_size)
+				{
+					fputs(";\n", expstate->fp);
+					expstate->batch_rows = 0;
+				}
+			}
 			else
 			{
 				fprintf(expstate->fp, ");\t\t -- %d. %s\n",
@@ -401,68 +497,44 @@ process_item(ExportState *expstate,
 		}
 		else if (typ == 'd')
 		{
-			char   *_field;
-
 			if (is_colname)
+				save_column_name(expstate, field, size);
+			else
 			{
-				if (!expstate->colnames)
+				if (expstate->colno == 0 &&
+					expstate->format == CLIPBOARD_FORMAT_INSERT_BATCH)
 				{
-					expstate->colnames = smalloc(sizeof(char *) * expstate->columns);
-					memset(expstate->colnames, 0, sizeof(char *) * expstate->columns);
-				}
-
-				field = trim_str(field, &size, expstate->force8bit);
-				_field = quote_sql_identifier(field, &size, expstate->force8bit);
-
-				if (!_field)
-					expstate->colnames[expstate->colno] = sstrdup("");
-				else if (_field != field)
-					expstate->colnames[expstate->colno] = _field;
-				else
-					expstate->colnames[expstate->colno] = sstrndup(field, size);
+					errno = 0;
 
-				expstate->colno += 1;
-			}
-			else
-			{
-				if (expstate->colno == 0)
+					if (expstate->batch_rows == 0)
+					{
+						fputs("INSERT INTO ", expstate->fp);
+						fput_target_table(expstate);
+						fputs(" VALUES\n(", expstate->fp);
+					}
+					else
+						fputs(",\n(", expstate->fp);
+				}
+				else if (expstate->colno == 0)
 				{
 					errno = 0;
 
 					fputs("INSERT INTO ", expstate->fp);
-					fputs(expstate->table_name, expstate->fp);
 
-					if (expstate->colnames)
+					if (expstate->format == CLIPBOARD_FORMAT_INSERT)
+						fput_target_table(expstate);
+					else
 					{
-						int		i;
-						bool	is_first = true;
-
-						fputc('(', expstate->fp);
-
-						if (expstate->format == CLIPBOARD_FORMAT_INSERT)
-						{
-							for (i = 0; i < expstate->columns; i++)
-							{
-								if (expstate->colnames[i])
-								{
-									if (!is_first)
-										fputs(", ", expstate->fp);
-									else
-										is_first = false;
-
-									fputs(expstate->colnames[i], expstate->fp);
-								}
-								else
-									break;
-							}
+						fputs(expstate->table_name, expstate->fp);
 
-							fputc(')', expstate->fp);
-						}
-						else
+						if (expstate->colnames)
 						{
 							int		indent_spaces;
 							int		columns = 0;
 							int		loc_colno = 0;
+							int		i;
+
+							fputc('(', expstate->fp);
 
 							if (expstate->force8bit)
 								indent_spaces = strlen(expstate->table_name) + 1 + 12;
@@ -505,7 +577,7 @@ process_item(ExportState *expstate,
 						fputs("   VALUES(", expstate->fp);
 				}
 
-				if (expstate->format == CLIPBOARD_FORMAT_INSERT)
+				if (expstate->format != CLIPBOARD_FORMAT_INSERT_WITH_COMMENTS)
 				{
 					if (expstate->colno > 0)
 						fputs(", ", expstate->fp);
@@ -520,22 +592,78 @@ process_item(ExportState *expstate,
 					}
 				}
 
-				field = trim_str(field, &size, expstate->force8bit);
-				_field = quote_sql_literal(field,
-										   &size,
-										   expstate->force8bit,
-										   expstate->empty_string_is_null);
+				if (!expstate->source_values)
+					field = trim_str(field, &size, expstate->force8bit);
 
-				fwrite(_field, size, 1, expstate->fp);
+				fput_sql_literal(expstate, field, size);
 
 				expstate->colno += 1;
+			}
+		}
+	}
 
-				if (_field != field)
-					free(_field);
+	/*
+	 * Export in text format of COPY FROM stdin command
+	 */
+	else if (expstate->format == CLIPBOARD_FORMAT_COPY)
+	{
+		errno = 0;
+
+		if (typ == 'N' && !is_colname && !has_continue_mark)
+			fputc('\n', expstate->fp);
+		else if (typ == 'd')
+		{
+			if (is_colname)
+				save_column_name(expstate, field, size);
+			else
+			{
+				if (!expstate->copy_started)
+				{
+					fputs("COPY ", expstate->fp);
+					fput_target_table(expstate);
+					fputs(" FROM stdin;\n", expstate->fp);
+
+					expstate->copy_started = true;
+				}
+
+				if (expstate->colno > 0)
+					fputc('\t', expstate->fp);
+
+				if (!expstate->source_values)
+					field = trim_str(field, &size, expstate->force8bit);
+
+				fput_copy_value(expstate, field, size);
+
+				expstate->colno += 1;
 			}
 		}
 	}
 
+	/*
+	 * Export to Apache Arrow file. Values are collected by columns,
+	 * and the file is written by record batches.
+	 */
+	else if (expstate->format == CLIPBOARD_FORMAT_ARROW)
+	{
+		if (typ == 'N' && !is_colname && !has_continue_mark)
+			return arrow_end_row(expstate->arrow);
+		else if (typ == 'd')
+		{
+			if (!expstate->source_values)
+				field = trim_str(field, &size, expstate->force8bit);
+
+			if (is_colname)
+				arrow_set_column_name(expstate->arrow, expstate->colno, field, size);
+			else
+				arrow_add_value(expstate->arrow, expstate->colno, field, size,
+								is_null_value(expstate, field, size));
+
+			expstate->colno += 1;
+		}
+
+		return true;
+	}
+
 	/*
 	 * Export in formatted text format
 	 */
@@ -576,31 +704,19 @@ process_item(ExportState *expstate,
 		{
 			if (typ == 'd')
 			{
-				int saved_errno = 0;
-				char   *_field;
-
-				field = trim_str(field, &size, expstate->force8bit);
-
-				_field = csv_format(field, &size,
-									expstate->force8bit,
-									expstate->empty_string_is_null);
-
+				if (!expstate->source_values)
+					field = trim_str(field, &size, expstate->force8bit);
 
 				if (expstate->copy_line_extended && is_colname)
 				{
-
 					if (!expstate->colnames)
 					{
 						expstate->colnames = smalloc(sizeof(char *) * expstate->columns);
 						memset(expstate->colnames, 0, sizeof(char *) * expstate->columns);
 					}
 
-					if (!_field)
-						expstate->colnames[expstate->colno] = sstrdup("");
-					else if (_field != field)
-						expstate->colnames[expstate->colno] = _field;
-					else
-						expstate->colnames[expstate->colno] = sstrndup(field, size);
+					/* the name is written (and quoted) later */
+					expstate->colnames[expstate->colno] = sstrndup(field, size);
 
 					expstate->colno += 1;
 
@@ -613,32 +729,27 @@ process_item(ExportState *expstate,
 				{
 					if (expstate->colno > 0)
 					{
-
 						if (expstate->format == CLIPBOARD_FORMAT_CSV)
 							fputc(',', expstate->fp);
 						else if (expstate->format == CLIPBOARD_FORMAT_TSVC)
 							fputc('\t', expstate->fp);
 					}
 
-					if (_field && !errno)
-					{
-						errno = 0;
-						fwrite(_field, size, 1, expstate->fp);
-					}
+					fput_csv_value(expstate, field, size);
 				}
 				else
-					fprintf(expstate->fp, "%s,%.*s\n",
-								  expstate->colnames[expstate->colno],
-								  size, _field);
-
-				saved_errno = errno;
+				{
+					char	   *colname = expstate->colnames[expstate->colno];
 
-				expstate->colno += 1;
+					if (*colname)
+						fput_csv_value(expstate, colname, strlen(colname));
 
-				if (_field != field)
-					free(_field);
+					fputc(',', expstate->fp);
+					fput_csv_value(expstate, field, size);
+					fputc('\n', expstate->fp);
+				}
 
-				errno = saved_errno;
+				expstate->colno += 1;
 			}
 		}
 	}
@@ -654,6 +765,80 @@ process_item(ExportState *expstate,
 	return true;
 }
 
+/*
+ * Close last multirow INSERT or COPY command, or write
+ * end of Apache Arrow file.
+ */
+static bool
+finish_export(ExportState *expstate)
+{
+	if (expstate->arrow)
+		return arrow_writer_finish(expstate->arrow);
+
+	errno = 0;
+
+	if (expstate->format == CLIPBOARD_FORMAT_INSERT_BATCH && expstate->batch_rows > 0)
+		fputs(";\n", expstate->fp);
+	else if (expstate->format == CLIPBOARD_FORMAT_COPY && expstate->copy_started)
+		fputs("\\.\n", expstate->fp);
+
+	if (errno != 0)
+	{
+		format_error("%s", strerror(errno));
+		log_row("Cannot write (%s)", current_state->errstr);
+
+		return false;
+	}
+
+	return true;
+}
+
+/*
+ * Export not formatted row of query result. The multiline
+ * values are complete, so continuation lines are skipped.
+ */
+static bool
+process_source_row(ExportState *expstate,
+				   DataDesc *desc,
+				   int lineno,
+				   bool is_colname)
+{
+	ColumnStore *cs = desc->colstore;
+	int			rowno = cs_find_row(cs, lineno);
+	int			i;
+
+	if (rowno == -1)
+		return true;
+
+	for (i = 0; i < desc->columns; i++)
+	{
+		/* any position inside column is good for selection check */
+		int		xpos = (desc->cranges[i].xmin + desc->cranges[i].xmax) / 2;
+		int		colno = get_source_column(desc, i);
+		const char *value;
+		int		size;
+
+		if (colno >= cs->ncolumns)
+			break;
+
+		value = cs_get_value(cs, rowno, colno, &size);
+
+		/* missing value of short row */
+		if (!value)
+		{
+			value = "";
+			size = 0;
+		}
+
+		if (!process_item(expstate, 'd',
+						  (char *) value, size, xpos,
+						  is_colname, false))
+			return false;
+	}
+
+	return process_item(expstate, 'N', NULL, 0, -1, is_colname, false);
+}
+
 /*
  * Exports data to defined stream in requested format.
  * Returns true, when the operation was successfull
@@ -669,13 +854,15 @@ export_data(Options *opts,
 			double percent,
 			char *table_name,
 			PspgCommand cmd,
-			ClipboardFormat format)
+			ClipboardFormat format,
+			ExportProgress *progress)
 {
 	LineBufferIter	lbi;
 	LineBufferMark	lbm;
 
 	int		rn;
 	char   *rowstr;
+	int		rowsize;
 	bool	print_header = true;
 	bool	print_footer = true;
 	bool	print_border = true;
@@ -687,6 +874,11 @@ export_data(Options *opts,
 	int		max_row = desc->last_row;
 
 	bool	isok = true;
+	int		processed_rows = 0;
+
+	int	   *bookmarks = NULL;
+	int		nbookmarks = 0;
+	int		bookmark_idx = 0;
 
 	ExportState expstate;
 
@@ -702,6 +894,11 @@ export_data(Options *opts,
 	expstate.columns = desc->columns;
 	expstate.copy_line_extended = (cmd == cmd_CopyLineExtended);
 	expstate.linestyle = desc->linestyle;
+	expstate.source_values = desc->colstore && format != CLIPBOARD_FORMAT_TEXT;
+	expstate.batch_size = opts->insert_batch_size;
+	expstate.batch_rows = 0;
+	expstate.copy_started = false;
+	expstate.arrow = NULL;
 
 	current_state->errstr = NULL;
 
@@ -713,9 +910,9 @@ export_data(Options *opts,
 		format = CLIPBOARD_FORMAT_CSV;
 
 	if (cmd == cmd_CopyLineExtended ||
-		INSERT_FORMAT_TYPE(format))
+		SQL_FORMAT_TYPE(format))
 	{
-		if (INSERT_FORMAT_TYPE(format))
+		if (SQL_FORMAT_TYPE(format))
 		{
 			int		slen = strlen(table_name);
 
@@ -799,6 +996,40 @@ export_data(Options *opts,
 			print_footer = false;
 	}
 
+	/*
+	 * The types of columns of Arrow file should be known before first
+	 * row. The types are detected from all rows (or are taken from
+	 * query result).
+	 */
+	if (format == CLIPBOARD_FORMAT_ARROW)
+	{
+		ColumnType *types = smalloc((desc->columns + 1) * sizeof(ColumnType));
+		bool	   *utc = smalloc((desc->columns + 1) * sizeof(bool));
+		int			ncolumns = 0;
+		int			i;
+
+		for (i = 0; i < desc->columns; i++)
+		{
+			ColumnValues *cv;
+			int		xpos = (desc->cranges[i].xmin + desc->cranges[i].xmax) / 2;
+
+			/* only columns from selected range */
+			if (expstate.xmin != -1 &&
+				  (xpos <= expstate.xmin || expstate.xmax <= xpos))
+				continue;
+
+			cv = get_column_values(opts, desc, i);
+
+			utc[ncolumns] = cv->has_time_zone;
+			types[ncolumns++] = cv->type;
+		}
+
+		expstate.arrow = arrow_writer_create(fp, ncolumns, types, utc);
+
+		free(types);
+		free(utc);
+	}
+
 	if (format != CLIPBOARD_FORMAT_TEXT)
 	{
 		print_border = false;
@@ -833,7 +1064,7 @@ export_data(Options *opts,
 				LineInfo *linfo;
 				bool		continuation_mark;
 
-				(void) lbm_get_line(&lbm, &rowstr, &linfo, &rn);
+				(void) lbm_get_line(&lbm, NULL, NULL, &linfo, &rn);
 
 				continuation_mark = linfo && linfo->mask & LINEINFO_CONTINUATION;
 
@@ -880,6 +1111,10 @@ export_data(Options *opts,
 		}
 	}
 
+	/* only bitsets of line buffers with bookmarks are read */
+	if (cmd == cmd_CopyMarkedLines)
+		bookmarks = ddesc_get_bookmark_positions(desc, &nbookmarks);
+
 	init_lbi_ddesc(&lbi, desc, 0);
 
 	while (lbi_set_mark_next(&lbi, &lbm))
@@ -896,7 +1131,48 @@ export_data(Options *opts,
 		bool	is_colname = false;
 		bool	continuation_mark = false;
 
-		(void) lbm_get_line(&lbm, &rowstr, &linfo, &rn);
+		/* data rows without bookmark are skipped without loading */
+		if (cmd == cmd_CopyMarkedLines &&
+			lbm.lineno >= desc->first_data_row && lbm.lineno <= desc->last_data_row)
+		{
+			while (bookmark_idx < nbookmarks && bookmarks[bookmark_idx] < lbm.lineno)
+				bookmark_idx += 1;
+
+			if (bookmark_idx == nbookmarks || bookmarks[bookmark_idx] != lbm.lineno)
+			{
+				int		pos = desc->last_data_row + 1;
+
+				if (bookmark_idx < nbookmarks && bookmarks[bookmark_idx] < pos)
+					pos = bookmarks[bookmark_idx];
+
+				init_lbi_ddesc(&lbi, desc, pos);
+				continue;
+			}
+		}
+
+		(void) lbm_get_line(&lbm, &rowstr, &rowsize, &linfo, &rn);
+
+		if (progress && (++processed_rows % EXPORT_PROGRESS_STEP) == 0)
+		{
+			bool	cancel_requested;
+
+			pthread_mutex_lock(&progress->mutex);
+			progress->processed_rows = processed_rows;
+			cancel_requested = progress->cancel_requested;
+			pthread_mutex_unlock(&progress->mutex);
+
+			if (cancel_requested)
+			{
+				format_error("canceled");
+				isok = false;
+
+				pthread_mutex_lock(&progress->mutex);
+				progress->canceled = true;
+				pthread_mutex_unlock(&progress->mutex);
+
+				goto exit_export;
+			}
+		}
 
 		/* reduce rows from export */
 		if (rn >= desc->first_data_row && rn <= desc->last_data_row)
@@ -904,15 +1180,10 @@ export_data(Options *opts,
 			if (rn < min_row || rn > max_row)
 				continue;
 
-			if (cmd == cmd_CopyMarkedLines)
-			{
-				if (!linfo || ((linfo->mask & LINEINFO_BOOKMARK) == 0))
-					continue;
-			}
 			if (cmd == cmd_CopySearchedLines)
 			{
 				/* force lineinfo setting */
-				linfo = set_line_info(opts, scrdesc, &lbm, rowstr);
+				linfo = set_line_info(opts, scrdesc, NULL, &lbm, rowstr, rowsize);
 
 				if (!linfo || ((linfo->mask & LINEINFO_FOUNDSTR) == 0))
 					continue;
@@ -938,9 +1209,27 @@ export_data(Options *opts,
 				continue;
 		}
 
+		if (expstate.source_values)
+		{
+			expstate.colno = 0;
+
+			/* rows of column store are identified by original line number */
+			isok = process_source_row(&expstate, desc,
+									  lbm.lb->first_row + lbm.lb_rowno,
+									  is_colname);
+			if (!isok)
+				goto exit_export;
+
+			continue;
+		}
+
 		iter.headline = desc->headline_transl;
 		iter.row = rowstr;
-		iter.force8bit = opts->force8bit;
+		iter.end = rowstr + rowsize;
+
+		/* only already known width is used, export runs in own thread */
+		iter.force8bit = opts->force8bit ||
+						 lb_is_ascii_row(lbm.lb, lbm.lb_rowno, false, false);
 		iter.xpos = 0;
 
 		field = NULL; field_size = 0; field_xpos = -1;
@@ -1008,8 +1297,15 @@ export_data(Options *opts,
 			goto exit_export;
 	}
 
+	isok = finish_export(&expstate);
+
 exit_export:
 
+	free(bookmarks);
+
+	if (expstate.arrow)
+		arrow_writer_free(expstate.arrow);
+
 	if (expstate.colnames)
 	{
 		int		i;
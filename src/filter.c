@@ -0,0 +1,1174 @@
+/*-------------------------------------------------------------------------
+ *
+ * filter.c
+ *	  filtering rows by predicate over columns
+ *
+ * Portions Copyright (c) 2017-2021 Pavel Stehule
+ *
+ * IDENTIFICATION
+ *	  src/filter.c
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include <ctype.h>
+#include <regex.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include "pspg.h"
+#include "unicode.h"
+
+/*
+ * Syntax of filter:
+ *
+ *   expr := and_expr [ OR and_expr ... ]
+ *   and_expr := not_expr [ AND not_expr ... ]
+ *   not_expr := NOT not_expr | ( expr ) | cond
+ *   cond := column op value | column [NOT] LIKE value |
+ *           column [NOT] ILIKE value | column IS [NOT] NULL
+ *   op := = | <> | != | < | <= | > | >= | ~ | ~* | !~ | !~*
+ *
+ * Column is specified by number (starts by 1) or by name. The name
+ * can be double quoted. Value can be single quoted. The numbers,
+ * dates and intervals are compared by value, when the column has
+ * this type.
+ */
+typedef enum
+{
+	FILTER_NODE_AND,
+	FILTER_NODE_OR,
+	FILTER_NODE_NOT,
+	FILTER_NODE_COND
+} FilterNodeType;
+
+typedef enum
+{
+	FILTER_OP_EQ,
+	FILTER_OP_NE,
+	FILTER_OP_LT,
+	FILTER_OP_LE,
+	FILTER_OP_GT,
+	FILTER_OP_GE,
+	FILTER_OP_LIKE,
+	FILTER_OP_ILIKE,
+	FILTER_OP_REGEX,
+	FILTER_OP_IS_NULL
+} FilterOperator;
+
+typedef struct FilterNode
+{
+	FilterNodeType type;
+	struct FilterNode *left;
+	struct FilterNode *right;
+
+	int			colno;					/* zero based column number */
+	FilterOperator op;
+	bool		negate;					/* NOT LIKE, !~, IS NOT NULL */
+	char	   *value;
+	int			value_size;
+	bool		by_value;				/* compare parsed (double) values */
+	double		d;
+	regex_t    *regexes;				/* one regex for every worker */
+	int			nregexes;
+} FilterNode;
+
+/*
+ * Saved position of rows, that are moved by filtering
+ */
+typedef struct
+{
+	int			last_row;
+	int			maxy;
+	int			last_data_row;
+	int			border_bottom_row;
+	int			footer_row;
+	int			alt_footer_row;
+} RowsGeometry;
+
+struct RowFilter
+{
+	FilterNode *root;
+	int			nworkers;
+	bool	   *matches;				/* result for first line of row */
+	MappedLine *unfiltered_order_map;
+	int			unfiltered_order_map_items;
+	RowsGeometry geometry;
+};
+
+typedef struct
+{
+	Options    *opts;
+	DataDesc   *desc;
+	const char *str;
+	const char *ptr;
+	int			nworkers;
+} FilterParser;
+
+typedef enum
+{
+	FILTER_TOKEN_END,
+	FILTER_TOKEN_WORD,
+	FILTER_TOKEN_QIDENT,
+	FILTER_TOKEN_STRING,
+	FILTER_TOKEN_OPERATOR,
+	FILTER_TOKEN_LPAREN,
+	FILTER_TOKEN_RPAREN
+} FilterTokenType;
+
+typedef struct
+{
+	FilterTokenType type;
+	const char *start;
+	char	   *value;
+	int			size;
+} FilterToken;
+
+typedef struct
+{
+	RowFilter  *rf;
+	DataDesc   *desc;
+	ColumnValues **cvs;
+	int			worker;					/* index of compiled regexes */
+	bool		force8bit;
+	char	   *buffer;					/* zero terminated value for regexec */
+	int			buffer_size;
+} FilterWorker;
+
+static FilterNode *parse_expr(FilterParser *parser);
+
+static void
+free_filter_node(FilterNode *node)
+{
+	int			i;
+
+	if (!node)
+		return;
+
+	free_filter_node(node->left);
+	free_filter_node(node->right);
+
+	for (i = 0; i < node->nregexes; i++)
+		regfree(&node->regexes[i]);
+
+	free(node->regexes);
+	free(node->value);
+	free(node);
+}
+
+void
+free_row_filter(RowFilter *rf)
+{
+	if (!rf)
+		return;
+
+	free_filter_node(rf->root);
+	free(rf->matches);
+	free(rf->unfiltered_order_map);
+	free(rf);
+}
+
+static bool
+is_word_char(char c)
+{
+	return c != '\0' && !isspace((unsigned char) c) && !strchr("()=<>!~'\"", c);
+}
+
+/*
+ * Reads next token. Returned value is allocated, and should be
+ * released by caller.
+ */
+static bool
+next_token(FilterParser *parser, FilterToken *token)
+{
+	const char *ptr = parser->ptr;
+
+	while (isspace((unsigned char) *ptr))
+		ptr++;
+
+	token->start = ptr;
+	token->value = NULL;
+	token->size = 0;
+
+	if (*ptr == '\0')
+		token->type = FILTER_TOKEN_END;
+	else if (*ptr == '(' || *ptr == ')')
+	{
+		token->type = *ptr == '(' ? FILTER_TOKEN_LPAREN : FILTER_TOKEN_RPAREN;
+		ptr++;
+	}
+	else if (*ptr == '\'' || *ptr == '"')
+	{
+		char		quote = *ptr++;
+		char	   *value = smalloc(strlen(ptr) + 1);
+		int			size = 0;
+
+		/* quote inside string is doubled */
+		while (*ptr)
+		{
+			if (*ptr == quote)
+			{
+				if (ptr[1] != quote)
+					break;
+
+				ptr++;
+			}
+
+			value[size++] = *ptr++;
+		}
+
+		if (*ptr != quote)
+		{
+			free(value);
+			format_error("unterminated quoted string");
+			return false;
+		}
+
+		ptr++;
+
+		token->type = quote == '"' ? FILTER_TOKEN_QIDENT : FILTER_TOKEN_STRING;
+		token->value = value;
+		token->size = size;
+	}
+	else if (strchr("=<>!~", *ptr))
+	{
+		const char *start = ptr;
+
+		while (*ptr && strchr("=<>!~*", *ptr))
+			ptr++;
+
+		token->type = FILTER_TOKEN_OPERATOR;
+		token->value = sstrndup(start, ptr - start);
+		token->size = ptr - start;
+	}
+	else
+	{
+		const char *start = ptr;
+
+		while (is_word_char(*ptr))
+			ptr++;
+
+		token->type = FILTER_TOKEN_WORD;
+		token->value = sstrndup(start, ptr - start);
+		token->size = ptr - start;
+	}
+
+	parser->ptr = ptr;
+
+	return true;
+}
+
+/*
+ * Returns true, when next token is specified keyword. The keyword
+ * is consumed.
+ */
+static bool
+accept_keyword(FilterParser *parser, const char *keyword)
+{
+	const char *ptr = parser->ptr;
+	size_t		len = strlen(keyword);
+
+	while (isspace((unsigned char) *ptr))
+		ptr++;
+
+	if (strncasecmp(ptr, keyword, len) == 0 && !is_word_char(ptr[len]))
+	{
+		parser->ptr = ptr + len;
+		return true;
+	}
+
+	return false;
+}
+
+static bool
+accept_char(FilterParser *parser, char c)
+{
+	const char *ptr = parser->ptr;
+
+	while (isspace((unsigned char) *ptr))
+		ptr++;
+
+	if (*ptr == c)
+	{
+		parser->ptr = ptr + 1;
+		return true;
+	}
+
+	return false;
+}
+
+static bool
+is_keyword(FilterToken *token)
+{
+	static const char *keywords[] = {"and", "or", "not", "like", "ilike", "is", "null", NULL};
+	const char **kw;
+
+	if (token->type != FILTER_TOKEN_WORD)
+		return false;
+
+	for (kw = keywords; *kw; kw++)
+		if (strcasecmp(token->value, *kw) == 0)
+			return true;
+
+	return false;
+}
+
+/*
+ * Returns zero based number of column specified by number or
+ * by name. Returns -1 when column doesn't exist.
+ */
+static int
+find_column(DataDesc *desc, FilterToken *token)
+{
+	int			i;
+
+	if (token->type == FILTER_TOKEN_WORD)
+	{
+		char	   *endptr;
+		long		colno = strtol(token->value, &endptr, 10);
+
+		if (*endptr == '\0')
+			return colno >= 1 && colno <= desc->columns ? colno - 1 : -1;
+	}
+
+	if (!desc->namesline)
+		return -1;
+
+	for (i = 0; i < desc->columns; i++)
+	{
+		const char *name = desc->namesline + desc->cranges[i].name_offset;
+		int			size = desc->cranges[i].name_size;
+
+		if (size != token->size)
+			continue;
+
+		/* quoted names are case sensitive */
+		if (token->type == FILTER_TOKEN_QIDENT ?
+			memcmp(name, token->value, size) == 0 :
+			strncasecmp(name, token->value, size) == 0)
+			return i;
+	}
+
+	return -1;
+}
+
+static bool
+get_operator(const char *str, FilterOperator *op, bool *negate)
+{
+	*negate = false;
+
+	if (strcmp(str, "=") == 0 || strcmp(str, "==") == 0)
+		*op = FILTER_OP_EQ;
+	else if (strcmp(str, "<>") == 0 || strcmp(str, "!=") == 0)
+		*op = FILTER_OP_NE;
+	else if (strcmp(str, "<") == 0)
+		*op = FILTER_OP_LT;
+	else if (strcmp(str, "<=") == 0)
+		*op = FILTER_OP_LE;
+	else if (strcmp(str, ">") == 0)
+		*op = FILTER_OP_GT;
+	else if (strcmp(str, ">=") == 0)
+		*op = FILTER_OP_GE;
+	else if (strcmp(str, "~") == 0 || strcmp(str, "~*") == 0)
+		*op = FILTER_OP_REGEX;
+	else if (strcmp(str, "!~") == 0 || strcmp(str, "!~*") == 0)
+	{
+		*op = FILTER_OP_REGEX;
+		*negate = true;
+	}
+	else
+		return false;
+
+	return true;
+}
+
+/*
+ * Every worker thread uses own compiled regular expression,
+ * because regexec can serialize concurrent calls.
+ */
+static bool
+compile_regexes(FilterNode *node, int nregexes, bool icase)
+{
+	int			flags = REG_EXTENDED | REG_NOSUB | (icase ? REG_ICASE : 0);
+	int			i;
+
+	node->regexes = smalloc(nregexes * sizeof(regex_t));
+
+	for (i = 0; i < nregexes; i++)
+	{
+		int			rc = regcomp(&node->regexes[i], node->value, flags);
+
+		if (rc != 0)
+		{
+			char		errbuf[256];
+
+			regerror(rc, &node->regexes[i], errbuf, sizeof(errbuf));
+			format_error("invalid regular expression (%s)", errbuf);
+
+			return false;
+		}
+
+		node->nregexes += 1;
+	}
+
+	return true;
+}
+
+static FilterNode *
+parse_cond(FilterParser *parser)
+{
+	FilterNode *node;
+	FilterToken column;
+	FilterToken token;
+	ColumnValues *cv;
+	bool		icase = false;
+
+	if (!next_token(parser, &column))
+		return NULL;
+
+	if ((column.type != FILTER_TOKEN_WORD && column.type != FILTER_TOKEN_QIDENT) ||
+		is_keyword(&column))
+	{
+		free(column.value);
+		format_error("column is expected at \"%s\"", column.start);
+		return NULL;
+	}
+
+	node = smalloc(sizeof(FilterNode));
+	node->type = FILTER_NODE_COND;
+
+	node->colno = find_column(parser->desc, &column);
+	if (node->colno == -1)
+	{
+		format_error("column \"%s\" does not exist", column.value);
+		free(column.value);
+		free(node);
+		return NULL;
+	}
+
+	free(column.value);
+
+	if (accept_keyword(parser, "is"))
+	{
+		node->op = FILTER_OP_IS_NULL;
+		node->negate = accept_keyword(parser, "not");
+
+		if (!accept_keyword(parser, "null"))
+		{
+			format_error("NULL is expected at \"%s\"", parser->ptr);
+			free_filter_node(node);
+			return NULL;
+		}
+
+		return node;
+	}
+
+	node->negate = accept_keyword(parser, "not");
+
+	if (accept_keyword(parser, "like"))
+		node->op = FILTER_OP_LIKE;
+	else if (accept_keyword(parser, "ilike"))
+		node->op = FILTER_OP_ILIKE;
+	else if (node->negate)
+	{
+		format_error("LIKE is expected at \"%s\"", parser->ptr);
+		free_filter_node(node);
+		return NULL;
+	}
+	else
+	{
+		if (!next_token(parser, &token))
+		{
+			free_filter_node(node);
+			return NULL;
+		}
+
+		if (token.type != FILTER_TOKEN_OPERATOR ||
+			!get_operator(token.value, &node->op, &node->negate))
+		{
+			format_error("operator is expected at \"%s\"", token.start);
+			free(token.value);
+			free_filter_node(node);
+			return NULL;
+		}
+
+		icase = token.value[token.size - 1] == '*';
+		free(token.value);
+	}
+
+	if (!next_token(parser, &token))
+	{
+		free_filter_node(node);
+		return NULL;
+	}
+
+	if ((token.type != FILTER_TOKEN_WORD && token.type != FILTER_TOKEN_STRING) ||
+		is_keyword(&token))
+	{
+		format_error("value is expected at \"%s\"", token.start);
+		free(token.value);
+		free_filter_node(node);
+		return NULL;
+	}
+
+	node->value = token.value;
+	node->value_size = token.size;
+
+	if (node->op == FILTER_OP_REGEX)
+	{
+		if (!compile_regexes(node, parser->nworkers + 1, icase))
+		{
+			free_filter_node(node);
+			return NULL;
+		}
+
+		return node;
+	}
+
+	if (node->op == FILTER_OP_LIKE || node->op == FILTER_OP_ILIKE)
+		return node;
+
+	/* values of not text columns are compared by binary value */
+	cv = get_column_values(parser->opts, parser->desc, node->colno);
+	if (cv->values)
+	{
+		ColumnType	t = parse_typed_value(node->value, node->value_size, &node->d);
+
+		if (t == COLUMN_TYPE_TEXT ||
+			merge_column_types(cv->type, t) == COLUMN_TYPE_TEXT)
+		{
+			format_error("value \"%s\" cannot be compared with column %d",
+						 node->value, node->colno + 1);
+			free_filter_node(node);
+			return NULL;
+		}
+
+		node->by_value = true;
+	}
+
+	return node;
+}
+
+static FilterNode *
+make_node(FilterNodeType type, FilterNode *left, FilterNode *right)
+{
+	FilterNode *node = smalloc(sizeof(FilterNode));
+
+	node->type = type;
+	node->left = left;
+	node->right = right;
+
+	return node;
+}
+
+static FilterNode *
+parse_not_expr(FilterParser *parser)
+{
+	FilterNode *node;
+
+	if (accept_keyword(parser, "not"))
+	{
+		node = parse_not_expr(parser);
+
+		return node ? make_node(FILTER_NODE_NOT, node, NULL) : NULL;
+	}
+
+	if (accept_char(parser, '('))
+	{
+		node = parse_expr(parser);
+		if (!node)
+			return NULL;
+
+		if (!accept_char(parser, ')'))
+		{
+			format_error("\")\" is expected at \"%s\"", parser->ptr);
+			free_filter_node(node);
+			return NULL;
+		}
+
+		return node;
+	}
+
+	return parse_cond(parser);
+}
+
+static FilterNode *
+parse_and_expr(FilterParser *parser)
+{
+	FilterNode *node = parse_not_expr(parser);
+
+	while (node && accept_keyword(parser, "and"))
+	{
+		FilterNode *right = parse_not_expr(parser);
+
+		if (!right)
+		{
+			free_filter_node(node);
+			return NULL;
+		}
+
+		node = make_node(FILTER_NODE_AND, node, right);
+	}
+
+	return node;
+}
+
+static FilterNode *
+parse_expr(FilterParser *parser)
+{
+	FilterNode *node = parse_and_expr(parser);
+
+	while (node && accept_keyword(parser, "or"))
+	{
+		FilterNode *right = parse_and_expr(parser);
+
+		if (!right)
+		{
+			free_filter_node(node);
+			return NULL;
+		}
+
+		node = make_node(FILTER_NODE_OR, node, right);
+	}
+
+	return node;
+}
+
+/*
+ * Compile filter's expression. Returns NULL, when the expression
+ * is not valid. Error message is available by current_state->errstr.
+ */
+RowFilter *
+compile_row_filter(Options *opts, DataDesc *desc, const char *str)
+{
+	FilterParser parser;
+	FilterNode *root;
+	RowFilter  *rf;
+
+	if (desc->columns == 0)
+	{
+		format_error("columns are not detected");
+		return NULL;
+	}
+
+	/* multilines should be detected before evaluation */
+	multilines_detection(opts, desc);
+
+	parser.opts = opts;
+	parser.desc = desc;
+	parser.str = str;
+	parser.ptr = str;
+	parser.nworkers = lb_get_parallel_workers();
+
+	root = parse_expr(&parser);
+	if (!root)
+		return NULL;
+
+	while (isspace((unsigned char) *parser.ptr))
+		parser.ptr++;
+
+	if (*parser.ptr)
+	{
+		format_error("syntax error at \"%s\"", parser.ptr);
+		free_filter_node(root);
+		return NULL;
+	}
+
+	rf = smalloc(sizeof(RowFilter));
+	rf->root = root;
+	rf->nworkers = parser.nworkers;
+
+	return rf;
+}
+
+/*
+ * Returns folded char and moves pointer to next char
+ */
+static int
+like_char(const char **str, bool force8bit, bool icase)
+{
+	const char *s = *str;
+	int			c;
+
+	if (force8bit || (unsigned char) *s < 128)
+	{
+		c = icase ? tolower((unsigned char) *s) : (unsigned char) *s;
+		*str = s + 1;
+	}
+	else
+	{
+		int			len = utf8charlen(*s);
+
+		if (icase)
+			c = utf8_tofold(s);
+		else
+		{
+			int			i;
+
+			c = 0;
+			for (i = 0; i < len; i++)
+				c = (c << 8) | (unsigned char) s[i];
+		}
+
+		*str = s + len;
+	}
+
+	return c;
+}
+
+/*
+ * SQL LIKE. The "%" is any string, the "_" is any char. The state
+ * is returned to position after last "%", so there is not any
+ * exponential backtracking.
+ */
+static bool
+like_match(const char *str, int size, const char *pattern, bool force8bit, bool icase)
+{
+	const char *end = str + size;
+	const char *pstar = NULL;
+	const char *sstar = NULL;
+
+	while (str < end)
+	{
+		if (*pattern == '%')
+		{
+			while (*pattern == '%')
+				pattern++;
+
+			if (!*pattern)
+				return true;
+
+			pstar = pattern;
+			sstar = str;
+			continue;
+		}
+
+		if (*pattern)
+		{
+			const char *p = pattern;
+			const char *s = str;
+
+			if (*p == '_')
+			{
+				(void) like_char(&s, force8bit, false);
+				p++;
+			}
+			else if (like_char(&p, force8bit, icase) != like_char(&s, force8bit, icase))
+				goto mismatch;
+
+			pattern = p;
+			str = s;
+			continue;
+		}
+
+mismatch:
+
+		if (!pstar)
+			return false;
+
+		/* try to match rest of pattern from next char */
+		(void) like_char(&sstar, force8bit, false);
+		pattern = pstar;
+		str = sstar;
+	}
+
+	while (*pattern == '%')
+		pattern++;
+
+	return *pattern == '\0';
+}
+
+static int
+compare_text(const char *str, int size, FilterNode *node)
+{
+	int			result;
+
+	result = memcmp(str, node->value, size < node->value_size ? size : node->value_size);
+
+	if (result == 0)
+		result = size - node->value_size;
+
+	return result;
+}
+
+static bool
+eval_cond(FilterWorker *fw, FilterNode *node, const char *line, int lineno)
+{
+	ColumnValues *cv = fw->cvs[node->colno];
+	const char *str = NULL;
+	int			size = 0;
+	bool		isnull;
+	int			cmp = 0;
+
+	if (node->by_value)
+	{
+		isnull = cv->isnull[lineno];
+
+		if (!isnull)
+			cmp = cv->values[lineno] < node->d ? -1 : (cv->values[lineno] > node->d ? 1 : 0);
+	}
+	else
+	{
+		str = get_field_value(fw->desc, line, lineno, node->colno, &size);
+		isnull = str == NULL || (cv->isnull && cv->isnull[lineno]);
+	}
+
+	if (node->op == FILTER_OP_IS_NULL)
+		return node->negate ? !isnull : isnull;
+
+	/* comparison with NULL is not true */
+	if (isnull)
+		return false;
+
+	switch (node->op)
+	{
+		case FILTER_OP_LIKE:
+		case FILTER_OP_ILIKE:
+			return like_match(str, size, node->value, fw->force8bit,
+							  node->op == FILTER_OP_ILIKE) != node->negate;
+
+		case FILTER_OP_REGEX:
+			if (size + 1 > fw->buffer_size)
+			{
+				fw->buffer_size = size + 1024;
+				fw->buffer = srealloc(fw->buffer, fw->buffer_size);
+			}
+
+			memcpy(fw->buffer, str, size);
+			fw->buffer[size] = '\0';
+
+			return (regexec(&node->regexes[fw->worker], fw->buffer, 0, NULL, 0) == 0) != node->negate;
+
+		default:
+			break;
+	}
+
+	if (!node->by_value)
+		cmp = compare_text(str, size, node);
+
+	switch (node->op)
+	{
+		case FILTER_OP_EQ:
+			return cmp == 0;
+		case FILTER_OP_NE:
+			return cmp != 0;
+		case FILTER_OP_LT:
+			return cmp < 0;
+		case FILTER_OP_LE:
+			return cmp <= 0;
+		case FILTER_OP_GT:
+			return cmp > 0;
+		case FILTER_OP_GE:
+			return cmp >= 0;
+		default:
+			return false;
+	}
+}
+
+static bool
+eval_node(FilterWorker *fw, FilterNode *node, const char *line, int lineno)
+{
+	switch (node->type)
+	{
+		case FILTER_NODE_AND:
+			return eval_node(fw, node->left, line, lineno) &&
+				   eval_node(fw, node->right, line, lineno);
+		case FILTER_NODE_OR:
+			return eval_node(fw, node->left, line, lineno) ||
+				   eval_node(fw, node->right, line, lineno);
+		case FILTER_NODE_NOT:
+			return !eval_node(fw, node->left, line, lineno);
+		case FILTER_NODE_COND:
+			return eval_cond(fw, node, line, lineno);
+	}
+
+	return false;
+}
+
+/*
+ * Evaluate predicate for first lines of rows of one line buffer.
+ * When peek_only is true, then the line buffer is not loaded, and
+ * only line buffers in memory or rows of column store can be processed.
+ */
+static bool
+eval_block(void *arg, LineBuffer *lb, bool peek_only)
+{
+	FilterWorker *fw = (FilterWorker *) arg;
+	DataDesc   *desc = fw->desc;
+	bool		has_lines = !peek_only || lb_peek_row(lb, 0);
+	int			i;
+
+	/* not formatted values of column store can be used without lines */
+	if (!has_lines && !desc->colstore)
+		return false;
+
+	for (i = 0; i < lb->nrows; i++)
+	{
+		int			lineno = lb->first_row + i;
+		const char *line = NULL;
+
+		if (lineno < desc->first_data_row || lineno > fw->rf->geometry.last_data_row)
+			continue;
+
+		if (desc->has_multilines && lb_is_continual_row(lb, i))
+			continue;
+
+		if (has_lines)
+			line = peek_only ? lb_peek_row(lb, i) : lb_get_row(lb, i, NULL);
+
+		fw->rf->matches[lineno] = eval_node(fw, fw->rf->root, line, lineno);
+	}
+
+	return true;
+}
+
+/*
+ * Parse values of columns used by predicate. It should be done before
+ * workers are started, because the parsing uses block cache.
+ */
+static void
+prepare_column_values(Options *opts, DataDesc *desc, FilterNode *node, ColumnValues **cvs)
+{
+	if (!node)
+		return;
+
+	if (node->type == FILTER_NODE_COND)
+		cvs[node->colno] = get_column_values(opts, desc, node->colno);
+
+	prepare_column_values(opts, desc, node->left, cvs);
+	prepare_column_values(opts, desc, node->right, cvs);
+}
+
+static void
+save_geometry(DataDesc *desc, RowsGeometry *g)
+{
+	g->last_row = desc->last_row;
+	g->maxy = desc->maxy;
+	g->last_data_row = desc->last_data_row;
+	g->border_bottom_row = desc->border_bottom_row;
+	g->footer_row = desc->footer_row;
+	g->alt_footer_row = desc->alt_footer_row;
+}
+
+static void
+restore_geometry(DataDesc *desc, RowsGeometry *g)
+{
+	desc->last_row = g->last_row;
+	desc->maxy = g->maxy;
+	desc->last_data_row = g->last_data_row;
+	desc->border_bottom_row = g->border_bottom_row;
+	desc->footer_row = g->footer_row;
+	desc->alt_footer_row = g->alt_footer_row;
+}
+
+/*
+ * Rows after data rows are moved up by number of hidden lines
+ */
+static int
+shift_row(int row, int last_data_row, int hidden)
+{
+	return row > last_data_row ? row - hidden : row;
+}
+
+/*
+ * Evaluate predicate for all rows. Line buffers are processed by
+ * worker threads in parallel.
+ */
+static void
+eval_row_filter(Options *opts, DataDesc *desc, RowFilter *rf)
+{
+	FilterWorker *workers;
+	void	  **args;
+	int			i;
+
+	rf->matches = smalloc(desc->total_rows * sizeof(bool));
+
+	workers = smalloc((rf->nworkers + 1) * sizeof(FilterWorker));
+	args = smalloc((rf->nworkers + 1) * sizeof(void *));
+
+	for (i = 0; i <= rf->nworkers; i++)
+	{
+		FilterWorker *fw = &workers[i];
+
+		fw->rf = rf;
+		fw->desc = desc;
+		fw->worker = i;
+		fw->force8bit = opts->force8bit;
+
+		/* parsed values are shared (read only) by all workers */
+		if (i == 0)
+		{
+			fw->cvs = smalloc(desc->columns * sizeof(ColumnValues *));
+			prepare_column_values(opts, desc, rf->root, fw->cvs);
+		}
+		else
+			fw->cvs = workers[0].cvs;
+
+		args[i] = fw;
+	}
+
+	lb_process_parallel(desc, eval_block, args, rf->nworkers);
+
+	for (i = 0; i <= rf->nworkers; i++)
+		free(workers[i].buffer);
+
+	free(workers[0].cvs);
+	free(workers);
+	free(args);
+}
+
+/*
+ * Builds filtered order map from current (possibly sorted) order map.
+ * Lines outside of data rows are not filtered, continuation lines of
+ * multiline rows shares the result of first line of row.
+ */
+void
+enable_row_filter(DataDesc *desc)
+{
+	RowFilter  *rf = desc->row_filter;
+	RowsGeometry *g;
+	MappedLine *map;
+	LineBuffer *lb = &desc->rows;
+	int			lb_row = 0;
+	int			items;
+	int			pos;
+	int			n = 0;
+	int			hidden;
+	bool		visible = true;
+
+	if (!rf || desc->row_filter_active)
+		return;
+
+	g = &rf->geometry;
+
+	items = desc->order_map ? desc->order_map_items : desc->total_rows;
+	map = smalloc(items * sizeof(MappedLine));
+
+	for (pos = 0; pos < items; pos++)
+	{
+		MappedLine	ml;
+		int			lineno;
+
+		if (desc->order_map)
+			ml = desc->order_map[pos];
+		else
+		{
+			if (lb_row == lb->nrows)
+			{
+				lb = lb->next;
+				lb_row = 0;
+			}
+
+			ml.lnb = lb;
+			ml.lnb_row = lb_row++;
+		}
+
+		lineno = ml.lnb->first_row + ml.lnb_row;
+
+		if (lineno >= desc->first_data_row && lineno <= g->last_data_row)
+		{
+			if (!(desc->has_multilines && lb_is_continual_row(ml.lnb, ml.lnb_row)))
+				visible = rf->matches[lineno];
+		}
+		else
+			visible = true;
+
+		if (visible)
+			map[n++] = ml;
+	}
+
+	rf->unfiltered_order_map = desc->order_map;
+	rf->unfiltered_order_map_items = desc->order_map_items;
+
+	desc->order_map = map;
+	desc->order_map_items = n;
+	ddesc_reset_positions(desc);
+
+	hidden = items - n;
+
+	desc->last_row = shift_row(g->last_row, g->last_data_row - 1, hidden);
+	desc->maxy = shift_row(g->maxy, g->last_data_row - 1, hidden);
+	desc->border_bottom_row = shift_row(g->border_bottom_row, g->last_data_row, hidden);
+	desc->footer_row = shift_row(g->footer_row, g->last_data_row, hidden);
+	desc->alt_footer_row = shift_row(g->alt_footer_row, g->last_data_row, hidden);
+	desc->last_data_row = g->last_data_row - hidden;
+
+	desc->row_filter_active = true;
+}
+
+/*
+ * Returns back unfiltered order map. It is cheap - nothing is
+ * evaluated.
+ */
+void
+disable_row_filter(DataDesc *desc)
+{
+	RowFilter  *rf = desc->row_filter;
+
+	if (!rf || !desc->row_filter_active)
+		return;
+
+	free(desc->order_map);
+
+	desc->order_map = rf->unfiltered_order_map;
+	desc->order_map_items = rf->unfiltered_order_map_items;
+
+	rf->unfiltered_order_map = NULL;
+	rf->unfiltered_order_map_items = 0;
+	ddesc_reset_positions(desc);
+
+	restore_geometry(desc, &rf->geometry);
+
+	desc->row_filter_active = false;
+}
+
+/*
+ * Replace current row filter by new filter (or remove it, when
+ * rf is NULL). The new filter is evaluated and enabled. Returns
+ * number of displayed data rows.
+ */
+int
+set_row_filter(Options *opts, DataDesc *desc, RowFilter *rf)
+{
+	long long	start_us;
+
+	disable_row_filter(desc);
+	free_row_filter(desc->row_filter);
+	desc->row_filter = rf;
+
+	if (!rf)
+		return desc->last_data_row - desc->first_data_row + 1;
+
+	start_us = stats_time_us();
+
+	save_geometry(desc, &rf->geometry);
+	eval_row_filter(opts, desc, rf);
+	enable_row_filter(desc);
+
+	perf_stats.search_us = stats_time_us() - start_us;
+
+	return desc->last_data_row - desc->first_data_row + 1;
+}
+
+/*
+ * Returns last data row of unfiltered data
+ */
+int
+get_unfiltered_last_data_row(DataDesc *desc)
+{
+	if (desc->row_filter_active)
+		return desc->row_filter->geometry.last_data_row;
+
+	return desc->last_data_row;
+}
+
+/*
+ * Returns true, when the row starting on lineno (original line number)
+ * is hidden by active filter.
+ */
+bool
+is_filtered_row(DataDesc *desc, int lineno)
+{
+	return desc->row_filter_active && !desc->row_filter->matches[lineno];
+}
@@ -12,8 +12,66 @@
  */
 
 #include "pspg.h"
+#include "unicode.h"
 
+#include <errno.h>
+#include <pthread.h>
 #include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define LB_DATA_INIT_SIZE		(16 * 1024)
+
+/* max number of threads used for parallel processing of line buffers */
+#define LB_MAX_WORKERS			16
+
+/* max number of decompressed line buffers, should be enough for few screens */
+#define LB_CACHE_BLOCKS			64
+
+/* full line buffers are compressed, when size of uncompressed data is higher */
+size_t		lb_compress_threshold = 64 * 1024 * 1024;
+
+/* full line buffers are moved to temp file, when stored data are larger */
+size_t		lb_memory_limit = 0;
+
+/* size of uncompressed data of line buffers (without cached data) */
+static size_t lb_plain_bytes = 0;
+
+/* size of compressed data of line buffers holded in memory */
+static size_t lb_zdata_bytes = 0;
+
+/* temporary file used for spilled line buffers */
+static int	lb_spill_fd = -1;
+static off_t lb_spill_end = 0;
+static int	lb_spilled_blocks = 0;
+
+static LineBuffer *lb_cache[LB_CACHE_BLOCKS];
+static int	lb_cache_items = 0;
+static unsigned long lb_cache_clock = 0;
+
+/*
+ * Display positions and byte offsets of starts of columns of recently
+ * displayed lines. The slot is selected by line number, so all lines
+ * of the screen can be cached together.
+ */
+#define LB_XPOS_CACHE_SLOTS		512
+
+typedef struct
+{
+	int			xpos;					/* display position of char */
+	int			offset;					/* byte offset of char */
+} ColumnStart;
+
+typedef struct
+{
+	LineBuffer *lb;						/* owner of line or NULL */
+	int			rowno;
+	int			nstarts;
+	int			allocated;
+	ColumnStart *starts;
+} XposCacheSlot;
+
+static XposCacheSlot lb_xpos_cache[LB_XPOS_CACHE_SLOTS];
 
 /*
  * Initialize line buffer iterator
@@ -37,155 +95,1188 @@ init_lbi(LineBufferIter *lbi,
  * Common case - initialize line buffer iterator
  * for stored data.
  */
-inline void
-init_lbi_ddesc(LineBufferIter *lbi,
-				  DataDesc *desc,
-				  int init_pos)
+inline void
+init_lbi_ddesc(LineBufferIter *lbi,
+				  DataDesc *desc,
+				  int init_pos)
+{
+	init_lbi(lbi,
+			 &desc->rows,
+			 desc->order_map,
+			 desc->order_map_items,
+			 init_pos);
+}
+
+/*
+ * Set iterator to absolute position in line buffer
+ */
+bool
+lbi_set_lineno(LineBufferIter *lbi, int pos)
+{
+	lbi->lineno = pos;
+
+	if (lbi->order_map)
+	{
+		if (lbi->order_map_items > pos)
+		{
+			MappedLine *mpl = &lbi->order_map[pos];
+
+			lbi->current_lb = mpl->lnb;
+			lbi->current_lb_rowno = mpl->lnb_row;
+
+			return true;
+		}
+
+		/* set max lineno */
+		lbi->lineno = lbi->order_map_items;
+	}
+	else
+	{
+		int		lineno_offset = 0;
+
+		lbi->current_lb = lbi->start_lb;
+
+		while (lbi->current_lb && pos >= LINEBUFFER_LINES)
+		{
+			pos -= LINEBUFFER_LINES;
+			lineno_offset += lbi->current_lb->nrows;
+
+			lbi->current_lb = lbi->current_lb->next;
+		}
+
+		if (lbi->current_lb)
+		{
+			if (pos < lbi->current_lb->nrows)
+			{
+				lbi->current_lb_rowno = pos;
+
+				return true;
+			}
+			else
+				lbi->lineno = lineno_offset + lbi->current_lb->nrows;
+		}
+		else
+			lbi->lineno = lineno_offset;
+	}
+
+	lbi->current_lb = NULL;
+	lbi->current_lb_rowno = 0;
+
+	return false;
+}
+
+/*
+ * Initialize line buffer mark to current position in
+ * line buffer.
+ */
+inline void
+lbi_set_mark(LineBufferIter *lbi, LineBufferMark *lbm)
+{
+	lbm->lb = lbi->current_lb;
+	lbm->lb_rowno = lbi->current_lb_rowno;
+	lbm->lineno = lbi->lineno;
+}
+
+/*
+ * Initialize line buffer mark to current position in line
+ * buffer. Increase current position in line buffer. Returns
+ * true if line buffer mark is valid.
+ */
+bool
+lbi_set_mark_next(LineBufferIter *lbi, LineBufferMark *lbm)
+{
+	lbi_set_mark(lbi, lbm);
+	(void) lbi_next(lbi);
+
+	return lbm->lb && lbm->lb_rowno < lbm->lb->nrows;
+}
+
+/*
+ * Initialize line buffer mark to current position in line
+ * buffer. Decrease current position in line buffer. Returns
+ * true if line buffer mark is valid.
+ */
+bool
+lbi_set_mark_prev(LineBufferIter *lbi, LineBufferMark *lbm)
+{
+	lbi_set_mark(lbi, lbm);
+	(void) lbi_prev(lbi);
+
+	return lbm->lb && lbm->lb_rowno >= 0 && lbm->lb_rowno < lbm->lb->nrows;
+}
+
+/*
+ * Sets mark to line buffer specified by position. When false,
+ * when position is not valid.
+ */
+bool
+ddesc_set_mark(LineBufferMark *lbm, DataDesc *desc, int pos)
+{
+	lbm->lb = NULL;
+	lbm->lineno = pos;
+
+	if (desc->order_map)
+	{
+		if (pos >= 0 && pos < desc->order_map_items)
+		{
+			lbm->lb = desc->order_map[pos].lnb;
+			lbm->lb_rowno = desc->order_map[pos].lnb_row;
+			lbm->lineno = pos;
+
+			return true;
+		}
+	}
+	else
+	{
+		LineBuffer *lb = &desc->rows;
+
+		while (lb && pos >= LINEBUFFER_LINES)
+		{
+			lb = lb->next;
+			pos -= LINEBUFFER_LINES;
+		}
+
+		if (lb && pos < lb->nrows)
+		{
+			lbm->lb = lb;
+			lbm->lb_rowno = pos;
+
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/*
+ * Returns position of line in current order of lines. The inverse
+ * order map is created when it is necessary, and it is used until
+ * the order map is changed (see ddesc_reset_positions).
+ */
+static int
+lb_get_position(DataDesc *desc, LineBuffer *lb, int rowno)
+{
+	if (!desc->order_map)
+		return lb->first_row + rowno;
+
+	if (!desc->positions)
+	{
+		LineBuffer *last = &desc->rows;
+		int		nlines;
+		int		i;
+
+		while (last->next)
+			last = last->next;
+
+		nlines = last->first_row + last->nrows;
+
+		desc->positions = smalloc(nlines * sizeof(int));
+
+		/* filtered lines are not displayed */
+		for (i = 0; i < nlines; i++)
+			desc->positions[i] = -1;
+
+		for (i = 0; i < desc->order_map_items; i++)
+		{
+			MappedLine *mpl = &desc->order_map[i];
+
+			desc->positions[mpl->lnb->first_row + mpl->lnb_row] = i;
+		}
+	}
+
+	return desc->positions[lb->first_row + rowno];
+}
+
+/*
+ * Returns position of line (specified by line buffer mark) in current
+ * order of lines. Returns -1, when the line is not displayed.
+ */
+int
+ddesc_get_position(DataDesc *desc, LineBufferMark *lbm)
+{
+	if (!lbm->lb)
+		return -1;
+
+	return lb_get_position(desc, lbm->lb, lbm->lb_rowno);
+}
+
+/*
+ * Should be called after any change of order map.
+ */
+void
+ddesc_reset_positions(DataDesc *desc)
+{
+	free(desc->positions);
+	desc->positions = NULL;
+}
+
+/*
+ * Bookmarks are stored in bitset of line buffer. Because they are
+ * attached to lines (not to positions), they are persistent over
+ * sorting and filtering.
+ */
+#define BOOKMARK_WORDS		((LINEBUFFER_LINES + 63) / 64)
+
+bool
+lb_is_bookmark(LineBuffer *lb, int rowno)
+{
+	return lb && lb->bookmarks &&
+		   (lb->bookmarks[rowno / 64] & ((uint64_t) 1 << (rowno % 64)));
+}
+
+/*
+ * Switch bookmark on line specified by position. Returns false,
+ * when the position is not valid.
+ */
+bool
+ddesc_toggle_bookmark(DataDesc *desc, int pos)
+{
+	LineBufferMark lbm;
+	LineBuffer *lb;
+	uint64_t	bit;
+
+	if (!ddesc_set_mark(&lbm, desc, pos))
+		return false;
+
+	lb = lbm.lb;
+
+	if (!lb->bookmarks)
+		lb->bookmarks = smalloc(BOOKMARK_WORDS * sizeof(uint64_t));
+
+	bit = (uint64_t) 1 << (lbm.lb_rowno % 64);
+	lb->bookmarks[lbm.lb_rowno / 64] ^= bit;
+
+	if (lb->bookmarks[lbm.lb_rowno / 64] & bit)
+	{
+		lb->nbookmarks += 1;
+		desc->nbookmarks += 1;
+	}
+	else
+	{
+		lb->nbookmarks -= 1;
+		desc->nbookmarks -= 1;
+	}
+
+	return true;
+}
+
+void
+ddesc_flush_bookmarks(DataDesc *desc)
+{
+	LineBuffer *lb;
+
+	for (lb = &desc->rows; lb; lb = lb->next)
+	{
+		free(lb->bookmarks);
+		lb->bookmarks = NULL;
+		lb->nbookmarks = 0;
+	}
+
+	desc->nbookmarks = 0;
+}
+
+/*
+ * Returns nearest position of bookmarked line after (forward) or before
+ * position. Without order map, the position of line is its row number,
+ * so only line buffers with some bookmarks are searched from position.
+ * With order map, the positions of all bookmarked lines are checked.
+ * Returns -1, when there is not any bookmark.
+ */
+static int
+ddesc_search_bookmark(DataDesc *desc, int pos, bool forward)
+{
+	LineBuffer *lb;
+	int		result = -1;
+
+	if (desc->nbookmarks == 0)
+		return -1;
+
+	for (lb = &desc->rows; lb; lb = lb->next)
+	{
+		int		i;
+
+		if (lb->nbookmarks == 0)
+			continue;
+
+		if (!desc->order_map)
+		{
+			/* the line buffers are ordered */
+			if (forward && lb->first_row + lb->nrows <= pos)
+				continue;
+			if (!forward && lb->first_row >= pos)
+				break;
+		}
+
+		for (i = 0; i < BOOKMARK_WORDS; i++)
+		{
+			uint64_t	word = lb->bookmarks[i];
+
+			while (word)
+			{
+				int		rowno = i * 64 + __builtin_ctzll(word);
+				int		rowpos = lb_get_position(desc, lb, rowno);
+
+				word &= word - 1;
+
+				if (rowpos == -1)
+					continue;
+
+				if (forward)
+				{
+					if (rowpos > pos && (result == -1 || rowpos < result))
+						result = rowpos;
+				}
+				else
+				{
+					if (rowpos < pos && rowpos > result)
+						result = rowpos;
+				}
+			}
+		}
+
+		/* nearest bookmark was found already */
+		if (!desc->order_map && forward && result != -1)
+			break;
+	}
+
+	return result;
+}
+
+static int
+compare_positions(const void *a, const void *b)
+{
+	int			p1 = *((const int *) a);
+	int			p2 = *((const int *) b);
+
+	return p1 < p2 ? -1 : (p1 > p2 ? 1 : 0);
+}
+
+/*
+ * Returns sorted array of positions of displayed bookmarked lines.
+ * Only bitsets of line buffers with some bookmarks are read, the
+ * lines are not loaded. Returns NULL, when there are not bookmarks.
+ */
+int *
+ddesc_get_bookmark_positions(DataDesc *desc, int *npositions)
+{
+	LineBuffer *lb;
+	int		   *positions;
+	int			n = 0;
+
+	*npositions = 0;
+
+	if (desc->nbookmarks == 0)
+		return NULL;
+
+	positions = smalloc(desc->nbookmarks * sizeof(int));
+
+	for (lb = &desc->rows; lb; lb = lb->next)
+	{
+		int		i;
+
+		if (lb->nbookmarks == 0)
+			continue;
+
+		for (i = 0; i < BOOKMARK_WORDS; i++)
+		{
+			uint64_t	word = lb->bookmarks[i];
+
+			while (word && n < desc->nbookmarks)
+			{
+				int		rowpos = lb_get_position(desc, lb, i * 64 + __builtin_ctzll(word));
+
+				word &= word - 1;
+
+				if (rowpos != -1)
+					positions[n++] = rowpos;
+			}
+		}
+	}
+
+	/* without order map, the positions are sorted already */
+	if (desc->order_map)
+		qsort(positions, n, sizeof(int), compare_positions);
+
+	*npositions = n;
+
+	return positions;
+}
+
+int
+ddesc_next_bookmark(DataDesc *desc, int pos)
+{
+	return ddesc_search_bookmark(desc, pos, true);
+}
+
+int
+ddesc_prev_bookmark(DataDesc *desc, int pos)
+{
+	return ddesc_search_bookmark(desc, pos, false);
+}
+
+void
+lbm_xor_mask(LineBufferMark *lbm, char mask)
+{
+	if (!lbm->lb->lineinfo)
+	{
+		/* smalloc returns zero fill memory already */
+		lbm->lb->lineinfo = smalloc(LINEBUFFER_LINES * sizeof(LineInfo));
+	}
+
+	lbm->lb->lineinfo[lbm->lb_rowno].mask ^= mask;
+}
+
+/*
+ * Creates compressed copy of line buffer data. Returns false, when
+ * the compression is not effective.
+ */
+static bool
+lb_compress(LineBuffer *lb)
+{
+	char	   *zdata;
+	char	   *aux;
+	int			bound;
+	int			zsize;
+
+	bound = lz_compress_bound(lb->data_size);
+
+	zdata = malloc(bound);
+	if (!zdata)
+		leave("out of memory");
+
+	zsize = lz_compress(lb->data, lb->data_size, zdata, bound);
+
+	/* don't use compression, when the saving is not significant */
+	if (zsize < 0 || (uint32_t) zsize > lb->data_size / 10 * 9)
+	{
+		free(zdata);
+		return false;
+	}
+
+	aux = realloc(zdata, zsize);
+
+	lb->zdata = aux ? aux : zdata;
+	lb->zdata_size = zsize;
+
+	return true;
+}
+
+/*
+ * Returns file descriptor of temporary file used for spilled line
+ * buffers. The file is unlinked immediately, so it is removed
+ * by system when pspg ends.
+ */
+static int
+lb_spill_file(void)
+{
+	if (lb_spill_fd == -1)
+	{
+		const char *tmpdir = getenv("TMPDIR");
+		char		path[MAXPATHLEN];
+
+		if (!tmpdir || !*tmpdir)
+			tmpdir = "/tmp";
+
+		snprintf(path, sizeof(path), "%s/pspg-XXXXXX", tmpdir);
+
+		lb_spill_fd = mkstemp(path);
+		if (lb_spill_fd == -1)
+			leave("cannot to create temporary file \"%s\" (%s)", path, strerror(errno));
+
+		(void) unlink(path);
+	}
+
+	return lb_spill_fd;
+}
+
+/*
+ * Write data of line buffer to temporary file and release memory.
+ * Compressed data are written when they are available.
+ */
+static void
+lb_spill(LineBuffer *lb)
+{
+	int			fd = lb_spill_file();
+	char	   *ptr;
+	size_t		size;
+	off_t		offset = lb_spill_end;
+
+	if (lb->zdata)
+	{
+		ptr = lb->zdata;
+		size = lb->zdata_size;
+	}
+	else
+	{
+		ptr = lb->data;
+		size = lb->data_size;
+	}
+
+	while (size > 0)
+	{
+		ssize_t		written = pwrite(fd, ptr, size, offset);
+
+		if (written < 0)
+		{
+			if (errno == EINTR)
+				continue;
+
+			leave("cannot to write to temporary file (%s)", strerror(errno));
+		}
+
+		ptr += written;
+		size -= written;
+		offset += written;
+	}
+
+	lb->spill_offset = lb_spill_end;
+	lb->is_spilled = true;
+
+	lb_spill_end = offset;
+	lb_spilled_blocks += 1;
+
+	if (lb->zdata)
+	{
+		lb_zdata_bytes -= lb->zdata_size;
+
+		free(lb->zdata);
+		lb->zdata = NULL;
+	}
+	else
+	{
+		lb_plain_bytes -= lb->data_allocated;
+
+		free(lb->data);
+		lb->data = NULL;
+		lb->data_allocated = 0;
+	}
+}
+
+/*
+ * Read data of spilled line buffer to buffer
+ */
+static void
+lb_unspill(LineBuffer *lb, char *buffer, size_t size)
+{
+	off_t		offset = lb->spill_offset;
+
+	while (size > 0)
+	{
+		ssize_t		nread = pread(lb_spill_fd, buffer, size, offset);
+
+		if (nread <= 0)
+		{
+			if (nread < 0 && errno == EINTR)
+				continue;
+
+			leave("cannot to read from temporary file (%s)",
+				  nread < 0 ? strerror(errno) : "unexpected end of file");
+		}
+
+		buffer += nread;
+		size -= nread;
+		offset += nread;
+	}
+}
+
+/*
+ * Full line buffer will not be changed, so it can be compressed
+ * (when there are lot of data), and moved to temporary file (when
+ * memory limit is exceeded). Elsewhere unused memory is released.
+ * First line buffer holds headline, and it is not compressed or
+ * spilled never. Data of line buffer should be counted in
+ * lb_plain_bytes.
+ */
+static void
+lb_freeze(LineBuffer *lb)
+{
+	/* rows are rendered from column store, there are not data */
+	if (lb->colstore)
+		return;
+
+	if (lb->prev && lb_compress_threshold > 0 &&
+		lb_plain_bytes > lb_compress_threshold &&
+		lb_compress(lb))
+	{
+		lb_plain_bytes -= lb->data_allocated;
+		lb_zdata_bytes += lb->zdata_size;
+
+		free(lb->data);
+		lb->data = NULL;
+		lb->data_allocated = 0;
+	}
+	else if (lb->data_size < lb->data_allocated)
+	{
+		char	   *data = realloc(lb->data, lb->data_size);
+
+		if (data)
+		{
+			lb_plain_bytes -= lb->data_allocated - lb->data_size;
+
+			lb->data = data;
+			lb->data_allocated = lb->data_size;
+		}
+	}
+
+	if (lb->prev && lb_memory_limit > 0 &&
+		lb_plain_bytes + lb_zdata_bytes > lb_memory_limit)
+		lb_spill(lb);
+}
+
+/*
+ * Remove line buffer from block cache. When cached data was not
+ * modified, then it is just released. Modified data have to be
+ * compressed or spilled again.
+ */
+static void
+lb_cache_remove(int i)
+{
+	LineBuffer *lb = lb_cache[i];
+
+	lb_cache[i] = lb_cache[--lb_cache_items];
+	lb->is_cached = false;
+
+	if (lb->is_dirty)
+	{
+		lb->is_dirty = false;
+
+		/* modified rows cannot be rendered again */
+		lb->colstore = NULL;
+		lb->source = NULL;
+		lb->projection = NULL;
+
+		if (lb->zdata)
+		{
+			lb_zdata_bytes -= lb->zdata_size;
+
+			free(lb->zdata);
+			lb->zdata = NULL;
+		}
+
+		lb->zdata_size = 0;
+
+		/* old content of temp file is not used anymore */
+		if (lb->is_spilled)
+		{
+			lb->is_spilled = false;
+			lb_spilled_blocks -= 1;
+		}
+
+		lb_plain_bytes += lb->data_allocated;
+		lb_freeze(lb);
+
+		return;
+	}
+
+	free(lb->data);
+	lb->data = NULL;
+	lb->data_allocated = 0;
+}
+
+/*
+ * Render rows of line buffer from rows of source line buffer.
+ * Returns new data, offsets and sizes of rows are updated.
+ */
+static char *
+lb_render_projection(LineBuffer *lb)
+{
+	LineBuffer *source = lb->source;
+	size_t		bound = 0;
+	size_t		used = 0;
+	char	   *data;
+	char	   *aux;
+	int			i;
+
+	for (i = 0; i < source->nrows; i++)
+		bound += project_line_max_size(lb->projection, source->sizes[i]) + 1;
+
+	if (bound > UINT32_MAX)
+		leave("too long data in line buffer");
+
+	data = malloc(bound);
+	if (!data)
+		leave("out of memory");
+
+	for (i = 0; i < source->nrows; i++)
+	{
+		int			size;
+		char	   *str = lb_get_row(source, i, &size);
+
+		size = project_line(lb->projection, str, size, lb->first_row + i, data + used);
+		data[used + size] = '\0';
+
+		lb->offsets[i] = used;
+		lb->sizes[i] = size;
+
+		used += size + 1;
+	}
+
+	aux = realloc(data, used);
+
+	lb->data_size = used;
+
+	return aux ? aux : data;
+}
+
+/*
+ * Load line buffer data (decompress or read from temp file) to block
+ * cache. Least recently used block is removed from full cache. Projected
+ * rows are rendered before, because the source rows can be loaded
+ * to cache too.
+ */
+static void
+lb_load(LineBuffer *lb)
+{
+	char	   *data = NULL;
+
+	if (lb->projection)
+		data = lb_render_projection(lb);
+
+	if (lb_cache_items == LB_CACHE_BLOCKS)
+	{
+		int			lru = 0;
+		int			i;
+
+		for (i = 1; i < lb_cache_items; i++)
+			if (lb_cache[i]->cache_tick < lb_cache[lru]->cache_tick)
+				lru = i;
+
+		lb_cache_remove(lru);
+	}
+
+	if (data)
+		lb->data = data;
+	else
+	{
+		lb->data = malloc(lb->data_size);
+		if (!lb->data)
+			leave("out of memory");
+
+		if (lb->colstore)
+			render_colstore_rows(lb->colstore, lb->colstore_rowno, lb->nrows,
+								 lb->data, lb->data_size);
+		else if (lb->is_spilled && lb->zdata_size == 0)
+			lb_unspill(lb, lb->data, lb->data_size);
+		else
+		{
+			char	   *zdata = lb->zdata;
+
+			if (lb->is_spilled)
+			{
+				zdata = malloc(lb->zdata_size);
+				if (!zdata)
+					leave("out of memory");
+
+				lb_unspill(lb, zdata, lb->zdata_size);
+			}
+
+			if (lz_decompress(zdata, lb->zdata_size, lb->data, lb->data_size) != (int) lb->data_size)
+				leave("broken compressed data in line buffer");
+
+			if (zdata != lb->zdata)
+				free(zdata);
+		}
+	}
+
+	lb->data_allocated = lb->data_size;
+	lb->is_cached = true;
+	lb->cache_tick = ++lb_cache_clock;
+
+	lb_cache[lb_cache_items++] = lb;
+}
+
+/*
+ * Formatted rows of full line buffer are released. The rows will be
+ * rendered from column store (from row rowno), when they will be
+ * used. It is an alternative to compression.
+ */
+void
+lb_set_colstore(LineBuffer *lb, ColumnStore *cs, int rowno)
+{
+	if (lb->is_cached || !lb->data || lb->zdata || lb->is_spilled)
+		return;
+
+	lb_plain_bytes -= lb->data_allocated;
+
+	free(lb->data);
+	lb->data = NULL;
+	lb->data_allocated = 0;
+
+	lb->colstore = cs;
+	lb->colstore_rowno = rowno;
+}
+
+/*
+ * Cached positions of line are not valid when the line is changed or
+ * released. When rowno is -1, then all lines of line buffer are removed
+ * from cache.
+ */
+static void
+lb_xpos_cache_invalidate(LineBuffer *lb, int rowno)
+{
+	int			i;
+
+	if (rowno != -1)
+	{
+		XposCacheSlot *slot = &lb_xpos_cache[(lb->first_row + rowno) % LB_XPOS_CACHE_SLOTS];
+
+		if (slot->lb == lb && slot->rowno == rowno)
+			slot->lb = NULL;
+
+		return;
+	}
+
+	for (i = 0; i < LB_XPOS_CACHE_SLOTS; i++)
+		if (lb_xpos_cache[i].lb == lb)
+			lb_xpos_cache[i].lb = NULL;
+}
+
+/*
+ * Creates line buffers with rows projected from rows of source line
+ * buffers. The rows are rendered when they are used. The first line
+ * buffer holds headline, so it is rendered immediately, and its data
+ * stays in memory.
+ */
+void
+lb_init_projection(LineBuffer *first, LineBuffer *source, Projection *pr)
+{
+	LineBuffer *lb = first;
+	LineBuffer *prev = NULL;
+
+	memset(first, 0, sizeof(LineBuffer));
+
+	while (source)
+	{
+		int			i;
+
+		if (!lb)
+			lb = smalloc2(sizeof(LineBuffer), "create projection");
+
+		lb->first_row = source->first_row;
+		lb->nrows = source->nrows;
+		lb->source = source;
+		lb->projection = pr;
+
+		for (i = 0; i < lb->nrows; i++)
+			lb->widths[i] = -1;
+
+		if (prev)
+		{
+			prev->next = lb;
+			lb->prev = prev;
+		}
+		else
+		{
+			lb->data = lb_render_projection(lb);
+			lb->data_allocated = lb->data_size;
+			lb_plain_bytes += lb->data_allocated;
+
+			lb->source = NULL;
+			lb->projection = NULL;
+		}
+
+		prev = lb;
+		lb = NULL;
+		source = source->next;
+	}
+}
+
+/*
+ * Moves rows from line buffer src (first line buffer embedded in
+ * data desc) to line buffer dest. Line buffer src is empty after.
+ */
+void
+lb_move_rows(LineBuffer *dest, LineBuffer *src)
+{
+	lb_xpos_cache_invalidate(src, -1);
+	lb_xpos_cache_invalidate(dest, -1);
+
+	memcpy(dest, src, sizeof(LineBuffer));
+
+	if (dest->next)
+		dest->next->prev = dest;
+
+	memset(src, 0, sizeof(LineBuffer));
+}
+
+/*
+ * Returns display width of line related to line buffer mark. The width
+ * is calculated only once, and then it is cached.
+ */
+int
+lbm_get_line_width(LineBufferMark *lbm, bool force8bit)
+{
+	LineBuffer *lb = lbm->lb;
+	int			rowno = lbm->lb_rowno;
+
+	if (lb->widths[rowno] < 0)
+	{
+		char	   *str = lb_get_row(lb, rowno, NULL);
+
+		lb->widths[rowno] = force8bit ? lb->sizes[rowno] : utf_string_dsplen(str, lb->sizes[rowno]);
+	}
+
+	return lb->widths[rowno];
+}
+
+/*
+ * Returns true, when every char of line has one byte and one display
+ * position (size of line is same like its width), so display positions
+ * can be used as byte offsets. When compute is false, only already known
+ * width is used (line buffers can be processed by other threads).
+ */
+bool
+lb_is_ascii_row(LineBuffer *lb, int rowno, bool force8bit, bool compute)
+{
+	if (force8bit)
+		return true;
+
+	if (lb->widths[rowno] < 0 && compute)
+	{
+		LineBufferMark lbm;
+
+		lbm.lb = lb;
+		lbm.lb_rowno = rowno;
+		lbm.lineno = lb->first_row + rowno;
+
+		(void) lbm_get_line_width(&lbm, force8bit);
+	}
+
+	return lb->widths[rowno] == lb->sizes[rowno];
+}
+
+/*
+ * Should be called when the line was shortened in place (trimming
+ * of footer). Cached width is invalidated.
+ */
+void
+lbm_set_line_size(LineBufferMark *lbm, int size)
 {
-	init_lbi(lbi,
-			 &desc->rows,
-			 desc->order_map,
-			 desc->order_map_items,
-			 init_pos);
+	lbm->lb->sizes[lbm->lb_rowno] = size;
+	lbm->lb->widths[lbm->lb_rowno] = -1;
+
+	lb_xpos_cache_invalidate(lbm->lb, lbm->lb_rowno);
+
+	/* the decompressed data was modified */
+	if (lbm->lb->is_cached)
+		lbm->lb->is_dirty = true;
 }
 
 /*
- * Set iterator to absolute position in line buffer
+ * Returns byte offset of char of line, from that the display position
+ * xpos can be reached (the display position of this char is returned
+ * in charpos, and it is not higher than xpos). For lines with wide or
+ * multibyte chars the starts of columns are calculated once and cached,
+ * so horizontal scrolling doesn't need to scan all skipped chars.
  */
-bool
-lbi_set_lineno(LineBufferIter *lbi, int pos)
+int
+lbm_get_xpos_offset(LineBufferMark *lbm,
+					DataDesc *desc,
+					int xpos,
+					bool force8bit,
+					int *charpos)
 {
-	lbi->lineno = pos;
+	LineBuffer *lb = lbm->lb;
+	int			rowno = lbm->lb_rowno;
+	XposCacheSlot *slot;
+	const char *str;
+	int			size;
+	int			low, high;
 
-	if (lbi->order_map)
-	{
-		if (lbi->order_map_items > pos)
-		{
-			MappedLine *mpl = &lbi->order_map[pos];
+	*charpos = 0;
 
-			lbi->current_lb = mpl->lnb;
-			lbi->current_lb_rowno = mpl->lnb_row;
+	if (xpos <= 0)
+		return 0;
 
-			return true;
-		}
+	str = lb_get_row(lb, rowno, &size);
 
-		/* set max lineno */
-		lbi->lineno = lbi->order_map_items;
-	}
-	else
+	/*
+	 * every char has one byte and one display position (cached width
+	 * can be calculated in utf8 mode, so force8bit is checked first)
+	 */
+	if (force8bit || lbm_get_line_width(lbm, force8bit) == size)
 	{
-		int		lineno_offset = 0;
+		*charpos = xpos < size ? xpos : size;
+		return *charpos;
+	}
 
-		lbi->current_lb = lbi->start_lb;
+	if (desc->columns <= 0 || !desc->cranges)
+		return 0;
 
-		while (lbi->current_lb && pos >= LINEBUFFER_LINES)
-		{
-			pos -= LINEBUFFER_LINES;
-			lineno_offset += lbi->current_lb->nrows;
+	slot = &lb_xpos_cache[(lb->first_row + rowno) % LB_XPOS_CACHE_SLOTS];
 
-			lbi->current_lb = lbi->current_lb->next;
+	if (slot->lb != lb || slot->rowno != rowno)
+	{
+		int			pos = 0;
+		int			offset = 0;
+		int			i;
+
+		if (slot->allocated < desc->columns)
+		{
+			free(slot->starts);
+			slot->starts = smalloc2(desc->columns * sizeof(ColumnStart), "cache positions of line");
+			slot->allocated = desc->columns;
 		}
 
-		if (lbi->current_lb)
+		/*
+		 * The chars are skipped in the same way like window_fill does
+		 * (stop on first char after the start of column), so the scan
+		 * can continue from any cached position.
+		 */
+		for (i = 0; i < desc->columns; i++)
 		{
-			if (pos < lbi->current_lb->nrows)
-			{
-				lbi->current_lb_rowno = pos;
+			int			xmin = desc->cranges[i].xmin;
 
-				return true;
+			while (pos < xmin && str[offset] != '\0' && str[offset] != '\n')
+			{
+				pos += utf_dsplen(str + offset);
+				offset += utf8charlen(str[offset]);
 			}
-			else
-				lbi->lineno = lineno_offset + lbi->current_lb->nrows;
+
+			slot->starts[i].xpos = pos;
+			slot->starts[i].offset = offset;
+		}
+
+		slot->lb = lb;
+		slot->rowno = rowno;
+		slot->nstarts = desc->columns;
+	}
+
+	/* find last column start before xpos */
+	low = 0;
+	high = slot->nstarts - 1;
+
+	while (low <= high)
+	{
+		int			mid = (low + high) / 2;
+
+		if (slot->starts[mid].xpos <= xpos)
+		{
+			*charpos = slot->starts[mid].xpos;
+			low = mid + 1;
 		}
 		else
-			lbi->lineno = lineno_offset;
+			high = mid - 1;
 	}
 
-	lbi->current_lb = NULL;
-	lbi->current_lb_rowno = 0;
+	if (low == 0)
+		return 0;
 
-	return false;
+	return slot->starts[low - 1].offset;
 }
 
 /*
- * Initialize line buffer mark to current position in
- * line buffer.
+ * Returns pointer to stored row. When size is not NULL, then
+ * the size of row in bytes (without ending zero) is returned too.
+ * This is only one place, where the content of line buffer is
+ * accessed directly. The pointer to compressed line buffer is valid
+ * only until other LB_CACHE_BLOCKS compressed line buffers are used.
  */
-inline void
-lbi_set_mark(LineBufferIter *lbi, LineBufferMark *lbm)
+char *
+lb_get_row(LineBuffer *lb, int rowno, int *size)
 {
-	lbm->lb = lbi->current_lb;
-	lbm->lb_rowno = lbi->current_lb_rowno;
-	lbm->lineno = lbi->lineno;
+	if (!lb->data)
+		lb_load(lb);
+	else if (lb->is_cached)
+		lb->cache_tick = ++lb_cache_clock;
+
+	if (size)
+		*size = lb->sizes[rowno];
+
+	return lb->data + lb->offsets[rowno];
 }
 
 /*
- * Initialize line buffer mark to current position in line
- * buffer. Increase current position in line buffer. Returns
- * true if line buffer mark is valid.
+ * Returns true, when previous line has continuation mark (the row
+ * is continuation of multiline row).
  */
 bool
-lbi_set_mark_next(LineBufferIter *lbi, LineBufferMark *lbm)
+lb_is_continual_row(LineBuffer *lb, int rowno)
 {
-	lbi_set_mark(lbi, lbm);
-	(void) lbi_next(lbi);
+	if (rowno == 0)
+	{
+		lb = lb->prev;
+		if (!lb)
+			return false;
 
-	return lbm->lb && lbm->lb_rowno < lbm->lb->nrows;
+		rowno = lb->nrows;
+	}
+
+	return lb->lineinfo && (lb->lineinfo[rowno - 1].mask & LINEINFO_CONTINUATION);
 }
 
 /*
- * Sets mark to line buffer specified by position. When false,
- * when position is not valid.
+ * Returns pointer to stored row, when the data of line buffer are in
+ * memory, else returns NULL. The block cache is not touched, so this
+ * routine can be used by more threads concurrently.
  */
-bool
-ddesc_set_mark(LineBufferMark *lbm, DataDesc *desc, int pos)
+char *
+lb_peek_row(LineBuffer *lb, int rowno)
 {
-	lbm->lb = NULL;
-	lbm->lineno = pos;
+	if (!lb->data)
+		return NULL;
 
-	if (desc->order_map)
+	return lb->data + lb->offsets[rowno];
+}
+
+/*
+ * Append line to line buffer. When the line buffer is full, then new
+ * line buffer is allocated and linked. Returns line buffer, where the
+ * line was stored. When width is not known, then -1 should be used.
+ */
+LineBuffer *
+lb_append_line(LineBuffer *lb, const char *str, int size, int width)
+{
+	size_t		required;
+
+	if (lb->nrows == LINEBUFFER_LINES)
 	{
-		if (pos >= 0 && pos < desc->order_map_items)
-		{
-			lbm->lb = desc->order_map[pos].lnb;
-			lbm->lb_rowno = desc->order_map[pos].lnb_row;
-			lbm->lineno = pos;
+		LineBuffer *newlb = smalloc2(sizeof(LineBuffer), "append line to line buffer");
 
-			return true;
-		}
+		lb_freeze(lb);
+
+		newlb->prev = lb;
+		newlb->first_row = lb->first_row + lb->nrows;
+		lb->next = newlb;
+		lb = newlb;
 	}
-	else
+
+	required = (size_t) lb->data_size + size + 1;
+
+	if (required > UINT32_MAX)
+		leave("too long data in line buffer");
+
+	if (required > lb->data_allocated)
 	{
-		LineBuffer *lb = &desc->rows;
+		size_t		newsize = lb->data_allocated > 0 ? lb->data_allocated : LB_DATA_INIT_SIZE;
 
-		while (lb && pos >= LINEBUFFER_LINES)
-		{
-			lb = lb->next;
-			pos -= LINEBUFFER_LINES;
-		}
+		while (newsize < required)
+			newsize *= 2;
 
-		if (lb && pos < lb->nrows)
-		{
-			lbm->lb = lb;
-			lbm->lb_rowno = pos;
+		if (newsize > UINT32_MAX)
+			newsize = UINT32_MAX;
 
-			return true;
-		}
+		lb->data = realloc(lb->data, newsize);
+		if (!lb->data)
+			leave("out of memory");
+
+		lb_plain_bytes += newsize - lb->data_allocated;
+		lb->data_allocated = newsize;
 	}
 
-	return false;
-}
+	memcpy(lb->data + lb->data_size, str, size);
+	lb->data[lb->data_size + size] = '\0';
 
-void
-lbm_xor_mask(LineBufferMark *lbm, char mask)
-{
-	if (!lbm->lb->lineinfo)
-	{
-		/* smalloc returns zero fill memory already */
-		lbm->lb->lineinfo = smalloc(LINEBUFFER_LINES * sizeof(LineInfo));
-	}
+	lb_xpos_cache_invalidate(lb, lb->nrows);
 
-	lbm->lb->lineinfo[lbm->lb_rowno].mask ^= mask;
+	lb->offsets[lb->nrows] = lb->data_size;
+	lb->sizes[lb->nrows] = size;
+	lb->widths[lb->nrows] = width;
+	lb->nrows += 1;
+
+	lb->data_size += size + 1;
+
+	return lb;
 }
 
 /*
@@ -196,6 +1287,7 @@ lb_get_line(LineBuffer *lb,
 			int rowno,
 			int lineno, 
 			char **line,
+			int *size,
 			LineInfo **linfo,
 			int	*linenoptr)
 {
@@ -205,7 +1297,9 @@ lb_get_line(LineBuffer *lb,
 	if (lb && rowno >= 0 && rowno < lb->nrows)
 	{
 		if (line)
-			*line = lb->rows[rowno];
+			*line = lb_get_row(lb, rowno, size);
+		else if (size)
+			*size = lb->sizes[rowno];
 
 		if (linfo)
 			*linfo = lb->lineinfo ? &lb->lineinfo[rowno] : NULL;
@@ -216,6 +1310,9 @@ lb_get_line(LineBuffer *lb,
 	if (line)
 		*line = NULL;
 
+	if (size)
+		*size = 0;
+
 	if (linfo)
 		*linfo = NULL;
 
@@ -228,6 +1325,7 @@ lb_get_line(LineBuffer *lb,
 bool
 lbm_get_line(LineBufferMark *lbm,
 			 char **line,
+			 int *size,
 			 LineInfo **linfo,
 			 int *lineno)
 {
@@ -235,6 +1333,7 @@ lbm_get_line(LineBufferMark *lbm,
 					   lbm->lb_rowno,
 					   lbm->lineno,
 					   line,
+					   size,
 					   linfo,
 					   lineno);
 }
@@ -245,6 +1344,7 @@ lbm_get_line(LineBufferMark *lbm,
 inline bool
 lbi_get_line(LineBufferIter *lbi,
 			  char **line,
+			  int *size,
 			  LineInfo **linfo,
 			  int *lineno)
 {
@@ -252,6 +1352,7 @@ lbi_get_line(LineBufferIter *lbi,
 					   lbi->current_lb_rowno,
 					   lbi->lineno,
 					   line,
+					   size,
 					   linfo,
 					   lineno);
 }
@@ -263,12 +1364,13 @@ lbi_get_line(LineBufferIter *lbi,
 inline bool
 lbi_get_line_next(LineBufferIter *lbi,
 				  char **line,
+				  int *size,
 				  LineInfo **linfo,
 				  int *lineno)
 {
 	bool result;
 
-	result = lbi_get_line(lbi, line, linfo, lineno);
+	result = lbi_get_line(lbi, line, size, linfo, lineno);
 
 	(void) lbi_next(lbi);
 
@@ -283,12 +1385,13 @@ lbi_get_line_next(LineBufferIter *lbi,
 inline bool
 lbi_get_line_prev(LineBufferIter *lbi,
 				  char **line,
+				  int *size,
 				  LineInfo **linfo,
 				  int *lineno)
 {
 	bool result;
 
-	result = lbi_get_line(lbi, line, linfo, lineno);
+	result = lbi_get_line(lbi, line, size, linfo, lineno);
 
 	(void) lbi_prev(lbi);
 
@@ -421,6 +1524,7 @@ init_slbi_ddesc(SimpleLineBufferIter *slbi, DataDesc *desc)
 SimpleLineBufferIter *
 slbi_get_line_next(SimpleLineBufferIter *slbi,
 				   char **line,
+				   int *size,
 				   LineInfo **linfo)
 {
 	if (slbi)
@@ -435,7 +1539,9 @@ slbi_get_line_next(SimpleLineBufferIter *slbi,
 			*linfo = lb->lineinfo ? &lb->lineinfo[slbi->lb_rowno] : NULL;
 
 		if (line)
-			*line = lb->rows[slbi->lb_rowno];
+			*line = lb_get_row(lb, slbi->lb_rowno, size);
+		else if (size)
+			*size = lb->sizes[slbi->lb_rowno];
 
 		slbi->lb_rowno += 1;
 
@@ -456,37 +1562,211 @@ slbi_get_line_next(SimpleLineBufferIter *slbi,
 			return NULL;
 	}
 	else
+	{
 		*line = NULL;
 
+		if (size)
+			*size = 0;
+	}
+
 	return slbi;
 }
 
 /*
- * Free all lines stored in line buffer. An argument is data desc,
- * because first chunk of line buffer is owned by data desc.
+ * Release data of one line buffer. The line buffer itself is not
+ * released.
+ */
+static void
+lb_release(LineBuffer *lb)
+{
+	if (lb->is_cached)
+	{
+		int			i;
+
+		/* cached data are released without compression */
+		for (i = 0; i < lb_cache_items; i++)
+		{
+			if (lb_cache[i] == lb)
+			{
+				lb_cache[i] = lb_cache[--lb_cache_items];
+				break;
+			}
+		}
+	}
+	else if (lb->data)
+		lb_plain_bytes -= lb->data_allocated;
+
+	if (lb->zdata)
+		lb_zdata_bytes -= lb->zdata_size;
+
+	if (lb->is_spilled)
+		lb_spilled_blocks -= 1;
+
+	lb_xpos_cache_invalidate(lb, -1);
+
+	free(lb->data);
+	free(lb->zdata);
+	free(lb->lineinfo);
+	free(lb->candidates);
+	free(lb->bookmarks);
+}
+
+/*
+ * Copy line info, bookmark and candidate bit of row to last row
+ * of line buffer dest.
+ */
+static void
+lb_copy_row_state(LineBuffer *dest, LineBuffer *src, int rowno)
+{
+	int			dest_rowno = dest->nrows - 1;
+
+	if (src->lineinfo)
+	{
+		if (!dest->lineinfo)
+			dest->lineinfo = smalloc(LINEBUFFER_LINES * sizeof(LineInfo));
+
+		dest->lineinfo[dest_rowno] = src->lineinfo[rowno];
+	}
+
+	if (lb_is_bookmark(src, rowno))
+	{
+		if (!dest->bookmarks)
+			dest->bookmarks = smalloc(BOOKMARK_WORDS * sizeof(uint64_t));
+
+		dest->bookmarks[dest_rowno / 64] |= (uint64_t) 1 << (dest_rowno % 64);
+		dest->nbookmarks += 1;
+	}
+
+	if (src->candidates && (src->candidates[rowno >> 3] & (1 << (rowno & 7))))
+	{
+		if (!dest->candidates)
+			dest->candidates = smalloc(LINEBUFFER_LINES / 8 + 1);
+
+		dest->candidates[dest_rowno >> 3] |= 1 << (dest_rowno & 7);
+		dest->ncandidates += 1;
+	}
+}
+
+/*
+ * Removes LINEBUFFER_LINES oldest rows stored after nheader rows of
+ * header. The header rows and the rows of second line buffer, that
+ * are not removed, are moved to first line buffer, and the second
+ * line buffer is released. So all line buffers (without last) stay
+ * full, and the position of row can be calculated still. The line
+ * info, bookmark and candidate bit are moved with row. The last
+ * line buffer (where the rows are appended) is not changed never.
+ * Returns size of removed rows in bytes or zero, when there are not
+ * rows that can be removed.
+ */
+size_t
+lb_evict_rows(DataDesc *desc, int nheader)
+{
+	LineBuffer *first = &desc->rows;
+	LineBuffer *second = first->next;
+	LineBuffer *lb;
+	LineBuffer	aux;
+	size_t		removed = 0;
+	int			i;
+
+	if (!second || !second->next || nheader < 0 || nheader >= LINEBUFFER_LINES)
+		return 0;
+
+	memset(&aux, 0, sizeof(LineBuffer));
+
+	for (i = 0; i < first->nrows; i++)
+	{
+		int		size;
+		char   *str = lb_get_row(first, i, &size);
+
+		if (i < nheader)
+		{
+			(void) lb_append_line(&aux, str, size, first->widths[i]);
+			lb_copy_row_state(&aux, first, i);
+		}
+		else
+			removed += size + 1;
+	}
+
+	for (i = 0; i < second->nrows; i++)
+	{
+		int		size;
+		char   *str = lb_get_row(second, i, &size);
+
+		if (i >= nheader)
+		{
+			(void) lb_append_line(&aux, str, size, second->widths[i]);
+			lb_copy_row_state(&aux, second, i);
+		}
+		else
+			removed += size + 1;
+	}
+
+	/* only bookmarks of removed rows are lost */
+	desc->nbookmarks -= first->nbookmarks + second->nbookmarks - aux.nbookmarks;
+
+	lb_release(first);
+	lb_release(second);
+
+	aux.next = second->next;
+	aux.next->prev = first;
+	free(second);
+
+	memcpy(first, &aux, sizeof(LineBuffer));
+
+	/* first line buffer is not compressed, but unused memory can be released */
+	lb_freeze(first);
+
+	for (lb = first->next; lb; lb = lb->next)
+		lb->first_row -= LINEBUFFER_LINES;
+
+	ddesc_reset_positions(desc);
+	desc->evicted_rows += LINEBUFFER_LINES;
+
+	return removed;
+}
+
+/*
+ * Free all lines stored in line buffers. The first line buffer is
+ * embedded in some other structure, so it is not released.
  */
 void
-lb_free(DataDesc *desc)
+lb_free_rows(LineBuffer *first)
 {
-	LineBuffer   *lb = &desc->rows;
+	LineBuffer   *lb = first;
 	LineBuffer   *next;
-	int		i;
 
 	while (lb)
 	{
-		for (i = 0; i < lb->nrows; i++)
-			free(lb->rows[i]);
-
-		free(lb->lineinfo);
+		lb_release(lb);
 		next = lb->next;
 
-		if (lb != &desc->rows)
+		if (lb != first)
 			free(lb);
 
 		lb = next;
 	}
 }
 
+/*
+ * Free all lines stored in line buffer. An argument is data desc,
+ * because first chunk of line buffer is owned by data desc.
+ */
+void
+lb_free(DataDesc *desc)
+{
+	lb_free_rows(&desc->rows);
+
+	ddesc_reset_positions(desc);
+	desc->nbookmarks = 0;
+
+	/* temp file can be reused, when there are not any spilled data */
+	if (lb_spill_fd != -1 && lb_spilled_blocks == 0 && lb_spill_end > 0)
+	{
+		if (ftruncate(lb_spill_fd, 0) == 0)
+			lb_spill_end = 0;
+	}
+}
+
 /*
  * Print all lines to stream
  */
@@ -502,10 +1782,125 @@ lb_print_all_ddesc(DataDesc *desc, FILE *f)
 	{
 		char	   *line;
 
-		_slbi = slbi_get_line_next(_slbi, &line, NULL);
+		_slbi = slbi_get_line_next(_slbi, &line, NULL, NULL);
 
 		res = fprintf(f, "%s\n", line);
 		if (res < 0)
 			break;
 	}
 }
+
+typedef struct
+{
+	LineBufferWorkerFunc func;
+	void	   *worker;
+	LineBuffer **blocks;
+	bool	   *processed;
+	int			nblocks;
+	int			first;
+	int			step;
+} LineBufferTask;
+
+/*
+ * Returns number of workers for parallel processing of line buffers
+ */
+int
+lb_get_parallel_workers(void)
+{
+	long		n = sysconf(_SC_NPROCESSORS_ONLN);
+
+	if (n < 1)
+		return 1;
+
+	return n > LB_MAX_WORKERS ? LB_MAX_WORKERS : (int) n;
+}
+
+static void *
+lb_parallel_worker(void *arg)
+{
+	LineBufferTask *task = (LineBufferTask *) arg;
+	int			i;
+
+	for (i = task->first; i < task->nblocks; i += task->step)
+		task->processed[i] = task->func(task->worker, task->blocks[i], true);
+
+	return NULL;
+}
+
+/*
+ * Process all line buffers by function func. The line buffers that are
+ * in memory are processed by nworkers threads, every thread has own
+ * worker (argument of func). Compressed or spilled line buffers are
+ * processed later by this thread with last worker (workers has
+ * nworkers + 1 items), because block cache cannot be used concurrently.
+ */
+void
+lb_process_parallel(DataDesc *desc,
+					LineBufferWorkerFunc func,
+					void **workers,
+					int nworkers)
+{
+	LineBufferTask *tasks;
+	pthread_t  *threads;
+	LineBuffer **blocks;
+	LineBuffer *lb;
+	bool	   *processed;
+	int			nblocks = 0;
+	int			nthreads = 0;
+	int			i;
+
+	for (lb = &desc->rows; lb; lb = lb->next)
+		nblocks += 1;
+
+	blocks = smalloc(nblocks * sizeof(LineBuffer *));
+	for (lb = &desc->rows, i = 0; lb; lb = lb->next)
+		blocks[i++] = lb;
+
+	/* result of workers, loading of block can release other block */
+	processed = smalloc(nblocks * sizeof(bool));
+
+	tasks = smalloc(nworkers * sizeof(LineBufferTask));
+	threads = smalloc(nworkers * sizeof(pthread_t));
+
+	for (i = 0; i < nworkers; i++)
+	{
+		LineBufferTask *task = &tasks[i];
+
+		task->func = func;
+		task->worker = workers[i];
+		task->blocks = blocks;
+		task->processed = processed;
+		task->nblocks = nblocks;
+		task->first = i;
+		task->step = nworkers;
+	}
+
+	/* one line buffer is not worth to start threads */
+	if (nblocks > 1)
+	{
+		for (i = 0; i < nworkers; i++)
+		{
+			if (pthread_create(&threads[i], NULL, lb_parallel_worker, &tasks[i]) != 0)
+				break;
+
+			nthreads += 1;
+		}
+	}
+
+	/* fallback, process blocks of not started workers */
+	for (i = nthreads; i < nworkers; i++)
+		lb_parallel_worker(&tasks[i]);
+
+	for (i = 0; i < nthreads; i++)
+		pthread_join(threads[i], NULL);
+
+	/* now, process line buffers, that are not in memory */
+	for (i = 0; i < nblocks; i++)
+		if (!processed[i])
+			(void) func(workers[nworkers], blocks[i], false);
+
+	free(processed);
+	free(tasks);
+	free(threads);
+	free(blocks);
+}
@@ -64,6 +64,9 @@ ST_MENU_ITEM _copy[] = {
 	{"_2_Use formatted text", cmd_UseClipboard_text, NULL, 0, 0, 0, NULL},
 	{"_3_Use INSERT format", cmd_UseClipboard_INSERT, NULL, 0, 0, 0, NULL},
 	{"_4_Use commented INSERT format", cmd_UseClipboard_INSERT_with_comments, NULL, 0, 0, 0, NULL},
+	{"_5_Use multirow INSERT format", cmd_UseClipboard_INSERT_batch, NULL, 0, 0, 0, NULL},
+	{"_6_Use COPY format", cmd_UseClipboard_COPY, NULL, 0, 0, 0, NULL},
+	{"_7_Use Apache Arrow format", cmd_UseClipboard_ARROW, NULL, 0, 0, 0, NULL},
 	{NULL, 0, NULL, 0, 0, 0, NULL}
 };
 
@@ -123,6 +126,17 @@ ST_MENU_ITEM _command[] = {
 	{"~D~escending order", cmd_SortDesc, "d", 0, 0, 0, NULL},
 	{"~O~riginal order", cmd_OriginalSort, "u", 0, 0, 0, NULL},
 	{"--", 0, NULL, 0, 0, 0, NULL},
+	{"F~i~lter rows", cmd_SetFilter, "&", 0, 0, 0, NULL},
+	{"Toggle fil~t~er", cmd_ToggleFilter, "M-f", 0, 0, 0, NULL},
+	{"--", 0, NULL, 0, 0, 0, NULL},
+	{"Displa~y~ columns", cmd_SetColumns, "|", 0, 0, 0, NULL},
+	{"Hide column", cmd_HideColumn, "x", 0, 0, 0, NULL},
+	{"Move column left", cmd_MoveColumnLeft, "{", 0, 0, 0, NULL},
+	{"Move column right", cmd_MoveColumnRight, "}", 0, 0, 0, NULL},
+	{"Show all columns", cmd_ShowAllColumns, "M-x", 0, 0, 0, NULL},
+	{"Group ~b~y column", cmd_GroupBy, "=", 0, 0, 0, NULL},
+	{"Sample column", cmd_SampleColumn, "M-=", 0, 0, 0, NULL},
+	{"--", 0, NULL, 0, 0, 0, NULL},
 	{"To~g~gle mark", cmd_Mark, "F3", 0, 0, 0, NULL},
 	{"~M~ark column", cmd_MarkColumn, "F13", 0, 0, 0, NULL},
 	{"Mark all", cmd_MarkAll, NULL, 0, 0, 0, NULL},
@@ -163,6 +177,8 @@ ST_MENU_ITEM _options[] = {
 	{"~C~ase sensitive search", cmd_CSSearchSet, NULL, 0, 0, 0, NULL},
 	{"Case ~i~nsensitive search", cmd_CISearchSet, NULL, 0, 0, 0, NULL},
 	{"~U~pper case sensitive search", cmd_USSearchSet, NULL, 0, 0, 0, NULL},
+	{"~R~egular expression search", cmd_RegexSearchToggle, NULL, 0, 0, 0, NULL},
+	{"Incr~e~mental search", cmd_IncrementalSearchToggle, NULL, 0, 0, 0, NULL},
 	{"--", 0, NULL, 0, 0, 0, NULL},
 	{"Highlight searched ~l~ines", cmd_HighlightLines, NULL, 0, 0, 0, NULL},
 	{"Highlight searched ~v~alues", cmd_HighlightValues, NULL, 0, 0, 0, NULL},
@@ -174,6 +190,7 @@ ST_MENU_ITEM _options[] = {
 	{"Show top bar", cmd_ShowTopBar, NULL, 0, 0, 0, NULL},
 	{"Show bottom bar", cmd_ShowBottomBar, NULL, 0, 0, 0, NULL},
 	{"Show scrollbar", cmd_ShowScrollbar, NULL, 0, 0, 0, NULL},
+	{"Show ~p~erformance counters", cmd_ShowStats, "M-p", 0, 0, 0, NULL},
 	{"--", 0, NULL, 0, 0, 0, NULL},
 	{"~M~ouse support", cmd_MouseToggle, "M-m", 0, 0, 0, NULL},
 	{"~Q~uiet mode", cmd_SoundToggle, NULL, 0, 0, 0, NULL},
@@ -374,6 +391,8 @@ post_menu(Options *opts, struct ST_MENU *menu)
 									  !(opts->ignore_case || opts->ignore_lower_case));
 	st_menu_set_option(menu, cmd_CISearchSet, ST_MENU_OPTION_MARKED, opts->ignore_case);
 	st_menu_set_option(menu, cmd_USSearchSet, ST_MENU_OPTION_MARKED, opts->ignore_lower_case);
+	st_menu_set_option(menu, cmd_RegexSearchToggle, ST_MENU_OPTION_MARKED, opts->regex_search);
+	st_menu_set_option(menu, cmd_IncrementalSearchToggle, ST_MENU_OPTION_MARKED, opts->incremental_search);
 
 	st_menu_set_option(menu, cmd_ShowTopBar, ST_MENU_OPTION_MARKED, !opts->no_topbar);
 	st_menu_set_option(menu, cmd_ShowBottomBar, ST_MENU_OPTION_MARKED, !opts->no_commandbar);
@@ -386,6 +405,7 @@ post_menu(Options *opts, struct ST_MENU *menu)
 	st_menu_set_option(menu, cmd_BoldCursorToggle, ST_MENU_OPTION_MARKED, opts->bold_cursor);
 
 	st_menu_set_option(menu, cmd_ShowScrollbar, ST_MENU_OPTION_MARKED, opts->show_scrollbar);
+	st_menu_set_option(menu, cmd_ShowStats, ST_MENU_OPTION_MARKED, opts->show_stats);
 
 	st_menu_reset_all_submenu_options(menu, MENU_ITEM_THEME, ST_MENU_OPTION_MARKED);
 	st_menu_enable_option(menu, theme_get_cmd(opts->theme), ST_MENU_OPTION_MARKED);
@@ -405,6 +425,10 @@ refresh_clipboard_options(Options *opts, struct ST_MENU *menu)
 	st_menu_set_option(menu, cmd_UseClipboard_INSERT, ST_MENU_OPTION_MARKED, opts->clipboard_format == CLIPBOARD_FORMAT_INSERT);
 	st_menu_set_option(menu, cmd_UseClipboard_INSERT_with_comments, ST_MENU_OPTION_MARKED,
 					   opts->clipboard_format == CLIPBOARD_FORMAT_INSERT_WITH_COMMENTS);
+	st_menu_set_option(menu, cmd_UseClipboard_INSERT_batch, ST_MENU_OPTION_MARKED,
+					   opts->clipboard_format == CLIPBOARD_FORMAT_INSERT_BATCH);
+	st_menu_set_option(menu, cmd_UseClipboard_COPY, ST_MENU_OPTION_MARKED, opts->clipboard_format == CLIPBOARD_FORMAT_COPY);
+	st_menu_set_option(menu, cmd_UseClipboard_ARROW, ST_MENU_OPTION_MARKED, opts->clipboard_format == CLIPBOARD_FORMAT_ARROW);
 }
 
 void
@@ -25,6 +25,48 @@
 
 char errmsg[1024];
 
+/*
+ * The connection is opened when first query is executed, and it is used
+ * until pspg ends (watch mode and query stream mode executes queries
+ * repeatedly). The watch query is executed as prepared statement.
+ */
+static PGconn *conn = NULL;
+
+#define PREPARED_QUERY_NAME		"pspg_query"
+
+static char *prepared_query = NULL;
+static bool prepare_failed = false;
+static bool sent_prepared = false;
+
+/*
+ * The query can be sent asynchronously (watch mode), and the result
+ * is read when it is available. In query stream mode more queries can
+ * be sent in pipeline mode (without waiting on results).
+ */
+static int running_queries = 0;
+static long long query_start_us = 0;
+
+#ifdef LIBPQ_HAS_PIPELINING
+
+#define USE_PIPELINE(opts)		((opts)->querystream && (opts)->querystream_pipeline)
+
+#else
+
+#define USE_PIPELINE(opts)		false
+
+#endif
+
+/*
+ * Results of query stream are stored in ring buffer, so the user can
+ * returns to older results without new execution.
+ */
+static PGresult **history = NULL;
+static int history_size = 0;
+static int history_count = 0;
+static int history_first = 0;
+static int history_pos = -1;
+static bool history_changed = false;
+
 static RowBucketType *
 push_row(RowBucketType *rb, RowType *row, bool is_multiline)
 {
@@ -64,6 +106,15 @@ push_row(RowBucketType *rb, RowType *row, bool is_multiline)
 #define CASHOID 790
 #define NUMERICOID 1700
 #define OIDOID 26
+#define BOOLOID 16
+#define NAMEOID 19
+#define TEXTOID 25
+#define BPCHAROID 1042
+#define VARCHAROID 1043
+#define DATEOID 1082
+#define TIMESTAMPOID 1114
+#define TIMESTAMPTZOID 1184
+#define INTERVALOID 1186
  
 static char
 column_type_class(Oid ftype)
@@ -91,12 +142,51 @@ column_type_class(Oid ftype)
 	return align;
 }
 
+/*
+ * Returns type of values of column. COLUMN_TYPE_UNKNOWN is used
+ * for types, that should be detected from values.
+ */
+static ColumnType
+column_type(Oid ftype)
+{
+	switch (ftype)
+	{
+		case INT2OID:
+		case INT4OID:
+		case INT8OID:
+		case OIDOID:
+		case XIDOID:
+		case CIDOID:
+			return COLUMN_TYPE_INTEGER;
+		case FLOAT4OID:
+		case FLOAT8OID:
+		case NUMERICOID:
+			return COLUMN_TYPE_DECIMAL;
+		case BOOLOID:
+			return COLUMN_TYPE_BOOLEAN;
+		case DATEOID:
+			return COLUMN_TYPE_DATE;
+		case TIMESTAMPOID:
+		case TIMESTAMPTZOID:
+			return COLUMN_TYPE_TIMESTAMP;
+		case INTERVALOID:
+			return COLUMN_TYPE_INTERVAL;
+		case NAMEOID:
+		case TEXTOID:
+		case BPCHAROID:
+		case VARCHAROID:
+			return COLUMN_TYPE_TEXT;
+		default:
+			return COLUMN_TYPE_UNKNOWN;
+	}
+}
+
 
 #endif
 
-#define EXIT_OUT_OF_MEMORY()		do { PQclear(result); PQfinish(conn); leave("out of memory"); } while (0)
-#define RELEASE_AND_LEAVE(s)		do { PQclear(result); PQfinish(conn); *err = s; return false; } while (0)
-#define RELEASE_AND_EXIT(s)			do { PQclear(result); PQfinish(conn); leave(s); } while (0)
+#define EXIT_OUT_OF_MEMORY()		do { PQclear(result); pg_finish(); leave("out of memory"); } while (0)
+#define RELEASE_AND_LEAVE(s)		do { PQclear(result); *err = s; return false; } while (0)
+#define RELEASE_AND_EXIT(s)			do { PQclear(result); pg_finish(); leave(s); } while (0)
 
 #ifdef HAVE_POSTGRESQL
 
@@ -209,48 +299,86 @@ mark_hidden_columns(PGresult *result,
 	return visible_columns;
 }
 
-
-#endif
-
+/*
+ * Prepared statement is lost when session is closed.
+ */
+static void
+forget_prepared_query(void)
+{
+	free(prepared_query);
+	prepared_query = NULL;
+	prepare_failed = false;
+}
 
 /*
- * exit on fatal error, or return error
+ * The query can leave open or aborted transaction. The connection is
+ * reused, so the transaction is rolled back, else all next queries
+ * are executed inside this transaction or fail.
  */
-bool
-pg_exec_query(Options *opts, char *query, RowBucketType *rb, PrintDataDesc *pdesc, const char **err)
+static void
+rollback_transaction(void)
 {
+	PGTransactionStatusType status = PQtransactionStatus(conn);
 
-	log_row("execute query \"%s\"", query);
+	if (status != PQTRANS_INTRANS && status != PQTRANS_INERROR)
+		return;
 
-#ifdef HAVE_POSTGRESQL
+#ifdef LIBPQ_HAS_PIPELINING
 
-	PGconn	   *conn = NULL;
-	PGresult   *result = NULL;
+	/* synchronous commands are not allowed in pipeline mode */
+	if (PQpipelineStatus(conn) != PQ_PIPELINE_OFF &&
+		!PQexitPipelineMode(conn))
+		return;
 
-	int			nfields;
-	int			size;
-	int			i, j;
-	int			n;
-	char	   *locbuf;
-	RowType	   *row;
-	bool		multiline_row;
-	bool		multiline_col;
-	char	   *password;
+#endif
+
+	log_row("rollback of %s transaction",
+			status == PQTRANS_INERROR ? "aborted" : "open");
+
+	PQclear(PQexec(conn, "ROLLBACK"));
+}
 
+/*
+ * Returns living connection. When the connection is broken, then
+ * try to reset it, when it is not possible, then new connection
+ * is created.
+ */
+static PGconn *
+get_connection(Options *opts, const char **err)
+{
 	const char *keywords[8];
 	const char *values[8];
+	char	   *password;
 
-	bool	   *hidden;
+	if (conn)
+	{
+		if (PQstatus(conn) == CONNECTION_OK)
+		{
+			rollback_transaction();
+			return conn;
+		}
 
-	rb->nrows = 0;
-	rb->next_bucket = NULL;
+		log_row("connection is broken, try to reset it");
+
+		/* results of sent queries are lost */
+		running_queries = 0;
+
+		forget_prepared_query();
+		PQreset(conn);
+
+		if (PQstatus(conn) == CONNECTION_OK)
+			return conn;
+
+		PQfinish(conn);
+		conn = NULL;
+	}
 
 	if (opts->force_password_prompt && !opts->password)
 	{
 		password = getpass("Password: ");
 		opts->password = strdup(password);
 		if (!opts->password)
-			EXIT_OUT_OF_MEMORY();
+			leave("out of memory");
 	}
 
 	keywords[0] = "host"; values[0] = opts->host;
@@ -268,10 +396,12 @@ pg_exec_query(Options *opts, char *query, RowBucketType *rb, PrintDataDesc *pdes
 		PQconnectionNeedsPassword(conn) &&
 		!opts->password)
 	{
+		PQfinish(conn);
+
 		password = getpass("Password: ");
 		opts->password = strdup(password);
 		if (!opts->password)
-				EXIT_OUT_OF_MEMORY();
+			leave("out of memory");
 
 		keywords[3] = "password"; values[3] = opts->password;
 
@@ -282,20 +412,192 @@ pg_exec_query(Options *opts, char *query, RowBucketType *rb, PrintDataDesc *pdes
 	if (PQstatus(conn) != CONNECTION_OK)
 	{
 		sprintf(errmsg, "Connection to database failed: %s", PQerrorMessage(conn));
-		RELEASE_AND_LEAVE(errmsg);
+		*err = errmsg;
+
+		PQfinish(conn);
+		conn = NULL;
+
+		return NULL;
 	}
 
-	/*
-	 * ToDo: Because data are copied to local memory, the result can be fetched.
-	 * It can save 1/2 memory.
-	 */
-	result = PQexec(conn, query);
-	if (PQresultStatus(result) != PGRES_TUPLES_OK)
+	log_row("connected to database");
+
+	return conn;
+}
+
+static bool
+is_watch_query(Options *opts, char *query)
+{
+	return opts->watch_time > 0 && query == opts->query;
+}
+
+/*
+ * Sends query to server (without waiting on result). The watch query
+ * is sent as prepared statement, when it is already prepared.
+ */
+static bool
+send_query(Options *opts, char *query)
+{
+	bool		result;
+
+	sent_prepared = false;
+
+#ifdef LIBPQ_HAS_PIPELINING
+
+	if (USE_PIPELINE(opts))
 	{
-		sprintf(errmsg, "Query doesn't return data: %s", PQerrorMessage(conn));
-		RELEASE_AND_LEAVE(errmsg);
+		/*
+		 * Every query is closed by sync point, so an error of one query
+		 * doesn't abort following queries.
+		 */
+		if (PQpipelineStatus(conn) == PQ_PIPELINE_OFF &&
+			!PQenterPipelineMode(conn))
+			return false;
+
+		result = PQsendQueryParams(conn, query, 0, NULL, NULL, NULL, NULL, 0) &&
+				 PQpipelineSync(conn) &&
+				 PQflush(conn) == 0;
+	}
+	else
+
+#endif
+
+	if (is_watch_query(opts, query) &&
+		prepared_query && strcmp(prepared_query, query) == 0)
+	{
+		result = PQsendQueryPrepared(conn, PREPARED_QUERY_NAME, 0, NULL, NULL, NULL, 0);
+		sent_prepared = result;
+	}
+	else
+		result = PQsendQuery(conn, query);
+
+	if (result)
+	{
+		if (running_queries++ == 0)
+			query_start_us = stats_time_us();
+	}
+
+	return result;
+}
+
+/*
+ * Waits on result of sent query. Like PQexec, returns last result,
+ * but an error is preferred.
+ */
+static PGresult *
+get_result(void)
+{
+	PGresult   *result = NULL;
+	PGresult   *r;
+
+	while ((r = PQgetResult(conn)))
+	{
+		if (result && PQresultStatus(result) == PGRES_FATAL_ERROR)
+			PQclear(r);
+		else
+		{
+			PQclear(result);
+			result = r;
+		}
+	}
+
+#ifdef LIBPQ_HAS_PIPELINING
+
+	/* in pipeline mode the result of query is followed by sync point */
+	if (PQpipelineStatus(conn) != PQ_PIPELINE_OFF)
+	{
+		r = PQgetResult(conn);
+		if (PQresultStatus(r) != PGRES_PIPELINE_SYNC)
+			log_row("unexpected result status in pipeline mode: %s",
+					PQresStatus(PQresultStatus(r)));
+		PQclear(r);
+	}
+
+#endif
+
+	if (running_queries > 0 && --running_queries > 0)
+		query_start_us = stats_time_us();
+
+	return result;
+}
+
+/*
+ * Stores the result of query stream to history. The oldest result
+ * is released when the history is full.
+ */
+static void
+history_push(Options *opts, PGresult *result)
+{
+	if (!history)
+	{
+		history_size = opts->querystream_history > 0 ? opts->querystream_history : 1;
+		history = smalloc(history_size * sizeof(PGresult *));
+	}
+
+	if (history_count == history_size)
+	{
+		PQclear(history[history_first]);
+		history_first = (history_first + 1) % history_size;
+		history_count -= 1;
+	}
+
+	history[(history_first + history_count) % history_size] = result;
+	history_pos = history_count++;
+}
+
+/*
+ * The watch query is prepared after first successful execution, and
+ * then only prepared statement is executed. When the query cannot be
+ * prepared (multiple statements), then it is sent by PQsendQuery always.
+ */
+static void
+prepare_query(Options *opts, char *query)
+{
+	PGresult   *presult;
+
+	if (!is_watch_query(opts, query) || prepare_failed ||
+		(prepared_query && strcmp(prepared_query, query) == 0))
+		return;
+
+	if (prepared_query)
+	{
+		PQclear(PQexec(conn, "DEALLOCATE " PREPARED_QUERY_NAME));
+		forget_prepared_query();
 	}
 
+	presult = PQprepare(conn, PREPARED_QUERY_NAME, query, 0, NULL);
+	if (PQresultStatus(presult) == PGRES_COMMAND_OK)
+		prepared_query = sstrdup(query);
+	else
+	{
+		log_row("cannot to prepare query: %s", PQerrorMessage(conn));
+		prepare_failed = true;
+	}
+
+	PQclear(presult);
+}
+
+#endif
+
+
+#ifdef HAVE_POSTGRESQL
+
+/*
+ * Copy result to row buckets. Exit on fatal error.
+ */
+static void
+format_result(Options *opts, PGresult *result, RowBucketType *rb, PrintDataDesc *pdesc)
+{
+	int			nfields;
+	int			size;
+	int			i, j;
+	int			n;
+	char	   *locbuf;
+	RowType	   *row;
+	bool		multiline_row;
+	bool		multiline_col;
+	bool	   *hidden;
+
 	if ((nfields = PQnfields(result)) > 1024)
 		RELEASE_AND_EXIT("too much columns");
 
@@ -307,7 +609,12 @@ pg_exec_query(Options *opts, char *query, RowBucketType *rb, PrintDataDesc *pdes
 	n = 0;
 	for (i = 0; i < nfields; i++)
 		if (!hidden[i])
-			pdesc->types[n++] = column_type_class(PQftype(result, i));
+		{
+			pdesc->types[n] = column_type_class(PQftype(result, i));
+			pdesc->coltypes[n] = column_type(PQftype(result, i));
+			pdesc->columns_map[n] = n;
+			n += 1;
+		}
 
 	/* calculate necessary size of header data */
 	size = 0;
@@ -324,7 +631,7 @@ pg_exec_query(Options *opts, char *query, RowBucketType *rb, PrintDataDesc *pdes
 	if (!row)
 		EXIT_OUT_OF_MEMORY();
 
-	row->nfields = nfields;
+	row->nfields = pdesc->nfields;
 
 	multiline_row = false;
 	n = 0;
@@ -398,16 +705,102 @@ pg_exec_query(Options *opts, char *query, RowBucketType *rb, PrintDataDesc *pdes
 	}
 
 	free(hidden);
+}
 
-	PQclear(result);
-	PQfinish(conn);
+#endif
+
+/*
+ * exit on fatal error, or return error
+ *
+ * In query stream mode the result is stored in history. When the query
+ * is NULL, then the result from history (selected by pg_history_move or
+ * fetched by pg_fetch_result) is used. In pipeline mode the query is only
+ * sent, and the function returns false without error.
+ */
+bool
+pg_exec_query(Options *opts, char *query, RowBucketType *rb, PrintDataDesc *pdesc, const char **err)
+{
+
+#ifdef HAVE_POSTGRESQL
+
+	PGresult   *result = NULL;
+
+	rb->nrows = 0;
+	rb->next_bucket = NULL;
 
 	*err = NULL;
 
+	if (opts->querystream && !query)
+	{
+		if (history_pos == -1)
+			return false;
+
+		format_result(opts, history[(history_first + history_pos) % history_size], rb, pdesc);
+
+		return true;
+	}
+
+	log_row("execute query \"%s\"", query);
+
+	/* the query can be already sent by pg_send_query */
+	if (!pg_send_query(opts, query, err))
+		return false;
+
+	/* the result will be fetched by pg_fetch_result */
+	if (USE_PIPELINE(opts))
+		return false;
+
+	/*
+	 * ToDo: Because data are copied to local memory, the result can be fetched.
+	 * It can save 1/2 memory.
+	 */
+	result = get_result();
+
+	/*
+	 * The prepared statement can be broken by change of used objects
+	 * (cached plan must not change result type). The statement is
+	 * released, and the query is executed again without prepared
+	 * statement.
+	 */
+	if (sent_prepared && PQresultStatus(result) != PGRES_TUPLES_OK &&
+		PQstatus(conn) == CONNECTION_OK)
+	{
+		log_row("execution of prepared query failed: %s", PQerrorMessage(conn));
+
+		PQclear(result);
+		result = NULL;
+
+		rollback_transaction();
+		PQclear(PQexec(conn, "DEALLOCATE " PREPARED_QUERY_NAME));
+		forget_prepared_query();
+
+		if (!pg_send_query(opts, query, err))
+			return false;
+
+		result = get_result();
+	}
+
+	if (PQresultStatus(result) == PGRES_TUPLES_OK)
+		prepare_query(opts, query);
+	else
+	{
+		sprintf(errmsg, "Query doesn't return data: %s", PQerrorMessage(conn));
+		RELEASE_AND_LEAVE(errmsg);
+	}
+
+	format_result(opts, result, rb, pdesc);
+
+	if (opts->querystream)
+		history_push(opts, result);
+	else
+		PQclear(result);
+
 	return true;
 
 #else
 
+	(void) opts;
+	(void) query;
 	(void) rb;
 	(void) pdesc;
 
@@ -418,3 +811,275 @@ pg_exec_query(Options *opts, char *query, RowBucketType *rb, PrintDataDesc *pdes
 #endif
 
 }
+
+/*
+ * Reads result of first query sent in pipeline mode, and stores it
+ * to history. When the result was selected from history already,
+ * then returns true immediately.
+ */
+bool
+pg_fetch_result(Options *opts, const char **err)
+{
+
+#ifdef HAVE_POSTGRESQL
+
+	PGresult   *result;
+
+	*err = NULL;
+
+	if (history_changed)
+	{
+		history_changed = false;
+		return true;
+	}
+
+	if (!running_queries)
+		return false;
+
+	result = get_result();
+
+	if (PQresultStatus(result) != PGRES_TUPLES_OK)
+	{
+		sprintf(errmsg, "Query doesn't return data: %s",
+				result ? PQresultErrorMessage(result) : PQerrorMessage(conn));
+		RELEASE_AND_LEAVE(errmsg);
+	}
+
+	history_push(opts, result);
+
+	return true;
+
+#else
+
+	(void) opts;
+
+	*err = NULL;
+
+	return false;
+
+#endif
+
+}
+
+/*
+ * Selects older (step < 0) or newer (step > 0) result from history.
+ * Returns false, when there is not any other result.
+ */
+bool
+pg_history_move(int step)
+{
+
+#ifdef HAVE_POSTGRESQL
+
+	int		pos = history_pos + step;
+
+	if (history_pos == -1 || pos < 0 || pos >= history_count)
+		return false;
+
+	history_pos = pos;
+	history_changed = true;
+
+	return true;
+
+#else
+
+	(void) step;
+
+	return false;
+
+#endif
+
+}
+
+/*
+ * Returns position of displayed result (starts by 1) and number
+ * of stored results.
+ */
+void
+pg_history_info(int *pos, int *count)
+{
+
+#ifdef HAVE_POSTGRESQL
+
+	*pos = history_pos + 1;
+	*count = history_count;
+
+#else
+
+	*pos = 0;
+	*count = 0;
+
+#endif
+
+}
+
+/*
+ * Sends query without waiting on result. The result is read by
+ * pg_exec_query.
+ */
+bool
+pg_send_query(Options *opts, char *query, const char **err)
+{
+
+#ifdef HAVE_POSTGRESQL
+
+	if (running_queries && !USE_PIPELINE(opts))
+		return true;
+
+	if (!get_connection(opts, err))
+		return false;
+
+	if (!send_query(opts, query))
+	{
+		/* the connection can be broken, try to reconnect */
+		if (PQstatus(conn) != CONNECTION_BAD ||
+			!get_connection(opts, err) ||
+			!send_query(opts, query))
+		{
+			if (conn)
+			{
+				sprintf(errmsg, "Query cannot be sent: %s", PQerrorMessage(conn));
+				*err = errmsg;
+			}
+
+			return false;
+		}
+	}
+
+	log_row("query was sent");
+
+	return true;
+
+#else
+
+	(void) opts;
+	(void) query;
+
+	*err = "Query cannot be executed. The Postgres library was not available at compile time.";
+
+	return false;
+
+#endif
+
+}
+
+/*
+ * Returns socket of connection with running query or -1
+ */
+int
+pg_socket(void)
+{
+
+#ifdef HAVE_POSTGRESQL
+
+	if (running_queries)
+		return PQsocket(conn);
+
+#endif
+
+	return -1;
+}
+
+/*
+ * Reads available data from socket. Returns true, when the result
+ * of running query is complete (and pg_exec_query will not wait),
+ * or when other result was selected from history.
+ */
+bool
+pg_consume_input(void)
+{
+
+#ifdef HAVE_POSTGRESQL
+
+	if (history_changed)
+		return true;
+
+	if (running_queries)
+	{
+		/* on broken connection the error is returned by PQgetResult */
+		if (!PQconsumeInput(conn))
+			return true;
+
+		return !PQisBusy(conn);
+	}
+
+#endif
+
+	return false;
+}
+
+/*
+ * Returns time of running query in ms or -1, when there is not
+ * any running query.
+ */
+long
+pg_query_time(void)
+{
+
+#ifdef HAVE_POSTGRESQL
+
+	if (running_queries)
+		return (long) ((stats_time_us() - query_start_us) / 1000);
+
+#endif
+
+	return -1;
+}
+
+/*
+ * Sends cancel request for running query. The error is returned
+ * like result of query.
+ */
+void
+pg_cancel_query(void)
+{
+
+#ifdef HAVE_POSTGRESQL
+
+	if (running_queries)
+	{
+		PGcancel   *cancel;
+		char		buffer[256];
+
+		cancel = PQgetCancel(conn);
+		if (cancel)
+		{
+			if (!PQcancel(cancel, buffer, sizeof(buffer)))
+				log_row("cannot to cancel query: %s", buffer);
+			else
+				log_row("cancel request was sent");
+
+			PQfreeCancel(cancel);
+		}
+	}
+
+#endif
+
+}
+
+/*
+ * Close the connection (when it is opened)
+ */
+void
+pg_finish(void)
+{
+
+#ifdef HAVE_POSTGRESQL
+
+	if (conn)
+	{
+		/* don't allow to run query after pspg ends */
+		pg_cancel_query();
+		running_queries = 0;
+
+		PQfinish(conn);
+		conn = NULL;
+
+		forget_prepared_query();
+
+		log_row("disconnected from database");
+	}
+
+#endif
+
+}
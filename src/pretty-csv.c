@@ -52,8 +52,14 @@ typedef struct
 	LineBuffer *linebuf;
 	bool		force8bit;
 	int			flushed_rows;		/* number of flushed rows */
+	size_t		flushed_bytes;		/* size of flushed rows */
 	int			maxbytes;
 	bool		printed_headline;
+	char	   *dest;				/* rendered rows are written here, when it is not NULL */
+	char	   *dest_end;
+	ColumnStore *colstore;			/* printed rows are stored there, when it is not NULL */
+	int			line_rowno;			/* row of column store of printed single line row or -1 */
+	int			block_rowno;		/* row of column store of first line of line buffer or -1 */
 } PrintbufType;
 
 typedef struct
@@ -66,37 +72,55 @@ typedef struct
 } PrintConfigType;
 
 /*
- * Add new row to LineBuffer
+ * Add new row to LineBuffer or to rendered rows
  */
 static void
 pb_flush_line(PrintbufType *printbuf)
 {
-	char	   *line;
+	if (printbuf->dest)
+	{
+		if (printbuf->dest + printbuf->used + 1 > printbuf->dest_end)
+			leave("broken rendering of rows from column store");
 
-	if (printbuf->linebuf->nrows == LINEBUFFER_LINES)
+		memcpy(printbuf->dest, printbuf->buffer, printbuf->used);
+		printbuf->dest[printbuf->used] = '\0';
+		printbuf->dest += printbuf->used + 1;
+	}
+	else
 	{
-		LineBuffer *nb = smalloc2(sizeof(LineBuffer), "serialize csv output");
+		LineBuffer *lb = printbuf->linebuf;
 
-		memset(nb, 0, sizeof(LineBuffer));
+		/*
+		 * When full line buffer holds only single line rows, then these
+		 * rows can be rendered from column store later, and formatted
+		 * rows can be released. First line buffer holds headline, so it
+		 * is not released.
+		 */
+		if (lb->nrows == LINEBUFFER_LINES && lb->prev &&
+			printbuf->block_rowno != -1)
+			lb_set_colstore(lb, printbuf->colstore, printbuf->block_rowno);
 
-		printbuf->linebuf->next = nb;
-		nb->prev = printbuf->linebuf;
-		printbuf->linebuf = nb;
-	}
+		lb = lb_append_line(lb, printbuf->buffer, printbuf->used, -1);
 
-	line = smalloc2(printbuf->used + 1, "serialize csv output");
-	memcpy(line, printbuf->buffer, printbuf->used);
-	line[printbuf->used] = '\0';
+		if (lb->nrows == 1)
+			printbuf->block_rowno = printbuf->line_rowno;
+		else if (printbuf->block_rowno != -1 &&
+				 printbuf->line_rowno != printbuf->block_rowno + lb->nrows - 1)
+			printbuf->block_rowno = -1;
 
-	printbuf->linebuf->rows[printbuf->linebuf->nrows++] = line;
+		printbuf->linebuf = lb;
+	}
+
+	printbuf->line_rowno = -1;
 
 	if (printbuf->used > printbuf->maxbytes)
 		printbuf->maxbytes = printbuf->used;
 
+	printbuf->flushed_rows += 1;
+	printbuf->flushed_bytes += printbuf->used + 1;
+
 	printbuf->used = 0;
 	printbuf->free = printbuf->size;
-
-	printbuf->flushed_rows += 1;
 }
 
 static void
@@ -396,7 +420,181 @@ pb_put_line(char *str, bool multiline, PrintbufType *printbuf)
 }
 
 /*
- * Print formatted data loaded inside RowBuckets
+ * Print one line of row. Multiline values are printed by more calls,
+ * fields holds rest of multiline values. Returns true, when the row
+ * has more lines.
+ */
+static bool
+pb_print_line(PrintbufType *printbuf,
+			  RowType *row,
+			  char **fields,
+			  int multiline_lineno,
+			  bool multiline,
+			  bool isheader,
+			  int border,
+			  char linestyle,
+			  PrintDataDesc *pdesc)
+{
+	bool	is_last_column_multiline = pdesc->multilines[pdesc->nfields - 1];
+	int		last_column_num = pdesc->nfields - 1;
+	bool	more_lines = false;
+	int		j;
+
+	if (border == 2)
+	{
+		if (linestyle == 'a')
+			pb_write(printbuf, "| ", 2);
+		else
+			pb_write(printbuf, "\342\224\202 ", 4);
+	}
+	else if (border == 1)
+		pb_write(printbuf, " ", 1);
+
+	for (j = 0; j < pdesc->nfields; j++)
+	{
+		int		width;
+		int		spaces;
+		char   *field;
+		bool	_more_lines = false;
+
+		if (j > 0)
+		{
+			if (border != 0)
+			{
+				if (linestyle == 'a')
+					pb_write(printbuf, "| ", 2);
+				else
+					pb_write(printbuf, "\342\224\202 ", 4);
+			}
+		}
+
+		if (pdesc->columns_map[j] < row->nfields)
+		{
+			if (multiline_lineno == 0)
+			{
+				field = row->fields[pdesc->columns_map[j]];
+				fields[j] = NULL;
+			}
+			else
+				field = fields[j];
+		}
+		else
+			field = NULL;
+
+		if (field && *field != '\0')
+		{
+			bool	left_align = pdesc->types[j] != 'd';
+
+			if (printbuf->force8bit)
+			{
+				if (multiline)
+				{
+					char   *ptr = field;
+					width = 0;
+
+					while (*ptr)
+					{
+						if (*ptr++ == '\n')
+						{
+							more_lines |= true;
+							break;
+						}
+						width += 1;
+					}
+				}
+				else
+					width = strlen(field);
+			}
+			else
+			{
+				if (multiline)
+				{
+					width = utf_string_dsplen_multiline(field, SIZE_MAX, &_more_lines, true, NULL, NULL);
+					more_lines |= _more_lines;
+				}
+				else
+					width = utf_string_dsplen(field, SIZE_MAX);
+			}
+
+			spaces = pdesc->widths[j] - width;
+
+			/*
+			 * The display width can be canculated badly when labels or
+			 * displayed string has some special or invisible chars. Here
+			 * is simple ugly fix - the number of spaces cannot be negative.
+			 */
+			if (spaces < 0)
+				spaces = 0;
+
+			/* left spaces */
+			if (isheader)
+				pb_putc_repeat(printbuf, spaces / 2, ' ');
+			else if (!left_align)
+				pb_putc_repeat(printbuf, spaces, ' ');
+
+			if (multiline)
+				fields[j] = pb_put_line(field, multiline, printbuf);
+			else
+				(void) pb_put_line(field, multiline, printbuf);
+
+			/* right spaces */
+			if (isheader)
+				pb_putc_repeat(printbuf, spaces - (spaces / 2), ' ');
+			else if (left_align)
+				pb_putc_repeat(printbuf, spaces, ' ');
+		}
+		else
+			pb_putc_repeat(printbuf, pdesc->widths[j], ' ');
+
+		if (_more_lines)
+		{
+			if (linestyle == 'a')
+				pb_putc(printbuf, '+');
+			else
+				pb_write(printbuf, "\342\206\265", 3);
+		}
+		else
+		{
+			if (border != 0 || j < last_column_num || is_last_column_multiline)
+				pb_putc(printbuf, ' ');
+		}
+	}
+
+	if (border == 2)
+	{
+		if (linestyle == 'a')
+			pb_write(printbuf, "|", 2);
+		else
+			pb_write(printbuf, "\342\224\202", 3);
+	}
+
+	return more_lines;
+}
+
+/*
+ * Release stored rows of one row bucket
+ */
+static void
+free_bucket_rows(RowBucketType *rb)
+{
+	int		i;
+
+	for (i = 0; i < rb->nrows; i++)
+	{
+		RowType	   *r = rb->rows[i];
+
+		/* only first field holds allocated string */
+		if (r->nfields > 0)
+			free(r->fields[0]);
+		free(r);
+	}
+
+	rb->nrows = 0;
+}
+
+/*
+ * Print formatted data loaded inside RowBuckets. When printbuf has
+ * column store, then printed rows are moved to column store.
  */
 static void
 pb_print_rowbuckets(PrintbufType *printbuf,
@@ -405,8 +603,6 @@ pb_print_rowbuckets(PrintbufType *printbuf,
 				   PrintDataDesc *pdesc,
 				   char *title)
 {
-	bool	is_last_column_multiline = pdesc->multilines[pdesc->nfields - 1];
-	int		last_column_num = pdesc->nfields - 1;
 	int		printed_rows = 0;
 	char	linestyle = pconfig->linestyle;
 	int		border = pconfig->border;
@@ -414,7 +610,10 @@ pb_print_rowbuckets(PrintbufType *printbuf,
 
 	printbuf->printed_headline = false;
 	printbuf->flushed_rows = 0;
+	printbuf->flushed_bytes = 0;
 	printbuf->maxbytes = 0;
+	printbuf->line_rowno = -1;
+	printbuf->block_rowno = -1;
 
 	if (title)
 	{
@@ -430,7 +629,6 @@ pb_print_rowbuckets(PrintbufType *printbuf,
 
 		for (i = 0; i < rb->nrows; i++)
 		{
-			int		j;
 			bool	isheader = false;
 			RowType	   *row;
 			bool	more_lines = true;
@@ -440,144 +638,27 @@ pb_print_rowbuckets(PrintbufType *printbuf,
 
 			/* skip broken rows */
 			if (pconfig->ignore_short_rows && rb->rows[i]->nfields != pdesc->nfields_all)
+			{
+				rb->linenos[i] = -1;
 				continue;
+			}
+
+			rb->linenos[i] = printbuf->flushed_rows;
 
 			multiline_lineno = 0;
 			row = rb->rows[i];
 
 			while (more_lines)
 			{
-				more_lines = false;
-
-				if (border == 2)
-				{
-					if (linestyle == 'a')
-						pb_write(printbuf, "| ", 2);
-					else
-						pb_write(printbuf, "\342\224\202 ", 4);
-				}
-				else if (border == 1)
-					pb_write(printbuf, " ", 1);
-
 				isheader = printed_rows == 0 ? pdesc->has_header : false;
 
-				for (j = 0; j < pdesc->nfields; j++)
-				{
-					int		width;
-					int		spaces;
-					char   *field;
-					bool	_more_lines = false;
-
-					if (j > 0)
-					{
-						if (border != 0)
-						{
-							if (linestyle == 'a')
-								pb_write(printbuf, "| ", 2);
-							else
-								pb_write(printbuf, "\342\224\202 ", 4);
-						}
-					}
-
-					if (pdesc->columns_map[j] < row->nfields)
-					{
-						if (multiline_lineno == 0)
-						{
-							field = row->fields[pdesc->columns_map[j]];
-							fields[j] = NULL;
-						}
-						else
-							field = fields[j];
-					}
-					else
-						field = NULL;
-
-					if (field && *field != '\0')
-					{
-						bool	left_align = pdesc->types[j] != 'd';
+				more_lines = pb_print_line(printbuf, row, fields,
+										   multiline_lineno, multiline, isheader,
+										   border, linestyle, pdesc);
 
-						if (printbuf->force8bit)
-						{
-							if (multiline)
-							{
-								char   *ptr = field;
-								width = 0;
-
-								while (*ptr)
-								{
-									if (*ptr++ == '\n')
-									{
-										more_lines |= true;
-										break;
-									}
-									width += 1;
-								}
-							}
-							else
-								width = strlen(field);
-						}
-						else
-						{
-							if (multiline)
-							{
-								width = utf_string_dsplen_multiline(field, SIZE_MAX, &_more_lines, true, NULL, NULL);
-								more_lines |= _more_lines;
-							}
-							else
-								width = utf_string_dsplen(field, SIZE_MAX);
-						}
-
-						spaces = pdesc->widths[j] - width;
-
-						/*
-						 * The display width can be canculated badly when labels or
-						 * displayed string has some special or invisible chars. Here
-						 * is simple ugly fix - the number of spaces cannot be negative.
-						 */
-						if (spaces < 0)
-							spaces = 0;
-
-						/* left spaces */
-						if (isheader)
-							pb_putc_repeat(printbuf, spaces / 2, ' ');
-						else if (!left_align)
-							pb_putc_repeat(printbuf, spaces, ' ');
-
-						if (multiline)
-							fields[j] = pb_put_line(field, multiline, printbuf);
-						else
-							(void) pb_put_line(field, multiline, printbuf);
-
-						/* right spaces */
-						if (isheader)
-							pb_putc_repeat(printbuf, spaces - (spaces / 2), ' ');
-						else if (left_align)
-							pb_putc_repeat(printbuf, spaces, ' ');
-					}
-					else
-						pb_putc_repeat(printbuf, pdesc->widths[j], ' ');
-
-					if (_more_lines)
-					{
-						if (linestyle == 'a')
-							pb_putc(printbuf, '+');
-						else
-							pb_write(printbuf, "\342\206\265", 3);
-					}
-					else
-					{
-						if (border != 0 || j < last_column_num || is_last_column_multiline)
-							pb_putc(printbuf, ' ');
-					}
-				}
-
-				if (border == 2)
-				{
-					if (linestyle == 'a')
-						pb_write(printbuf, "|", 2);
-					else
-						pb_write(printbuf, "\342\224\202", 3);
-				}
+				/* only single line data rows can be rendered again */
+				if (printbuf->colstore && !multiline && !isheader)
+					printbuf->line_rowno = printbuf->colstore->nrows;
 
 				pb_flush_line(printbuf);
 
@@ -590,8 +671,15 @@ pb_print_rowbuckets(PrintbufType *printbuf,
 				printed_rows += 1;
 				multiline_lineno += 1;
 			}
+
+			if (printbuf->colstore)
+				cs_append_row(printbuf->colstore, row, pdesc->columns_map, rb->linenos[i]);
 		}
 
+		/* values are in column store now */
+		if (printbuf->colstore)
+			free_bucket_rows(rb);
+
 		rb = rb->next_bucket;
 	}
 
@@ -602,6 +690,50 @@ pb_print_rowbuckets(PrintbufType *printbuf,
 	pb_flush_line(printbuf);
 }
 
+/*
+ * Render rows of column store to buffer. The result should be same like
+ * the original formatted rows (one row is one line). It is called when
+ * line buffer, that released formatted rows, is loaded.
+ */
+void
+render_colstore_rows(ColumnStore *cs, int rowno, int nrows, char *dest, size_t size)
+{
+	PrintbufType printbuf;
+	RowType	   *row;
+	char	   *fields[1024];
+	int			i;
+
+	memset(&printbuf, 0, sizeof(PrintbufType));
+
+	printbuf.buffer = smalloc2(10 * 1024, "render rows");
+	printbuf.size = 10 * 1024;
+	printbuf.free = printbuf.size;
+	printbuf.force8bit = cs->force8bit;
+	printbuf.dest = dest;
+	printbuf.dest_end = dest + size;
+
+	row = smalloc2(offsetof(RowType, fields) + (cs->ncolumns * sizeof(char *)), "render rows");
+	row->nfields = cs->ncolumns;
+
+	for (i = 0; i < nrows; i++)
+	{
+		int		j;
+
+		for (j = 0; j < cs->ncolumns; j++)
+			row->fields[j] = (char *) cs_get_value(cs, rowno + i, j, NULL);
+
+		(void) pb_print_line(&printbuf, row, fields, 0, false, false,
+							 cs->border, cs->linestyle, cs->pdesc);
+		pb_flush_line(&printbuf);
+	}
+
+	if (printbuf.dest != printbuf.dest_end)
+		leave("broken rendering of rows from column store");
+
+	free(printbuf.buffer);
+	free(row);
+}
+
 /*
  * Try to detect column type and prepare all data necessary for printing
  */
@@ -1358,49 +1490,30 @@ next_char:
 }
 
 /*
- * Read external unformatted data (csv or result of some query
- *
+ * Release row buckets and stored rows
  */
-bool
-read_and_format(Options *opts, DataDesc *desc, StateData *state)
+void
+free_rowbuckets(RowBucketType *rb)
 {
-	LinebufType		linebuf;
-	RowBucketType	rowbuckets, *rb;
-	PrintConfigType	pconfig;
-	PrintbufType	printbuf;
-	PrintDataDesc	pdesc;
-	char	   *query = opts->query;
-
-	state->errstr = NULL;
-	state->_errno = 0;
-
-	if (opts->querystream)
+	while (rb)
 	{
-		SimpleLineBufferIter slbi, *_slbi;
-		char	   *str;
-		ExtStr		estr;
-
-		/* We need to make an query from stored lines */
-		_slbi = init_slbi_ddesc(&slbi, desc);
-		InitExtStr(&estr);
-
-		while (_slbi)
-		{
-			_slbi = slbi_get_line_next(_slbi, &str, NULL);
-			ExtStrAppendNewLine(&estr, str);
-		}
-
-		if (estr.len > 0)
-			query = estr.data;
-		else
-			free(estr.data);
+		RowBucketType	*nextrb;
 
-		lb_free(desc);
+		free_bucket_rows(rb);
 
-		if (!query)
-			return false;
+		nextrb = rb->next_bucket;
+		if (rb->allocated)
+			free(rb);
+		rb = nextrb;
 	}
+}
 
+/*
+ * Initialize fields of DataDesc before formatting
+ */
+static void
+init_desc(DataDesc *desc)
+{
 	memset(desc, 0, sizeof(DataDesc));
 
 	desc->title[0] = '\0';
@@ -1419,6 +1532,13 @@ read_and_format(Options *opts, DataDesc *desc, StateData *state)
 	desc->is_pgcli_fmt = false;
 	desc->namesline = NULL;
 	desc->order_map = NULL;
+	desc->positions = NULL;
+	desc->nbookmarks = 0;
+	desc->column_values = NULL;
+	desc->row_filter = NULL;
+	desc->row_filter_active = false;
+	desc->colstore = NULL;
+	desc->source_types = NULL;
 	desc->total_rows = 0;
 	desc->multilines_already_tested = false;
 
@@ -1427,64 +1547,27 @@ read_and_format(Options *opts, DataDesc *desc, StateData *state)
 
 	memset(&desc->rows, 0, sizeof(LineBuffer));
 	desc->rows.prev = NULL;
+}
 
-	memset(&linebuf, 0, sizeof(LinebufType));
-
-	linebuf.buffer = malloc(10 * 1024);
-	linebuf.used = 0;
-	linebuf.size = 10 * 1024;
-
-	pconfig.linestyle = (opts->force_ascii_art || opts->force8bit) ? 'a' : 'u';
-	pconfig.border = opts->border_type;
-	pconfig.double_header = opts->double_header;
-	pconfig.header_mode = opts->csv_header;
-	pconfig.ignore_short_rows = opts->ignore_short_rows;
-
-	rowbuckets.allocated = false;
-
-	if (query)
-	{
-		if (!pg_exec_query(opts,
-						   query,
-						   &rowbuckets,
-						   &pdesc,
-						   &state->errstr))
-		{
-			log_row("pgclient error: %s\n", state->errstr);
-
-			if (query != opts->query)
-				free(query);
-
-			return false;
-		}
-	}
-	else if (opts->csv_format)
-	{
-		read_csv(&rowbuckets,
-				 &linebuf,
-				 opts->csv_separator,
-				 opts->force8bit,
-				 state->fp, opts->ignore_short_rows,
-				 opts);
-
-		prepare_pdesc(&rowbuckets, &linebuf, &pdesc, &pconfig);
-	}
-	else if (opts->tsv_format)
-	{
-		read_tsv(&rowbuckets,
-				 &linebuf,
-				 opts->force8bit,
-				 state->fp,
-				 opts->ignore_short_rows,
-				 opts);
-
-		prepare_pdesc(&rowbuckets, &linebuf, &pdesc, &pconfig);
-	}
+/*
+ * Print rows to line buffers of desc and set geometry of formatted
+ * table. The buffer is used as print buffer, and it is released.
+ */
+static void
+print_rows(Options *opts,
+		   DataDesc *desc,
+		   RowBucketType *rb,
+		   PrintDataDesc *pdesc,
+		   PrintConfigType *pconfig,
+		   char *buffer,
+		   int size,
+		   bool is_query_result)
+{
+	PrintbufType	printbuf;
 
-	/* reuse allocated memory */
-	printbuf.buffer = linebuf.buffer;
-	printbuf.size = linebuf.size;
-	printbuf.free = linebuf.size;
+	printbuf.buffer = buffer;
+	printbuf.size = size;
+	printbuf.free = size;
 	printbuf.used = 0;
 	printbuf.linebuf = &desc->rows;
 	printbuf.force8bit = opts->force8bit;
@@ -1492,31 +1575,56 @@ read_and_format(Options *opts, DataDesc *desc, StateData *state)
 	/* init other printbuf fields */
 	printbuf.printed_headline = false;
 	printbuf.flushed_rows = 0;
+	printbuf.flushed_bytes = 0;
 	printbuf.maxbytes = 0;
+	printbuf.dest = NULL;
+	printbuf.dest_end = NULL;
+	printbuf.colstore = NULL;
+
+	/*
+	 * Not formatted values are stored by columns. They are used for sort,
+	 * filter or export, and full line buffers are rendered from column
+	 * store on demand, so formatted rows (with padding and borders) are
+	 * not holded in memory.
+	 */
+	if (pdesc->nfields > 0)
+	{
+		ColumnStore *cs = cs_create(pdesc->nfields);
+		int		i;
 
-	/* sanitize ptr */
-	linebuf.buffer = NULL;
-	linebuf.size = 0;
+		cs->pdesc = smalloc2(sizeof(PrintDataDesc), "create column store");
+		memcpy(cs->pdesc, pdesc, sizeof(PrintDataDesc));
+
+		/* only visible columns are stored */
+		for (i = 0; i < pdesc->nfields; i++)
+			cs->pdesc->columns_map[i] = i;
 
-	pb_print_rowbuckets(&printbuf, &rowbuckets, &pconfig, &pdesc, NULL);
+		cs->border = pconfig->border;
+		cs->linestyle = pconfig->linestyle;
+		cs->force8bit = opts->force8bit;
 
-	desc->border_type = pconfig.border;
-	desc->linestyle = pconfig.linestyle;
+		printbuf.colstore = cs;
+	}
+
+	pb_print_rowbuckets(&printbuf, rb, pconfig, pdesc, NULL);
+
+	desc->border_type = pconfig->border;
+	desc->linestyle = pconfig->linestyle;
 	desc->maxbytes = printbuf.maxbytes;
+	desc->total_bytes = printbuf.flushed_bytes;
 
 	if (printbuf.printed_headline)
 	{
 		int		headline_rowno;
 
-		headline_rowno = pconfig.border == 2 ? 2 : 1;
+		headline_rowno = pconfig->border == 2 ? 2 : 1;
 
 		if (desc->rows.nrows > headline_rowno)
 		{
-			desc->namesline = desc->rows.rows[headline_rowno - 1];
+			desc->namesline = lb_get_row(&desc->rows, headline_rowno - 1, NULL);
 
 			desc->border_head_row = headline_rowno;
-			desc->headline = desc->rows.rows[headline_rowno];
-			desc->headline_size = strlen(desc->headline);
+			desc->headline = lb_get_row(&desc->rows, headline_rowno, &desc->headline_size);
 
 			if (opts->force8bit)
 				desc->headline_char_size = desc->headline_size;
@@ -1532,7 +1640,7 @@ read_and_format(Options *opts, DataDesc *desc, StateData *state)
 			desc->footer_row = desc->last_row;
 			desc->footer_rows = 1;
 
-			if (pconfig.border == 2)
+			if (pconfig->border == 2)
 			{
 				desc->border_top_row = 0;
 				desc->last_data_row = desc->total_rows - 2 - 1;
@@ -1555,31 +1663,31 @@ read_and_format(Options *opts, DataDesc *desc, StateData *state)
 		 * When we have not headline. We know structure, so we can
 		 * "translate" headline here (generate translated headline).
 		 */
-		desc->columns = linebuf.maxfields;
+		desc->columns = pdesc->nfields;
 		desc->cranges = smalloc2(desc->columns * sizeof(CRange), "prepare metadata");
 		memset(desc->cranges, 0, desc->columns * sizeof(CRange));
 		desc->headline_transl = smalloc2(desc->maxbytes + 3, "prepare metadata");
 
 		ptr = desc->headline_transl;
 
-		if (pconfig.border == 1)
+		if (pconfig->border == 1)
 			*ptr++ = 'd';
-		else if (pconfig.border == 2)
+		else if (pconfig->border == 2)
 		{
 			*ptr++ = 'L';
 			*ptr++ = 'd';
 		}
 
-		for (i = 0; i < linebuf.maxfields; i++)
+		for (i = 0; i < pdesc->nfields; i++)
 		{
-			int		width = linebuf.widths[i];
+			int		width = pdesc->widths[i];
 
 			desc->cranges[i].name_offset = -1;
 			desc->cranges[i].name_size = -1;
 
 			if (i > 0)
 			{
-				if (pconfig.border > 0)
+				if (pconfig->border > 0)
 				{
 					*ptr++ = 'd';
 					*ptr++ = 'I';
@@ -1595,9 +1703,9 @@ read_and_format(Options *opts, DataDesc *desc, StateData *state)
 			}
 		}
 
-		if (pconfig.border == 1)
+		if (pconfig->border == 1)
 			*ptr++ = 'd';
-		else if (pconfig.border == 2)
+		else if (pconfig->border == 2)
 		{
 			*ptr++ = 'd';
 			*ptr++ = 'R';
@@ -1628,7 +1736,7 @@ read_and_format(Options *opts, DataDesc *desc, StateData *state)
 		desc->footer_row = desc->last_row;
 		desc->footer_rows = 1;
 
-		if (pconfig.border == 2)
+		if (pconfig->border == 2)
 		{
 			desc->first_data_row = 0;
 			desc->border_top_row = 0;
@@ -1649,29 +1757,226 @@ read_and_format(Options *opts, DataDesc *desc, StateData *state)
 
 	free(printbuf.buffer);
 
-	/* release row buckets */
-	rb = &rowbuckets;
+	desc->colstore = printbuf.colstore;
 
-	while (rb)
+	if (desc->colstore)
+		cs_freeze(desc->colstore);
+
+	/* types of query result's columns are known */
+	if (is_query_result && desc->colstore)
 	{
-		RowBucketType	*nextrb;
-		int		i;
+		desc->source_types = smalloc2(pdesc->nfields * sizeof(ColumnType), "save query result");
+		memcpy(desc->source_types, pdesc->coltypes, pdesc->nfields * sizeof(ColumnType));
+	}
 
-		for (i = 0; i < rb->nrows; i++)
+	free_rowbuckets(rb);
+}
+
+/*
+ * Read external unformatted data (csv or result of some query
+ *
+ */
+bool
+read_and_format(Options *opts, DataDesc *desc, StateData *state)
+{
+	LinebufType		linebuf;
+	RowBucketType	rowbuckets;
+	PrintConfigType	pconfig;
+	PrintDataDesc	pdesc;
+	char	   *query = opts->query;
+	bool		is_query_result = opts->query || opts->querystream;
+	long long	start_us;
+
+	start_us = stats_time_us();
+
+	state->errstr = NULL;
+	state->_errno = 0;
+
+	if (opts->querystream)
+	{
+		SimpleLineBufferIter slbi, *_slbi;
+		char	   *str;
+		ExtStr		estr;
+
+		/* We need to make an query from stored lines */
+		_slbi = init_slbi_ddesc(&slbi, desc);
+		InitExtStr(&estr);
+
+		while (_slbi)
 		{
-			RowType	   *r = rb->rows[i];
+			_slbi = slbi_get_line_next(_slbi, &str, NULL, NULL);
+			ExtStrAppendNewLine(&estr, str);
+		}
 
-			/* only first field holds allocated string */
-			if (r->nfields > 0)
-				free(r->fields[0]);
-			free(r);
+		/* without query the result from history is displayed */
+		if (estr.len > 0)
+			query = estr.data;
+		else
+			free(estr.data);
+
+		lb_free(desc);
+	}
+
+	init_desc(desc);
+
+	memset(&linebuf, 0, sizeof(LinebufType));
+
+	linebuf.buffer = malloc(10 * 1024);
+	linebuf.used = 0;
+	linebuf.size = 10 * 1024;
+
+	pconfig.linestyle = (opts->force_ascii_art || opts->force8bit) ? 'a' : 'u';
+	pconfig.border = opts->border_type;
+	pconfig.double_header = opts->double_header;
+	pconfig.header_mode = opts->csv_header;
+	pconfig.ignore_short_rows = opts->ignore_short_rows;
+
+	rowbuckets.allocated = false;
+
+	if (is_query_result)
+	{
+		bool	result;
+
+		result = pg_exec_query(opts,
+							   query,
+							   &rowbuckets,
+							   &pdesc,
+							   &state->errstr);
+
+		if (query != opts->query)
+			free(query);
+
+		/* in pipeline mode the query is only sent, and there is not an error */
+		if (!result)
+		{
+			if (state->errstr)
+				log_row("pgclient error: %s\n", state->errstr);
+
+			return false;
 		}
+	}
+	else if (opts->csv_format)
+	{
+		read_csv(&rowbuckets,
+				 &linebuf,
+				 opts->csv_separator,
+				 opts->force8bit,
+				 state->fp, opts->ignore_short_rows,
+				 opts);
 
-		nextrb = rb->next_bucket;
-		if (rb->allocated)
-			free(rb);
-		rb = nextrb;
+		prepare_pdesc(&rowbuckets, &linebuf, &pdesc, &pconfig);
+	}
+	else if (opts->tsv_format)
+	{
+		read_tsv(&rowbuckets,
+				 &linebuf,
+				 opts->force8bit,
+				 state->fp,
+				 opts->ignore_short_rows,
+				 opts);
+
+		prepare_pdesc(&rowbuckets, &linebuf, &pdesc, &pconfig);
 	}
 
+	print_rows(opts, desc, &rowbuckets, &pdesc, &pconfig,
+			   linebuf.buffer, linebuf.size, is_query_result);
+
+	/* sanitize ptr */
+	linebuf.buffer = NULL;
+	linebuf.size = 0;
+
+	perf_stats.load_us = stats_time_us() - start_us;
+
 	return true;
 }
+
+/*
+ * Format rows generated by pager (first row is header). Types of columns
+ * are known, so they are not detected. The rows are released.
+ */
+void
+format_rows(Options *opts, DataDesc *desc, RowBucketType *rb, ColumnType *coltypes, int nfields)
+{
+	PrintConfigType	pconfig;
+	PrintDataDesc	pdesc;
+	RowBucketType  *iter;
+	int			size = 10 * 1024;
+	int			i, j;
+
+	memset(&pdesc, 0, sizeof(PrintDataDesc));
+
+	pdesc.nfields = nfields;
+	pdesc.nfields_all = nfields;
+	pdesc.has_header = true;
+
+	for (i = 0; i < nfields; i++)
+	{
+		ColumnType	t = coltypes[i];
+
+		pdesc.types[i] = (t == COLUMN_TYPE_INTEGER ||
+						  t == COLUMN_TYPE_DECIMAL ||
+						  t == COLUMN_TYPE_SIZE) ? 'd' : 'a';
+		pdesc.coltypes[i] = t;
+		pdesc.columns_map[i] = i;
+	}
+
+	for (iter = rb; iter; iter = iter->next_bucket)
+	{
+		for (i = 0; i < iter->nrows; i++)
+		{
+			RowType	   *row = iter->rows[i];
+
+			iter->multilines[i] = false;
+
+			for (j = 0; j < nfields; j++)
+			{
+				long int	digits;
+				long int	others;
+				bool		multiline = false;
+				int			width;
+
+				if (opts->force8bit)
+				{
+					char	   *ptr = row->fields[j];
+					int			cw = 0;
+
+					width = 0;
+
+					while (*ptr)
+					{
+						if (*ptr++ == '\n')
+						{
+							multiline = true;
+							width = cw > width ? cw : width;
+							cw = 0;
+						}
+						else
+							cw++;
+					}
+
+					width = cw > width ? cw : width;
+				}
+				else
+					width = utf_string_dsplen_multiline(row->fields[j], strlen(row->fields[j]),
+														&multiline, false, &digits, &others);
+
+				if (width > pdesc.widths[j])
+					pdesc.widths[j] = width;
+
+				pdesc.multilines[j] |= multiline;
+				iter->multilines[i] |= multiline;
+			}
+		}
+	}
+
+	pconfig.linestyle = (opts->force_ascii_art || opts->force8bit) ? 'a' : 'u';
+	pconfig.border = opts->border_type;
+	pconfig.double_header = opts->double_header;
+	pconfig.header_mode = '+';
+	pconfig.ignore_short_rows = false;
+
+	init_desc(desc);
+
+	print_rows(opts, desc, rb, &pdesc, &pconfig,
+			   smalloc2(size, "format rows"), size, true);
+}
@@ -426,11 +426,18 @@ print_column_names(WINDOW *win,
 	}
 }
 
+/*
+ * Sets flags of found pattern of line. When desc is NULL, then cached
+ * positions of line are not used (rowstr is not the line of lbm, or the
+ * function is called from other thread than main).
+ */
 LineInfo *
 set_line_info(Options *opts,
 			  ScrDesc *scrdesc,
+			  DataDesc *desc,
 			  LineBufferMark *lbm,
-			  char *rowstr)
+			  char *rowstr,
+			  int rowsize)
 {
 	LineInfo   *linfo = NULL;
 
@@ -459,28 +466,9 @@ set_line_info(Options *opts,
 
 		while (str != NULL)
 		{
-			/*
-			 * When we would to ignore case or lower case (in this case, we know, so
-			 * pattern has not any upper char, then we have to use slower case insensitive
-			 * searching.
-			 */
-			if (opts->ignore_case || (opts->ignore_lower_case && !scrdesc->has_upperchr))
-			{
-				if (opts->force8bit)
-					str = nstrstr(str, scrdesc->searchterm);
-				else
-					str = utf8_nstrstr(str, scrdesc->searchterm);
-			}
-			else if (opts->ignore_lower_case && scrdesc->has_upperchr)
-			{
-				if (opts->force8bit)
-					str = nstrstr_ignore_lower_case(str, scrdesc->searchterm);
-				else
-					str = utf8_nstrstr_ignore_lower_case(str, scrdesc->searchterm);
-			}
-			else
-				/* we can use case sensitive searching (binary comparation) */
-				str = strstr(str, scrdesc->searchterm);
+			int		size;
+
+			str = pspg_search(opts, scrdesc, desc, desc ? lbm : NULL, rowstr, rowsize, str, &size);
 
 			if (str != NULL)
 			{
@@ -497,9 +485,19 @@ set_line_info(Options *opts,
 						linfo->start_char = str - rowstr;
 					else
 						linfo->start_char = utf8len_start_stop(rowstr, str);
+
+					/*
+					 * The length of regular expression match is not constant,
+					 * so the positions are calculated when row is displayed.
+					 */
+					if (scrdesc->searchregexp)
+					{
+						linfo->mask |= LINEINFO_FOUNDSTR_MULTI;
+						break;
+					}
 				}
 
-				str += scrdesc->searchterm_size;
+				str += size;
 			}
 		}
 	}
@@ -672,6 +670,7 @@ window_fill(int window_identifier,
 		int			bytes;
 		char	   *ptr;
 		char	   *rowstr = NULL;
+		int			rowsize = 0;
 		bool		line_is_valid = false;
 		LineInfo   *lineinfo = NULL;
 		bool		is_bookmark_row = false;
@@ -687,7 +686,7 @@ window_fill(int window_identifier,
 
 		(void) lbi_set_mark_next(&lbi, &lbm);
 
-		line_is_valid = lbm_get_line(&lbm, &rowstr, &lineinfo, NULL);
+		line_is_valid = lbm_get_line(&lbm, &rowstr, &rowsize, &lineinfo, NULL);
 
 		/* when rownum is printed, don't process original text */
 		if (is_rownum && line_is_valid)
@@ -698,10 +697,11 @@ window_fill(int window_identifier,
 			rowstr = buffer;
 		}
 
-		is_bookmark_row = (lineinfo != NULL && (lineinfo->mask & LINEINFO_BOOKMARK) != 0) ? true : false;
+		is_bookmark_row = line_is_valid && lb_is_bookmark(lbm.lb, lbm.lb_rowno);
 
 		if (!is_fix_rows && *scrdesc->searchterm != '\0' && !opts->no_highlight_search)
-			lineinfo = set_line_info(opts, scrdesc, &lbm, rowstr);
+			lineinfo = set_line_info(opts, scrdesc, is_rownum ? NULL : desc, &lbm, rowstr,
+									 is_rownum ? -1 : rowsize);
 
 		is_pattern_row = (lineinfo != NULL && (lineinfo->mask & LINEINFO_FOUNDSTR) != 0) ? true : false;
 
@@ -714,12 +714,15 @@ window_fill(int window_identifier,
 
 			while (str != NULL && npositions < 100)
 			{
-				str = pspg_search(opts, scrdesc, str);
+				int		size;
+
+				str = pspg_search(opts, scrdesc, desc, is_rownum ? NULL : &lbm, rowstr,
+								  is_rownum ? -1 : rowsize, str, &size);
 
 				if (str != NULL)
 				{
 					positions[npositions][0] = opts->force8bit ? (size_t) (str - rowstr) : utf8len_start_stop(rowstr, str);
-					positions[npositions][1] = positions[npositions][0] + scrdesc->searchterm_char_size;
+					positions[npositions][1] = opts->force8bit ? (size_t) (str + size - rowstr) : utf8len_start_stop(rowstr, str + size);
 
 					/* don't search more if we are over visible part */
 					if (positions[npositions][1] > srcx + maxx)
@@ -728,7 +731,7 @@ window_fill(int window_identifier,
 						break;
 					}
 
-					str += scrdesc->searchterm_size;
+					str += size;
 					npositions += 1;
 				}
 			}
@@ -860,6 +863,22 @@ window_fill(int window_identifier,
 			/* skip first srcx chars */
 			i = srcx;
 			left_spaces = 0;
+
+			/* fast path, the row is not visible, cached width can be used */
+			if (srcx > 0 && lbm_get_line_width(&lbm, opts->force8bit) <= srcx)
+			{
+				rowstr += rowsize;
+				i = 0;
+			}
+			else if (srcx > 0)
+			{
+				int		charpos;
+
+				/* jump to nearest start of column before srcx */
+				rowstr += lbm_get_xpos_offset(&lbm, desc, srcx, opts->force8bit, &charpos);
+				i = srcx - charpos;
+			}
+
 			if (opts->force8bit)
 			{
 				while(i > 0)
@@ -1053,7 +1072,7 @@ window_fill(int window_identifier,
 						if (is_cursor || is_cross_cursor)
 						{
 							if (is_found_row && pos >= scrdesc->found_start_x &&
-									pos < scrdesc->found_start_x + scrdesc->searchterm_char_size)
+									pos < scrdesc->found_start_x + scrdesc->found_char_size)
 								new_attr = new_attr ^ ( A_REVERSE | pattern_fix );
 							else if (is_pattern_row)
 							{
@@ -1331,7 +1350,7 @@ draw_rectange(int offsety, int offsetx,			/* y, x offset on screen */
 		char	   *ptr;
 		char	   *rowstr = NULL;
 
-		(void) lbi_get_line_next(&lbi, &rowstr, NULL, NULL);
+		(void) lbi_get_line_next(&lbi, &rowstr, NULL, NULL, NULL);
 
 		active_attr = line_attr;
 		printf("%s", ansi_attr(active_attr));
@@ -0,0 +1,807 @@
+/*-------------------------------------------------------------------------
+ *
+ * projection.c
+ *	  hide and reorder displayed columns
+ *
+ * Portions Copyright (c) 2017-2021 Pavel Stehule
+ *
+ * IDENTIFICATION
+ *	  src/projection.c
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include "pspg.h"
+#include "unicode.h"
+
+/*
+ * Bounds are display positions of parts of source line. The first
+ * bound is end of left border, then there are pairs of start and
+ * end of inner border, and last bound is start of right border.
+ * So the column n is between bounds[2n] and bounds[2n + 1].
+ */
+static void
+init_bounds(Projection *pr, DataDesc *desc)
+{
+	const char *transl = desc->headline_transl;
+	int			tail = desc->headline_char_size;
+	int			pos;
+
+	pr->bounds = smalloc2(2 * desc->columns * sizeof(int), "create projection");
+	pr->offsets = smalloc2(2 * desc->columns * sizeof(int), "create projection");
+	pr->xpos = smalloc2(2 * desc->columns * sizeof(int), "create projection");
+
+	pr->bounds[pr->nbounds++] = transl[0] == 'L' ? 1 : 0;
+
+	for (pos = 0; transl[pos]; pos++)
+	{
+		if (transl[pos] == 'I')
+		{
+			pr->bounds[pr->nbounds++] = pos;
+			pr->bounds[pr->nbounds++] = pos + 1;
+		}
+		else if (transl[pos] == 'R')
+		{
+			tail = pos;
+			break;
+		}
+	}
+
+	pr->bounds[pr->nbounds++] = tail;
+}
+
+/*
+ * Returns max size of projected line in bytes (without ending zero).
+ * Any part of source line is used once, only inner borders can be
+ * used more times, and the parts can be padded by spaces.
+ */
+int
+project_line_max_size(Projection *pr, int size)
+{
+	return size + 5 * pr->ncolumns + pr->bounds[pr->nbounds - 1] + 1;
+}
+
+static char *
+append_spaces(char *ptr, int n)
+{
+	while (n-- > 0)
+		*ptr++ = ' ';
+
+	return ptr;
+}
+
+/*
+ * Copy part of line between bounds from and to. The part is padded
+ * by spaces, when some wide char is cut by bound, or when the line
+ * is shorter.
+ */
+static char *
+append_part(Projection *pr, const char *str, char *ptr, int from, int to)
+{
+	int			size = pr->offsets[to] - pr->offsets[from];
+	int			width = pr->bounds[to] - pr->bounds[from];
+	int			lpad = 0;
+	int			used = 0;
+
+	/* the line is not shorter */
+	if (pr->xpos[from] >= pr->bounds[from])
+	{
+		lpad = pr->xpos[from] - pr->bounds[from];
+		used = pr->xpos[to] - pr->xpos[from];
+	}
+
+	ptr = append_spaces(ptr, lpad);
+
+	memcpy(ptr, str + pr->offsets[from], size);
+	ptr += size;
+
+	return append_spaces(ptr, width - lpad - used);
+}
+
+/*
+ * Writes projected line to dest, and returns its size. Only table
+ * lines are projected, other lines (title, footer) are copied. An
+ * inner border is taken from position after displayed source column
+ * (there can be a continuation symbol).
+ */
+int
+project_line(Projection *pr, const char *str, int size, int lineno, char *dest)
+{
+	char	   *ptr = dest;
+	int			ntail = pr->nbounds - 1;
+	int			offset = 0;
+	int			pos = 0;
+	int			i;
+
+	if (lineno < pr->first_table_row || lineno > pr->last_table_row)
+	{
+		memcpy(dest, str, size);
+		return size;
+	}
+
+	for (i = 0; i < pr->nbounds; i++)
+	{
+		while (pos < pr->bounds[i] && offset < size)
+		{
+			if (pr->force8bit)
+			{
+				pos += 1;
+				offset += 1;
+			}
+			else
+			{
+				pos += utf_dsplen(str + offset);
+				offset += utf8charlen(str[offset]);
+			}
+		}
+
+		pr->offsets[i] = offset < size ? offset : size;
+		pr->xpos[i] = pos;
+	}
+
+	/* left border */
+	memcpy(ptr, str, pr->offsets[0]);
+	ptr += pr->offsets[0];
+
+	for (i = 0; i < pr->ncolumns; i++)
+	{
+		int			colno = pr->columns[i];
+
+		if (i > 0)
+		{
+			int			prev = pr->columns[i - 1];
+			int			border = 2 * prev + 1 < ntail ? 2 * prev + 1 : 1;
+
+			ptr = append_part(pr, str, ptr, border, border + 1);
+		}
+
+		ptr = append_part(pr, str, ptr, 2 * colno, 2 * colno + 1);
+	}
+
+	/* right border */
+	if (pr->offsets[ntail] < size)
+	{
+		memcpy(ptr, str + pr->offsets[ntail], size - pr->offsets[ntail]);
+		ptr += size - pr->offsets[ntail];
+	}
+	else
+	{
+		/* short line should not be padded */
+		while (ptr > dest && ptr[-1] == ' ')
+			ptr -= 1;
+	}
+
+	return ptr - dest;
+}
+
+/*
+ * Returns number of source column of displayed column
+ */
+int
+get_source_column(DataDesc *desc, int colno)
+{
+	if (desc->projection && colno >= 0 && colno < desc->projection->ncolumns)
+		return desc->projection->columns[colno];
+
+	return colno;
+}
+
+/*
+ * Returns source columns of displayed columns or NULL, when all
+ * columns are displayed.
+ */
+int *
+get_projection(DataDesc *desc, int *ncolumns)
+{
+	if (!desc->projection)
+	{
+		*ncolumns = desc->columns;
+		return NULL;
+	}
+
+	*ncolumns = desc->projection->ncolumns;
+
+	return desc->projection->columns;
+}
+
+/*
+ * Line buffers of both lists are in same order, so line buffer
+ * can be found by its first row.
+ */
+static LineBuffer **
+get_blocks(LineBuffer *first, LineBuffer *rows)
+{
+	LineBuffer **blocks;
+	LineBuffer *lb;
+	int			n = 0;
+
+	for (lb = rows; lb; lb = lb->next)
+		n += 1;
+
+	blocks = smalloc2(n * sizeof(LineBuffer *), "create projection");
+
+	n = 0;
+	for (lb = rows; lb; lb = lb->next)
+		blocks[n++] = lb;
+
+	/* first line buffer is moved */
+	blocks[0] = first;
+
+	return blocks;
+}
+
+/*
+ * Order map points to old line buffers, that are replaced by
+ * new line buffers with same rows.
+ */
+static void
+remap_order_map(DataDesc *desc, LineBuffer **blocks)
+{
+	int			i;
+
+	for (i = 0; desc->order_map && i < desc->order_map_items; i++)
+	{
+		MappedLine *ml = &desc->order_map[i];
+
+		ml->lnb = blocks[ml->lnb->first_row / LINEBUFFER_LINES];
+	}
+
+	ddesc_reset_positions(desc);
+}
+
+/*
+ * Bookmarks are moved between line buffers with same rows
+ */
+static void
+move_bookmarks(LineBuffer *dest, LineBuffer *src)
+{
+	while (dest && src)
+	{
+		dest->bookmarks = src->bookmarks;
+		dest->nbookmarks = src->nbookmarks;
+
+		src->bookmarks = NULL;
+		src->nbookmarks = 0;
+
+		dest = dest->next;
+		src = src->next;
+	}
+}
+
+/*
+ * Continuation lines of multiline rows are same in projection
+ */
+static void
+copy_continuations(LineBuffer *dest, LineBuffer *src)
+{
+	while (dest && src)
+	{
+		int			i;
+
+		if (src->lineinfo)
+		{
+			for (i = 0; i < src->nrows; i++)
+			{
+				if (src->lineinfo[i].mask & LINEINFO_CONTINUATION)
+				{
+					if (!dest->lineinfo)
+						dest->lineinfo = smalloc(LINEBUFFER_LINES * sizeof(LineInfo));
+
+					dest->lineinfo[i].mask |= LINEINFO_CONTINUATION;
+				}
+			}
+		}
+
+		dest = dest->next;
+		src = src->next;
+	}
+}
+
+/*
+ * Returns back source rows and geometry of source data.
+ */
+static void
+remove_projection(DataDesc *desc)
+{
+	Projection *pr = desc->projection;
+	DataDesc   *src = &pr->source;
+	LineBuffer **blocks;
+
+	move_bookmarks(&pr->source.rows, &desc->rows);
+
+	blocks = get_blocks(&desc->rows, &pr->source.rows);
+	remap_order_map(desc, blocks);
+	free(blocks);
+
+	lb_free_rows(&desc->rows);
+	lb_move_rows(&desc->rows, &pr->source.rows);
+
+	free_column_values(desc);
+	free(desc->headline_transl);
+	free(desc->cranges);
+
+	desc->headline = src->headline;
+	desc->headline_size = src->headline_size;
+	desc->headline_transl = src->headline_transl;
+	desc->headline_char_size = src->headline_char_size;
+	desc->namesline = src->namesline;
+	desc->cranges = src->cranges;
+	desc->columns = src->columns;
+	desc->maxx = src->maxx;
+	desc->maxbytes = src->maxbytes;
+	desc->footer_char_size = src->footer_char_size;
+	desc->linestyle = src->linestyle;
+	desc->border_type = src->border_type;
+	desc->is_pgcli_fmt = src->is_pgcli_fmt;
+	desc->expanded_info_minx = src->expanded_info_minx;
+	desc->oid_name_table = src->oid_name_table;
+	desc->multilines_already_tested = src->multilines_already_tested;
+	desc->has_multilines = src->has_multilines;
+
+	desc->projection = NULL;
+
+	free(pr->columns);
+	free(pr->bounds);
+	free(pr->offsets);
+	free(pr->xpos);
+	free(pr);
+}
+
+/*
+ * Source rows are returned back to desc, and they can be released
+ * with desc.
+ */
+void
+free_projection(DataDesc *desc)
+{
+	if (desc->projection)
+		remove_projection(desc);
+}
+
+/*
+ * When there is not headline (csv without header), then the translated
+ * headline is generated by pretty-csv. In this case the translated
+ * headline is projected like any other table line. Returns its width.
+ */
+static int
+project_headline_transl(Projection *pr, DataDesc *desc)
+{
+	const char *transl = pr->source.headline_transl;
+	bool		force8bit = pr->force8bit;
+	char	   *ptr;
+	int			size;
+	int			i = 0;
+
+	size = strlen(transl);
+	desc->headline_transl = smalloc2(project_line_max_size(pr, size) + 1, "create projection");
+
+	/* translated headline holds only ascii chars */
+	pr->force8bit = true;
+	size = project_line(pr, transl, size, pr->first_table_row, desc->headline_transl);
+	pr->force8bit = force8bit;
+
+	desc->headline_transl[size] = '\0';
+	desc->headline_char_size = size;
+
+	desc->columns = pr->ncolumns;
+	desc->cranges = smalloc2(desc->columns * sizeof(CRange), "create projection");
+
+	desc->cranges[0].xmin = 0;
+
+	for (ptr = desc->headline_transl; *ptr; ptr++)
+	{
+		desc->cranges[i].name_offset = -1;
+		desc->cranges[i].name_size = -1;
+
+		if (*ptr == 'I')
+		{
+			desc->cranges[i].xmax = ptr - desc->headline_transl;
+			desc->cranges[++i].xmin = ptr - desc->headline_transl;
+		}
+	}
+
+	desc->cranges[i].name_offset = -1;
+	desc->cranges[i].name_size = -1;
+	desc->cranges[i].xmax = size - 1;
+
+	return size;
+}
+
+/*
+ * Replace source rows by projected rows. Returns false, when
+ * the projected headline cannot be translated.
+ */
+static bool
+create_projection(Options *opts, DataDesc *desc, int *columns, int ncolumns)
+{
+	Projection *pr;
+	LineBuffer **blocks;
+	LineBuffer *lb;
+	int			width;
+
+	pr = smalloc2(sizeof(Projection), "create projection");
+
+	pr->ncolumns = ncolumns;
+	pr->columns = smalloc2(ncolumns * sizeof(int), "create projection");
+	memcpy(pr->columns, columns, ncolumns * sizeof(int));
+	pr->force8bit = opts->force8bit;
+
+	free_column_values(desc);
+
+	/* source data are holded by projection */
+	memcpy(&pr->source, desc, sizeof(DataDesc));
+	lb_move_rows(&pr->source.rows, &desc->rows);
+
+	/* these fields are valid only for desc */
+	pr->source.order_map = NULL;
+	pr->source.positions = NULL;
+	pr->source.row_filter = NULL;
+
+	init_bounds(pr, &pr->source);
+
+	pr->first_table_row = desc->border_top_row != -1 ? desc->border_top_row : desc->title_rows;
+	pr->last_table_row = desc->border_bottom_row != -1 ? desc->border_bottom_row : desc->last_data_row;
+
+	lb_init_projection(&desc->rows, &pr->source.rows, pr);
+
+	move_bookmarks(&desc->rows, &pr->source.rows);
+
+	if (desc->multilines_already_tested)
+		copy_continuations(&desc->rows, &pr->source.rows);
+
+	blocks = get_blocks(&desc->rows, &desc->rows);
+	remap_order_map(desc, blocks);
+	free(blocks);
+
+	desc->projection = pr;
+
+	desc->headline_transl = NULL;
+	desc->cranges = NULL;
+	desc->oid_name_table = false;
+
+	if (pr->source.headline)
+	{
+		desc->headline = lb_get_row(&desc->rows, desc->border_head_row, &desc->headline_size);
+		desc->namesline = pr->source.namesline ?
+							lb_get_row(&desc->rows, desc->border_head_row - 1, NULL) : NULL;
+
+		if (!translate_headline(opts, desc))
+		{
+			/* translate_headline released headline_transl already */
+			remove_projection(desc);
+			format_error("cannot to detect columns of projected data");
+			return false;
+		}
+
+		/* table lines are padded to width of headline */
+		width = opts->force8bit ? desc->headline_size : utf_string_dsplen(desc->headline, desc->headline_size);
+	}
+	else
+		width = project_headline_transl(pr, desc);
+
+	desc->maxx = width - 1;
+
+	/* other lines are not changed */
+	for (lb = &desc->rows; lb; lb = lb->next)
+	{
+		LineBufferMark lbm;
+
+		if (lb->first_row >= pr->first_table_row &&
+			lb->first_row + lb->nrows - 1 <= pr->last_table_row)
+			continue;
+
+		lbm.lb = lb;
+
+		for (lbm.lb_rowno = 0; lbm.lb_rowno < lb->nrows; lbm.lb_rowno++)
+		{
+			int			lineno = lb->first_row + lbm.lb_rowno;
+
+			if (lineno >= pr->first_table_row && lineno <= pr->last_table_row)
+				continue;
+
+			width = lbm_get_line_width(&lbm, opts->force8bit);
+			if (width - 1 > desc->maxx)
+				desc->maxx = width - 1;
+		}
+	}
+
+	desc->maxbytes = project_line_max_size(pr, pr->source.maxbytes);
+
+	if (desc->footer_row == -1)
+		desc->footer_char_size = desc->maxx;
+
+	return true;
+}
+
+/*
+ * Display only specified columns (numbers of source columns) in
+ * specified order. When columns is NULL, then all columns are
+ * displayed. The rows are not copied - they are rendered from source
+ * rows, when they are displayed. Returns false, when projection
+ * cannot be used.
+ */
+bool
+set_projection(Options *opts, DataDesc *desc, int *columns, int ncolumns)
+{
+	DataDesc   *src = desc->projection ? &desc->projection->source : desc;
+	bool		is_filtered = desc->row_filter_active;
+	bool		result = true;
+	int			i;
+
+	if (columns)
+	{
+		if (!src->headline_transl || src->is_expanded_mode)
+		{
+			format_error("columns are not detected");
+			return false;
+		}
+
+		if (ncolumns < 1)
+		{
+			format_error("at least one column should be displayed");
+			return false;
+		}
+
+		for (i = 0; i < ncolumns; i++)
+		{
+			if (columns[i] < 0 || columns[i] >= src->columns)
+			{
+				format_error("column %d does not exist", columns[i] + 1);
+				return false;
+			}
+		}
+
+		/* all columns in original order */
+		if (ncolumns == src->columns)
+		{
+			for (i = 0; i < ncolumns; i++)
+				if (columns[i] != i)
+					break;
+
+			if (i == ncolumns)
+				columns = NULL;
+		}
+	}
+
+	if (!columns && !desc->projection)
+		return true;
+
+	/* the row filter holds order map of line buffers */
+	disable_row_filter(desc);
+
+	if (desc->projection)
+		remove_projection(desc);
+
+	if (columns)
+		result = create_projection(opts, desc, columns, ncolumns);
+
+	if (is_filtered)
+		enable_row_filter(desc);
+
+	return result;
+}
+
+/*
+ * Returns next column name or number from comma separated list.
+ * Double quoted names are case sensitive.
+ */
+static const char *
+get_column_token(const char *str, char *buffer, int size, bool *quoted)
+{
+	int			n = 0;
+
+	while (isspace((unsigned char) *str))
+		str++;
+
+	*quoted = *str == '"';
+
+	if (*quoted)
+	{
+		str++;
+
+		while (*str)
+		{
+			if (*str == '"')
+			{
+				/* doubled quote is a quote */
+				if (str[1] != '"')
+				{
+					str++;
+					break;
+				}
+
+				str++;
+			}
+
+			if (n < size - 1)
+				buffer[n++] = *str;
+
+			str++;
+		}
+	}
+	else
+	{
+		while (*str && *str != ',')
+		{
+			if (n < size - 1)
+				buffer[n++] = *str;
+
+			str++;
+		}
+
+		/* trim ending spaces */
+		while (n > 0 && isspace((unsigned char) buffer[n - 1]))
+			n--;
+	}
+
+	buffer[n] = '\0';
+
+	while (isspace((unsigned char) *str))
+		str++;
+
+	return str;
+}
+
+/*
+ * Returns zero based number of source column specified by number
+ * or by name, or -1.
+ */
+static int
+find_source_column(DataDesc *desc, const char *token, bool quoted)
+{
+	int			size = strlen(token);
+	int			i;
+
+	if (!quoted)
+	{
+		char	   *endptr;
+		long		colno = strtol(token, &endptr, 10);
+
+		if (*token && *endptr == '\0')
+			return colno >= 1 && colno <= desc->columns ? colno - 1 : -1;
+	}
+
+	if (!desc->namesline)
+		return -1;
+
+	for (i = 0; i < desc->columns; i++)
+	{
+		const char *name = desc->namesline + desc->cranges[i].name_offset;
+
+		if (desc->cranges[i].name_offset == -1 || desc->cranges[i].name_size != size)
+			continue;
+
+		if (quoted ?
+			memcmp(name, token, size) == 0 :
+			strncasecmp(name, token, size) == 0)
+			return i;
+	}
+
+	return -1;
+}
+
+/*
+ * Returns zero based number of displayed column specified by number
+ * (starts by 1) or by name, or -1. The name can be followed by comma,
+ * and next points after this comma or to end of string.
+ */
+int
+parse_column(DataDesc *desc, const char *str, const char **next)
+{
+	char		token[256];
+	bool		quoted;
+
+	str = get_column_token(str, token, sizeof(token), &quoted);
+
+	*next = *str == ',' ? str + 1 : str;
+
+	if ((*str && *str != ',') || (!*token && !quoted))
+		return -1;
+
+	return find_source_column(desc, token, quoted);
+}
+
+/*
+ * Parse comma separated list of column numbers (starts by 1) or
+ * column names. Returns array of source column numbers (starts by
+ * zero) or NULL, when the list is not valid.
+ */
+int *
+parse_projection(DataDesc *desc, const char *str, int *ncolumns)
+{
+	DataDesc   *src = desc->projection ? &desc->projection->source : desc;
+	bool	   *used;
+	int		   *columns;
+	int			n = 0;
+
+	if (!src->headline_transl || src->is_expanded_mode)
+	{
+		format_error("columns are not detected");
+		return NULL;
+	}
+
+	columns = smalloc2(src->columns * sizeof(int), "parse columns");
+	used = smalloc2(src->columns * sizeof(bool), "parse columns");
+
+	while (*str)
+	{
+		char		token[256];
+		bool		quoted;
+		int			colno;
+
+		str = get_column_token(str, token, sizeof(token), &quoted);
+
+		if (*str && *str != ',')
+		{
+			format_error("syntax error at \"%s\"", str);
+			goto error;
+		}
+
+		if (*str == ',')
+			str++;
+
+		if (!*token && !quoted)
+		{
+			format_error("missing column");
+			goto error;
+		}
+
+		colno = find_source_column(src, token, quoted);
+		if (colno == -1)
+		{
+			format_error("column \"%s\" does not exist", token);
+			goto error;
+		}
+
+		if (used[colno])
+		{
+			format_error("column \"%s\" is used more times", token);
+			goto error;
+		}
+
+		used[colno] = true;
+		columns[n++] = colno;
+	}
+
+	free(used);
+
+	*ncolumns = n;
+
+	return columns;
+
+error:
+
+	free(used);
+	free(columns);
+
+	return NULL;
+}
+
+/*
+ * Writes list of displayed columns (numbers of source columns) to
+ * buffer. The list is empty, when all columns are displayed.
+ */
+void
+format_projection(DataDesc *desc, char *buffer, int size)
+{
+	Projection *pr = desc->projection;
+	int			n = 0;
+	int			i;
+
+	buffer[0] = '\0';
+
+	if (!pr)
+		return;
+
+	for (i = 0; i < pr->ncolumns && n < size; i++)
+		n += snprintf(buffer + n, size - n, i > 0 ? ",%d" : "%d", pr->columns[i] + 1);
+
+	/* the list was truncated */
+	if (n >= size)
+		buffer[0] = '\0';
+}
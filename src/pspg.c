@@ -26,6 +26,7 @@
 #endif
 
 #include <errno.h>
+#include <limits.h>
 #include <math.h>
 #include <stdbool.h>
 #include <stdio.h>
@@ -120,9 +121,47 @@ static char		last_line[256];
 static char		last_path[1025];
 static char		last_rows_number[256];
 static char		last_table_name[256];
+static char		last_filter[256];
+
+/* displayed columns, they are used for fresh data too */
+static int	   *last_projection = NULL;
+static int		last_projection_ncolumns = 0;
+
+/*
+ * Displayed data and state of pager, that are saved when the table
+ * created by group by is displayed.
+ */
+typedef struct
+{
+	bool		active;
+	DataDesc	desc;
+	int			cursor_row;
+	int			cursor_col;
+	int			first_row;
+	int			first_data_row;
+	int			vertical_cursor_column;
+	int			last_ordered_column;
+	bool		last_order_desc;
+	bool		row_filter_active;
+	int		   *last_projection;
+	int			last_projection_ncolumns;
+	char		last_filter[256];
+} SavedView;
+
+static SavedView saved_view;
+
+/* approximate statistics of column displayed in box, and sampling is not finished */
+static ColumnSketch *column_sketch = NULL;
+static bool column_sketch_pending = false;
+
+/* number of rows sampled between checks of keyboard */
+#define SKETCH_STEP_ROWS		20000
 
 int		clipboard_application_id = 0;
 
+/* path of config file */
+static const char *PSPG_CONF = NULL;
+
 #ifdef HAVE_READLINE_HISTORY
 
 static char		last_history[256];
@@ -152,7 +191,7 @@ static bool active_ncurses = false;
 static bool xterm_mouse_mode_was_initialized = false;
 
 static int number_width(int num);
-static int get_event(MEVENT *mevent, bool *alt, bool *sigint, bool *timeout, bool *notify, bool *reopen, int timeoutval, int hold_stream);
+static int get_event(MEVENT *mevent, bool *alt, bool *sigint, bool *timeout, bool *notify, bool *reopen, bool *query_event, int timeoutval, int hold_stream);
 static void set_scrollbar(ScrDesc *scrdesc, DataDesc *desc, int first_row);
 static bool check_visible_vertical_cursor(DataDesc *desc, ScrDesc *scrdesc, Options *opts, int vertical_cursor_column);
 
@@ -301,29 +340,104 @@ print_duration(time_t start_sec, long start_ms, const char *label)
 #endif
 
 /*
- * Multiple used block - searching in string based on configuration
+ * Multiple used block - searching in string based on configuration.
+ * The line is start of searched string (it is used by regular expression
+ * assertions), str is position where the searching starts. The size of
+ * found pattern is returned by size. When searching is limited to some
+ * columns, then only the related part of line is searched. When lbm is
+ * not NULL (line is the line of lbm), then the start of these columns
+ * is found by cached positions of line without scanning of previous
+ * columns.
  */
 const char *
-pspg_search(Options *opts, ScrDesc *scrdesc, const char *str)
+pspg_search(Options *opts,
+			ScrDesc *scrdesc,
+			DataDesc *desc,
+			LineBufferMark *lbm,
+			const char *line,
+			int line_size,
+			const char *str,
+			int *size)
 {
 	bool	ignore_case = opts->ignore_case;
 	bool	ignore_lower_case = opts->ignore_lower_case;
 	bool	has_upperchr = scrdesc->has_upperchr;
 	const char *searchterm = scrdesc->searchterm;
 	const char *result;
+	const char *range = NULL;
+	const char *copy = NULL;
 
-	if (ignore_case || (ignore_lower_case && !has_upperchr))
+	if (line_size < 0)
+		line_size = strlen(line);
+
+	if (str > line + line_size)
+		return NULL;
+
+	if (scrdesc->search_xmax > 0)
 	{
-		result = opts->force8bit ? nstrstr(str, searchterm) : utf8_nstrstr(str, searchterm);
+		int		offset = 0;
+		int		charpos = 0;
+		int		range_size;
+
+		if (lbm && lbm->lb)
+			offset = lbm_get_xpos_offset(lbm, desc, scrdesc->search_xmin,
+										 opts->force8bit, &charpos);
+
+		range = get_line_range(line + offset, charpos,
+							   scrdesc->search_xmin, scrdesc->search_xmax,
+							   opts->force8bit, &range_size);
+
+		if (!range || str >= range + range_size)
+			return NULL;
+
+		if (str < range)
+			str = range;
+
+		line = range;
+		line_size = range_size;
 	}
-	else if (ignore_lower_case && has_upperchr)
+
+	if (scrdesc->searchregexp)
+		return regexp_search(scrdesc->searchregexp, line, line_size, str - line, size);
+
+	*size = scrdesc->searchterm_size;
+
+	if (ignore_case || (ignore_lower_case && !has_upperchr))
+		return opts->force8bit ?
+						nstrstr_with_sizes(str, line + line_size - str,
+										   searchterm, scrdesc->searchterm_size) :
+						utf8_nstrstr_with_sizes(str, line + line_size - str,
+												searchterm, scrdesc->searchterm_size);
+	else if (!(ignore_lower_case && has_upperchr))
+		return strstr_with_sizes(str, line + line_size - str,
+								 searchterm, scrdesc->searchterm_size);
+
+	/* mixed case searching requires zero terminated string */
+	if (range)
 	{
-		result = opts->force8bit ?
-						nstrstr_ignore_lower_case(str, searchterm) :
-						utf8_nstrstr_ignore_lower_case(str, searchterm);
+		static char *buffer = NULL;
+		static int	buffer_size = 0;
+
+		if (line_size + 1 > buffer_size)
+		{
+			buffer_size = line_size + 1;
+			buffer = srealloc(buffer, buffer_size);
+		}
+
+		memcpy(buffer, range, line_size);
+		buffer[line_size] = '\0';
+
+		copy = buffer;
+		str = copy + (str - range);
 	}
-	else
-		result = strstr(str, searchterm);
+
+	result = opts->force8bit ?
+					nstrstr_ignore_lower_case(str, searchterm) :
+					utf8_nstrstr_ignore_lower_case(str, searchterm);
+
+	/* returns pointer to line, not to the buffer */
+	if (copy && result)
+		result = range + (result - copy);
 
 	return result;
 }
@@ -337,18 +451,22 @@ trim_footer_rows(Options *opts, DataDesc *desc)
 	if (desc->headline_transl != NULL && desc->footer_row != -1)
 	{
 		LineBufferIter lbi;
+		LineBufferMark lbm;
 		char   *line;
 
 		desc->footer_char_size = 0;
 
 		init_lbi_ddesc(&lbi, desc, desc->footer_row);
 
-		while(lbi_get_line_next(&lbi, &line, NULL, NULL))
+		while(lbi_set_mark_next(&lbi, &lbm))
 		{
-			char   *ptr = line;
+			char   *ptr;
 			char   *last_nspc = NULL;
 			int		len;
 
+			(void) lbm_get_line(&lbm, &line, NULL, NULL, NULL);
+			ptr = line;
+
 			/* search last non space char */
 			while (*ptr)
 			{
@@ -363,6 +481,9 @@ trim_footer_rows(Options *opts, DataDesc *desc)
 			else
 				*line = '\0';
 
+			/* the row was shortened */
+			lbm_set_line_size(&lbm, last_nspc ? last_nspc + 1 - line : 0);
+
 			len = opts->force8bit ? strlen(line) : utf8len(line);
 			if (len > desc->footer_char_size)
 				desc->footer_char_size = len;
@@ -793,9 +914,34 @@ print_status(Options *opts, ScrDesc *scrdesc, DataDesc *desc,
 			wattroff(top_bar, top_bar_theme->title_attr);
 		}
 
-		if (opts->watch_time > 0 || current_state->errstr)
+		if (opts->watch_time > 0 || current_state->errstr || opts->querystream ||
+			pg_query_time() != -1)
 		{
-			if (last_watch_sec > 0)
+			long	query_time = pg_query_time();
+
+			if (query_time != -1)
+			{
+				int		x = 0;
+
+				if (desc->title[0] != '\0' || desc->filename[0] != '\0')
+					x = maxx / 4;
+
+				/* elapsed time of running query, it can be canceled by ctrl c */
+				mvwprintw(top_bar, 0, x, "query %ld.%ld sec", query_time / 1000, (query_time % 1000) / 100);
+			}
+			else if (opts->querystream)
+			{
+				int		pos, count;
+				int		x = 0;
+
+				if (desc->title[0] != '\0' || desc->filename[0] != '\0')
+					x = maxx / 4;
+
+				pg_history_info(&pos, &count);
+				if (count > 1)
+					mvwprintw(top_bar, 0, x, "result %d/%d", pos, count);
+			}
+			else if (last_watch_sec > 0)
 			{
 				long	ms, td;
 				time_t	sec;
@@ -1080,7 +1226,7 @@ show_info_wait(Options *opts, ScrDesc *scrdesc, const char *fmt, const char *par
 	if (applytimeout)
 		timeout = strlen(fmt) < 50 ? 2000 : 6000;
 
-	c = get_event(&event, &press_alt, &got_sigint, NULL, NULL, NULL, timeout, 0);
+	c = get_event(&event, &press_alt, &got_sigint, NULL, NULL, NULL, NULL, timeout, 0);
 
 	/*
 	 * Screen should be refreshed after show any info.
@@ -1380,6 +1526,266 @@ has_upperchr(Options *opts, char *str)
 	return false;
 }
 
+/*
+ * Set new searchterm. In regular expression search mode, the
+ * searchterm is compiled. Returns false, when the pattern is
+ * not valid regular expression.
+ */
+static bool
+set_searchterm(Options *opts, ScrDesc *scrdesc, const char *str)
+{
+	regexp_free(scrdesc->searchregexp);
+	scrdesc->searchregexp = NULL;
+
+	strncpy(scrdesc->searchterm, str, sizeof(scrdesc->searchterm) - 1);
+	scrdesc->has_upperchr = has_upperchr(opts, scrdesc->searchterm);
+	scrdesc->searchterm_size = strlen(scrdesc->searchterm);
+	scrdesc->searchterm_char_size = opts->force8bit ? strlen(scrdesc->searchterm) : utf8len(scrdesc->searchterm);
+
+	if (opts->regex_search && *scrdesc->searchterm)
+	{
+		bool	icase;
+
+		/* upper char in pattern forces case sensitive search */
+		icase = opts->ignore_case || (opts->ignore_lower_case && !scrdesc->has_upperchr);
+
+		scrdesc->searchregexp = regexp_compile(scrdesc->searchterm, icase, opts->force8bit);
+		if (!scrdesc->searchregexp)
+		{
+			scrdesc->searchterm[0] = '\0';
+			scrdesc->searchterm_size = 0;
+			scrdesc->searchterm_char_size = 0;
+
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/*
+ * Searching can be limited to selected columns or to the column
+ * with vertical cursor. The name of this column is displayed in
+ * the prompt.
+ */
+static void
+set_search_scope(Options *opts, ScrDesc *scrdesc, DataDesc *desc,
+				 int vertical_cursor_column, const char *prompt,
+				 char *buffer, int size)
+{
+	bool	border0 = desc->border_type == 0;
+	int		xmin, xmax;
+
+	scrdesc->search_xmin = 0;
+	scrdesc->search_xmax = 0;
+
+	if (!desc->headline_transl)
+	{
+		snprintf(buffer, size, "%s", prompt);
+		return;
+	}
+
+	if (scrdesc->selected_first_column != -1 && scrdesc->selected_columns > 0)
+	{
+		xmin = scrdesc->selected_first_column;
+		xmax = xmin + scrdesc->selected_columns - 1;
+
+		snprintf(buffer, size, "[selection]%s", prompt);
+	}
+	else if (opts->vertical_cursor &&
+			 vertical_cursor_column > 0 && vertical_cursor_column <= desc->columns)
+	{
+		CRange	   *cr = &desc->cranges[vertical_cursor_column - 1];
+
+		xmin = cr->xmin;
+		xmax = cr->xmax;
+
+		if (desc->namesline && cr->name_offset != -1)
+			snprintf(buffer, size, "[%.*s]%s",
+					 cr->name_size, desc->namesline + cr->name_offset, prompt);
+		else
+			snprintf(buffer, size, "[%d]%s", vertical_cursor_column, prompt);
+	}
+	else
+	{
+		snprintf(buffer, size, "%s", prompt);
+		return;
+	}
+
+	/* vertical lines on xmin and xmax positions are not searched */
+	scrdesc->search_xmin = border0 ? xmin : xmin + 1;
+	scrdesc->search_xmax = xmax;
+}
+
+/*
+ * Returns true, when name of column contains searched pattern
+ */
+static bool
+is_searched_column(Options *opts, ScrDesc *scrdesc, DataDesc *desc, Regexp *re, int colnum)
+{
+	const char *name = desc->namesline + desc->cranges[colnum - 1].name_offset;
+	int			name_size = desc->cranges[colnum - 1].name_size;
+	int			size;
+
+	if (re)
+		return regexp_search(re, name, name_size, 0, &size) != NULL;
+
+	if (opts->force8bit)
+		return nstrstr_with_sizes(name, name_size,
+								  scrdesc->searchcolterm,
+								  scrdesc->searchcolterm_size) != NULL;
+
+	return utf8_nstrstr_with_sizes(name, name_size,
+								   scrdesc->searchcolterm,
+								   scrdesc->searchcolterm_size) != NULL;
+}
+
+/*
+ * Incremental search - every row has a bit in candidates bitset of
+ * line buffer. When the pattern is only extended (refine is true), then
+ * only rows, that matched previous pattern, can match, and only these
+ * rows are tested again. Line buffers without candidates are skipped.
+ * Returns number of found data rows (rows hidden by filter and
+ * continuation lines of multiline rows are not counted).
+ */
+static int
+incremental_search(Options *opts, ScrDesc *scrdesc, DataDesc *desc, bool refine)
+{
+	LineBuffer *lb;
+	int			first_lineno = 0;
+	int			last_lineno = INT_MAX;
+	int			found = 0;
+
+	if (desc->headline_transl)
+	{
+		first_lineno = desc->first_data_row;
+		last_lineno = get_unfiltered_last_data_row(desc);
+
+		/* continuation lines should be known before counting */
+		multilines_detection(opts, desc);
+	}
+
+	for (lb = &desc->rows; lb; lb = lb->next)
+	{
+		bool		test_all = !refine || !lb->candidates;
+		int			i;
+
+		if (!lb->candidates)
+			lb->candidates = smalloc(LINEBUFFER_LINES / 8 + 1);
+		else if (!test_all && lb->ncandidates == 0)
+			continue;
+
+		lb->ncandidates = 0;
+
+		for (i = 0; i < lb->nrows; i++)
+		{
+			int			lineno = lb->first_row + i;
+			unsigned char bit = 1 << (i & 7);
+
+			if (!test_all && !(lb->candidates[i >> 3] & bit))
+				continue;
+
+			if (lineno >= first_lineno && lineno <= last_lineno && *scrdesc->searchterm)
+			{
+				LineBufferMark lbm;
+				int			line_size;
+				const char *line = lb_get_row(lb, i, &line_size);
+				int			size;
+
+				lbm.lb = lb;
+				lbm.lb_rowno = i;
+				lbm.lineno = lineno;
+
+				if (pspg_search(opts, scrdesc, desc, &lbm, line, line_size, line, &size))
+				{
+					lb->candidates[i >> 3] |= bit;
+					lb->ncandidates += 1;
+
+					if (!(desc->has_multilines && lb_is_continual_row(lb, i)) &&
+						!is_filtered_row(desc, lineno))
+						found += 1;
+
+					continue;
+				}
+			}
+
+			lb->candidates[i >> 3] &= ~bit;
+		}
+	}
+
+	return found;
+}
+
+/*
+ * Returns line number of first displayed row from lineno, that was
+ * found by incremental search, or -1.
+ */
+static int
+incremental_search_next_row(DataDesc *desc, int lineno)
+{
+	LineBufferIter lbi;
+	LineBufferMark lbm;
+
+	init_lbi_ddesc(&lbi, desc, lineno);
+
+	while (lbi_set_mark_next(&lbi, &lbm))
+	{
+		LineBuffer *lb = lbm.lb;
+
+		if (lb->candidates && lb->ncandidates > 0 &&
+			(lb->candidates[lbm.lb_rowno >> 3] & (1 << (lbm.lb_rowno & 7))))
+			return lbm.lineno;
+	}
+
+	return -1;
+}
+
+/*
+ * Show prompt and searched pattern of incremental search in bottom bar
+ */
+static void
+draw_incremental_search_prompt(ScrDesc *scrdesc,
+							   const char *prompt,
+							   const char *term,
+							   int found,
+							   bool is_valid)
+{
+	WINDOW	   *bottom_bar = w_bottom_bar(scrdesc);
+	Theme	   *t = &scrdesc->themes[WINDOW_BOTTOM_BAR];
+	char		info[50];
+	int			maxx, y, x;
+
+	if (!bottom_bar)
+		return;
+
+	if (!is_valid)
+		snprintf(info, sizeof(info), " invalid pattern ");
+	else if (*term)
+		snprintf(info, sizeof(info), " %d rows ", found);
+	else
+		info[0] = '\0';
+
+	maxx = getmaxx(bottom_bar);
+
+	wbkgd(bottom_bar, t->input_attr);
+	werase(bottom_bar);
+	mvwprintw(bottom_bar, 0, 0, "%s%s", prompt, term);
+	mvwchgat(bottom_bar, 0, 0, -1, t->input_attr, PAIR_NUMBER(t->input_attr), 0);
+	getyx(bottom_bar, y, x);
+
+	if (*info && x + (int) strlen(info) < maxx)
+	{
+		attr_t		att = is_valid && found > 0 ? t->bottom_light_attr : t->error_attr;
+
+		wattron(bottom_bar, att);
+		mvwprintw(bottom_bar, 0, maxx - strlen(info), "%s", info);
+		wattroff(bottom_bar, att);
+	}
+
+	wmove(bottom_bar, y, x);
+	wnoutrefresh(bottom_bar);
+}
+
 static void
 reset_searching_lineinfo(DataDesc *desc)
 {
@@ -1390,7 +1796,7 @@ reset_searching_lineinfo(DataDesc *desc)
 
 	while (_slbi)
 	{
-		_slbi = slbi_get_line_next(_slbi, NULL, &linfo);
+		_slbi = slbi_get_line_next(_slbi, NULL, NULL, &linfo);
 
 		if (linfo)
 		{
@@ -1465,6 +1871,7 @@ get_event(MEVENT *mevent,
 		  bool *timeout,
 		  bool *file_event,
 		  bool *reopen_file,
+		  bool *query_event,
 		  int timeoutval,
 		  int hold_stream)
 {
@@ -1554,6 +1961,9 @@ get_event(MEVENT *mevent,
 		if (reopen_file)
 			*reopen_file = false;
 
+		if (query_event)
+			*query_event = false;
+
 		memcpy(mevent,
 			   &mouse_events_buffer[buffered_mouse_events_read++],
 			   sizeof(MEVENT));
@@ -1569,8 +1979,26 @@ retry:
 	if (timeout)
 		*timeout = false;
 
+	if (query_event)
+	{
+		/* the result can be read from socket already */
+		if (pg_consume_input())
+		{
+			*query_event = true;
+			return 0;
+		}
+
+		*query_event = false;
+
+		/* the socket is polled only when some query is running */
+		current_state->fds[2].fd = pg_socket();
+	}
+	else
+		current_state->fds[2].fd = -1;
+
 	/* check file event when it is wanted, and when event is available */
-	if (file_event && current_state->fds[1].fd != -1)
+	if (file_event &&
+		(current_state->fds[1].fd != -1 || current_state->fds[2].fd != -1))
 	{
 		int		poll_num;
 
@@ -1579,7 +2007,7 @@ retry:
 		if (reopen_file)
 			*reopen_file = false;
 
-		poll_num = poll(current_state->fds, 2, timeoutval);
+		poll_num = poll(current_state->fds, 3, timeoutval);
 		if (poll_num == -1)
 		{
 			/* pool error is expected after sigint */
@@ -1595,8 +2023,19 @@ retry:
 		}
 		else if (poll_num > 0)
 		{
+			/* result of query is (maybe partially) available */
+			if (current_state->fds[2].fd != -1 && current_state->fds[2].revents)
+			{
+				/* wait on complete result */
+				if (!pg_consume_input())
+					goto retry;
+
+				*query_event = true;
+				return 0;
+			}
+
 			/* process inotify event, but only when we can process it */
-			if (current_state->fds[1].revents)
+			if (current_state->fds[1].fd != -1 && current_state->fds[1].revents)
 			{
 				short revents = current_state->fds[1].revents;
 				char		buff[64];
@@ -1756,6 +2195,9 @@ repeat:
 				if (reopen_file)
 					*reopen_file = false;
 
+				if (query_event)
+					*query_event = false;
+
 return_first_mouse_event:
 
 				if (buffered_mouse_events_count > 0)
@@ -1889,12 +2331,246 @@ exit_ncurses(void)
 static void
 DataDescFree(DataDesc *desc)
 {
+	free_projection(desc);
 	lb_free(desc);
+	free_column_values(desc);
+	free_row_filter(desc->row_filter);
+	cs_free(desc->colstore);
+	free(desc->source_types);
 	free(desc->order_map);
 	free(desc->headline_transl);
 	free(desc->cranges);
 }
 
+/*
+ * Moves data desc to other variable. The first line buffer is embedded
+ * in data desc, so references to this line buffer should be updated.
+ * Row filter should be disabled (unfiltered order map is not updated).
+ */
+static void
+DataDescMove(DataDesc *dest, DataDesc *src)
+{
+	int		i;
+
+	for (i = 0; src->order_map && i < src->order_map_items; i++)
+		if (src->order_map[i].lnb == &src->rows)
+			src->order_map[i].lnb = &dest->rows;
+
+	memcpy(dest, src, sizeof(DataDesc));
+	lb_move_rows(&dest->rows, &src->rows);
+	memset(src, 0, sizeof(DataDesc));
+
+	ddesc_reset_positions(dest);
+}
+
+/*
+ * Writes name of column with vertical cursor to buffer. The number of
+ * column is used, when the name cannot be used in list of columns.
+ * Empty string is used when vertical cursor is not visible.
+ */
+static void
+get_default_column(Options *opts, DataDesc *desc, int vertical_cursor_column, char *buffer, int size)
+{
+	CRange	   *cr;
+
+	buffer[0] = '\0';
+
+	if (!opts->vertical_cursor || vertical_cursor_column <= 0)
+		return;
+
+	cr = &desc->cranges[vertical_cursor_column - 1];
+
+	if (desc->namesline && cr->name_offset != -1 &&
+		!memchr(desc->namesline + cr->name_offset, ',', cr->name_size) &&
+		!memchr(desc->namesline + cr->name_offset, '"', cr->name_size))
+		snprintf(buffer, size, "%.*s",
+				 cr->name_size, desc->namesline + cr->name_offset);
+	else
+		snprintf(buffer, size, "%d", vertical_cursor_column);
+}
+
+static void
+close_column_sketch(void)
+{
+	free_column_sketch(column_sketch);
+	column_sketch = NULL;
+	column_sketch_pending = false;
+}
+
+/*
+ * Sampling of column starts again (after change of data or filter).
+ * The sampling is stopped, when the column is not available.
+ */
+static void
+restart_column_sketch(Options *opts, DataDesc *desc)
+{
+	int			colno;
+
+	if (!column_sketch)
+		return;
+
+	colno = get_sketch_column(column_sketch);
+	close_column_sketch();
+
+	if (colno < desc->columns && desc->headline_transl && !desc->is_expanded_mode)
+	{
+		column_sketch = create_column_sketch(opts, desc, colno);
+		column_sketch_pending = true;
+	}
+}
+
+/*
+ * Returns true, when some input from terminal is waiting (the input
+ * is not read).
+ */
+static bool
+is_key_pending(void)
+{
+	if (current_state->fds[0].fd == -1)
+		return false;
+
+	return poll(current_state->fds, 1, 0) > 0;
+}
+
+/*
+ * Samples rows of column until all rows are sampled or until some key
+ * is pressed, so the data can be browsed while the statistics are
+ * calculated. The box with statistics is updated after every step.
+ */
+static void
+sample_column(ScrDesc *scrdesc, DataDesc *desc)
+{
+	WINDOW	   *win = w_rows(scrdesc);
+	Theme	   *t = &scrdesc->themes[WINDOW_ROWS];
+
+	for (;;)
+	{
+		bool		finished = sketch_rows(column_sketch, desc, SKETCH_STEP_ROWS);
+
+		sketch_draw_overlay(column_sketch, desc, win, t);
+		wnoutrefresh(win);
+		doupdate();
+
+		if (finished)
+		{
+			column_sketch_pending = false;
+			break;
+		}
+
+		if (handle_sigint || is_key_pending())
+			break;
+	}
+}
+
+/*
+ * Displays table created by group by instead of current data. The state
+ * of pager is saved, and it is restored by leave_group_view.
+ */
+static void
+enter_group_view(DataDesc *desc, DataDesc *grouped,
+				 int *cursor_row, int *cursor_col, int *first_row,
+				 int *first_data_row, int *vertical_cursor_column,
+				 int *last_ordered_column, bool *last_order_desc)
+{
+	SavedView  *sv = &saved_view;
+
+	/* statistics are related to displayed data */
+	close_column_sketch();
+
+	sv->cursor_row = *cursor_row;
+	sv->cursor_col = *cursor_col;
+	sv->first_row = *first_row;
+	sv->first_data_row = *first_data_row;
+	sv->vertical_cursor_column = *vertical_cursor_column;
+	sv->last_ordered_column = *last_ordered_column;
+	sv->last_order_desc = *last_order_desc;
+	sv->last_projection = last_projection;
+	sv->last_projection_ncolumns = last_projection_ncolumns;
+	memcpy(sv->last_filter, last_filter, sizeof(last_filter));
+
+	/* filter is enabled again, when data are displayed again */
+	sv->row_filter_active = desc->row_filter_active;
+	disable_row_filter(desc);
+
+	DataDescMove(&sv->desc, desc);
+	DataDescMove(desc, grouped);
+
+	sv->active = true;
+
+	*cursor_row = 0;
+	*cursor_col = 0;
+	*first_row = 0;
+	*first_data_row = desc->first_data_row;
+	*vertical_cursor_column = 1;
+	*last_ordered_column = -1;
+	*last_order_desc = false;
+
+	last_projection = NULL;
+	last_projection_ncolumns = 0;
+	last_filter[0] = '\0';
+}
+
+/*
+ * Table created by group by is released, and saved data and state
+ * of pager are restored.
+ */
+static void
+leave_group_view(DataDesc *desc,
+				 int *cursor_row, int *cursor_col, int *first_row,
+				 int *first_data_row, int *vertical_cursor_column,
+				 int *last_ordered_column, bool *last_order_desc)
+{
+	SavedView  *sv = &saved_view;
+
+	close_column_sketch();
+
+	DataDescFree(desc);
+	DataDescMove(desc, &sv->desc);
+
+	if (sv->row_filter_active)
+		enable_row_filter(desc);
+
+	*cursor_row = sv->cursor_row;
+	*cursor_col = sv->cursor_col;
+	*first_row = sv->first_row;
+	*first_data_row = sv->first_data_row;
+	*vertical_cursor_column = sv->vertical_cursor_column;
+	*last_ordered_column = sv->last_ordered_column;
+	*last_order_desc = sv->last_order_desc;
+
+	free(last_projection);
+	last_projection = sv->last_projection;
+	last_projection_ncolumns = sv->last_projection_ncolumns;
+	memcpy(last_filter, sv->last_filter, sizeof(last_filter));
+
+	sv->active = false;
+}
+
+/*
+ * Reads queries from query stream. In pipeline mode the queries are
+ * only sent (the results are processed after query event), so all
+ * queries available in stream are sent without waiting on results.
+ * Returns true, when desc holds fresh data.
+ */
+static bool
+read_querystream(Options *opts, DataDesc *desc, StateData *state)
+{
+	for (;;)
+	{
+		if (!readfile(opts, desc, state))
+			return false;
+
+		if (read_and_format(opts, desc, state))
+			return true;
+
+		if (state->errstr)
+			return false;
+
+		DataDescFree(desc);
+		memset(desc, 0, sizeof(DataDesc));
+	}
+}
+
 /*
  * Copy persistent data (search related and info box related)
  * to new instance.
@@ -1905,6 +2581,9 @@ MergeScrDesc(ScrDesc *new, ScrDesc *old)
 	memcpy(new->searchterm, old->searchterm, 255);
 	new->searchterm_char_size = old->searchterm_char_size;
 	new->searchterm_size = old->searchterm_size;
+	new->searchregexp = old->searchregexp;
+	new->search_xmin = old->search_xmin;
+	new->search_xmax = old->search_xmax;
 
 	memcpy(new->searchcolterm, old->searchcolterm, 255);
 	new->searchcolterm_size = old->searchcolterm_size;
@@ -1938,6 +2617,84 @@ adjust_first_row(int first_row, DataDesc *desc, ScrDesc *scrdesc)
 	return first_row > max_first_row ? max_first_row : first_row;
 }
 
+/*
+ * Save detected clipboard application to config file, so next
+ * time the (slow) detection is not necessary.
+ */
+static void
+remember_clipboard_app(Options *opts, int id)
+{
+	clipboard_application_id = id;
+
+	if (opts->detected_clipboard_app != id)
+	{
+		opts->detected_clipboard_app = id;
+
+		if (!save_config_int_value(tilde(NULL, PSPG_CONF), "detected_clipboard_app", id))
+			log_row("cannot to save detected clipboard application (%s)", strerror(errno));
+	}
+}
+
+/*
+ * Waits on finish of clipboard application. The stdout and stderr
+ * of the application are read before, so the application cannot be
+ * blocked on full pipe. Returns the size of saved error message.
+ */
+static int
+wait_clipboard_app(pid_t pid, int fout, int ferr,
+				   char *err_buffer, int size,
+				   int *status)
+{
+	int			errsz = 0;
+
+	*status = 0;
+
+	for (;;)
+	{
+		struct pollfd fds[2];
+		char		buffer[1024];
+		ssize_t		n;
+		pid_t		res;
+
+		fds[0].fd = ferr;
+		fds[0].events = POLLIN;
+		fds[1].fd = fout;
+		fds[1].events = POLLIN;
+
+		(void) poll(fds, 2, 100);
+
+		/* first part of error message is saved, rest is ignored */
+		while ((n = read(ferr, buffer, sizeof(buffer))) > 0)
+		{
+			if (errsz < size)
+			{
+				int		len = n < size - errsz ? n : size - errsz;
+
+				memcpy(err_buffer + errsz, buffer, len);
+				errsz += len;
+			}
+		}
+
+		while (read(fout, buffer, sizeof(buffer)) > 0)
+			;
+
+		res = waitpid(pid, status, WNOHANG);
+		if (res == pid || (res == -1 && errno != EINTR))
+			break;
+	}
+
+	/* the message can be written just before exit */
+	if (errsz < size)
+	{
+		ssize_t		n = read(ferr, err_buffer + errsz, size - errsz);
+
+		if (n > 0)
+			errsz += n;
+	}
+
+	return errsz;
+}
+
 /*
  * When error is detected, then better to clean screen
  */
@@ -1948,6 +2705,8 @@ check_clipboard_app(Options *opts, bool *force_refresh)
 
 	if (opts->clipboard_app)
 		clipboard_application_id = opts->clipboard_app;
+	else if (!clipboard_application_id && opts->detected_clipboard_app)
+		clipboard_application_id = opts->detected_clipboard_app;
 
 	if (!clipboard_application_id)
 	{
@@ -1976,7 +2735,7 @@ check_clipboard_app(Options *opts, bool *force_refresh)
 			status = pclose(f);
 			if (status == 0 && isokstr)
 			{
-				clipboard_application_id = 1;
+				remember_clipboard_app(opts, 1);
 				return;
 			}
 		}
@@ -2001,7 +2760,7 @@ check_clipboard_app(Options *opts, bool *force_refresh)
 			status = pclose(f);
 			if (status == 0 && isokstr)
 			{
-				clipboard_application_id = 2;
+				remember_clipboard_app(opts, 2);
 				return;
 			}
 		}
@@ -2024,7 +2783,7 @@ check_clipboard_app(Options *opts, bool *force_refresh)
 			status = pclose(f);
 			if (status == 0 && isokstr)
 			{
-				clipboard_application_id = 3;
+				remember_clipboard_app(opts, 3);
 				return;
 			}
 		}
@@ -2072,7 +2831,9 @@ rwe_popen(char *command, int *fin, int *fout, int *ferr)
 				}
 				else if (pid == 0)
 				{
-					/* child */
+					/* child, own process group allows to kill all processes */
+					setpgid(0, 0);
+
 					close(in[1]);
 					close(out[0]);
 					close(err[0]);
@@ -2085,35 +2846,198 @@ rwe_popen(char *command, int *fin, int *fout, int *ferr)
 					close(out[1]);
 					close(err[1]);
 
-					execl("/bin/sh", "sh", "-c", command, NULL);
-					exit(127);
-				}
-				else
-					saved_errno = errno;
+					execl("/bin/sh", "sh", "-c", command, NULL);
+					exit(127);
+				}
+				else
+					saved_errno = errno;
+
+				close(err[0]);
+				close(err[1]);
+			}
+			else
+				saved_errno = errno;
+
+			close(out[0]);
+			close(out[1]);
+		}
+		else
+			saved_errno = errno;
+
+		close(in[0]);
+		close(out[1]);
+	}
+	else
+		saved_errno = errno;
+
+	errno = saved_errno;
+
+	return -1;
+}
+
+/* size of output buffer used by export to file */
+#define EXPORT_BUFFER_SIZE			(1024 * 1024)
+
+/*
+ * Parameters and result of export running in background thread
+ */
+typedef struct
+{
+	Options	   *opts;
+	ScrDesc	   *scrdesc;
+	DataDesc   *desc;
+	int			cursor_row;
+	int			cursor_column;
+	FILE	   *fp;
+	int			rows;
+	double		percent;
+	char	   *table_name;
+	PspgCommand	command;
+	ClipboardFormat format;
+	pid_t		helper_pid;			/* clipboard application or 0 */
+	ExportProgress progress;
+	bool		result;
+} ExportTask;
+
+static void *
+export_thread_main(void *arg)
+{
+	ExportTask *task = (ExportTask *) arg;
+	bool		result;
+
+	result = export_data(task->opts, task->scrdesc, task->desc,
+						 task->cursor_row, task->cursor_column,
+						 task->fp,
+						 task->rows, task->percent, task->table_name,
+						 task->command, task->format,
+						 &task->progress);
+
+	pthread_mutex_lock(&task->progress.mutex);
+	task->result = result;
+	task->progress.finished = true;
+	pthread_mutex_unlock(&task->progress.mutex);
+
+	return NULL;
+}
+
+static void
+show_export_progress(ScrDesc *scrdesc, const char *target, int processed_rows, int total_rows)
+{
+	WINDOW	*bottom_bar = w_bottom_bar(scrdesc);
+	Theme	*t = &scrdesc->themes[WINDOW_BOTTOM_BAR];
+	attr_t	att = t->bottom_light_attr;
+	char	bar[21];
+	int		percent;
+	int		i;
+
+	percent = total_rows > 0 ? (int) (processed_rows * 100.0 / total_rows) : 0;
+	percent = percent > 100 ? 100 : percent;
+
+	for (i = 0; i < 20; i++)
+		bar[i] = i < percent / 5 ? '#' : '.';
+	bar[20] = '\0';
+
+	wattron(bottom_bar, att);
+	mvwprintw(bottom_bar, 0, 0, " Saving to %s [%s] %3d%% (press Esc to cancel)", target, bar, percent);
+	wclrtoeol(bottom_bar);
+	mvwchgat(bottom_bar, 0, 0, -1, att, PAIR_NUMBER(att), 0);
+	wattroff(bottom_bar, att);
+	wnoutrefresh(bottom_bar);
+
+	doupdate();
+}
+
+/*
+ * Export data in background thread. UI thread shows progress and
+ * can cancel the export. UI thread cannot to touch data until export
+ * is finished (block cache of line buffers is not thread safe).
+ * When the target is pipe to clipboard application, then the writing
+ * is blocked when the application doesn't read data, so the application
+ * is killed on cancel.
+ */
+static bool
+export_data_bg(ExportTask *task, const char *target, bool *canceled)
+{
+	pthread_t	thread;
+	int			stdscr_delay = wgetdelay(stdscr);
+	int			loops = 0;
+
+	pthread_mutex_init(&task->progress.mutex, NULL);
+	task->progress.processed_rows = 0;
+	task->progress.total_rows = task->desc->total_rows;
+	task->progress.cancel_requested = false;
+	task->progress.canceled = false;
+	task->progress.finished = false;
+
+	if (pthread_create(&thread, NULL, export_thread_main, task) != 0)
+	{
+		/* fallback to synchronous export */
+		log_row("cannot to start export thread (%s)", strerror(errno));
+
+		pthread_mutex_destroy(&task->progress.mutex);
+		*canceled = false;
+
+		return export_data(task->opts, task->scrdesc, task->desc,
+						   task->cursor_row, task->cursor_column,
+						   task->fp,
+						   task->rows, task->percent, task->table_name,
+						   task->command, task->format,
+						   NULL);
+	}
+
+	while (true)
+	{
+		bool	finished;
+		int		processed_rows;
+		int		c;
+
+		pthread_mutex_lock(&task->progress.mutex);
+		finished = task->progress.finished;
+		processed_rows = task->progress.processed_rows;
+		pthread_mutex_unlock(&task->progress.mutex);
+
+		if (finished)
+			break;
+
+		/* don't show progress for fast export */
+		if (loops++ < 5)
+		{
+			napms(20);
+			continue;
+		}
+
+		show_export_progress(task->scrdesc, target, processed_rows, task->progress.total_rows);
+
+		/* get_event has too rough timeout, so read key directly */
+		timeout(100);
+		c = getch();
+		timeout(stdscr_delay);
+
+		if (c == 27 || c == 'q' || handle_sigint)
+		{
+			handle_sigint = false;
 
-				close(err[0]);
-				close(err[1]);
-			}
-			else
-				saved_errno = errno;
+			pthread_mutex_lock(&task->progress.mutex);
+			task->progress.cancel_requested = true;
+			pthread_mutex_unlock(&task->progress.mutex);
 
-			close(out[0]);
-			close(out[1]);
+			/* export thread can wait on write to full pipe */
+			if (task->helper_pid > 0)
+				kill(-task->helper_pid, SIGTERM);
 		}
-		else
-			saved_errno = errno;
-
-		close(in[0]);
-		close(out[1]);
 	}
-	else
-		saved_errno = errno;
 
-	errno = saved_errno;
+	pthread_join(thread, NULL);
+	pthread_mutex_destroy(&task->progress.mutex);
 
-	return -1;
-}
+	if (loops > 5)
+		task->scrdesc->refresh_scr = true;
+
+	/* the write to killed application fails before cancel check */
+	*canceled = task->progress.canceled || task->progress.cancel_requested;
 
+	return task->result;
+}
 
 static void
 export_to_file(PspgCommand command,
@@ -2132,11 +3056,12 @@ export_to_file(PspgCommand command,
 	int		rows = 0;
 	double  percent = 0.0;
 	FILE   *fp = NULL;
+	char   *iobuf = NULL;
 	char   *path = NULL;
 	bool	isok = false;
 	bool	copy_to_file = false;
 	int		fin = -1, fout = -1, ferr = -1;
-	pid_t	pid;
+	pid_t	pid = 0;
 
 	*force_refresh = false;
 
@@ -2187,7 +3112,7 @@ export_to_file(PspgCommand command,
 		copy_to_file = true;
 	}
 
-	if (INSERT_FORMAT_TYPE(format))
+	if (SQL_FORMAT_TYPE(format))
 	{
 		get_string(opts, scrdesc, "target table name: ", table_name, sizeof(table_name) - 1, last_table_name);
 		if (table_name[0] == '\0')
@@ -2261,7 +3186,7 @@ export_to_file(PspgCommand command,
 		}
 
 		if (format == CLIPBOARD_FORMAT_TEXT ||
-			INSERT_FORMAT_TYPE(format))
+			SQL_FORMAT_TYPE(format))
 		{
 			if (opts->force8bit)
 				fmt = "text/plain";
@@ -2279,6 +3204,10 @@ export_to_file(PspgCommand command,
 		{
 			fmt = "application/x-libreoffice-tsvc";
 		}
+		else if (format == CLIPBOARD_FORMAT_ARROW)
+		{
+			fmt = "application/vnd.apache.arrow.file";
+		}
 		else /* fallback */
 		{
 			if (opts->force8bit)
@@ -2311,6 +3240,7 @@ export_to_file(PspgCommand command,
 			return;
 		}
 
+		fcntl(fout, F_SETFL, O_NONBLOCK);
 		fcntl(ferr, F_SETFL, O_NONBLOCK);
 
 		fp = fdopen(fin, "w");
@@ -2318,48 +3248,103 @@ export_to_file(PspgCommand command,
 
 	if (fp)
 	{
-		isok = export_data(opts, scrdesc, desc,
-						   cursor_row, cursor_column,
-						   fp,
-						   rows, percent, table_name,
-						   command, format);
-
-		if (copy_to_file)
-			fclose(fp);
-		else
+		ExportTask	task;
+		bool		canceled;
+		char		err_buffer[1024];
+		int			errsz = 0;
+		const char *target = copy_to_file ? path : "clipboard";
+		void		(*prev_sigpipe_handler) (int) = SIG_DFL;
+
+		iobuf = smalloc(EXPORT_BUFFER_SIZE);
+		setvbuf(fp, iobuf, _IOFBF, EXPORT_BUFFER_SIZE);
+
+		task.opts = opts;
+		task.scrdesc = scrdesc;
+		task.desc = desc;
+		task.cursor_row = cursor_row;
+		task.cursor_column = cursor_column;
+		task.fp = fp;
+		task.rows = rows;
+		task.percent = percent;
+		task.table_name = table_name;
+		task.command = command;
+		task.format = format;
+		task.helper_pid = copy_to_file ? 0 : pid;
+
+		/* the write to finished clipboard application should not to kill pspg */
+		if (!copy_to_file)
+			prev_sigpipe_handler = signal(SIGPIPE, SIG_IGN);
+
+		/*
+		 * The data are written from background thread. When the pipe
+		 * to clipboard application is full, then this thread waits, but
+		 * the UI is still responsive.
+		 */
+		isok = export_data_bg(&task, target, &canceled);
+
+		if (fclose(fp) != 0 && isok && !canceled)
 		{
-			char	err_buffer[2048];
-			int		errsz;
-			int		status;
+			format_error("%s", strerror(errno));
+			isok = false;
+		}
 
-			memset(buffer, 0, sizeof(err_buffer));
+		free(iobuf);
 
-			fclose(fp);
-			fp = NULL;
+		if (!copy_to_file)
+		{
+			int		status;
 
-			waitpid(pid, &status, 0);
-			errsz = read(ferr, err_buffer, 1000);
+			errsz = wait_clipboard_app(pid, fout, ferr,
+									   err_buffer, sizeof(err_buffer) - 1,
+									   &status);
 
-			close(fin);
 			close(fout);
 			close(ferr);
 
-			if (errsz != -1)
-			{
-				format_error("%s", err_buffer);
-				log_row("write error (%s)", current_state->errstr);
+			signal(SIGPIPE, prev_sigpipe_handler);
 
-				*next_event_keycode = show_info_wait(opts,
-													 scrdesc,
-													 " Cannot write to clipboard (%s) (press any key)",
-													(char *) current_state->errstr, true, true, false, true);
+			/*
+			 * Detected application can be broken or not available now.
+			 * Forget it, and detect it again next time.
+			 */
+			if (!canceled &&
+				!(WIFEXITED(status) && WEXITSTATUS(status) == 0) &&
+				!opts->clipboard_app)
+				remember_clipboard_app(opts, 0);
+		}
 
-				/* err string is saved already, because refresh_first is used */
-				current_state->errstr = NULL;
-				*force_refresh = true;
+		if (canceled)
+		{
+			/* don't leave incomplete file */
+			if (copy_to_file)
+				unlink(path);
 
-				return;
-			}
+			*next_event_keycode = show_info_wait(opts,
+												 scrdesc,
+												 " Saving to %s was canceled",
+												 (char *) target, true, false, true, false);
+			*force_refresh = true;
+
+			return;
+		}
+
+		if (errsz > 0)
+		{
+			err_buffer[errsz] = '\0';
+
+			format_error("%s", err_buffer);
+			log_row("write error (%s)", current_state->errstr);
+
+			*next_event_keycode = show_info_wait(opts,
+												 scrdesc,
+												 " Cannot write to clipboard (%s) (press any key)",
+												(char *) current_state->errstr, true, true, false, true);
+
+			/* err string is saved already, because refresh_first is used */
+			current_state->errstr = NULL;
+			*force_refresh = true;
+
+			return;
 		}
 	}
 
@@ -2469,6 +3454,12 @@ throw_searching(ScrDesc *scrdesc)
 
 	scrdesc->searchterm_size = 0;
 	scrdesc->searchterm_char_size = 0;
+
+	regexp_free(scrdesc->searchregexp);
+	scrdesc->searchregexp = NULL;
+
+	scrdesc->search_xmin = 0;
+	scrdesc->search_xmax = 0;
 }
 
 static bool
@@ -2594,6 +3585,14 @@ main(int argc, char *argv[])
 	int		fresh_found_cursor_col = -1;
 	bool	reinit = false;
 
+	bool	incsearch_active = false;			/* pattern is edited in incremental search */
+	bool	incsearch_valid = true;				/* false, when pattern is not valid regexp */
+	char	incsearch_prompt[100];
+	char	incsearch_term[256];
+	int		incsearch_found = 0;				/* number of found rows */
+	int		incsearch_cursor_row = 0;			/* cursor_row before incremental search */
+	int		incsearch_first_row = 0;			/* first_row before incremental search */
+
 	bool	ignore_mouse_release = false;		/* after leave menu by press ignore release too */
 	bool	no_doupdate = false;				/* when we sure stdstr refresh is useless */
 	bool	raw_output_quit = false;
@@ -2651,8 +3650,6 @@ main(int argc, char *argv[])
 	int		mouse_row = -1;
 	int		mouse_col = -1;
 
-	const char *PSPG_CONF;
-
 #ifdef HAVE_LIBREADLINE
 
 	const char *PSPG_HISTORY;
@@ -2683,6 +3680,9 @@ main(int argc, char *argv[])
 	opts.clipboard_app = 0;
 	opts.no_sleep = false;
 	opts.menu_always = false;
+	opts.compress_threshold = 64;
+	opts.insert_batch_size = 1000;
+	opts.querystream_history = 10;
 
 	setup_sigsegv_handler();
 
@@ -2763,6 +3763,9 @@ main(int argc, char *argv[])
 	if (!args_are_consistent(&opts, &state))
 		leave(state.errstr ? state.errstr : "options are not valid");
 
+	lb_compress_threshold = (size_t) opts.compress_threshold * 1024 * 1024;
+	lb_memory_limit = (size_t) opts.memory_limit * 1024 * 1024;
+
 	/* open log file when user want it */
 	if (opts.log_pathname)
 	{
@@ -2840,12 +3843,7 @@ main(int argc, char *argv[])
 	if (opts.csv_format || opts.tsv_format || opts.query)
 		result = read_and_format(&opts, &desc, &state);
 	else if (opts.querystream)
-	{
-		result = readfile(&opts, &desc, &state);
-
-		if (result)
-			result = read_and_format(&opts, &desc, &state);
-	}
+		result = read_querystream(&opts, &desc, &state);
 	else
 		result = readfile(&opts, &desc, &state);
 
@@ -3054,8 +4052,10 @@ main(int argc, char *argv[])
 
 	state.fds[0].fd = -1;
 	state.fds[1].fd = -1;
+	state.fds[2].fd = -1;
 	state.fds[0].events = POLLIN;
 	state.fds[1].events = POLLIN;
+	state.fds[2].events = POLLIN;
 
 	if (opts.watch_file && !state.is_fifo && !state.is_pipe)
 	{
@@ -3076,6 +4076,9 @@ main(int argc, char *argv[])
 			state.fds[1].fd = fileno(state.fp);
 		}
 	}
+	else if (opts.query)
+		/* the query is executed asynchronously, terminal and socket are polled */
+		state.fds[0].fd = noatty ? STDERR_FILENO : STDIN_FILENO;
 
 	log_row("ncurses started");
 
@@ -3278,7 +4281,7 @@ leaveok(stdscr, TRUE);
 		{
 			if (strchr(desc.headline_transl,'I') == NULL)
 			{
-				char *str = desc.rows.rows[desc.title_rows + 1];
+				char *str = lb_get_row(&desc.rows, desc.title_rows + 1, NULL);
 				int pos = 0;
 
 				/* fallback point, didn't find separator already */
@@ -3383,6 +4386,7 @@ leaveok(stdscr, TRUE);
 	last_line[0] = '\0';
 	last_path[0] = '\0';
 	last_rows_number[0] = '\0';
+	last_filter[0] = '\0';
 
 #if RL_READLINE_VERSION > 0x0603
 
@@ -3427,6 +4431,7 @@ leaveok(stdscr, TRUE);
 		bool	after_freeze_signal = false;
 		bool	recheck_vertical_cursor_visibility = false;
 		bool	force_refresh = false;
+		long long start_draw_us;
 
 #ifdef DEBUG_PIPE
 
@@ -3612,6 +4617,8 @@ leaveok(stdscr, TRUE);
 
 #endif
 
+				start_draw_us = stats_time_us();
+
 				window_fill(WINDOW_LUC,
 							desc.title_rows + desc.fixed_rows - scrdesc.fix_rows_rows,
 							0,
@@ -3669,6 +4676,17 @@ leaveok(stdscr, TRUE);
 							0, 0, cursor_row, -1, -1, -1, -1,
 							&desc, &scrdesc, &opts);
 
+				stats_set_data(&desc);
+				stats_frame_done(stats_time_us() - start_draw_us);
+
+				if (column_sketch)
+					sketch_draw_overlay(column_sketch, &desc, w_rows(&scrdesc), &scrdesc.themes[WINDOW_ROWS]);
+
+				if (opts.show_stats)
+					stats_draw_overlay(w_rows(&scrdesc), &scrdesc.themes[WINDOW_ROWS]);
+
+				stats_write_file(opts.stats_pathname, false);
+
 				for (i = 0; i < PSPG_WINDOW_COUNT; i++)
 				{
 					if (i != WINDOW_TOP_BAR &&
@@ -3702,6 +4720,11 @@ leaveok(stdscr, TRUE);
 
 #endif
 
+			if (incsearch_active)
+				draw_incremental_search_prompt(&scrdesc,
+											   incsearch_prompt, incsearch_term,
+											   incsearch_found, incsearch_valid);
+
 			if (no_doupdate)
 				no_doupdate = false;
 			else if (next_command == 0 || scrdesc.fmt != NULL)
@@ -3816,6 +4839,11 @@ leaveok(stdscr, TRUE);
 			{
 				bool		handle_file_event;
 				bool		reopen_file;
+				bool		handle_query_event;
+
+				/* column is sampled until some key is pressed */
+				if (column_sketch_pending)
+					sample_column(&scrdesc, &desc);
 
 				event_keycode = get_event(&event,
 										  &press_alt,
@@ -3823,7 +4851,8 @@ leaveok(stdscr, TRUE);
 										  &handle_timeout,
 										  &handle_file_event,
 										  &reopen_file,
-										  opts.watch_time > 0 ? 1000 : -1,
+										  &handle_query_event,
+										  opts.watch_time > 0 || pg_query_time() != -1 ? 1000 : -1,
 										  state.hold_stream);
 
 				/*
@@ -3856,6 +4885,8 @@ leaveok(stdscr, TRUE);
 
 				if (force_refresh ||
 					opts.watch_time ||
+					handle_query_event ||
+					pg_query_time() != -1 ||
 					((opts.watch_file || state.stream_mode) && handle_file_event))
 				{
 					long	ms;
@@ -3866,11 +4897,13 @@ leaveok(stdscr, TRUE);
 					ct = sec * 1000 + ms;
 
 					if (force_refresh ||
-						(ct > next_watch && !paused) ||
+						(ct > next_watch && !paused && !saved_view.active) ||
+						handle_query_event ||
 						((opts.watch_file || state.stream_mode) && handle_file_event))
 					{
 						DataDesc	desc2;
 						bool		fresh_data = false;
+						bool		appended_rows = false;
 
 						memset(&desc2, 0, sizeof(desc2));
 
@@ -3896,7 +4929,20 @@ leaveok(stdscr, TRUE);
 								fresh_data = open_data_file(&opts, &state);
 						}
 						else if (opts.query)
-							fresh_data = true;
+						{
+							/*
+							 * The query is sent, and the result is processed
+							 * later (after query event), so the slow query
+							 * doesn't block the browsing of current data.
+							 * When the query cannot be sent, then the error
+							 * is reported by read_and_format.
+							 */
+							if (handle_query_event)
+								fresh_data = true;
+							else
+								fresh_data = pg_query_time() == -1 &&
+											 !pg_send_query(&opts, opts.query, &state.errstr);
+						}
 						else
 							/*
 							 * When we have a stream mode without watch file,
@@ -3907,17 +4953,53 @@ leaveok(stdscr, TRUE);
 						/* when we wanted fresh data */
 						if (fresh_data)
 						{
+							/* fresh data are displayed instead grouped rows */
+							if (saved_view.active)
+								leave_group_view(&desc,
+												 &cursor_row, &cursor_col, &first_row,
+												 &first_data_row, &vertical_cursor_column,
+												 &last_ordered_column, &last_order_desc);
+
 							if (opts.csv_format || opts.tsv_format || opts.query)
 								/* returns false when format is broken */
 								fresh_data = read_and_format(&opts, &desc2, &state);
 							else if (opts.querystream)
 							{
-								fresh_data = readfile(&opts, &desc2, &state);
-								if (fresh_data)
-									fresh_data = read_and_format(&opts, &desc2, &state);
+								/* result of sent query, or result from history */
+								if (handle_query_event)
+								{
+									fresh_data = pg_fetch_result(&opts, &state.errstr);
+									if (fresh_data)
+										fresh_data = read_and_format(&opts, &desc2, &state);
+								}
+								else
+									fresh_data = read_querystream(&opts, &desc2, &state);
 							}
 							else
+							{
+								/*
+								 * Rows of incomplete table from stream are moved
+								 * to desc2, and new rows are appended. Derived data
+								 * (layout, order map, ...) stay in desc, and they
+								 * are released with desc.
+								 */
+								if (state.stream_continue)
+								{
+									/* new rows are appended to source rows */
+									(void) set_projection(&opts, &desc, NULL, 0);
+
+									memcpy(&desc2, &desc, sizeof(desc));
+
+									if (desc2.rows.next)
+										desc2.rows.next->prev = &desc2.rows;
+
+									memset(&desc.rows, 0, sizeof(LineBuffer));
+
+									appended_rows = true;
+								}
+
 								fresh_data = readfile(&opts, &desc2, &state);
+							}
 
 							if (!state.stream_mode && state.fp)
 							{
@@ -3931,10 +5013,23 @@ leaveok(stdscr, TRUE);
 						{
 							int		max_cursor_row;
 							ScrDesc		aux;
+							bool	is_filtered = desc.row_filter_active;
+							int		evicted_rows = desc2.evicted_rows - desc.evicted_rows;
 
 							DataDescFree(&desc);
 							memcpy(&desc, &desc2, sizeof(desc));
 
+							/* first line buffer is embedded in desc */
+							if (desc.rows.next)
+								desc.rows.next->prev = &desc.rows;
+
+							/* cursor stays on same row, when older rows was removed */
+							if (evicted_rows > 0)
+							{
+								cursor_row = cursor_row > evicted_rows ? cursor_row - evicted_rows : 0;
+								first_row = first_row > evicted_rows ? first_row - evicted_rows : 0;
+							}
+
 							if (desc.headline)
 								(void) translate_headline(&opts, &desc);
 
@@ -3955,6 +5050,25 @@ leaveok(stdscr, TRUE);
 
 							first_data_row = desc.first_data_row;
 
+							/* fresh data are displayed with same columns, when it is possible */
+							if (last_projection)
+							{
+								int		i;
+
+								for (i = 0; i < last_projection_ncolumns; i++)
+									if (last_projection[i] >= desc.columns)
+										break;
+
+								if (i < last_projection_ncolumns ||
+									!set_projection(&opts, &desc, last_projection, last_projection_ncolumns))
+								{
+									free(last_projection);
+									last_projection = NULL;
+									last_projection_ncolumns = 0;
+									current_state->errstr = NULL;
+								}
+							}
+
 							detected_format = desc.headline_transl;
 							if (detected_format && desc.oid_name_table)
 								default_freezed_cols = 2;
@@ -3985,14 +5099,35 @@ leaveok(stdscr, TRUE);
 
 							if (last_ordered_column != -1)
 								update_order_map(&opts, &scrdesc, &desc, last_ordered_column, last_order_desc);
+
+							/* fresh data should be filtered again */
+							if (is_filtered)
+							{
+								RowFilter  *rf = compile_row_filter(&opts, &desc, last_filter);
+
+								if (rf)
+									(void) set_row_filter(&opts, &desc, rf);
+								else
+									current_state->errstr = NULL;
+							}
+
+							/* appended rows are sampled too, other data are sampled again */
+							if (appended_rows)
+								column_sketch_pending = column_sketch != NULL;
+							else
+								restart_column_sketch(&opts, &desc);
 						}
 						else
 							DataDescFree(&desc2);
 
-						if ((ct - next_watch) < (opts.watch_time * 1000))
-							next_watch = next_watch + 1000 * opts.watch_time;
-						else
-							next_watch = ct + 100 * opts.watch_time;
+						/* the arrival of result is not the watch event */
+						if (!handle_query_event)
+						{
+							if ((ct - next_watch) < (opts.watch_time * 1000))
+								next_watch = next_watch + 1000 * opts.watch_time;
+							else
+								next_watch = ct + 100 * opts.watch_time;
+						}
 						/*
 						 * Force refresh, only when we got fresh data or when
 						 * this event was forced by timer.
@@ -4045,8 +5180,26 @@ leaveok(stdscr, TRUE);
 		}
 
 		/* Exit immediately on F10 or input error */
-		if (got_sigint)
+		if (got_sigint && pg_query_time() != -1)
+		{
+			/* cancel running query, the error is displayed like result */
+			pg_cancel_query();
+		}
+		else if (got_sigint)
 		{
+			if (incsearch_active)
+			{
+				incsearch_active = false;
+				curs_set(0);
+
+				cursor_row = incsearch_cursor_row;
+				first_row = incsearch_first_row;
+
+				scrdesc.found = false;
+				fresh_found = false;
+				refresh_scr = true;
+			}
+
 			if (!opts.no_sigint_search_reset &&
 				  (*scrdesc.searchterm || *scrdesc.searchcolterm ||
 				   scrdesc.selected_first_row != -1 ||
@@ -4073,6 +5226,161 @@ leaveok(stdscr, TRUE);
 			break;
 		}
 
+		/* in incremental search mode the keys modify searched pattern */
+		if (incsearch_active && !redirect_mode && event_keycode != 0 &&
+			event_keycode != KEY_RESIZE && event_keycode != KEY_MOUSE)
+		{
+			int		len = strlen(incsearch_term);
+			bool	refine = false;
+
+			if (event_keycode == 27 && press_alt)
+			{
+				/* escape - cancel searching, and returns cursor back */
+				incsearch_active = false;
+				curs_set(0);
+
+				cursor_row = incsearch_cursor_row;
+				first_row = incsearch_first_row;
+
+				(void) set_searchterm(&opts, &scrdesc, "");
+				reset_searching_lineinfo(&desc);
+
+				scrdesc.found = false;
+				fresh_found = false;
+
+				print_status(&opts, &scrdesc, &desc, cursor_row, cursor_col, first_row, fix_rows_offset, vertical_cursor_column);
+				set_scrollbar(&scrdesc, &desc, first_row);
+
+				refresh_scr = true;
+				continue;
+			}
+			else if (event_keycode == KEY_BACKSPACE || event_keycode == 127 || event_keycode == 8)
+			{
+				if (len > 0)
+				{
+					len -= 1;
+
+					/* remove complete multibyte char */
+					if (!opts.force8bit)
+						while (len > 0 && (incsearch_term[len] & 0xC0) == 0x80)
+							len -= 1;
+
+					incsearch_term[len] = '\0';
+				}
+			}
+			else if (!press_alt && event_keycode >= 32 &&
+					 !(event_keycode >= KEY_MIN && event_keycode <= KEY_MAX))
+			{
+				unsigned char buffer[10];
+				int		size;
+
+				if (opts.force8bit)
+				{
+					buffer[0] = (unsigned char) event_keycode;
+					size = 1;
+				}
+				else
+					(void) unicode_to_utf8(event_keycode, buffer, &size);
+
+				if (len + size < (int) sizeof(incsearch_term))
+				{
+					memcpy(incsearch_term + len, buffer, size);
+					incsearch_term[len + size] = '\0';
+
+					/* only rows found by previous (shorter) pattern can be found */
+					refine = len > 0 && incsearch_valid && !opts.regex_search;
+				}
+			}
+			else
+			{
+				/* enter or any other key finish the editing of pattern */
+				incsearch_active = false;
+				curs_set(0);
+
+				if (*incsearch_term)
+					memcpy(last_row_search, incsearch_term, sizeof(last_row_search));
+
+				refresh_scr = true;
+
+				if (event_keycode == 10 || event_keycode == 13 || event_keycode == KEY_ENTER)
+					continue;
+			}
+
+			if (incsearch_active)
+			{
+				int		lineno;
+
+				incsearch_valid = set_searchterm(&opts, &scrdesc, incsearch_term);
+				if (!incsearch_valid)
+					current_state->errstr = NULL;
+
+				reset_searching_lineinfo(&desc);
+
+				incsearch_found = incremental_search(&opts, &scrdesc, &desc, refine);
+
+				lineno = incremental_search_next_row(&desc, incsearch_cursor_row + CURSOR_ROW_OFFSET);
+
+				/* try to search from start */
+				if (lineno == -1)
+					lineno = incremental_search_next_row(&desc, desc.first_data_row);
+
+				scrdesc.found = false;
+
+				if (lineno != -1)
+				{
+					LineBufferIter lbi;
+					LineBufferMark lbm;
+					char	   *line;
+					int			line_size;
+					const char *pttrn = NULL;
+					int		size;
+
+					init_lbi_ddesc(&lbi, &desc, lineno);
+
+					if (lbi_set_mark_next(&lbi, &lbm) &&
+						lbm_get_line(&lbm, &line, &line_size, NULL, NULL))
+						pttrn = pspg_search(&opts, &scrdesc, &desc, &lbm, line, line_size, line, &size);
+
+					if (pttrn)
+					{
+						scrdesc.found_start_bytes = pttrn - line;
+						scrdesc.found_start_x =
+							opts.force8bit ? (size_t) (pttrn - line) :
+											 utf8len_start_stop(line, pttrn);
+						scrdesc.found_size = size;
+						scrdesc.found_char_size =
+							opts.force8bit ? (size_t) size :
+											 utf8len_start_stop(pttrn, pttrn + size);
+						scrdesc.found_row = lineno;
+						scrdesc.found = true;
+
+						fresh_found = true;
+						fresh_found_cursor_col = -1;
+					}
+
+					cursor_row = lineno - CURSOR_ROW_OFFSET;
+
+					if (cursor_row - first_row + 1 > VISIBLE_DATA_ROWS)
+						first_row = cursor_row - VISIBLE_DATA_ROWS + 1;
+					else if (cursor_row < first_row)
+						first_row = cursor_row;
+				}
+				else
+				{
+					/* nothing found, returns cursor back */
+					cursor_row = incsearch_cursor_row;
+					first_row = incsearch_first_row;
+				}
+
+				first_row = adjust_first_row(first_row, &desc, &scrdesc);
+
+				print_status(&opts, &scrdesc, &desc, cursor_row, cursor_col, first_row, fix_rows_offset, vertical_cursor_column);
+				set_scrollbar(&scrdesc, &desc, first_row);
+
+				continue;
+			}
+		}
+
 #ifndef COMPILE_MENU
 
 		if (!redirect_mode)
@@ -4115,6 +5423,9 @@ leaveok(stdscr, TRUE);
 						next_command != cmd_UseClipboard_text &&
 						next_command != cmd_UseClipboard_INSERT &&
 						next_command != cmd_UseClipboard_INSERT_with_comments &&
+						next_command != cmd_UseClipboard_INSERT_batch &&
+						next_command != cmd_UseClipboard_COPY &&
+						next_command != cmd_UseClipboard_ARROW &&
 						next_command != cmd_SetCopyFile &&
 						next_command != cmd_SetCopyClipboard &&
 						next_command != cmd_TogleEmptyStringIsNULL)
@@ -4209,6 +5520,21 @@ hide_menu:
 				throw_selection(&scrdesc, &mark_mode);
 				reset_searching_lineinfo(&desc);
 			}
+			else if (column_sketch)
+			{
+				close_column_sketch();
+				refresh_clear = true;
+			}
+			else if (saved_view.active)
+			{
+				/* return from grouped rows to data */
+				leave_group_view(&desc,
+								 &cursor_row, &cursor_col, &first_row,
+								 &first_data_row, &vertical_cursor_column,
+								 &last_ordered_column, &last_order_desc);
+
+				refresh_clear = true;
+			}
 			else
 			{
 				if (opts.on_sigint_exit)
@@ -4336,6 +5662,39 @@ hide_menu:
 
 				refresh_clipboard_options(&opts, menu);
 
+#endif
+
+				break;
+
+			case cmd_UseClipboard_INSERT_batch:
+				opts.clipboard_format = CLIPBOARD_FORMAT_INSERT_BATCH;
+
+#ifdef COMPILE_MENU
+
+				refresh_clipboard_options(&opts, menu);
+
+#endif
+
+				break;
+
+			case cmd_UseClipboard_COPY:
+				opts.clipboard_format = CLIPBOARD_FORMAT_COPY;
+
+#ifdef COMPILE_MENU
+
+				refresh_clipboard_options(&opts, menu);
+
+#endif
+
+				break;
+
+			case cmd_UseClipboard_ARROW:
+				opts.clipboard_format = CLIPBOARD_FORMAT_ARROW;
+
+#ifdef COMPILE_MENU
+
+				refresh_clipboard_options(&opts, menu);
+
 #endif
 
 				break;
@@ -4365,6 +5724,14 @@ hide_menu:
 				opts.ignore_case = false;
 				goto reset_search;
 
+			case cmd_RegexSearchToggle:
+				opts.regex_search = !opts.regex_search;
+				goto reset_search;
+
+			case cmd_IncrementalSearchToggle:
+				opts.incremental_search = !opts.incremental_search;
+				break;
+
 			case cmd_CSSearchSet:
 				opts.ignore_lower_case = false;
 				opts.ignore_case = false;
@@ -4374,6 +5741,9 @@ reset_search:
 				scrdesc.searchterm_size = 0;
 				scrdesc.searchterm_char_size = 0;
 
+				regexp_free(scrdesc.searchregexp);
+				scrdesc.searchregexp = NULL;
+
 				reset_searching_lineinfo(&desc);
 				break;
 
@@ -4409,6 +5779,11 @@ reset_search:
 				refresh_scr = true;
 				break;
 
+			case cmd_ShowStats:
+				opts.show_stats = !opts.show_stats;
+				refresh_scr = true;
+				break;
+
 			case cmd_RowNumToggle:
 				opts.show_rownum = !opts.show_rownum;
 				refresh_scr = true;
@@ -4682,27 +6057,12 @@ reset_search:
 				}
 				break;
 
-			case cmd_FlushBookmarks:
-				{
-					SimpleLineBufferIter slbi, *_slbi;
-
-					_slbi = init_slbi_ddesc(&slbi, &desc);
-
-					while (_slbi)
-					{
-						LineInfo *linfo;
-
-						_slbi = slbi_get_line_next(_slbi, NULL, &linfo);
-
-						if (linfo && (linfo->mask & LINEINFO_BOOKMARK))
-							linfo->mask ^= LINEINFO_BOOKMARK;
-					}
-				}
+			case cmd_FlushBookmarks:
+				ddesc_flush_bookmarks(&desc);
 				break;
 
 			case cmd_ToggleBookmark:
 				{
-					LineBufferMark lbm;
 					int		_cursor_row;
 
 					if (mouse_row != -1)
@@ -4714,73 +6074,43 @@ reset_search:
 					else
 						_cursor_row = cursor_row + CURSOR_ROW_OFFSET;
 
-					if (ddesc_set_mark(&lbm, &desc, _cursor_row))
-						lbm_xor_mask(&lbm, LINEINFO_BOOKMARK);
+					(void) ddesc_toggle_bookmark(&desc, _cursor_row);
 				}
 				break;
 
 			case cmd_PrevBookmark:
 				{
 					int		lineno;
-					bool	found = false;
 
-					/* start from previous line before cursor */
-					lineno = cursor_row + CURSOR_ROW_OFFSET - 1;
+					lineno = ddesc_prev_bookmark(&desc, cursor_row + CURSOR_ROW_OFFSET);
 
-					if (lineno > 0)
+					if (lineno >= CURSOR_ROW_OFFSET)
 					{
-						LineBufferIter lbi;
-						LineInfo *linfo;
-
-						init_lbi_ddesc(&lbi, &desc, lineno);
-
-						while (lbi_get_line_prev(&lbi, NULL, &linfo, &lineno))
-						{
-							if (linfo && linfo->mask & LINEINFO_BOOKMARK)
-							{
-								cursor_row = lineno - CURSOR_ROW_OFFSET;
-								if (cursor_row < first_row)
-									first_row = cursor_row;
-
-								found = true;
-								break;
-							}
-						}
+						cursor_row = lineno - CURSOR_ROW_OFFSET;
+						if (cursor_row < first_row)
+							first_row = cursor_row;
 					}
-
-					if (!found)
+					else
 						make_beep(&opts);
 				}
 				break;
 
 			case cmd_NextBookmark:
 				{
-					LineBufferIter lbi;
-					LineInfo *linfo;
 					int		lineno;
-					bool	found = false;
-
-					/* start after (next line) cursor line */
-					lineno = cursor_row + CURSOR_ROW_OFFSET + 1;
 
-					init_lbi_ddesc(&lbi, &desc, lineno);
+					lineno = ddesc_next_bookmark(&desc, cursor_row + CURSOR_ROW_OFFSET);
 
-					while (lbi_get_line_next(&lbi, NULL, &linfo, &lineno))
+					if (lineno != -1)
 					{
-						if (linfo && linfo->mask & LINEINFO_BOOKMARK)
-						{
-							cursor_row = lineno - CURSOR_ROW_OFFSET;
+						cursor_row = lineno - CURSOR_ROW_OFFSET;
 
-							if (cursor_row - first_row + 1 > VISIBLE_DATA_ROWS)
-								first_row = cursor_row - VISIBLE_DATA_ROWS + 1;
+						if (cursor_row - first_row + 1 > VISIBLE_DATA_ROWS)
+							first_row = cursor_row - VISIBLE_DATA_ROWS + 1;
 
-							first_row = adjust_first_row(first_row, &desc, &scrdesc);
-							found = true;
-							break;
-						}
+						first_row = adjust_first_row(first_row, &desc, &scrdesc);
 					}
-
-					if (!found)
+					else
 						make_beep(&opts);
 				}
 				break;
@@ -5429,10 +6759,19 @@ recheck_end:
 			case cmd_OriginalSort:
 				if (desc.order_map)
 				{
+					bool	is_filtered = desc.row_filter_active;
+
+					/* unsorted rows should be filtered again */
+					disable_row_filter(&desc);
+
 					free(desc.order_map);
 					desc.order_map = NULL;
+					ddesc_reset_positions(&desc);
 					last_ordered_column = -1;
 
+					if (is_filtered)
+						enable_row_filter(&desc);
+
 					throw_selection(&scrdesc, &mark_mode);
 				}
 
@@ -5464,6 +6803,366 @@ recheck_end:
 					break;
 				}
 
+			case cmd_SetFilter:
+			case cmd_ToggleFilter:
+				{
+					LineBufferMark	lbm;
+					int		max_cursor_row;
+					int		rows = -1;
+					int		pos;
+
+					if (command == cmd_SetFilter)
+					{
+						char	locfilter[256];
+
+						get_string(&opts, &scrdesc, "&", locfilter, sizeof(locfilter) - 1, last_filter);
+
+						if (locfilter[0] != '\0')
+						{
+							RowFilter *rf = compile_row_filter(&opts, &desc, locfilter);
+
+							if (!rf)
+							{
+								next_event_keycode = show_info_wait(&opts, &scrdesc,
+																	" Cannot use filter (%s) (press any key)",
+																	(char *) current_state->errstr,
+																	true, true, false, true);
+
+								/* err string is saved already, because refresh_first is used */
+								current_state->errstr = NULL;
+								break;
+							}
+
+							memcpy(last_filter, locfilter, sizeof(last_filter));
+
+							(void) ddesc_set_mark(&lbm, &desc, cursor_row + desc.first_data_row);
+							rows = set_row_filter(&opts, &desc, rf);
+						}
+						else if (desc.row_filter)
+						{
+							(void) ddesc_set_mark(&lbm, &desc, cursor_row + desc.first_data_row);
+							(void) set_row_filter(&opts, &desc, NULL);
+						}
+						else
+							break;
+					}
+					else
+					{
+						if (!desc.row_filter)
+						{
+							show_info_wait(&opts, &scrdesc,
+										   " Filter is not defined (press any key)",
+										   NULL, true, true, true, false);
+							break;
+						}
+
+						(void) ddesc_set_mark(&lbm, &desc, cursor_row + desc.first_data_row);
+
+						if (desc.row_filter_active)
+							disable_row_filter(&desc);
+						else
+							enable_row_filter(&desc);
+					}
+
+					/* try to hold cursor on same row */
+					pos = ddesc_get_position(&desc, &lbm);
+					cursor_row = pos != -1 ? pos - desc.first_data_row : 0;
+
+					max_cursor_row = MAX_CURSOR_ROW;
+					if (cursor_row > max_cursor_row)
+						cursor_row = max_cursor_row;
+					if (cursor_row < 0)
+						cursor_row = 0;
+
+					if (cursor_row < first_row || cursor_row - first_row + 1 > VISIBLE_DATA_ROWS)
+						first_row = cursor_row - VISIBLE_DATA_ROWS / 2;
+
+					first_row = adjust_first_row(first_row, &desc, &scrdesc);
+					if (first_row < 0)
+						first_row = 0;
+
+					/* statistics should be calculated from filtered rows */
+					restart_column_sketch(&opts, &desc);
+
+					throw_selection(&scrdesc, &mark_mode);
+					scrdesc.found_row = -1;
+					refresh_clear = true;
+
+					if (rows == 0)
+						show_info_wait(&opts, &scrdesc,
+									   " No rows match the filter (press any key)",
+									   NULL, true, true, true, false);
+
+					break;
+				}
+
+			case cmd_SetColumns:
+			case cmd_HideColumn:
+			case cmd_MoveColumnLeft:
+			case cmd_MoveColumnRight:
+			case cmd_ShowAllColumns:
+				{
+					int	   *columns = NULL;
+					int		ncolumns = 0;
+					int		colno = vertical_cursor_column - 1;
+					bool	isok;
+
+					if (desc.columns == 0 || !desc.headline_transl || desc.is_expanded_mode)
+					{
+						show_info_wait(&opts, &scrdesc,
+									   " Columns can be hidden only in tables.",
+									   NULL, true, true, true, false);
+						break;
+					}
+
+					if (command == cmd_SetColumns)
+					{
+						char	defstr[256];
+						char	str[256];
+
+						format_projection(&desc, defstr, sizeof(defstr));
+						get_string(&opts, &scrdesc, "|", str, sizeof(str) - 1, defstr);
+
+						if (str[0] != '\0')
+						{
+							columns = parse_projection(&desc, str, &ncolumns);
+							if (!columns)
+							{
+								next_event_keycode = show_info_wait(&opts, &scrdesc,
+																	" Cannot to display columns (%s) (press any key)",
+																	(char *) current_state->errstr,
+																	true, true, false, true);
+
+								current_state->errstr = NULL;
+								break;
+							}
+						}
+					}
+					else if (command != cmd_ShowAllColumns)
+					{
+						int	   *current;
+						int		i;
+
+						if (!opts.vertical_cursor || vertical_cursor_column < 1)
+						{
+							show_info_wait(&opts, &scrdesc,
+										   " Vertical cursor is not visible",
+										   NULL, true, true, true, false);
+							break;
+						}
+
+						current = get_projection(&desc, &ncolumns);
+						columns = smalloc(ncolumns * sizeof(int));
+
+						for (i = 0; i < ncolumns; i++)
+							columns[i] = current ? current[i] : i;
+
+						if (command == cmd_HideColumn)
+						{
+							if (ncolumns == 1)
+							{
+								free(columns);
+								show_info_wait(&opts, &scrdesc,
+											   " Last column cannot be hidden",
+											   NULL, true, true, true, false);
+								break;
+							}
+
+							memmove(columns + colno, columns + colno + 1,
+									(ncolumns - colno - 1) * sizeof(int));
+							ncolumns -= 1;
+						}
+						else
+						{
+							int		other = command == cmd_MoveColumnLeft ? colno - 1 : colno + 1;
+							int		aux;
+
+							if (other < 0 || other >= ncolumns)
+							{
+								free(columns);
+								make_beep(&opts);
+								break;
+							}
+
+							aux = columns[colno];
+							columns[colno] = columns[other];
+							columns[other] = aux;
+
+							/* vertical cursor follows moved column */
+							vertical_cursor_column = other + 1;
+						}
+					}
+					else if (!desc.projection)
+						break;
+
+					isok = set_projection(&opts, &desc, columns, ncolumns);
+
+					free(last_projection);
+					last_projection = NULL;
+					last_projection_ncolumns = 0;
+
+					if (!isok)
+					{
+						free(columns);
+
+						next_event_keycode = show_info_wait(&opts, &scrdesc,
+															" Cannot to display columns (%s) (press any key)",
+															(char *) current_state->errstr,
+															true, true, false, true);
+
+						current_state->errstr = NULL;
+						refresh_clear = true;
+						break;
+					}
+
+					if (desc.projection)
+					{
+						last_projection = columns;
+						last_projection_ncolumns = ncolumns;
+					}
+					else
+						free(columns);
+
+					/* order map is not changed, but sort column is not known */
+					last_ordered_column = -1;
+
+					/* sampled column can be hidden or moved */
+					close_column_sketch();
+
+					if (vertical_cursor_column > desc.columns)
+						vertical_cursor_column = desc.columns;
+
+					if (vertical_cursor_column > 0)
+						cursor_col = get_cursor_col_for_vertical_column(vertical_cursor_column,
+																		cursor_col,
+																		&desc,
+																		&scrdesc);
+
+					if (cursor_col > desc.headline_char_size - scrdesc.main_maxx)
+						cursor_col = desc.headline_char_size - scrdesc.main_maxx;
+					if (cursor_col < 0)
+						cursor_col = 0;
+
+					throw_selection(&scrdesc, &mark_mode);
+					refresh_clear = true;
+					break;
+				}
+
+			case cmd_GroupBy:
+				{
+					DataDesc	grouped;
+					const char *ptr;
+					char	defstr[256];
+					char	str[256];
+					int		colno;
+					int		aggcolno = -1;
+
+					if (saved_view.active)
+					{
+						show_info_wait(&opts, &scrdesc,
+									   " Grouped rows are displayed already (press Esc Esc to return)",
+									   NULL, true, true, true, false);
+						break;
+					}
+
+					if (desc.columns == 0 || !desc.headline_transl || desc.is_expanded_mode)
+					{
+						show_info_wait(&opts, &scrdesc,
+									   " Rows can be grouped only in tables.",
+									   NULL, true, true, true, false);
+						break;
+					}
+
+					/* column with vertical cursor is used by default */
+					get_default_column(&opts, &desc, vertical_cursor_column, defstr, sizeof(defstr));
+
+					get_string(&opts, &scrdesc, "=", str, sizeof(str) - 1, defstr);
+					if (str[0] == '\0')
+						break;
+
+					colno = parse_column(&desc, str, &ptr);
+					if (colno != -1 && *ptr)
+					{
+						aggcolno = parse_column(&desc, ptr, &ptr);
+						if (*ptr)
+							aggcolno = -1;
+						if (aggcolno == -1)
+							colno = -1;
+					}
+
+					if (colno == -1)
+					{
+						next_event_keycode = show_info_wait(&opts, &scrdesc,
+															" Cannot to group rows (unknown column \"%s\") (press any key)",
+															str, true, true, false, true);
+						break;
+					}
+
+					if (!group_by_column(&opts, &desc, colno, aggcolno, &grouped))
+					{
+						next_event_keycode = show_info_wait(&opts, &scrdesc,
+															" Cannot to group rows (%s) (press any key)",
+															(char *) current_state->errstr,
+															true, true, false, true);
+
+						current_state->errstr = NULL;
+						break;
+					}
+
+					enter_group_view(&desc, &grouped,
+									 &cursor_row, &cursor_col, &first_row,
+									 &first_data_row, &vertical_cursor_column,
+									 &last_ordered_column, &last_order_desc);
+
+					throw_searching(&scrdesc);
+					throw_selection(&scrdesc, &mark_mode);
+					refresh_clear = true;
+					break;
+				}
+
+			case cmd_SampleColumn:
+				{
+					const char *ptr;
+					char	defstr[256];
+					char	str[256];
+					int		colno;
+
+					if (column_sketch)
+					{
+						close_column_sketch();
+						refresh_clear = true;
+						break;
+					}
+
+					if (desc.columns == 0 || !desc.headline_transl || desc.is_expanded_mode)
+					{
+						show_info_wait(&opts, &scrdesc,
+									   " Columns can be sampled only in tables.",
+									   NULL, true, true, true, false);
+						break;
+					}
+
+					get_default_column(&opts, &desc, vertical_cursor_column, defstr, sizeof(defstr));
+
+					get_string(&opts, &scrdesc, "column: ", str, sizeof(str) - 1, defstr);
+					if (str[0] == '\0')
+						break;
+
+					colno = parse_column(&desc, str, &ptr);
+					if (colno == -1 || *ptr)
+					{
+						next_event_keycode = show_info_wait(&opts, &scrdesc,
+															" Cannot to sample column (unknown column \"%s\") (press any key)",
+															str, true, true, false, true);
+						break;
+					}
+
+					column_sketch = create_column_sketch(&opts, &desc, colno);
+					column_sketch_pending = true;
+					refresh_clear = true;
+					break;
+				}
+
 			case cmd_SaveData:
 				{
 					export_to_file(cmd_SaveData,
@@ -5606,10 +7305,32 @@ recheck_end:
 			case cmd_ForwardSearch:
 				{
 					char	locsearchterm[256];
+					char	prompt[100];
 
 					search_direction = SEARCH_FORWARD;
 
-					get_string(&opts, &scrdesc, "/", locsearchterm, sizeof(locsearchterm) - 1, last_row_search);
+					set_search_scope(&opts, &scrdesc, &desc, vertical_cursor_column,
+									 "/", prompt, sizeof(prompt));
+
+					/* pattern is edited in main loop, search is done after any change */
+					if (opts.incremental_search)
+					{
+						strcpy(incsearch_prompt, prompt);
+						incsearch_term[0] = '\0';
+						incsearch_found = 0;
+						incsearch_valid = true;
+						incsearch_cursor_row = cursor_row;
+						incsearch_first_row = first_row;
+						incsearch_active = true;
+
+						(void) set_searchterm(&opts, &scrdesc, "");
+						reset_searching_lineinfo(&desc);
+
+						curs_set(1);
+						break;
+					}
+
+					get_string(&opts, &scrdesc, prompt, locsearchterm, sizeof(locsearchterm) - 1, last_row_search);
 
 					reset_searching_lineinfo(&desc);
 
@@ -5617,17 +7338,19 @@ recheck_end:
 					{
 						memcpy(last_row_search, locsearchterm, sizeof(last_row_search));
 
-						strncpy(scrdesc.searchterm, locsearchterm, sizeof(scrdesc.searchterm));
-						scrdesc.has_upperchr = has_upperchr(&opts, scrdesc.searchterm);
-						scrdesc.searchterm_size = strlen(scrdesc.searchterm);
-						scrdesc.searchterm_char_size = opts.force8bit ? strlen(scrdesc.searchterm) : utf8len(scrdesc.searchterm);
+						if (!set_searchterm(&opts, &scrdesc, locsearchterm))
+						{
+							next_event_keycode = show_info_wait(&opts, &scrdesc,
+																" Cannot to compile regular expression (%s) (press any key)",
+																(char *) current_state->errstr,
+																true, true, false, true);
+							current_state->errstr = NULL;
+							break;
+						}
 					}
 					else
 					{
-						scrdesc.searchterm[0] = '\0';
-						scrdesc.searchterm_size = 0;
-						scrdesc.searchterm_char_size = 0;
-
+						(void) set_searchterm(&opts, &scrdesc, "");
 						break;
 					}
 
@@ -5643,9 +7366,12 @@ recheck_end:
 			case cmd_SearchNext:
 				{
 					LineBufferIter lbi;
+					LineBufferMark lbm;
 					int		lineno;
 					char   *line;
+					int		line_size;
 					int		skip_bytes = 0;
+					long long start_search_us;
 
 					if (!*scrdesc.searchterm)
 						break;
@@ -5660,17 +7386,21 @@ recheck_end:
 					lineno = cursor_row + CURSOR_ROW_OFFSET;
 
 					if (scrdesc.found && lineno == scrdesc.found_row)
-						skip_bytes = scrdesc.found_start_bytes + scrdesc.searchterm_size;
+						skip_bytes = scrdesc.found_start_bytes + scrdesc.found_size;
 
 					scrdesc.found = false;
 
+					start_search_us = stats_time_us();
+
 					init_lbi_ddesc(&lbi, &desc, lineno);
 
-					while (lbi_get_line_next(&lbi, &line, NULL, &lineno))
+					while (lbi_set_mark_next(&lbi, &lbm) &&
+						   lbm_get_line(&lbm, &line, &line_size, NULL, &lineno))
 					{
 						const char   *pttrn;
+						int		size;
 
-						pttrn = pspg_search(&opts, &scrdesc, line + skip_bytes);
+						pttrn = pspg_search(&opts, &scrdesc, &desc, &lbm, line, line_size, line + skip_bytes, &size);
 						if (pttrn)
 						{
 							int		found_start_bytes = pttrn - line;
@@ -5680,6 +7410,10 @@ recheck_end:
 												 utf8len_start_stop(line, pttrn);
 
 							scrdesc.found_start_bytes = found_start_bytes;
+							scrdesc.found_size = size;
+							scrdesc.found_char_size =
+								opts.force8bit ? (size_t) size :
+												 utf8len_start_stop(pttrn, pttrn + size);
 							scrdesc.found_row = lineno;
 
 							fresh_found = true;
@@ -5699,6 +7433,8 @@ recheck_end:
 						skip_bytes = 0;
 					}
 
+					perf_stats.search_us = stats_time_us() - start_search_us;
+
 					if (!scrdesc.found)
 						show_info_wait(&opts, &scrdesc,
 									   " Not found (press any key)",
@@ -5709,10 +7445,14 @@ recheck_end:
 			case cmd_BackwardSearch:
 				{
 					char	locsearchterm[256];
+					char	prompt[100];
 
 					search_direction = SEARCH_BACKWARD;
 
-					get_string(&opts, &scrdesc, "?", locsearchterm, sizeof(locsearchterm) - 1, last_row_search);
+					set_search_scope(&opts, &scrdesc, &desc, vertical_cursor_column,
+									 "?", prompt, sizeof(prompt));
+
+					get_string(&opts, &scrdesc, prompt, locsearchterm, sizeof(locsearchterm) - 1, last_row_search);
 
 					reset_searching_lineinfo(&desc);
 
@@ -5720,17 +7460,19 @@ recheck_end:
 					{
 						memcpy(last_row_search, locsearchterm, sizeof(last_row_search));
 
-						strncpy(scrdesc.searchterm, locsearchterm, sizeof(scrdesc.searchterm));
-						scrdesc.has_upperchr = has_upperchr(&opts, scrdesc.searchterm);
-						scrdesc.searchterm_size = strlen(scrdesc.searchterm);
-						scrdesc.searchterm_char_size = utf8len(scrdesc.searchterm);
+						if (!set_searchterm(&opts, &scrdesc, locsearchterm))
+						{
+							next_event_keycode = show_info_wait(&opts, &scrdesc,
+																" Cannot to compile regular expression (%s) (press any key)",
+																(char *) current_state->errstr,
+																true, true, false, true);
+							current_state->errstr = NULL;
+							break;
+						}
 					}
 					else
 					{
-						scrdesc.searchterm[0] = '\0';
-						scrdesc.searchterm_size = 0;
-						scrdesc.searchterm_char_size = 0;
-
+						(void) set_searchterm(&opts, &scrdesc, "");
 						break;
 					}
 
@@ -5742,9 +7484,12 @@ recheck_end:
 			case cmd_SearchPrev:
 				{
 					LineBufferIter lbi;
+					LineBufferMark lbm;
 					int		lineno;
-					char   *line, *_line;
+					char   *line;
+					int		line_size;
 					int		cut_bytes = 0;
+					long long start_search_us;
 
 					if (!*scrdesc.searchterm)
 						break;
@@ -5770,12 +7515,16 @@ recheck_end:
 
 					scrdesc.found = false;
 
+					start_search_us = stats_time_us();
+
 					init_lbi_ddesc(&lbi, &desc, lineno);
 
-					while (lbi_get_line_prev(&lbi, &line, NULL, &lineno))
+					while (lbi_set_mark_prev(&lbi, &lbm) &&
+						   lbm_get_line(&lbm, &line, &line_size, NULL, &lineno))
 					{
 						const char   *ptr;
 						const char   *most_right_pttrn = NULL;
+						int		most_right_size = 0;
 
 						/* inside table don't try search below first data row */
 						if (desc.headline_transl)
@@ -5784,24 +7533,33 @@ recheck_end:
 								break;
 						}
 
-						_line = cut_bytes > 0 ? sstrndup(line, cut_bytes) : line;
-						ptr = _line;
+						ptr = line;
 
-						/* try to find most right pattern */
+						/*
+						 * Try to find most right pattern before cut. The whole
+						 * line is searched, because regular expression can
+						 * depends on end of line.
+						 */
 						while (ptr)
 						{
-							ptr = pspg_search(&opts, &scrdesc, ptr);
+							int		size;
+
+							ptr = pspg_search(&opts, &scrdesc, &desc, &lbm, line, line_size, ptr, &size);
 
 							if (ptr)
 							{
+								if (cut_bytes > 0 && ptr - line + size > cut_bytes)
+									break;
+
 								most_right_pttrn = ptr;
-								ptr += scrdesc.searchterm_size;
+								most_right_size = size;
+								ptr += size;
 							}
 						}
 
 						if (most_right_pttrn)
 						{
-							int		found_start_bytes = most_right_pttrn - _line;
+							int		found_start_bytes = most_right_pttrn - line;
 
 							cursor_row = lineno - CURSOR_ROW_OFFSET;
 							if (first_row > cursor_row)
@@ -5809,27 +7567,27 @@ recheck_end:
 
 							scrdesc.found_start_x =
 								opts.force8bit ? (size_t) (found_start_bytes) :
-												 utf8len_start_stop(_line, most_right_pttrn);
+												 utf8len_start_stop(line, most_right_pttrn);
 
 							scrdesc.found_start_bytes = found_start_bytes;
+							scrdesc.found_size = most_right_size;
+							scrdesc.found_char_size =
+								opts.force8bit ? (size_t) most_right_size :
+												 utf8len_start_stop(most_right_pttrn, most_right_pttrn + most_right_size);
 							scrdesc.found_row = lineno;
 
 							fresh_found = true;
 							fresh_found_cursor_col = -1;
 
-							if (line != _line)
-								free(_line);
-
 							scrdesc.found = true;
 							break;
 						}
 
-						if (line != _line)
-							free(_line);
-
 						cut_bytes = 0;
 					}
 
+					perf_stats.search_us = stats_time_us() - start_search_us;
+
 					if (!scrdesc.found)
 						show_info_wait(&opts, &scrdesc,
 									   " Not found (press any key)",
@@ -5860,6 +7618,23 @@ recheck_end:
 
 						if (scrdesc.searchcolterm[0] != '\0')
 						{
+							Regexp	   *re = NULL;
+
+							/* column names are searched case insensitive */
+							if (opts.regex_search)
+							{
+								re = regexp_compile(scrdesc.searchcolterm, true, opts.force8bit);
+								if (!re)
+								{
+									next_event_keycode = show_info_wait(&opts, &scrdesc,
+																		" Cannot to compile regular expression (%s) (press any key)",
+																		(char *) current_state->errstr,
+																		true, true, false, true);
+									current_state->errstr = NULL;
+									break;
+								}
+							}
+
 							/*
 							 * Where we should to start searching?
 							 * 1. after visible vertical cursor
@@ -5891,27 +7666,10 @@ recheck_end:
 
 							for (colnum = startcolumn; colnum <= desc.columns; colnum++)
 							{
-								if (opts.force8bit)
-								{
-									if (nstrstr_with_sizes(desc.namesline + desc.cranges[colnum - 1].name_offset,
-														   desc.cranges[colnum - 1].name_size,
-														   scrdesc.searchcolterm,
-														   scrdesc.searchcolterm_size))
-									{
-										found = true;
-										break;
-									}
-								}
-								else
+								if (is_searched_column(&opts, &scrdesc, &desc, re, colnum))
 								{
-									if (utf8_nstrstr_with_sizes(desc.namesline + desc.cranges[colnum - 1].name_offset,
-														   desc.cranges[colnum - 1].name_size,
-														   scrdesc.searchcolterm,
-														   scrdesc.searchcolterm_size))
-									{
-										found = true;
-										break;
-									}
+									found = true;
+									break;
 								}
 							}
 
@@ -5921,10 +7679,7 @@ recheck_end:
 
 								for (colnum = 1; colnum < startcolumn; colnum++)
 								{
-									if (nstrstr_with_sizes(desc.namesline + desc.cranges[colnum - 1].name_offset,
-														   desc.cranges[colnum - 1].name_size,
-														   scrdesc.searchcolterm,
-														   scrdesc.searchcolterm_size))
+									if (is_searched_column(&opts, &scrdesc, &desc, re, colnum))
 									{
 										found = true;
 										break;
@@ -5932,6 +7687,8 @@ recheck_end:
 								}
 							}
 
+							regexp_free(re);
+
 							if (found)
 							{
 								if (search_from_start)
@@ -5967,6 +7724,13 @@ recheck_end:
 				paused = !paused;
 				break;
 
+			case cmd_PrevResult:
+			case cmd_NextResult:
+				/* the result is displayed after query event */
+				if (opts.querystream)
+					(void) pg_history_move(command == cmd_PrevResult ? -1 : 1);
+				break;
+
 			case cmd_Refresh:
 				refresh_clear = true;
 				break;
@@ -6466,7 +8230,7 @@ recheck_end:
 			{
 				getmaxyx(w_fix_cols(&scrdesc), maxy_loc, maxx_loc);
 
-				if (scrdesc.found_start_x + scrdesc.searchterm_char_size <= maxx_loc)
+				if (scrdesc.found_start_x + scrdesc.found_char_size <= maxx_loc)
 					fresh_found = false;
 			}
 
@@ -6475,7 +8239,7 @@ recheck_end:
 				getmaxyx(w_rows(&scrdesc), maxy_loc, maxx_loc);
 
 				if (cursor_col + scrdesc.fix_cols_cols <= scrdesc.found_start_x &&
-						cursor_col + scrdesc.fix_cols_cols + maxx_loc >= scrdesc.found_start_x + scrdesc.searchterm_char_size)
+						cursor_col + scrdesc.fix_cols_cols + maxx_loc >= scrdesc.found_start_x + scrdesc.found_char_size)
 				{
 					fresh_found = false;
 				}
@@ -6484,7 +8248,7 @@ recheck_end:
 					/* we would to move cursor_col to left or right to be partially visible */
 					if (cursor_col + scrdesc.fix_cols_cols > scrdesc.found_start_x)
 						next_command = cmd_MoveLeft;
-					else if (cursor_col + scrdesc.fix_cols_cols + maxx_loc < scrdesc.found_start_x + scrdesc.searchterm_char_size)
+					else if (cursor_col + scrdesc.fix_cols_cols + maxx_loc < scrdesc.found_start_x + scrdesc.found_char_size)
 						next_command = cmd_MoveRight;
 				}
 			}
@@ -6494,7 +8258,7 @@ recheck_end:
 				getmaxyx(w_footer(&scrdesc), maxy_loc, maxx_loc);
 
 				if (footer_cursor_col + scrdesc.fix_cols_cols <= scrdesc.found_start_x &&
-						footer_cursor_col + maxx_loc >= scrdesc.found_start_x + scrdesc.searchterm_char_size)
+						footer_cursor_col + maxx_loc >= scrdesc.found_start_x + scrdesc.found_char_size)
 				{
 					fresh_found = false;
 				}
@@ -6503,7 +8267,7 @@ recheck_end:
 					/* we would to move cursor_col to left or right to be partially visible */
 					if (footer_cursor_col > scrdesc.found_start_x)
 						next_command = cmd_MoveLeft;
-					else if (footer_cursor_col + maxx_loc < scrdesc.found_start_x + scrdesc.searchterm_char_size)
+					else if (footer_cursor_col + maxx_loc < scrdesc.found_start_x + scrdesc.found_char_size)
 						next_command = cmd_MoveRight;
 				}
 			}
@@ -6674,6 +8438,8 @@ refresh:
 	if (state.inotify_fd >= 0)
 		close(state.inotify_fd);
 
+	pg_finish();
+
 #ifdef DEBUG_PIPE
 
 	/*
@@ -6692,6 +8458,8 @@ refresh:
 
 #endif
 
+	stats_write_file(opts.stats_pathname, true);
+
 	/* close file in streaming mode */
 	if (state.fp && !state.is_pipe)
 		fclose(state.fp);
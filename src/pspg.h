@@ -15,7 +15,10 @@
 #define PSPG_PSPG_H
 
 #include <poll.h>
+#include <pthread.h>
+#include <stdint.h>
 #include <stdio.h>
+#include <sys/types.h>
 
 #include "commands.h"
 #include "config.h"
@@ -23,7 +26,6 @@
 #include "st_menu.h"
 
 #define LINEINFO_NONE				0
-#define LINEINFO_BOOKMARK			1
 #define LINEINFO_FOUNDSTR			2
 #define LINEINFO_FOUNDSTR_MULTI		4
 #define LINEINFO_UNKNOWN			8
@@ -49,12 +51,39 @@ typedef struct LineInfo
 
 #define	LINEBUFFER_LINES		1000
 
+/*
+ * Lines are stored in one continuous memory block as NUL terminated
+ * strings. Sizes and display widths are cached, so consumers should
+ * not to calculate it again. Full line buffers can be compressed or moved
+ * to temporary file. Then data is NULL (or it is copy holded by block
+ * cache).
+ */
 typedef struct LineBuffer
 {
-	int		first_row;
+	int		first_row;						/* line number of first row */
 	int		nrows;
-	char   *rows[LINEBUFFER_LINES];
+	char   *data;							/* stored lines */
+	uint32_t data_size;						/* used bytes of data */
+	uint32_t data_allocated;				/* allocated bytes of data */
+	char   *zdata;							/* compressed data or NULL */
+	uint32_t zdata_size;					/* size of compressed data */
+	bool	is_cached;						/* data are in block cache */
+	bool	is_spilled;						/* data are stored in temp file */
+	off_t	spill_offset;					/* position of data in temp file */
+	bool	is_dirty;						/* cached data was modified */
+	unsigned long cache_tick;				/* last access to cached data */
+	uint32_t offsets[LINEBUFFER_LINES];		/* start of line in data */
+	int		sizes[LINEBUFFER_LINES];		/* size of line in bytes */
+	int		widths[LINEBUFFER_LINES];		/* display width of line or -1 */
 	LineInfo	   *lineinfo;
+	unsigned char *candidates;				/* bitset of rows found by incremental search */
+	int		ncandidates;					/* number of rows in candidates */
+	uint64_t *bookmarks;					/* bitset of bookmarked rows or NULL */
+	int		nbookmarks;						/* number of bookmarked rows */
+	struct ColumnStore *colstore;			/* rows are rendered from column store */
+	int		colstore_rowno;					/* row of column store of first line */
+	struct LineBuffer *source;				/* rows are projected from source rows */
+	struct Projection *projection;
 	struct LineBuffer *next;
 	struct LineBuffer *prev;
 } LineBuffer;
@@ -81,6 +110,81 @@ typedef struct
 	int				lnb_row;
 } SortData;
 
+/*
+ * Detected type of column. Numeric types should be first and
+ * ordered from most specific.
+ */
+typedef enum
+{
+	COLUMN_TYPE_UNKNOWN,			/* only NULLs */
+	COLUMN_TYPE_INTEGER,
+	COLUMN_TYPE_DECIMAL,			/* number with decimal point or exponent */
+	COLUMN_TYPE_SIZE,				/* number with unit like kB or MB */
+	COLUMN_TYPE_BOOLEAN,
+	COLUMN_TYPE_DATE,
+	COLUMN_TYPE_TIMESTAMP,
+	COLUMN_TYPE_INTERVAL,
+	COLUMN_TYPE_TEXT
+} ColumnType;
+
+/*
+ * Parsed values of one column. Values are indexed by line number
+ * (in original order). Values are available only for not text columns.
+ */
+typedef struct
+{
+	bool		is_valid;			/* true, when column was parsed already */
+	ColumnType	type;
+	bool		has_time_zone;		/* some timestamps had UTC offset */
+	int			scale;				/* max digits after decimal point */
+	double	   *values;
+	bool	   *isnull;
+} ColumnValues;
+
+/*
+ * Compiled predicate used for filtering of rows (opaque)
+ */
+typedef struct RowFilter RowFilter;
+
+/*
+ * Compiled regular expression (opaque)
+ */
+typedef struct Regexp Regexp;
+
+/*
+ * Not formatted values stored by columns
+ */
+typedef struct ColumnStore ColumnStore;
+
+/*
+ * Selected and ordered displayed columns
+ */
+typedef struct Projection Projection;
+
+/*
+ * Approximate statistics of one column (opaque)
+ */
+typedef struct ColumnSketch ColumnSketch;
+
+/*
+ * Used for storing not yet formatted data
+ */
+typedef struct
+{
+	int		nfields;
+	char   *fields[];
+} RowType;
+
+typedef struct _rowBucketType
+{
+	int			nrows;
+	RowType	   *rows[1000];
+	bool		multilines[1000];
+	int			linenos[1000];		/* first formatted line of row or -1 */
+	bool		allocated;
+	struct _rowBucketType *next_bucket;
+} RowBucketType;
+
 /*
  * Column range
  */
@@ -120,8 +224,12 @@ typedef struct
 	char	filename[65];			/* filename (printed on top bar) */
 	LineBuffer rows;				/* list of rows buffers */
 	int		total_rows;				/* number of input rows */
+	size_t	total_bytes;			/* size of stored rows in bytes */
+	int		evicted_rows;			/* number of rows removed by stream retention */
 	MappedLine *order_map;			/* maps sorted lines to original lines */
 	int		order_map_items;		/* number of items of order map */
+	int	   *positions;				/* inverse order map (position of lines) or NULL */
+	int		nbookmarks;				/* number of bookmarked lines */
 	int		maxy;					/* maxy of used pad area with data */
 	int		maxx;					/* maxx of used pad area with data */
 	int		maxbytes;				/* max length of line in bytes */
@@ -132,6 +240,12 @@ typedef struct
 	int		headline_char_size;		/* size of headerline in chars */
 	CRange *cranges;				/* pairs of start, end of columns */
 	int		columns;				/* number of columns */
+	ColumnValues *column_values;	/* cache of parsed columns or NULL */
+	RowFilter *row_filter;			/* compiled row filter or NULL */
+	bool	row_filter_active;		/* true, when only filtered rows are displayed */
+	ColumnStore *colstore;			/* not formatted values of csv or query or NULL */
+	ColumnType *source_types;		/* types of result's columns */
+	Projection *projection;			/* displayed columns or NULL */
 	int		first_data_row;			/* fist data row line (starts by zero) */
 	int		last_data_row;			/* last line of data row */
 	int		footer_row;				/* nrow of first footer row or -1 */
@@ -171,10 +285,15 @@ typedef struct
 	int		searchterm_char_size;	/* size of searchterm in chars */
 	int		searchterm_size;		/* size of searchterm in bytes */
 	bool	has_upperchr;			/* true, when search term has upper char */
+	Regexp *searchregexp;			/* compiled searchterm in regex search mode */
 	bool	found;					/* true, when last search was successfull */
 	int		found_start_x;			/* x position of found pattern */
 	int		found_start_bytes;		/* bytes position of found pattern */
+	int		found_size;				/* size of found pattern in bytes */
+	int		found_char_size;		/* size of found pattern in chars */
 	int		found_row;				/* row of found pattern */
+	int		search_xmin;			/* searching is limited to display positions */
+	int		search_xmax;			/* search_xmin .. search_xmax - 1, 0 when not limited */
 	int		first_rec_title_y;		/* y of first displayed record title in expanded mode */
 	int		last_rec_title_y;		/* y of last displayed record title in expanded mode */
 	char	searchcolterm[256];		/* last searched column patterm */
@@ -215,24 +334,6 @@ typedef struct
 #define		w_rownum_luc(scrdesc)	((scrdesc)->wins[WINDOW_ROWNUM_LUC])
 #define		w_vscrollbar(scrdesc)	((scrdesc)->wins[WINDOW_VSCROLLBAR])
 
-/*
- * Used for storing not yet formatted data
- */
-typedef struct
-{
-	int		nfields;
-	char   *fields[];
-} RowType;
-
-typedef struct _rowBucketType
-{
-	int			nrows;
-	RowType	   *rows[1000];
-	bool		multilines[1000];
-	bool		allocated;
-	struct _rowBucketType *next_bucket;
-} RowBucketType;
-
 /*
  * Used for formatting
  */
@@ -242,11 +343,65 @@ typedef struct
 	int		nfields_all;
 	bool	has_header;
 	char	types[1024];			/* a or d .. content in column */
+	ColumnType coltypes[1024];		/* type of column when it is known */
 	int		widths[1024];			/* column's display width */
 	bool	multilines[1024];		/* true if column has multiline row */
 	int		columns_map[1024];		/* column numbers - used when some column is hidden */
 } PrintDataDesc;
 
+/*
+ * Values of one column. The values are stored in one zero terminated
+ * strings blob. Missing values (short rows) are marked in null bitmap.
+ */
+typedef struct
+{
+	char	   *data;					/* blob of values */
+	uint32_t	size;					/* used bytes of blob */
+	uint32_t	allocated;				/* allocated bytes of blob */
+	uint32_t   *offsets;				/* start of value in blob */
+	unsigned char *nulls;				/* bitmap of missing values or NULL */
+} ColumnData;
+
+/*
+ * Holds not formatted values of csv, tsv or query result. Visible columns
+ * are stored only. The full line buffers of single line rows releases
+ * formatted data, and the data are rendered from column store again,
+ * when they are loaded.
+ */
+struct ColumnStore
+{
+	int			ncolumns;
+	int			nrows;
+	int			allocated_rows;
+	ColumnData *columns;
+	int			first_lineno;			/* first formatted line of first row */
+	int		   *linenos;				/* first formatted line of row or NULL */
+	PrintDataDesc *pdesc;				/* widths and alignment used by rendering */
+	int			border;
+	char		linestyle;
+	bool		force8bit;
+};
+
+/*
+ * Displayed columns are selected and ordered by projection. The projected
+ * lines are not stored, they are rendered from lines of source data, when
+ * line buffer is loaded. The source data (and their geometry) are holded
+ * by projection, and they are returned back, when projection is removed.
+ */
+struct Projection
+{
+	int			ncolumns;
+	int		   *columns;				/* source column of displayed column */
+	int		   *bounds;					/* display positions of parts of source line */
+	int		   *offsets;				/* byte offsets of bounds (work memory) */
+	int		   *xpos;					/* display positions of bounds (work memory) */
+	int			nbounds;
+	int			first_table_row;		/* other lines are not projected */
+	int			last_table_row;
+	bool		force8bit;
+	DataDesc	source;
+};
+
 /*
  * holds pager state data
  */
@@ -277,13 +432,14 @@ typedef struct
 	bool	is_file;				/* true, when input is file (can be reopened) */
 	bool	is_blocking;			/* true, when input is in block mode */
 
-	struct pollfd fds[2];
+	struct pollfd fds[3];			/* terminal, input file, database connection */
 
 	const char *errstr;				/* ptr to error string */
 	int		_errno;					/* saved errno */
 
 	bool	detect_truncation;		/* true, when input source can be truncated */
 	long int last_position;			/* saved position for truncation file check */
+	bool	stream_continue;		/* true, when last table of stream is not complete */
 
 	int		inotify_fd;				/* inotify API access file descriptor */
 	int		inotify_wd;				/* inotify watched file descriptor */
@@ -291,6 +447,44 @@ typedef struct
 
 extern StateData *current_state;
 
+/*
+ * Runtime performance counters. Durations are in microseconds.
+ */
+typedef struct
+{
+	long	rows;					/* rows of displayed document */
+	size_t	bytes;					/* bytes of displayed document */
+	long long load_us;				/* duration of last load */
+	long long sort_us;				/* duration of last sort */
+	long long search_us;			/* duration of last search */
+	long long render_us;			/* duration of last draw of screen */
+	long	frames;					/* number of draws */
+	double	fps;					/* frames per second */
+	long	interval_frames;		/* frames in current fps interval */
+	long long interval_start_us;	/* start of current fps interval */
+} PerfStats;
+
+extern PerfStats perf_stats;
+
+/*
+ * Shared state of export running in background thread. The fields
+ * should be accessed under mutex.
+ */
+typedef struct
+{
+	pthread_mutex_t mutex;
+	int		processed_rows;			/* number of already processed lines */
+	int		total_rows;				/* number of all lines */
+	bool	cancel_requested;		/* set by UI thread */
+	bool	canceled;				/* export was not finished */
+	bool	finished;				/* export thread is done */
+} ExportProgress;
+
+/*
+ * Writer of Apache Arrow file (opaque)
+ */
+typedef struct ArrowWriter ArrowWriter;
+
 typedef struct
 {
 	LineBuffer	   *start_lb;
@@ -315,6 +509,13 @@ typedef struct
 	int				lb_rowno;
 } SimpleLineBufferIter;
 
+/*
+ * Processing of one line buffer by parallel worker. When peek_only
+ * is true, then the line buffer should not be loaded, and false is
+ * returned, when the line buffer cannot be processed without loading.
+ */
+typedef bool (*LineBufferWorkerFunc) (void *worker, LineBuffer *lb, bool peek_only);
+
 typedef struct
 {
 	int		len;
@@ -329,7 +530,7 @@ void exit_ncurses(void);
 extern void window_fill(int window_identifier, int srcy, int srcx, int cursor_row, int vcursor_xmin, int vcursor_xmax,
 	int selected_xmin, int selected_xmax, DataDesc *desc, ScrDesc *scrdesc, Options *opts);
 extern void draw_data(Options *opts, ScrDesc *scrdesc, DataDesc *desc, int first_data_row, int first_row, int cursor_col, int footer_cursor_col, int fix_rows_offset);
-extern LineInfo *set_line_info(Options *opts, ScrDesc *scrdesc, LineBufferMark *lbm, char *rowstr);
+extern LineInfo *set_line_info(Options *opts, ScrDesc *scrdesc, DataDesc *desc, LineBufferMark *lbm, char *rowstr, int rowsize);
 
 #define PSPG_ERRSTR_BUFFER_SIZE		2048
 extern char pspg_errstr_buffer[PSPG_ERRSTR_BUFFER_SIZE];
@@ -340,7 +541,7 @@ extern const char *nstrstr(const char *haystack, const char *needle);
 extern const char *nstrstr_ignore_lower_case(const char *haystack, const char *needle);
 extern bool nstreq(const char *str1, const char *str2);
 
-extern const char *pspg_search(Options *opts, ScrDesc *scrdesc, const char *str);
+extern const char *pspg_search(Options *opts, ScrDesc *scrdesc, DataDesc *desc, LineBufferMark *lbm, const char *line, int line_size, const char *str, int *size);
 
 /* from menu.c */
 extern void init_menu_config(Options *opts);
@@ -350,15 +551,41 @@ extern void post_menu(Options *opts, struct ST_MENU *current_menu);
 extern void refresh_clipboard_options(Options *opts, struct ST_MENU *menu);
 extern void refresh_copy_target_options(Options *opts, struct ST_MENU *menu);
 
+/* from coltypes.c */
+extern ColumnType parse_typed_value(const char *str, int size, double *d);
+extern ColumnType merge_column_types(ColumnType t1, ColumnType t2);
+extern bool timestamp_has_time_zone(const char *str, int size);
+extern int number_scale(const char *str, int size);
+
 /* from sort.c */
 extern void sort_column_num(SortData *sortbuf, int rows, bool desc);
 extern void sort_column_text(SortData *sortbuf, int rows, bool desc);
 
 /* from pretty-csv.c */
 extern bool read_and_format(Options *opts, DataDesc *desc, StateData *state);
+extern void format_rows(Options *opts, DataDesc *desc, RowBucketType *rb, ColumnType *coltypes, int nfields);
+extern void free_rowbuckets(RowBucketType *rb);
+extern void render_colstore_rows(ColumnStore *cs, int rowno, int nrows, char *dest, size_t size);
+
+/* from colstore.c */
+extern ColumnStore *cs_create(int ncolumns);
+extern void cs_append_row(ColumnStore *cs, RowType *row, int *columns_map, int lineno);
+extern void cs_freeze(ColumnStore *cs);
+extern int cs_find_row(ColumnStore *cs, int lineno);
+extern const char *cs_get_value(ColumnStore *cs, int rowno, int colno, int *size);
+extern void cs_free(ColumnStore *cs);
 
 /* from pgclient.c */
 extern bool pg_exec_query(Options *opts, char *query, RowBucketType *rb, PrintDataDesc *pdesc, const char **err);
+extern bool pg_send_query(Options *opts, char *query, const char **err);
+extern bool pg_fetch_result(Options *opts, const char **err);
+extern bool pg_history_move(int step);
+extern void pg_history_info(int *pos, int *count);
+extern int pg_socket(void);
+extern bool pg_consume_input(void);
+extern long pg_query_time(void);
+extern void pg_cancel_query(void);
+extern void pg_finish(void);
 
 /* from args.c */
 extern char **buildargv(const char *input, int *argc, char *appname);
@@ -394,6 +621,67 @@ extern bool translate_headline(Options *opts, DataDesc *desc);
 extern void multilines_detection(Options *opts, DataDesc *desc);
 
 extern void update_order_map(Options *opts, ScrDesc *scrdesc, DataDesc *desc, int sbcn, bool desc_sort);
+extern ColumnValues *get_column_values(Options *opts, DataDesc *desc, int colno);
+extern void free_column_values(DataDesc *desc);
+extern const char *get_field_value(DataDesc *desc, const char *line, int lineno, int colno, int *size);
+extern const char *get_line_range(const char *str, int x, int xmin, int xmax, bool force8bit, int *size);
+
+/* from filter.c */
+extern RowFilter *compile_row_filter(Options *opts, DataDesc *desc, const char *str);
+extern void free_row_filter(RowFilter *rf);
+extern int set_row_filter(Options *opts, DataDesc *desc, RowFilter *rf);
+extern void enable_row_filter(DataDesc *desc);
+extern void disable_row_filter(DataDesc *desc);
+extern int get_unfiltered_last_data_row(DataDesc *desc);
+extern bool is_filtered_row(DataDesc *desc, int lineno);
+
+/* from projection.c */
+extern bool set_projection(Options *opts, DataDesc *desc, int *columns, int ncolumns);
+extern void free_projection(DataDesc *desc);
+extern int *get_projection(DataDesc *desc, int *ncolumns);
+extern int *parse_projection(DataDesc *desc, const char *str, int *ncolumns);
+extern void format_projection(DataDesc *desc, char *buffer, int size);
+extern int get_source_column(DataDesc *desc, int colno);
+extern int parse_column(DataDesc *desc, const char *str, const char **next);
+extern int project_line(Projection *pr, const char *str, int size, int lineno, char *dest);
+extern int project_line_max_size(Projection *pr, int size);
+
+/* from aggregate.c */
+extern bool group_by_column(Options *opts, DataDesc *desc, int colno, int aggcolno, DataDesc *result);
+extern void get_column_name(DataDesc *desc, int colno, char *buffer, int size);
+extern void format_number(double d, int scale, char *buffer, int size);
+
+/* from sketch.c */
+extern ColumnSketch *create_column_sketch(Options *opts, DataDesc *desc, int colno);
+extern void free_column_sketch(ColumnSketch *sk);
+extern int get_sketch_column(ColumnSketch *sk);
+extern bool sketch_rows(ColumnSketch *sk, DataDesc *desc, int nrows);
+extern void sketch_draw_overlay(ColumnSketch *sk, DataDesc *desc, WINDOW *win, Theme *t);
+
+/* from regexp.c */
+extern Regexp *regexp_compile(const char *pattern, bool icase, bool force8bit);
+extern const char *regexp_search(Regexp *re, const char *str, int size, int offset, int *match_size);
+extern void regexp_free(Regexp *re);
+
+/* from compress.c */
+extern int lz_compress_bound(int size);
+extern int lz_compress(const char *src, int size, char *dest, int dest_size);
+extern int lz_decompress(const char *src, int size, char *dest, int dest_size);
+
+/* from arrow.c */
+extern ArrowWriter *arrow_writer_create(FILE *fp, int columns, ColumnType *types, bool *utc);
+extern void arrow_set_column_name(ArrowWriter *aw, int colno, const char *name, int size);
+extern void arrow_add_value(ArrowWriter *aw, int colno, const char *str, int size, bool isnull);
+extern bool arrow_end_row(ArrowWriter *aw);
+extern bool arrow_writer_finish(ArrowWriter *aw);
+extern void arrow_writer_free(ArrowWriter *aw);
+
+/* from stats.c */
+extern long long stats_time_us(void);
+extern void stats_set_data(DataDesc *desc);
+extern void stats_frame_done(long long render_us);
+extern void stats_draw_overlay(WINDOW *win, Theme *t);
+extern void stats_write_file(const char *pathname, bool force);
 
 /* from string.c */
 extern const char *nstrstr(const char *haystack, const char *needle);
@@ -401,13 +689,16 @@ extern const char *nstrstr_ignore_lower_case(const char *haystack, const char *n
 extern bool nstreq(const char *str1, const char *str2);
 extern const char *nstrstr_with_sizes(const char *haystack, const int haystack_size,
 				   const char *needle, int needle_size);
+extern const char *strstr_with_sizes(const char *haystack, int haystack_size,
+				   const char *needle, int needle_size);
 
 /* from export.c */
 extern bool export_data(Options *opts, ScrDesc *scrdesc, DataDesc *desc,
 						int cursor_row, int cursor_column,
 						FILE *fp,
 						int rows, double percent, char *table_name,
-						PspgCommand cmd, ClipboardFormat format);
+						PspgCommand cmd, ClipboardFormat format,
+						ExportProgress *progress);
 
 /* from linebuffer.c */
 extern void init_lbi(LineBufferIter *lbi, LineBuffer *lb, MappedLine *order_map, int order_map_items, int init_pos);
@@ -415,18 +706,45 @@ extern void init_lbi_ddesc(LineBufferIter *lbi, DataDesc *desc, int init_pos);
 extern bool lbi_set_lineno(LineBufferIter *lbi, int pos);
 extern void lbi_set_mark(LineBufferIter *lbi, LineBufferMark *lbm);
 extern bool lbi_set_mark_next(LineBufferIter *lbi, LineBufferMark *lbm);
-extern bool lbm_get_line(LineBufferMark *lbm, char **line, LineInfo **linfo, int *lineno);
-extern bool lbi_get_line(LineBufferIter *lbi, char **line, LineInfo **linfo, int *lineno);
-extern bool lbi_get_line_prev(LineBufferIter *lbi, char **line, LineInfo **linfo, int *lineno);
-extern bool lbi_get_line_next(LineBufferIter *lbi, char **line, LineInfo **linfo, int *lineno);
+extern bool lbi_set_mark_prev(LineBufferIter *lbi, LineBufferMark *lbm);
+extern bool lbm_get_line(LineBufferMark *lbm, char **line, int *size, LineInfo **linfo, int *lineno);
+extern bool lbi_get_line(LineBufferIter *lbi, char **line, int *size, LineInfo **linfo, int *lineno);
+extern bool lbi_get_line_prev(LineBufferIter *lbi, char **line, int *size, LineInfo **linfo, int *lineno);
+extern bool lbi_get_line_next(LineBufferIter *lbi, char **line, int *size, LineInfo **linfo, int *lineno);
 extern bool lbi_prev(LineBufferIter *lbi);
 extern bool lbi_next(LineBufferIter *lbi);
 extern SimpleLineBufferIter *init_slbi_ddesc(SimpleLineBufferIter *slbi, DataDesc *desc);
-extern SimpleLineBufferIter *slbi_get_line_next(SimpleLineBufferIter *slbi, char **line, LineInfo **linfo);
+extern SimpleLineBufferIter *slbi_get_line_next(SimpleLineBufferIter *slbi, char **line, int *size, LineInfo **linfo);
 extern bool ddesc_set_mark(LineBufferMark *lbm, DataDesc *desc, int pos);
+extern int ddesc_get_position(DataDesc *desc, LineBufferMark *lbm);
+extern void ddesc_reset_positions(DataDesc *desc);
+extern bool lb_is_bookmark(LineBuffer *lb, int rowno);
+extern bool ddesc_toggle_bookmark(DataDesc *desc, int pos);
+extern void ddesc_flush_bookmarks(DataDesc *desc);
+extern int *ddesc_get_bookmark_positions(DataDesc *desc, int *npositions);
+extern int ddesc_next_bookmark(DataDesc *desc, int pos);
+extern int ddesc_prev_bookmark(DataDesc *desc, int pos);
 extern void lbm_xor_mask(LineBufferMark *lbm, char mask);
+extern int lbm_get_line_width(LineBufferMark *lbm, bool force8bit);
+extern bool lb_is_ascii_row(LineBuffer *lb, int rowno, bool force8bit, bool compute);
+extern void lbm_set_line_size(LineBufferMark *lbm, int size);
+extern int lbm_get_xpos_offset(LineBufferMark *lbm, DataDesc *desc, int xpos, bool force8bit, int *charpos);
+extern LineBuffer *lb_append_line(LineBuffer *lb, const char *str, int size, int width);
+extern char *lb_get_row(LineBuffer *lb, int rowno, int *size);
+extern char *lb_peek_row(LineBuffer *lb, int rowno);
+extern bool lb_is_continual_row(LineBuffer *lb, int rowno);
+
+extern size_t lb_compress_threshold;
+extern size_t lb_memory_limit;
 extern void lb_free(DataDesc *desc);
+extern size_t lb_evict_rows(DataDesc *desc, int nheader);
+extern void lb_set_colstore(LineBuffer *lb, ColumnStore *cs, int rowno);
+extern void lb_init_projection(LineBuffer *first, LineBuffer *source, Projection *pr);
+extern void lb_move_rows(LineBuffer *dest, LineBuffer *src);
+extern void lb_free_rows(LineBuffer *lb);
 extern void lb_print_all_ddesc(DataDesc *desc, FILE *f);
+extern int lb_get_parallel_workers(void);
+extern void lb_process_parallel(DataDesc *desc, LineBufferWorkerFunc func, void **workers, int nworkers);
 
 /*
  * REMOVE THIS COMMENT FOR DEBUG OUTPUT
@@ -0,0 +1,1216 @@
+/*-------------------------------------------------------------------------
+ *
+ * regexp.c
+ *	  regular expressions for searching (without backtracking)
+ *
+ * Portions Copyright (c) 2017-2021 Pavel Stehule
+ *
+ * IDENTIFICATION
+ *	  src/regexp.c
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+#include <wctype.h>
+
+#include "pspg.h"
+#include "unicode.h"
+
+/*
+ * The pattern is compiled to program of NFA (Thompson's construction).
+ * The program is executed by lazy built DFA (the states are created
+ * when they are used first time), that is used for fast test if the
+ * string contains pattern, and by Pike VM, that returns position of
+ * leftmost longest match. Both methods are linear with length of
+ * string, there is not any backtracking.
+ *
+ * Supported syntax: literals, ".", [...], [^...], \d \w \s \D \W \S,
+ * ^, $, (...), |, *, +, ?, {m}, {m,}, {m,n}. Back references are not
+ * supported (they cannot be evaluated in linear time).
+ */
+
+#define RX_MAX_INSTRUCTIONS		10000
+#define RX_MAX_DFA_STATES		2048
+#define RX_HASH_SIZE			4096
+#define RX_MAX_REPEAT			1000
+
+typedef enum
+{
+	RX_CHAR,
+	RX_ANY,
+	RX_CLASS,
+	RX_SPLIT,
+	RX_JMP,
+	RX_BOL,
+	RX_EOL,
+	RX_MATCH
+} RxOpcode;
+
+typedef struct
+{
+	RxOpcode	op;
+	int			c;						/* char or index of class */
+	int			x;						/* jump targets */
+	int			y;
+} RxInst;
+
+typedef struct
+{
+	int			nranges;
+	int		   *ranges;					/* pairs of low, high chars */
+	bool		negate;
+} RxClass;
+
+typedef enum
+{
+	RX_NODE_EMPTY,
+	RX_NODE_CHAR,
+	RX_NODE_ANY,
+	RX_NODE_CLASS,
+	RX_NODE_BOL,
+	RX_NODE_EOL,
+	RX_NODE_CAT,
+	RX_NODE_ALT,
+	RX_NODE_REPEAT
+} RxNodeType;
+
+typedef struct RxNode
+{
+	RxNodeType	type;
+	int			c;
+	int			min;
+	int			max;					/* -1 is unlimited */
+	struct RxNode *left;
+	struct RxNode *right;
+} RxNode;
+
+typedef struct DfaState
+{
+	int		   *pcs;					/* sorted NFA states */
+	int			npcs;
+	bool		match;					/* match without end of string */
+	bool		match_eol;				/* match on end of string */
+	struct DfaState *next[256];
+	struct DfaState *hash_next;
+} DfaState;
+
+typedef struct
+{
+	int			pc;
+	int			start;
+} RxThread;
+
+struct Regexp
+{
+	RxInst	   *insts;
+	int			ninsts;
+	RxClass    *classes;
+	int			nclasses;
+	bool		icase;
+	bool		force8bit;
+
+	/* DFA cache */
+	DfaState   *hash[RX_HASH_SIZE];
+	int			nstates;
+	DfaState   *start_bol;				/* initial state on start of string */
+	DfaState   *start;					/* initial state inside string */
+
+	/* work space */
+	int		   *marks;
+	int			mark_gen;
+	int		   *pcs;
+	RxThread   *clist;
+	RxThread   *nlist;
+};
+
+typedef struct
+{
+	const char *ptr;
+	Regexp	   *re;
+	const char *errmsg;
+} RxParser;
+
+static RxNode *parse_alt(RxParser *parser);
+
+static RxNode *
+make_node(RxNodeType type, RxNode *left, RxNode *right)
+{
+	RxNode	   *node = smalloc(sizeof(RxNode));
+
+	node->type = type;
+	node->left = left;
+	node->right = right;
+
+	return node;
+}
+
+static void
+free_node(RxNode *node)
+{
+	if (!node)
+		return;
+
+	free_node(node->left);
+	free_node(node->right);
+	free(node);
+}
+
+/*
+ * Returns char (code point) and moves pointer after this char.
+ * Broken UTF8 sequence is processed like one byte char.
+ */
+static int
+next_char(const char **str, const char *end, bool force8bit)
+{
+	const unsigned char *s = (const unsigned char *) *str;
+	int			len;
+	int			c;
+	int			i;
+
+	if (force8bit || *s < 0x80)
+	{
+		*str += 1;
+		return *s;
+	}
+
+	len = utf8charlen(*s);
+	if (len < 2 || len > 4 || (const char *) s + len > end)
+	{
+		*str += 1;
+		return *s;
+	}
+
+	c = *s & (0xff >> (len + 1));
+
+	for (i = 1; i < len; i++)
+	{
+		if ((s[i] & 0xc0) != 0x80)
+		{
+			*str += 1;
+			return *s;
+		}
+
+		c = (c << 6) | (s[i] & 0x3f);
+	}
+
+	*str += len;
+
+	return c;
+}
+
+static int
+fold_char(int c, bool force8bit)
+{
+	if (c < 0x80 || force8bit)
+		return tolower(c);
+
+	return (int) towlower((wint_t) c);
+}
+
+static int
+add_class(Regexp *re, RxClass *cls)
+{
+	re->classes = srealloc(re->classes, (re->nclasses + 1) * sizeof(RxClass));
+	re->classes[re->nclasses] = *cls;
+
+	return re->nclasses++;
+}
+
+static void
+add_range(RxClass *cls, int low, int high)
+{
+	cls->ranges = srealloc(cls->ranges, (cls->nranges + 1) * 2 * sizeof(int));
+	cls->ranges[cls->nranges * 2] = low;
+	cls->ranges[cls->nranges * 2 + 1] = high;
+	cls->nranges += 1;
+}
+
+/*
+ * Add ranges of \d, \w or \s. Returns false, when the char is
+ * not class shortcut.
+ */
+static bool
+add_shortcut_class(RxClass *cls, int c)
+{
+	switch (tolower(c))
+	{
+		case 'd':
+			add_range(cls, '0', '9');
+			return true;
+		case 'w':
+			add_range(cls, '0', '9');
+			add_range(cls, 'A', 'Z');
+			add_range(cls, 'a', 'z');
+			add_range(cls, '_', '_');
+			return true;
+		case 's':
+			add_range(cls, ' ', ' ');
+			add_range(cls, '\t', '\r');
+			return true;
+	}
+
+	return false;
+}
+
+static int
+escaped_char(int c)
+{
+	switch (c)
+	{
+		case 't':
+			return '\t';
+		case 'n':
+			return '\n';
+		case 'r':
+			return '\r';
+		case 'f':
+			return '\f';
+		case 'v':
+			return '\v';
+	}
+
+	return c;
+}
+
+static RxNode *
+parse_class(RxParser *parser)
+{
+	const char *end = parser->ptr + strlen(parser->ptr);
+	bool		force8bit = parser->re->force8bit;
+	RxClass		cls;
+	RxNode	   *node;
+	bool		first = true;
+
+	memset(&cls, 0, sizeof(RxClass));
+
+	if (*parser->ptr == '^')
+	{
+		cls.negate = true;
+		parser->ptr++;
+	}
+
+	/* "]" on first position is a char */
+	while (*parser->ptr && (*parser->ptr != ']' || first))
+	{
+		int			low;
+		int			high;
+
+		first = false;
+
+		if (*parser->ptr == '\\')
+		{
+			parser->ptr++;
+			if (!*parser->ptr)
+				break;
+
+			if (strchr("dws", *parser->ptr))
+			{
+				(void) add_shortcut_class(&cls, *parser->ptr++);
+				continue;
+			}
+
+			low = escaped_char(next_char(&parser->ptr, end, force8bit));
+		}
+		else
+			low = next_char(&parser->ptr, end, force8bit);
+
+		high = low;
+
+		if (parser->ptr[0] == '-' && parser->ptr[1] && parser->ptr[1] != ']')
+		{
+			parser->ptr++;
+
+			if (*parser->ptr == '\\')
+			{
+				parser->ptr++;
+				high = escaped_char(next_char(&parser->ptr, end, force8bit));
+			}
+			else
+				high = next_char(&parser->ptr, end, force8bit);
+
+			if (high < low)
+			{
+				free(cls.ranges);
+				parser->errmsg = "invalid range in brackets";
+				return NULL;
+			}
+		}
+
+		add_range(&cls, low, high);
+	}
+
+	if (*parser->ptr != ']')
+	{
+		free(cls.ranges);
+		parser->errmsg = "brackets [] not balanced";
+		return NULL;
+	}
+
+	parser->ptr++;
+
+	node = make_node(RX_NODE_CLASS, NULL, NULL);
+	node->c = add_class(parser->re, &cls);
+
+	return node;
+}
+
+static RxNode *
+parse_atom(RxParser *parser)
+{
+	const char *end = parser->ptr + strlen(parser->ptr);
+	RxNode	   *node;
+	int			c = *parser->ptr;
+
+	switch (c)
+	{
+		case '(':
+			parser->ptr++;
+
+			/* ignore non capturing group mark */
+			if (parser->ptr[0] == '?' && parser->ptr[1] == ':')
+				parser->ptr += 2;
+
+			node = parse_alt(parser);
+			if (!node)
+				return NULL;
+
+			if (*parser->ptr != ')')
+			{
+				free_node(node);
+				parser->errmsg = "parentheses () not balanced";
+				return NULL;
+			}
+
+			parser->ptr++;
+
+			return node;
+
+		case '[':
+			parser->ptr++;
+			return parse_class(parser);
+
+		case '.':
+			parser->ptr++;
+			return make_node(RX_NODE_ANY, NULL, NULL);
+
+		case '^':
+			parser->ptr++;
+			return make_node(RX_NODE_BOL, NULL, NULL);
+
+		case '$':
+			parser->ptr++;
+			return make_node(RX_NODE_EOL, NULL, NULL);
+
+		case '*':
+		case '+':
+		case '?':
+		case '{':
+			parser->errmsg = "quantifier operand invalid";
+			return NULL;
+
+		case '\\':
+			parser->ptr++;
+			if (!*parser->ptr)
+			{
+				parser->errmsg = "trailing backslash";
+				return NULL;
+			}
+
+			if (strchr("dwsDWS", *parser->ptr))
+			{
+				RxClass		cls;
+
+				memset(&cls, 0, sizeof(RxClass));
+				(void) add_shortcut_class(&cls, *parser->ptr);
+				cls.negate = isupper((unsigned char) *parser->ptr);
+				parser->ptr++;
+
+				node = make_node(RX_NODE_CLASS, NULL, NULL);
+				node->c = add_class(parser->re, &cls);
+
+				return node;
+			}
+
+			if (isdigit((unsigned char) *parser->ptr))
+			{
+				parser->errmsg = "back references are not supported";
+				return NULL;
+			}
+
+			node = make_node(RX_NODE_CHAR, NULL, NULL);
+			node->c = escaped_char(next_char(&parser->ptr, end, parser->re->force8bit));
+			break;
+
+		default:
+			node = make_node(RX_NODE_CHAR, NULL, NULL);
+			node->c = next_char(&parser->ptr, end, parser->re->force8bit);
+			break;
+	}
+
+	if (parser->re->icase)
+		node->c = fold_char(node->c, parser->re->force8bit);
+
+	return node;
+}
+
+/*
+ * Read number of {m,n} quantifier
+ */
+static bool
+parse_bound(RxParser *parser, int *value)
+{
+	if (!isdigit((unsigned char) *parser->ptr))
+		return false;
+
+	*value = 0;
+
+	while (isdigit((unsigned char) *parser->ptr))
+	{
+		*value = *value * 10 + (*parser->ptr++ - '0');
+
+		if (*value > RX_MAX_REPEAT)
+			return false;
+	}
+
+	return true;
+}
+
+static RxNode *
+parse_repeat(RxParser *parser)
+{
+	RxNode	   *node = parse_atom(parser);
+
+	while (node)
+	{
+		RxNode	   *rep;
+		int			min;
+		int			max;
+
+		if (*parser->ptr == '*')
+		{
+			min = 0; max = -1;
+		}
+		else if (*parser->ptr == '+')
+		{
+			min = 1; max = -1;
+		}
+		else if (*parser->ptr == '?')
+		{
+			min = 0; max = 1;
+		}
+		else if (*parser->ptr == '{')
+		{
+			parser->ptr++;
+
+			if (!parse_bound(parser, &min))
+				goto invalid_bound;
+
+			max = min;
+
+			if (*parser->ptr == ',')
+			{
+				parser->ptr++;
+
+				if (*parser->ptr == '}')
+					max = -1;
+				else if (!parse_bound(parser, &max) || max < min)
+					goto invalid_bound;
+			}
+
+			if (*parser->ptr != '}')
+				goto invalid_bound;
+		}
+		else
+			break;
+
+		parser->ptr++;
+
+		/* the result is same for lazy quantifiers (leftmost longest is used) */
+		if (*parser->ptr == '?')
+			parser->ptr++;
+
+		rep = make_node(RX_NODE_REPEAT, node, NULL);
+		rep->min = min;
+		rep->max = max;
+		node = rep;
+	}
+
+	return node;
+
+invalid_bound:
+
+	free_node(node);
+	parser->errmsg = "invalid repetition count(s)";
+
+	return NULL;
+}
+
+static RxNode *
+parse_cat(RxParser *parser)
+{
+	RxNode	   *node = NULL;
+
+	while (*parser->ptr && *parser->ptr != '|' && *parser->ptr != ')')
+	{
+		RxNode	   *atom = parse_repeat(parser);
+
+		if (!atom)
+		{
+			free_node(node);
+			return NULL;
+		}
+
+		node = node ? make_node(RX_NODE_CAT, node, atom) : atom;
+	}
+
+	return node ? node : make_node(RX_NODE_EMPTY, NULL, NULL);
+}
+
+static RxNode *
+parse_alt(RxParser *parser)
+{
+	RxNode	   *node = parse_cat(parser);
+
+	while (node && *parser->ptr == '|')
+	{
+		RxNode	   *right;
+
+		parser->ptr++;
+
+		right = parse_cat(parser);
+		if (!right)
+		{
+			free_node(node);
+			return NULL;
+		}
+
+		node = make_node(RX_NODE_ALT, node, right);
+	}
+
+	return node;
+}
+
+static int
+emit(Regexp *re, RxOpcode op, int c, int x, int y)
+{
+	if (re->ninsts >= RX_MAX_INSTRUCTIONS)
+		return -1;
+
+	re->insts[re->ninsts].op = op;
+	re->insts[re->ninsts].c = c;
+	re->insts[re->ninsts].x = x;
+	re->insts[re->ninsts].y = y;
+
+	return re->ninsts++;
+}
+
+/*
+ * Generate NFA program. Returns false when the program is too long.
+ */
+static bool
+compile_node(Regexp *re, RxNode *node)
+{
+	int			pc1, pc2;
+	int			i;
+
+	switch (node->type)
+	{
+		case RX_NODE_EMPTY:
+			return true;
+
+		case RX_NODE_CHAR:
+			return emit(re, RX_CHAR, node->c, 0, 0) != -1;
+
+		case RX_NODE_ANY:
+			return emit(re, RX_ANY, 0, 0, 0) != -1;
+
+		case RX_NODE_CLASS:
+			return emit(re, RX_CLASS, node->c, 0, 0) != -1;
+
+		case RX_NODE_BOL:
+			return emit(re, RX_BOL, 0, 0, 0) != -1;
+
+		case RX_NODE_EOL:
+			return emit(re, RX_EOL, 0, 0, 0) != -1;
+
+		case RX_NODE_CAT:
+			return compile_node(re, node->left) && compile_node(re, node->right);
+
+		case RX_NODE_ALT:
+			/* split L1, L2; L1: left; jmp L3; L2: right; L3: */
+			if ((pc1 = emit(re, RX_SPLIT, 0, 0, 0)) == -1)
+				return false;
+
+			re->insts[pc1].x = re->ninsts;
+
+			if (!compile_node(re, node->left) ||
+				(pc2 = emit(re, RX_JMP, 0, 0, 0)) == -1)
+				return false;
+
+			re->insts[pc1].y = re->ninsts;
+
+			if (!compile_node(re, node->right))
+				return false;
+
+			re->insts[pc2].x = re->ninsts;
+
+			return true;
+
+		case RX_NODE_REPEAT:
+			for (i = 0; i < node->min; i++)
+				if (!compile_node(re, node->left))
+					return false;
+
+			if (node->max == -1)
+			{
+				/* L1: split L2, L3; L2: expr; jmp L1; L3: */
+				if ((pc1 = emit(re, RX_SPLIT, 0, 0, 0)) == -1)
+					return false;
+
+				re->insts[pc1].x = re->ninsts;
+
+				if (!compile_node(re, node->left) ||
+					emit(re, RX_JMP, 0, pc1, 0) == -1)
+					return false;
+
+				re->insts[pc1].y = re->ninsts;
+
+				return true;
+			}
+
+			/* optional repeating: split L1, L2; L1: expr; L2: */
+			for (i = node->min; i < node->max; i++)
+			{
+				if ((pc1 = emit(re, RX_SPLIT, 0, 0, 0)) == -1)
+					return false;
+
+				re->insts[pc1].x = re->ninsts;
+
+				if (!compile_node(re, node->left))
+					return false;
+
+				re->insts[pc1].y = re->ninsts;
+			}
+
+			return true;
+	}
+
+	return false;
+}
+
+/*
+ * Compile pattern. Returns NULL, when pattern is not valid. Error
+ * message is available by current_state->errstr.
+ */
+Regexp *
+regexp_compile(const char *pattern, bool icase, bool force8bit)
+{
+	Regexp	   *re = smalloc(sizeof(Regexp));
+	RxParser	parser;
+	RxNode	   *root;
+
+	re->icase = icase;
+	re->force8bit = force8bit;
+
+	parser.ptr = pattern;
+	parser.re = re;
+	parser.errmsg = NULL;
+
+	root = parse_alt(&parser);
+	if (root && *parser.ptr)
+	{
+		/* unbalanced ")" */
+		free_node(root);
+		root = NULL;
+		parser.errmsg = "parentheses () not balanced";
+	}
+
+	if (!root)
+	{
+		format_error("%s", parser.errmsg);
+		regexp_free(re);
+
+		return NULL;
+	}
+
+	re->insts = smalloc(RX_MAX_INSTRUCTIONS * sizeof(RxInst));
+
+	if (!compile_node(re, root) || emit(re, RX_MATCH, 0, 0, 0) == -1)
+	{
+		format_error("regular expression is too complex");
+		free_node(root);
+		regexp_free(re);
+
+		return NULL;
+	}
+
+	free_node(root);
+
+	re->insts = srealloc(re->insts, re->ninsts * sizeof(RxInst));
+	re->marks = smalloc(re->ninsts * sizeof(int));
+	re->pcs = smalloc(re->ninsts * sizeof(int));
+	re->clist = smalloc(re->ninsts * sizeof(RxThread));
+	re->nlist = smalloc(re->ninsts * sizeof(RxThread));
+
+	return re;
+}
+
+static void
+free_dfa_states(Regexp *re)
+{
+	int			i;
+
+	for (i = 0; i < RX_HASH_SIZE; i++)
+	{
+		DfaState   *state = re->hash[i];
+
+		while (state)
+		{
+			DfaState   *next = state->hash_next;
+
+			free(state->pcs);
+			free(state);
+			state = next;
+		}
+
+		re->hash[i] = NULL;
+	}
+
+	re->nstates = 0;
+	re->start_bol = NULL;
+	re->start = NULL;
+}
+
+void
+regexp_free(Regexp *re)
+{
+	int			i;
+
+	if (!re)
+		return;
+
+	free_dfa_states(re);
+
+	for (i = 0; i < re->nclasses; i++)
+		free(re->classes[i].ranges);
+
+	free(re->classes);
+	free(re->insts);
+	free(re->marks);
+	free(re->pcs);
+	free(re->clist);
+	free(re->nlist);
+	free(re);
+}
+
+static bool
+class_contains(RxClass *cls, int c)
+{
+	int			i;
+
+	for (i = 0; i < cls->nranges; i++)
+		if (c >= cls->ranges[i * 2] && c <= cls->ranges[i * 2 + 1])
+			return true;
+
+	return false;
+}
+
+/*
+ * Returns true, when the instruction consumes char c
+ */
+static bool
+inst_accepts(Regexp *re, RxInst *inst, int c)
+{
+	switch (inst->op)
+	{
+		case RX_CHAR:
+			return inst->c == (re->icase ? fold_char(c, re->force8bit) : c);
+
+		case RX_ANY:
+			return true;
+
+		case RX_CLASS:
+			{
+				RxClass    *cls = &re->classes[inst->c];
+				bool		result = class_contains(cls, c);
+
+				if (!result && re->icase)
+				{
+					if (c < 0x80 || re->force8bit)
+						result = class_contains(cls, tolower(c)) ||
+								 class_contains(cls, toupper(c));
+					else
+						result = class_contains(cls, (int) towlower((wint_t) c)) ||
+								 class_contains(cls, (int) towupper((wint_t) c));
+				}
+
+				return result != cls->negate;
+			}
+
+		default:
+			return false;
+	}
+}
+
+/*
+ * Add NFA state and all states accessible by epsilon transitions to
+ * the set of states used by DFA. The assertion "$" is holded in the
+ * set, and it is evaluated on end of string.
+ */
+static void
+add_dfa_pc(Regexp *re, int *pcs, int *npcs, int pc, bool at_bol, bool at_eol)
+{
+	RxInst	   *inst;
+
+	if (re->marks[pc] == re->mark_gen)
+		return;
+
+	re->marks[pc] = re->mark_gen;
+	inst = &re->insts[pc];
+
+	switch (inst->op)
+	{
+		case RX_JMP:
+			add_dfa_pc(re, pcs, npcs, inst->x, at_bol, at_eol);
+			break;
+
+		case RX_SPLIT:
+			add_dfa_pc(re, pcs, npcs, inst->x, at_bol, at_eol);
+			add_dfa_pc(re, pcs, npcs, inst->y, at_bol, at_eol);
+			break;
+
+		case RX_BOL:
+			if (at_bol)
+				add_dfa_pc(re, pcs, npcs, pc + 1, at_bol, at_eol);
+			break;
+
+		case RX_EOL:
+			if (at_eol)
+				add_dfa_pc(re, pcs, npcs, pc + 1, at_bol, at_eol);
+			else
+				pcs[(*npcs)++] = pc;
+			break;
+
+		default:
+			pcs[(*npcs)++] = pc;
+			break;
+	}
+}
+
+static int
+compare_int(const void *a, const void *b)
+{
+	return *(const int *) a - *(const int *) b;
+}
+
+static unsigned int
+hash_pcs(int *pcs, int npcs)
+{
+	unsigned int h = 5381;
+	int			i;
+
+	for (i = 0; i < npcs; i++)
+		h = h * 33 + pcs[i];
+
+	return h % RX_HASH_SIZE;
+}
+
+/*
+ * Returns DFA state for the set of NFA states. When the state is not
+ * in cache, then it is created.
+ */
+static DfaState *
+get_dfa_state(Regexp *re, int *pcs, int npcs)
+{
+	DfaState   *state;
+	unsigned int h;
+	int			i;
+
+	qsort(pcs, npcs, sizeof(int), compare_int);
+
+	h = hash_pcs(pcs, npcs);
+
+	for (state = re->hash[h]; state; state = state->hash_next)
+	{
+		if (state->npcs == npcs &&
+			memcmp(state->pcs, pcs, npcs * sizeof(int)) == 0)
+			return state;
+	}
+
+	state = smalloc(sizeof(DfaState));
+	state->pcs = smalloc((npcs > 0 ? npcs : 1) * sizeof(int));
+	memcpy(state->pcs, pcs, npcs * sizeof(int));
+	state->npcs = npcs;
+
+	for (i = 0; i < npcs; i++)
+	{
+		if (re->insts[pcs[i]].op == RX_MATCH)
+			state->match = true;
+	}
+
+	/* can be matched on end of string? */
+	if (!state->match)
+	{
+		int		   *aux = smalloc(re->ninsts * sizeof(int));
+		int			naux = 0;
+
+		re->mark_gen += 1;
+
+		for (i = 0; i < npcs; i++)
+			if (re->insts[pcs[i]].op == RX_EOL)
+				add_dfa_pc(re, aux, &naux, pcs[i], false, true);
+
+		for (i = 0; i < naux; i++)
+			if (re->insts[aux[i]].op == RX_MATCH)
+				state->match_eol = true;
+
+		free(aux);
+	}
+
+	state->hash_next = re->hash[h];
+	re->hash[h] = state;
+	re->nstates += 1;
+
+	return state;
+}
+
+/*
+ * Returns next DFA state. Only transitions by ASCII chars (or by all
+ * chars in 8bit mode) are cached.
+ */
+static DfaState *
+dfa_step(Regexp *re, DfaState *state, int c)
+{
+	DfaState   *next;
+	int			npcs = 0;
+	int			i;
+
+	if (c < 256 && (c < 0x80 || re->force8bit) && state->next[c])
+		return state->next[c];
+
+	re->mark_gen += 1;
+
+	for (i = 0; i < state->npcs; i++)
+	{
+		int			pc = state->pcs[i];
+
+		if (inst_accepts(re, &re->insts[pc], c))
+			add_dfa_pc(re, re->pcs, &npcs, pc + 1, false, false);
+	}
+
+	/* pattern can start on any position */
+	add_dfa_pc(re, re->pcs, &npcs, 0, false, false);
+
+	if (re->nstates >= RX_MAX_DFA_STATES)
+	{
+		int		   *pcs = smalloc(npcs * sizeof(int) + 1);
+
+		/* the cache is full, start again with empty cache */
+		memcpy(pcs, re->pcs, npcs * sizeof(int));
+		free_dfa_states(re);
+		next = get_dfa_state(re, pcs, npcs);
+		free(pcs);
+
+		return next;
+	}
+
+	next = get_dfa_state(re, re->pcs, npcs);
+
+	if (c < 256 && (c < 0x80 || re->force8bit))
+		state->next[c] = next;
+
+	return next;
+}
+
+/*
+ * Returns true, when string contains some match of pattern.
+ */
+static bool
+dfa_match(Regexp *re, const char *str, const char *end, bool at_bol)
+{
+	DfaState   *state;
+
+	if (!re->start_bol)
+	{
+		int			npcs = 0;
+
+		re->mark_gen += 1;
+		add_dfa_pc(re, re->pcs, &npcs, 0, true, false);
+		re->start_bol = get_dfa_state(re, re->pcs, npcs);
+
+		npcs = 0;
+		re->mark_gen += 1;
+		add_dfa_pc(re, re->pcs, &npcs, 0, false, false);
+		re->start = get_dfa_state(re, re->pcs, npcs);
+	}
+
+	state = at_bol ? re->start_bol : re->start;
+
+	while (str < end)
+	{
+		int			c;
+
+		if (state->match)
+			return true;
+
+		/* fast path for cached transitions */
+		if ((unsigned char) *str < 0x80 || re->force8bit)
+		{
+			c = (unsigned char) *str++;
+
+			if (state->next[c])
+			{
+				state = state->next[c];
+				continue;
+			}
+		}
+		else
+			c = next_char(&str, end, false);
+
+		state = dfa_step(re, state, c);
+	}
+
+	return state->match || state->match_eol;
+}
+
+/*
+ * Add thread to list of threads of Pike VM. When the match is found,
+ * then match_start and match_end are updated.
+ */
+static void
+add_thread(Regexp *re, RxThread *list, int *n, int pc, int start,
+		   int pos, int size, int *match_start, int *match_end)
+{
+	RxInst	   *inst;
+
+	if (re->marks[pc] == re->mark_gen)
+		return;
+
+	re->marks[pc] = re->mark_gen;
+	inst = &re->insts[pc];
+
+	switch (inst->op)
+	{
+		case RX_JMP:
+			add_thread(re, list, n, inst->x, start, pos, size, match_start, match_end);
+			break;
+
+		case RX_SPLIT:
+			add_thread(re, list, n, inst->x, start, pos, size, match_start, match_end);
+			add_thread(re, list, n, inst->y, start, pos, size, match_start, match_end);
+			break;
+
+		case RX_BOL:
+			if (pos == 0)
+				add_thread(re, list, n, pc + 1, start, pos, size, match_start, match_end);
+			break;
+
+		case RX_EOL:
+			if (pos == size)
+				add_thread(re, list, n, pc + 1, start, pos, size, match_start, match_end);
+			break;
+
+		case RX_MATCH:
+			/* empty matches are ignored, leftmost longest match is used */
+			if (pos > start &&
+				(*match_start == -1 || start < *match_start ||
+				 (start == *match_start && pos > *match_end)))
+			{
+				*match_start = start;
+				*match_end = pos;
+			}
+			break;
+
+		default:
+			list[*n].pc = pc;
+			list[*n].start = start;
+			*n += 1;
+			break;
+	}
+}
+
+/*
+ * Pike VM. The threads are ordered by start position, so when more
+ * threads are in same NFA state, then the thread with leftmost start
+ * is used.
+ */
+static bool
+pike_search(Regexp *re, const char *str, int size, int offset,
+			int *match_start, int *match_end)
+{
+	RxThread   *clist = re->clist;
+	RxThread   *nlist = re->nlist;
+	int			nc = 0;
+	int			pos = offset;
+
+	*match_start = -1;
+	*match_end = -1;
+
+	re->mark_gen += 1;
+	add_thread(re, clist, &nc, 0, pos, pos, size, match_start, match_end);
+
+	while (pos < size && (nc > 0 || *match_start == -1))
+	{
+		const char *ptr = str + pos;
+		int			nn = 0;
+		int			c;
+		int			i;
+
+		c = next_char(&ptr, str + size, re->force8bit);
+
+		re->mark_gen += 1;
+
+		for (i = 0; i < nc; i++)
+		{
+			/* the match more on left was found already */
+			if (*match_start != -1 && clist[i].start > *match_start)
+				break;
+
+			if (inst_accepts(re, &re->insts[clist[i].pc], c))
+				add_thread(re, nlist, &nn, clist[i].pc + 1, clist[i].start,
+						   ptr - str, size, match_start, match_end);
+		}
+
+		pos = ptr - str;
+
+		/* new thread for match starting on next position */
+		if (*match_start == -1)
+			add_thread(re, nlist, &nn, 0, pos, pos, size, match_start, match_end);
+
+		clist = nlist;
+		nlist = clist == re->clist ? re->nlist : re->clist;
+		nc = nn;
+	}
+
+	return *match_start != -1;
+}
+
+/*
+ * Returns pointer to leftmost longest not empty match of pattern in
+ * string, or NULL. The search starts on offset. The "^" and "$" are
+ * related to the start and end of string. When size is negative,
+ * then the string is zero terminated.
+ */
+const char *
+regexp_search(Regexp *re, const char *str, int size, int offset, int *match_size)
+{
+	int			match_start;
+	int			match_end;
+
+	if (size < 0)
+		size = strlen(str);
+
+	/* fast test by DFA, most rows doesn't contains pattern */
+	if (!dfa_match(re, str + offset, str + size, offset == 0))
+		return NULL;
+
+	if (!pike_search(re, str, size, offset, &match_start, &match_end))
+		return NULL;
+
+	*match_size = match_end - match_start;
+
+	return str + match_start;
+}
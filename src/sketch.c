@@ -0,0 +1,677 @@
+/*-------------------------------------------------------------------------
+ *
+ * sketch.c
+ *	  approximate statistics of column calculated in one pass
+ *
+ * Portions Copyright (c) 2017-2021 Pavel Stehule
+ *
+ * IDENTIFICATION
+ *	  src/sketch.c
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pspg.h"
+#include "unicode.h"
+
+#define SKETCH_COUNTERS			64			/* counters of Space-Saving algorithm */
+#define SKETCH_TOP_VALUES		10
+#define SKETCH_COMPACTOR_SIZE	256			/* values of one level of quantile sketch */
+#define SKETCH_MAX_LEVELS		40
+#define SKETCH_HLL_BITS			12			/* 4096 registers of HyperLogLog */
+#define SKETCH_HLL_REGISTERS	(1 << SKETCH_HLL_BITS)
+#define SKETCH_VALUE_WIDTH		30
+#define SKETCH_LINES			(SKETCH_TOP_VALUES + 16)
+#define SKETCH_LINE_SIZE		256
+
+/*
+ * Counter of Space-Saving algorithm. The count is overestimated
+ * by error at most.
+ */
+typedef struct
+{
+	char	   *value;
+	int			size;
+	uint32_t	hash;
+	long		count;
+	long		error;
+} SketchCounter;
+
+typedef struct
+{
+	double		value;
+	double		weight;
+} WeightedValue;
+
+struct ColumnSketch
+{
+	int			colno;
+	char		name[64];
+	bool		force8bit;
+	long		next_pos;					/* next line (evicted lines are counted) */
+	long		nrows;						/* processed rows */
+	long		nnulls;
+	long		nskipped;					/* lines removed from stream before sampling */
+	SketchCounter counters[SKETCH_COUNTERS];
+	int			ncounters;
+	unsigned char hll[SKETCH_HLL_REGISTERS];
+	ColumnType	type;						/* common type of not null values */
+	long		nvalues;					/* values of quantile sketch */
+	double		min;
+	double		max;
+	double	   *levels[SKETCH_MAX_LEVELS];	/* value of level n has weight 2^n */
+	int			nitems[SKETCH_MAX_LEVELS];
+	uint32_t	random;
+};
+
+/*
+ * FNV-1a hash with murmur3 finalizer (HyperLogLog requires well
+ * mixed high bits).
+ */
+static uint32_t
+hash_value(const char *str, int size)
+{
+	uint32_t	hash = 2166136261u;
+
+	while (size-- > 0)
+	{
+		hash ^= (unsigned char) *str++;
+		hash *= 16777619u;
+	}
+
+	hash ^= hash >> 16;
+	hash *= 0x85ebca6bu;
+	hash ^= hash >> 13;
+	hash *= 0xc2b2ae35u;
+	hash ^= hash >> 16;
+
+	return hash;
+}
+
+/*
+ * Space-Saving: when the value has not own counter, then the counter
+ * with smallest count is reused.
+ */
+static void
+count_value(ColumnSketch *sk, const char *str, int size, uint32_t hash)
+{
+	SketchCounter *c = NULL;
+	int			i;
+
+	for (i = 0; i < sk->ncounters; i++)
+	{
+		c = &sk->counters[i];
+
+		if (c->hash == hash && c->size == size && memcmp(c->value, str, size) == 0)
+		{
+			c->count += 1;
+			return;
+		}
+	}
+
+	if (sk->ncounters < SKETCH_COUNTERS)
+	{
+		c = &sk->counters[sk->ncounters++];
+
+		c->count = 0;
+	}
+	else
+	{
+		c = &sk->counters[0];
+
+		for (i = 1; i < SKETCH_COUNTERS; i++)
+			if (sk->counters[i].count < c->count)
+				c = &sk->counters[i];
+	}
+
+	c->value = srealloc(c->value, size + 1);
+	memcpy(c->value, str, size);
+	c->value[size] = '\0';
+
+	c->size = size;
+	c->hash = hash;
+	c->error = c->count;
+	c->count += 1;
+}
+
+static void
+add_hll_hash(ColumnSketch *sk, uint32_t hash)
+{
+	uint32_t	w = hash << SKETCH_HLL_BITS;
+	int			idx = hash >> (32 - SKETCH_HLL_BITS);
+	int			rho = 1;
+
+	while (rho <= 32 - SKETCH_HLL_BITS && !(w & 0x80000000u))
+	{
+		w <<= 1;
+		rho += 1;
+	}
+
+	if (rho > sk->hll[idx])
+		sk->hll[idx] = rho;
+}
+
+static double
+get_distinct_estimate(ColumnSketch *sk)
+{
+	double		m = SKETCH_HLL_REGISTERS;
+	double		alpha = 0.7213 / (1.0 + 1.079 / m);
+	double		sum = 0.0;
+	double		estimate;
+	int			zeros = 0;
+	int			i;
+
+	for (i = 0; i < SKETCH_HLL_REGISTERS; i++)
+	{
+		sum += ldexp(1.0, -sk->hll[i]);
+		if (sk->hll[i] == 0)
+			zeros += 1;
+	}
+
+	estimate = alpha * m * m / sum;
+
+	/* linear counting is more precise for small cardinalities */
+	if (estimate <= 2.5 * m && zeros > 0)
+		estimate = m * log(m / zeros);
+
+	return estimate;
+}
+
+static int
+compare_doubles(const void *a, const void *b)
+{
+	double		d1 = *((const double *) a);
+	double		d2 = *((const double *) b);
+
+	if (d1 == d2)
+		return 0;
+
+	return d1 < d2 ? -1 : 1;
+}
+
+/*
+ * Quantiles are calculated by stack of compactors (like KLL sketch, but
+ * all levels have same capacity). When one level is full, then values
+ * are sorted, and every second value (random start) is moved to higher
+ * level with double weight.
+ */
+static void
+add_quantile_value(ColumnSketch *sk, double d)
+{
+	int			level = 0;
+
+	if (sk->nvalues == 0 || d < sk->min)
+		sk->min = d;
+	if (sk->nvalues == 0 || d > sk->max)
+		sk->max = d;
+
+	sk->nvalues += 1;
+
+	if (!sk->levels[0])
+		sk->levels[0] = smalloc(SKETCH_COMPACTOR_SIZE * sizeof(double));
+
+	sk->levels[0][sk->nitems[0]++] = d;
+
+	while (sk->nitems[level] == SKETCH_COMPACTOR_SIZE &&
+		   level + 1 < SKETCH_MAX_LEVELS)
+	{
+		int			i;
+
+		if (!sk->levels[level + 1])
+			sk->levels[level + 1] = smalloc(SKETCH_COMPACTOR_SIZE * sizeof(double));
+
+		qsort(sk->levels[level], SKETCH_COMPACTOR_SIZE, sizeof(double), compare_doubles);
+
+		/* xorshift */
+		sk->random ^= sk->random << 13;
+		sk->random ^= sk->random >> 17;
+		sk->random ^= sk->random << 5;
+
+		for (i = sk->random & 1; i < SKETCH_COMPACTOR_SIZE; i += 2)
+			sk->levels[level + 1][sk->nitems[level + 1]++] = sk->levels[level][i];
+
+		sk->nitems[level] = 0;
+		level += 1;
+	}
+}
+
+static int
+compare_weighted_values(const void *a, const void *b)
+{
+	return compare_doubles(&((const WeightedValue *) a)->value,
+						   &((const WeightedValue *) b)->value);
+}
+
+/*
+ * Returns sorted values of quantile sketch with their weights
+ */
+static WeightedValue *
+get_weighted_values(ColumnSketch *sk, int *nitems, double *total_weight)
+{
+	WeightedValue *result;
+	int			n = 0;
+	int			i, j;
+
+	for (i = 0; i < SKETCH_MAX_LEVELS; i++)
+		n += sk->nitems[i];
+
+	result = smalloc((n + 1) * sizeof(WeightedValue));
+
+	*total_weight = 0.0;
+	n = 0;
+
+	for (i = 0; i < SKETCH_MAX_LEVELS; i++)
+	{
+		for (j = 0; j < sk->nitems[i]; j++)
+		{
+			result[n].value = sk->levels[i][j];
+			result[n++].weight = ldexp(1.0, i);
+		}
+
+		*total_weight += sk->nitems[i] * ldexp(1.0, i);
+	}
+
+	qsort(result, n, sizeof(WeightedValue), compare_weighted_values);
+
+	*nitems = n;
+
+	return result;
+}
+
+static double
+get_quantile(WeightedValue *values, int nitems, double total_weight, double q)
+{
+	double		weight = 0.0;
+	int			i;
+
+	for (i = 0; i < nitems; i++)
+	{
+		weight += values[i].weight;
+		if (weight >= q * total_weight)
+			return values[i].value;
+	}
+
+	return values[nitems - 1].value;
+}
+
+ColumnSketch *
+create_column_sketch(Options *opts, DataDesc *desc, int colno)
+{
+	ColumnSketch *sk = smalloc(sizeof(ColumnSketch));
+
+	sk->colno = colno;
+	sk->force8bit = opts->force8bit;
+	sk->next_pos = desc->first_data_row + desc->evicted_rows;
+	sk->type = COLUMN_TYPE_UNKNOWN;
+	sk->random = 2463534242u;
+
+	get_column_name(desc, colno, sk->name, sizeof(sk->name));
+
+	/* multilines should be detected before sampling */
+	multilines_detection(opts, desc);
+
+	return sk;
+}
+
+void
+free_column_sketch(ColumnSketch *sk)
+{
+	int			i;
+
+	if (!sk)
+		return;
+
+	for (i = 0; i < sk->ncounters; i++)
+		free(sk->counters[i].value);
+
+	for (i = 0; i < SKETCH_MAX_LEVELS; i++)
+		free(sk->levels[i]);
+
+	free(sk);
+}
+
+int
+get_sketch_column(ColumnSketch *sk)
+{
+	return sk->colno;
+}
+
+/*
+ * Process next (at most) nrows lines. Rows appended to data later
+ * (stream mode) are processed by next calls. Rows hidden by filter
+ * are skipped. Returns true, when all rows are processed.
+ */
+bool
+sketch_rows(ColumnSketch *sk, DataDesc *desc, int nrows)
+{
+	LineBuffer *lb;
+	int			last_data_row = get_unfiltered_last_data_row(desc);
+	int			lineno;
+
+	/* position is shifted by evicted rows in stream mode */
+	lineno = sk->next_pos - desc->evicted_rows;
+	if (lineno < desc->first_data_row)
+	{
+		/* rows removed from stream before sampling */
+		sk->nskipped += desc->first_data_row - lineno;
+
+		lineno = desc->first_data_row;
+	}
+
+	for (lb = &desc->rows; lb && nrows > 0 && lineno <= last_data_row; lb = lb->next)
+	{
+		int			i;
+
+		if (lineno >= lb->first_row + lb->nrows)
+			continue;
+
+		for (i = lineno - lb->first_row;
+			 i < lb->nrows && nrows > 0 && lineno <= last_data_row;
+			 i++, lineno++, nrows--)
+		{
+			const char *line = NULL;
+			const char *str;
+			uint32_t	hash;
+			double		d;
+			int			size;
+
+			if (desc->has_multilines && lb_is_continual_row(lb, i))
+				continue;
+
+			if (is_filtered_row(desc, lineno))
+				continue;
+
+			/* not formatted values of column store can be used without lines */
+			if (!desc->colstore)
+				line = lb_get_row(lb, i, NULL);
+
+			str = get_field_value(desc, line, lineno, sk->colno, &size);
+
+			sk->nrows += 1;
+
+			if (!str)
+			{
+				sk->nnulls += 1;
+				continue;
+			}
+
+			hash = hash_value(str, size);
+
+			count_value(sk, str, size, hash);
+			add_hll_hash(sk, hash);
+
+			/* quantiles are calculated only for numeric columns */
+			if (sk->type != COLUMN_TYPE_TEXT)
+			{
+				sk->type = merge_column_types(sk->type, parse_typed_value(str, size, &d));
+
+				if (sk->type == COLUMN_TYPE_INTEGER ||
+					sk->type == COLUMN_TYPE_DECIMAL ||
+					sk->type == COLUMN_TYPE_SIZE)
+					add_quantile_value(sk, d);
+				else
+					sk->type = COLUMN_TYPE_TEXT;
+			}
+		}
+	}
+
+	sk->next_pos = lineno + desc->evicted_rows;
+
+	return lineno > last_data_row;
+}
+
+/*
+ * Copy value to buffer. The value is shortened to width display chars,
+ * and control chars are replaced by space. Returns display width.
+ */
+static int
+format_value(ColumnSketch *sk, const char *str, int size, char *buffer, int width)
+{
+	int			dsplen = 0;
+
+	while (size > 0)
+	{
+		int			clen = sk->force8bit ? 1 : utf8charlen(*str);
+		int			w;
+
+		if (clen > size)
+			break;
+
+		if ((unsigned char) *str < 32)
+		{
+			w = 1;
+			if (dsplen + w > width)
+				break;
+
+			*buffer++ = ' ';
+		}
+		else
+		{
+			w = sk->force8bit ? 1 : utf_dsplen(str);
+			if (w < 0)
+				w = 0;
+
+			if (dsplen + w > width)
+				break;
+
+			memcpy(buffer, str, clen);
+			buffer += clen;
+		}
+
+		dsplen += w;
+		str += clen;
+		size -= clen;
+	}
+
+	*buffer = '\0';
+
+	return dsplen;
+}
+
+static int
+compare_counters(const void *a, const void *b)
+{
+	const SketchCounter *c1 = *((const SketchCounter **) a);
+	const SketchCounter *c2 = *((const SketchCounter **) b);
+
+	if (c1->count != c2->count)
+		return c1->count > c2->count ? -1 : 1;
+
+	return c1->error < c2->error ? -1 : (c1->error > c2->error ? 1 : 0);
+}
+
+/*
+ * Prepare lines of overlay. Display widths of lines are returned
+ * in widths.
+ */
+static int
+sketch_lines(ColumnSketch *sk, DataDesc *desc,
+			 char lines[SKETCH_LINES][SKETCH_LINE_SIZE], int *widths)
+{
+	SketchCounter *counters[SKETCH_COUNTERS];
+	int			ncounters = 0;
+	long		min_count = 0;
+	int			value_width = 0;
+	int			count_width = 0;
+	int			last_data_row = get_unfiltered_last_data_row(desc);
+	int			nlines = 0;
+	long		pos = sk->next_pos - desc->evicted_rows;
+	int			i;
+
+	if (pos <= last_data_row)
+	{
+		int			total = last_data_row - desc->first_data_row + 1;
+		int			percent = total > 0 ? (int) ((pos - desc->first_data_row) * 100.0 / total) : 0;
+
+		snprintf(lines[nlines++], SKETCH_LINE_SIZE, "sampling ... %d%%", percent < 0 ? 0 : percent);
+	}
+	else
+		snprintf(lines[nlines++], SKETCH_LINE_SIZE, "all rows sampled");
+
+	snprintf(lines[nlines++], SKETCH_LINE_SIZE, "rows:      %ld", sk->nrows);
+	snprintf(lines[nlines++], SKETCH_LINE_SIZE, "nulls:     %ld", sk->nnulls);
+
+	if (sk->nskipped > 0)
+		snprintf(lines[nlines++], SKETCH_LINE_SIZE, "skipped:   %ld", sk->nskipped);
+	snprintf(lines[nlines++], SKETCH_LINE_SIZE, "distinct:  ~%.0f",
+			 sk->nrows > sk->nnulls ? get_distinct_estimate(sk) : 0.0);
+
+	/*
+	 * Any value without counter can have this count at most, so only
+	 * values with higher guaranteed count are surely frequent.
+	 */
+	if (sk->ncounters == SKETCH_COUNTERS)
+	{
+		min_count = sk->counters[0].count;
+
+		for (i = 1; i < SKETCH_COUNTERS; i++)
+			if (sk->counters[i].count < min_count)
+				min_count = sk->counters[i].count;
+	}
+
+	for (i = 0; i < sk->ncounters; i++)
+		if (sk->counters[i].count - sk->counters[i].error > min_count)
+			counters[ncounters++] = &sk->counters[i];
+
+	qsort(counters, ncounters, sizeof(SketchCounter *), compare_counters);
+
+	if (sk->ncounters > 0)
+	{
+		lines[nlines++][0] = '\0';
+
+		if (ncounters == 0)
+			snprintf(lines[nlines++], SKETCH_LINE_SIZE, "no frequent values");
+
+		if (ncounters > SKETCH_TOP_VALUES)
+			ncounters = SKETCH_TOP_VALUES;
+
+		/* values and counts are aligned */
+		for (i = 0; i < ncounters; i++)
+		{
+			char		value[SKETCH_VALUE_WIDTH * 4 + 1];
+			char		count[32];
+			int			w;
+
+			w = format_value(sk, counters[i]->value, counters[i]->size, value, SKETCH_VALUE_WIDTH);
+			if (w > value_width)
+				value_width = w;
+
+			/* the count is exact, when there is not any error */
+			w = snprintf(count, sizeof(count), "%s%ld",
+						 counters[i]->error > 0 ? "~" : "",
+						 counters[i]->count);
+			if (w > count_width)
+				count_width = w;
+		}
+
+		for (i = 0; i < ncounters; i++)
+		{
+			char		value[SKETCH_VALUE_WIDTH * 4 + 1];
+			char		count[32];
+			int			w;
+
+			w = format_value(sk, counters[i]->value, counters[i]->size, value, SKETCH_VALUE_WIDTH);
+
+			snprintf(count, sizeof(count), "%s%ld",
+					 counters[i]->error > 0 ? "~" : "",
+					 counters[i]->count);
+
+			snprintf(lines[nlines++], SKETCH_LINE_SIZE, "%s%*s  %*s",
+					 value, value_width - w, "",
+					 count_width, count);
+		}
+	}
+
+	if (sk->type != COLUMN_TYPE_TEXT && sk->nvalues > 0)
+	{
+		static const double quantiles[] = {0.25, 0.5, 0.75, 0.9, 0.99};
+		static const char *labels[] = {"25%", "median", "75%", "90%", "99%"};
+
+		WeightedValue *values;
+		double		total_weight;
+		int			scale = sk->type != COLUMN_TYPE_DECIMAL ? 0 : 6;
+		char		buffer[64];
+		int			nitems;
+
+		values = get_weighted_values(sk, &nitems, &total_weight);
+
+		lines[nlines++][0] = '\0';
+
+		format_number(sk->min, scale, buffer, sizeof(buffer));
+		snprintf(lines[nlines++], SKETCH_LINE_SIZE, "min:       %s", buffer);
+
+		for (i = 0; i < 5; i++)
+		{
+			format_number(get_quantile(values, nitems, total_weight, quantiles[i]),
+						  scale, buffer, sizeof(buffer));
+			snprintf(lines[nlines++], SKETCH_LINE_SIZE, "%-10s ~%s", labels[i], buffer);
+		}
+
+		format_number(sk->max, scale, buffer, sizeof(buffer));
+		snprintf(lines[nlines++], SKETCH_LINE_SIZE, "max:       %s", buffer);
+
+		free(values);
+	}
+
+	for (i = 0; i < nlines; i++)
+		widths[i] = sk->force8bit ? (int) strlen(lines[i]) : utf_string_dsplen(lines[i], SIZE_MAX);
+
+	return nlines;
+}
+
+/*
+ * Draw box with approximate statistics to right bottom corner of window
+ */
+void
+sketch_draw_overlay(ColumnSketch *sk, DataDesc *desc, WINDOW *win, Theme *t)
+{
+	char		lines[SKETCH_LINES][SKETCH_LINE_SIZE];
+	int			widths[SKETCH_LINES];
+	char		title[SKETCH_VALUE_WIDTH * 4 + 1];
+	int			nlines;
+	int			maxy, maxx;
+	int			title_width;
+	int			width;
+	int			startx, starty;
+	int			i;
+
+	if (!win)
+		return;
+
+	nlines = sketch_lines(sk, desc, lines, widths);
+
+	title_width = format_value(sk, sk->name, strlen(sk->name), title, SKETCH_VALUE_WIDTH);
+	width = title_width;
+
+	for (i = 0; i < nlines; i++)
+		if (widths[i] > width)
+			width = widths[i];
+
+	/* one space before and after text */
+	width += 2;
+
+	getmaxyx(win, maxy, maxx);
+
+	startx = maxx - width;
+	if (startx < 0)
+		startx = 0;
+
+	starty = maxy - nlines - 1;
+	if (starty < 0)
+		starty = 0;
+
+	wattron(win, t->cursor_data_attr | A_BOLD);
+	mvwprintw(win, starty, startx, " %s%*s ", title, width - 2 - title_width, "");
+	wattroff(win, A_BOLD);
+
+	for (i = 0; i < nlines && starty + i + 1 < maxy; i++)
+		mvwprintw(win, starty + i + 1, startx, " %s%*s ", lines[i], width - 2 - widths[i], "");
+
+	wattroff(win, t->cursor_data_attr);
+}
@@ -25,7 +25,7 @@ compar_num_asc(const void *a, const void *b)
 	if (sdb->info == INFO_DOUBLE)
 	{
 		if (sda->info == INFO_DOUBLE)
-			return sda->d - sdb->d;
+			return sda->d < sdb->d ? -1 : (sda->d > sdb->d ? 1 : 0);
 		else
 			return 1;
 	}
@@ -47,7 +47,7 @@ compar_num_desc(const void *a, const void *b)
 	if (sdb->info == INFO_DOUBLE)
 	{
 		if (sda->info == INFO_DOUBLE)
-			return sdb->d - sda->d;
+			return sdb->d < sda->d ? -1 : (sdb->d > sda->d ? 1 : 0);
 		else
 			return 1;
 	}
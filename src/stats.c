@@ -0,0 +1,245 @@
+/*-------------------------------------------------------------------------
+ *
+ * stats.c
+ *	  runtime performance counters
+ *
+ * Portions Copyright (c) 2017-2021 Pavel Stehule
+ *
+ * IDENTIFICATION
+ *	  src/stats.c
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef __GNU_LIBRARY__
+
+/* used for mallinfo */
+#include <malloc.h>
+
+#endif
+
+#include "pspg.h"
+
+PerfStats perf_stats;
+
+#define STATS_LINES				11
+#define STATS_LINE_SIZE			40
+
+/*
+ * Returns monotonic time in microseconds
+ */
+long long
+stats_time_us(void)
+{
+	struct timespec spec;
+
+	clock_gettime(CLOCK_MONOTONIC, &spec);
+
+	return (long long) spec.tv_sec * 1000000 + spec.tv_nsec / 1000;
+}
+
+/*
+ * Save size of currently displayed document
+ */
+void
+stats_set_data(DataDesc *desc)
+{
+	perf_stats.rows = desc->total_rows;
+	perf_stats.bytes = desc->total_bytes;
+}
+
+/*
+ * Should be called after any draw of screen. The fps value is
+ * calculated from frames of last (at least one second long) interval.
+ */
+void
+stats_frame_done(long long render_us)
+{
+	long long	now = stats_time_us();
+
+	perf_stats.render_us = render_us;
+	perf_stats.frames += 1;
+	perf_stats.interval_frames += 1;
+
+	if (perf_stats.interval_start_us == 0)
+		perf_stats.interval_start_us = now;
+	else if (now - perf_stats.interval_start_us >= 1000000)
+	{
+		perf_stats.fps = perf_stats.interval_frames * 1000000.0 /
+								(now - perf_stats.interval_start_us);
+
+		perf_stats.interval_frames = 0;
+		perf_stats.interval_start_us = now;
+	}
+}
+
+static void
+get_malloc_stats(size_t *used, size_t *unused, size_t *mmapped)
+{
+
+#ifdef __GNU_LIBRARY__
+
+/*
+ * Same test is used in get_event, mallinfo is deprecated, but
+ * mallinfo2 is available from glibc 2.33.
+ */
+#if (__GLIBC__ == 2 &&  __GLIBC_MINOR__ >= 33) || __GLIBC__ > 2
+
+	struct mallinfo2 mi;
+
+	mi = mallinfo2();
+
+#else
+
+	struct mallinfo mi;
+
+	mi = mallinfo();
+
+#endif
+
+	*used = (size_t) mi.uordblks;
+	*unused = (size_t) mi.fordblks;
+	*mmapped = (size_t) mi.hblkhd;
+
+#else
+
+	*used = 0;
+	*unused = 0;
+	*mmapped = 0;
+
+#endif
+
+}
+
+static char *
+format_bytes(char *buffer, size_t size, size_t bytes)
+{
+	if (bytes < 10 * 1024)
+		snprintf(buffer, size, "%zu B", bytes);
+	else if (bytes < 10 * 1024 * 1024)
+		snprintf(buffer, size, "%.1f kB", bytes / 1024.0);
+	else if (bytes < 10 * 1024 * 1024 * 1024L)
+		snprintf(buffer, size, "%.1f MB", bytes / 1024.0 / 1024.0);
+	else
+		snprintf(buffer, size, "%.1f GB", bytes / 1024.0 / 1024.0 / 1024.0);
+
+	return buffer;
+}
+
+/*
+ * Prepare formatted lines used by overlay and by stats file
+ */
+static int
+stats_lines(char lines[STATS_LINES][STATS_LINE_SIZE])
+{
+	size_t		used, unused, mmapped;
+	char		buffer[20];
+	int			n = 0;
+
+	get_malloc_stats(&used, &unused, &mmapped);
+
+	snprintf(lines[n++], STATS_LINE_SIZE, "rows:      %ld", perf_stats.rows);
+	snprintf(lines[n++], STATS_LINE_SIZE, "data:      %s",
+			 format_bytes(buffer, sizeof(buffer), perf_stats.bytes));
+	snprintf(lines[n++], STATS_LINE_SIZE, "heap used: %s",
+			 format_bytes(buffer, sizeof(buffer), used));
+	snprintf(lines[n++], STATS_LINE_SIZE, "heap free: %s",
+			 format_bytes(buffer, sizeof(buffer), unused));
+	snprintf(lines[n++], STATS_LINE_SIZE, "mmapped:   %s",
+			 format_bytes(buffer, sizeof(buffer), mmapped));
+	snprintf(lines[n++], STATS_LINE_SIZE, "load:      %.1f ms", perf_stats.load_us / 1000.0);
+	snprintf(lines[n++], STATS_LINE_SIZE, "sort:      %.1f ms", perf_stats.sort_us / 1000.0);
+	snprintf(lines[n++], STATS_LINE_SIZE, "search:    %.1f ms", perf_stats.search_us / 1000.0);
+	snprintf(lines[n++], STATS_LINE_SIZE, "render:    %.1f ms", perf_stats.render_us / 1000.0);
+	snprintf(lines[n++], STATS_LINE_SIZE, "fps:       %.1f", perf_stats.fps);
+	snprintf(lines[n++], STATS_LINE_SIZE, "frames:    %ld", perf_stats.frames);
+
+	return n;
+}
+
+/*
+ * Draw box with counters to right top corner of window
+ */
+void
+stats_draw_overlay(WINDOW *win, Theme *t)
+{
+	char		lines[STATS_LINES][STATS_LINE_SIZE];
+	int			nlines;
+	int			maxy, maxx;
+	int			width = 0;
+	int			startx;
+	int			i;
+
+	if (!win)
+		return;
+
+	nlines = stats_lines(lines);
+
+	for (i = 0; i < nlines; i++)
+	{
+		int		len = strlen(lines[i]);
+
+		if (len > width)
+			width = len;
+	}
+
+	/* one space before and after text */
+	width += 2;
+
+	getmaxyx(win, maxy, maxx);
+
+	startx = maxx - width;
+	if (startx < 0)
+		startx = 0;
+
+	wattron(win, t->cursor_data_attr);
+
+	for (i = 0; i < nlines && i < maxy; i++)
+		mvwprintw(win, i, startx, " %-*.*s ", width - 2, maxx - 2, lines[i]);
+
+	wattroff(win, t->cursor_data_attr);
+}
+
+/*
+ * Write counters to file. When force is false, then the file is
+ * rewritten at most once per second.
+ */
+void
+stats_write_file(const char *pathname, bool force)
+{
+	static long long last_write_us = 0;
+	char		lines[STATS_LINES][STATS_LINE_SIZE];
+	long long	now;
+	FILE	   *f;
+	int			nlines;
+	int			i;
+
+	if (!pathname)
+		return;
+
+	now = stats_time_us();
+
+	if (!force && last_write_us != 0 && now - last_write_us < 1000000)
+		return;
+
+	last_write_us = now;
+
+	f = fopen(pathname, "w");
+	if (!f)
+	{
+		log_row("cannot to open stats file \"%s\" (%s)", pathname, strerror(errno));
+		return;
+	}
+
+	nlines = stats_lines(lines);
+
+	for (i = 0; i < nlines; i++)
+		fprintf(f, "%s\n", lines[i]);
+
+	fclose(f);
+}
@@ -12,6 +12,7 @@
  */
 
 #include <ctype.h>
+#include <string.h>
 
 #include "pspg.h"
 
@@ -117,6 +118,35 @@ nstrstr_with_sizes(const char *haystack,
 	return haystack;
 }
 
+/*
+ * Case sensitive searching in not zero terminated string
+ */
+const char *
+strstr_with_sizes(const char *haystack,
+				  int haystack_size,
+				  const char *needle,
+				  int needle_size)
+{
+	const char *haystack_end = haystack + haystack_size;
+
+	if (needle_size == 0)
+		return haystack;
+
+	while (haystack_end - haystack >= needle_size)
+	{
+		haystack = memchr(haystack, *needle, haystack_end - haystack - needle_size + 1);
+		if (!haystack)
+			return NULL;
+
+		if (memcmp(haystack, needle, needle_size) == 0)
+			return haystack;
+
+		haystack += 1;
+	}
+
+	return NULL;
+}
+
 /*
  * Special string searching, lower chars are case insensitive,
  * upper chars are case sensitive.
@@ -14,6 +14,7 @@
 #include <ctype.h>
 #include <errno.h>
 #include <libgen.h>
+#include <math.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/types.h>
@@ -530,6 +531,61 @@ strncpytrim(Options *opts, char *dest, const char *src,
 }
 
 
+/*
+ * Returns row number after removing evicted rows. The rows of header
+ * are not moved, removed rows are replaced by -1.
+ */
+static int
+shift_evicted_row(int row, int nheader, int evicted)
+{
+	if (row < nheader)
+		return row;
+
+	return row >= nheader + evicted ? row - evicted : -1;
+}
+
+/*
+ * Removes oldest rows of stream, when the limits of retention are
+ * exceeded. The rows are removed by whole line buffers, the rows
+ * of header are not removed. Returns number of removed rows.
+ */
+static int
+stream_retention(Options *opts, DataDesc *desc, int nrows)
+{
+	size_t		max_bytes = (size_t) opts->stream_max_size * 1024 * 1024;
+	int			nheader = 0;
+	int			evicted = 0;
+
+	if (desc->border_head_row != -1)
+		nheader = desc->border_head_row + 1;
+	else if (desc->border_top_row != -1)
+		nheader = desc->border_top_row + 1;
+
+	while ((opts->stream_max_rows > 0 &&
+			nrows - evicted - nheader - LINEBUFFER_LINES >= opts->stream_max_rows) ||
+		   (max_bytes > 0 && desc->total_bytes > max_bytes))
+	{
+		size_t		removed = lb_evict_rows(desc, nheader);
+
+		if (removed == 0)
+			break;
+
+		desc->total_bytes -= removed;
+		evicted += LINEBUFFER_LINES;
+	}
+
+	if (evicted > 0)
+	{
+		desc->last_row = shift_evicted_row(desc->last_row, nheader, evicted);
+		desc->last_data_row = shift_evicted_row(desc->last_data_row, nheader, evicted);
+		desc->border_bottom_row = shift_evicted_row(desc->border_bottom_row, nheader, evicted);
+		desc->footer_row = shift_evicted_row(desc->footer_row, nheader, evicted);
+		desc->alt_footer_row = shift_evicted_row(desc->alt_footer_row, nheader, evicted);
+	}
+
+	return evicted;
+}
+
 /*
  * Read data from file and fill DataDesc.
  */
@@ -541,6 +597,10 @@ readfile(Options *opts, DataDesc *desc, StateData *state)
 	ssize_t		read;
 	int			nrows = 0;
 	LineBuffer *rows;
+	long long	start_us;
+	bool		incremental;
+	bool		continued;
+	bool		complete = false;
 
 #ifdef DEBUG_PIPE
 
@@ -552,37 +612,75 @@ readfile(Options *opts, DataDesc *desc, StateData *state)
 
 #endif
 
-	desc->title[0] = '\0';
-	desc->title_rows = 0;
-	desc->border_top_row = -1;
-	desc->border_head_row = -1;
-	desc->border_bottom_row = -1;
+	start_us = stats_time_us();
+
+	/*
+	 * When retention of stream is active, then we don't wait on end
+	 * of table, and the rows of incomplete table are displayed. The
+	 * next rows are appended to already read rows (desc holds rows
+	 * of previous call).
+	 */
+	incremental = state->stream_mode &&
+				  (opts->stream_max_rows > 0 || opts->stream_max_size > 0);
+	continued = incremental && state->stream_continue;
+
 	desc->first_data_row = -1;
-	desc->last_data_row = -1;
-	desc->is_expanded_mode = false;
 	desc->headline_transl = NULL;
 	desc->cranges = NULL;
 	desc->columns = 0;
-	desc->footer_row = -1;
-	desc->alt_footer_row = -1;
 	desc->is_pgcli_fmt = false;
-	desc->namesline = NULL;
 	desc->order_map = NULL;
-	desc->total_rows = 0;
+	desc->positions = NULL;
+	desc->column_values = NULL;
+	desc->row_filter = NULL;
+	desc->row_filter_active = false;
+	desc->colstore = NULL;
+	desc->source_types = NULL;
+	desc->multilines_already_tested = false;
 
-	desc->maxbytes = -1;
-	desc->maxx = -1;
+	if (continued)
+	{
+		nrows = desc->total_rows;
 
-	memset(&desc->rows, 0, sizeof(LineBuffer));
-	rows = &desc->rows;
-	desc->rows.prev = NULL;
-	desc->oid_name_table = false;
-	desc->multilines_already_tested = false;
+		/* end of data is not known yet, it is detected again */
+		desc->last_data_row = -1;
+
+		rows = &desc->rows;
+		while (rows->next)
+			rows = rows->next;
+	}
+	else
+	{
+		desc->title[0] = '\0';
+		desc->title_rows = 0;
+		desc->border_top_row = -1;
+		desc->border_head_row = -1;
+		desc->border_bottom_row = -1;
+		desc->last_data_row = -1;
+		desc->is_expanded_mode = false;
+		desc->footer_row = -1;
+		desc->alt_footer_row = -1;
+		desc->namesline = NULL;
+		desc->nbookmarks = 0;
+		desc->total_rows = 0;
+		desc->total_bytes = 0;
+		desc->evicted_rows = 0;
+
+		desc->maxbytes = -1;
+		desc->maxx = -1;
+
+		memset(&desc->rows, 0, sizeof(LineBuffer));
+		rows = &desc->rows;
+		desc->rows.prev = NULL;
+		desc->oid_name_table = false;
+
+		/* safe reset */
+		desc->filename[0] = '\0';
+	}
 
-	/* safe reset */
-	desc->filename[0] = '\0';
 	state->errstr = NULL;
 	state->_errno = 0;
+	state->stream_continue = false;
 
 	if (opts->pathname != NULL)
 	{
@@ -615,7 +713,12 @@ readfile(Options *opts, DataDesc *desc, StateData *state)
 	errno = 0;
 	read = _getline(&line, &len, state->fp, state->is_blocking, false);
 	if (read == -1)
-		return false;
+	{
+		/* there are not new rows, but already read rows are valid */
+		state->stream_continue = continued;
+
+		return continued;
+	}
 
 	do
 	{
@@ -631,11 +734,13 @@ readfile(Options *opts, DataDesc *desc, StateData *state)
 		if (state->stream_mode && read == 0)
 		{
 			free(line);
+			line = NULL;
 
 			/* ignore this line if we are on second line - probably watch mode */
 			if (nrows == 1)
 				goto next_row;
 
+			complete = true;
 			break;
 		}
 
@@ -648,16 +753,11 @@ readfile(Options *opts, DataDesc *desc, StateData *state)
 
 		clen = utf_string_dsplen(line, read);
 
-		if (rows->nrows == LINEBUFFER_LINES)
-		{
-			LineBuffer *newrows = smalloc(sizeof(LineBuffer));
-
-			rows->next = newrows;
-			newrows->prev = rows;
-			rows = newrows;
-		}
+		rows = lb_append_line(rows, line, read, clen);
+		desc->total_bytes += read + 1;
 
-		rows->rows[rows->nrows++] = line;
+		if (incremental)
+			nrows -= stream_retention(opts, desc, nrows + 1);
 
 		/*
 		 * The input file is not an table
@@ -732,21 +832,39 @@ readfile(Options *opts, DataDesc *desc, StateData *state)
 
 		/* Detection of status rows */
 		if (nrows == 1 && is_cmdtag(line))
+		{
+			complete = true;
 			break;
+		}
 
 next_row:
 
-		line = NULL;
+		/*
+		 * The content of line was copied to line buffer. getline can
+		 * reuse the buffer, but nonblocking read allocates new buffer
+		 * every time.
+		 */
+		if (!state->is_blocking)
+		{
+			free(line);
+			line = NULL;
+		}
 
-		read = _getline(&line, &len, state->fp, state->is_blocking, true);
+		read = _getline(&line, &len, state->fp, state->is_blocking, !incremental);
 	} while (read != -1);
 
+	free(line);
+
 	if (errno && errno != EAGAIN)
 	{
 		log_row("cannot to read from file (%s)", strerror(errno));
 
-		return false;
+		state->stream_continue = continued;
+		if (!continued)
+			return false;
 	}
+	else
+		state->stream_continue = incremental && !complete;
 
 	if (state->detect_truncation)
 		state->last_position = ftell(state->fp);
@@ -775,8 +893,7 @@ next_row:
 		if (desc->border_head_row == 0 && !desc->is_expanded_mode)
 			goto broken_format;
 
-		desc->headline = desc->rows.rows[desc->border_head_row];
-		desc->headline_size = strlen(desc->headline);
+		desc->headline = lb_get_row(&desc->rows, desc->border_head_row, &desc->headline_size);
 
 		/*
 		 * fallback, but can be fixed later, when border_type
@@ -786,13 +903,12 @@ next_row:
 			desc->last_data_row = desc->last_row - 1;
 
 		if (desc->border_head_row >= 1)
-			desc->namesline = desc->rows.rows[desc->border_head_row - 1];
+			desc->namesline = lb_get_row(&desc->rows, desc->border_head_row - 1, NULL);
 
 	}
 	else if (desc->is_expanded_mode && desc->border_top_row != -1)
 	{
-		desc->headline = desc->rows.rows[desc->border_top_row];
-		desc->headline_size = strlen(desc->headline);
+		desc->headline = lb_get_row(&desc->rows, desc->border_top_row, &desc->headline_size);
 	}
 	else
 	{
@@ -814,6 +930,8 @@ broken_format:
 
 #endif
 
+	perf_stats.load_us = stats_time_us() - start_us;
+
 	/* clean event buffer */
 	if (state->inotify_fd >= 0)
 		lseek(state->inotify_fd, 0, SEEK_END);
@@ -1199,27 +1317,95 @@ translate_headline(Options *opts, DataDesc *desc)
 }
 
 /*
- * Cut text from column.
+ * Prepare string for sorting (result of strxfrm)
+ */
+static bool
+text_strxfrm(char *str, int size, bool force8bit, char **result)
+{
+#define TEXT_STACK_BUFFER_SIZE		1024
+
+	char		buffer[TEXT_STACK_BUFFER_SIZE];
+	char	   *dynbuf = NULL;
+	char	   *cstr = NULL;
+	int			dynbuf_size = 0;
+
+	cstr = strndup(str, size);
+	if (!cstr)
+		leave("out of memory");
+
+	if (force8bit)
+	{
+		*result = cstr;
+		return true;
+	}
+
+	errno = 0;
+	size = strxfrm(buffer, (const char *) cstr, 1024);
+	if (errno != 0)
+	{
+		/* cannot to sort this string */
+		free(cstr);
+		return false;
+	}
+
+	if (size > TEXT_STACK_BUFFER_SIZE - 1)
+	{
+		while (size > dynbuf_size)
+		{
+			if (dynbuf)
+				free(dynbuf);
+
+			dynbuf_size = size + 1;
+			dynbuf = smalloc(dynbuf_size);
+
+			errno = 0;
+			size = strxfrm(dynbuf, cstr, dynbuf_size);
+			if (errno != 0)
+			{
+				/* cannot to sort this string */
+				free(cstr);
+				return false;
+			}
+		}
+	}
+
+	free(cstr);
+
+	if (!dynbuf)
+	{
+		dynbuf = sstrdup(buffer);
+		if (!dynbuf)
+			leave("out of memory");
+	}
+
+	*result = dynbuf;
+
+	return true;
+}
+
+/*
+ * Cut text from column. The str points to char displayed on position
+ * pos (not after xmin), and size is number of bytes to end of row.
  */
 static bool
 cut_text(char *str,
+		 int size,
+		 int pos,
 		 int xmin,
 		 int xmax,
 		 bool border0,
 		 bool force8bit,
 		 char **result)
 {
-#define TEXT_STACK_BUFFER_SIZE		1024
-
 	if (str)
 	{
 		char	   *_str = NULL;
 		char	   *after_last_nospc = NULL;
-		int			pos = 0;
+		char	   *end = str + size;
 		int			charlen;
 		bool		skip_left_spaces = true;
 
-		while (*str)
+		while (str < end)
 		{
 			charlen = utf8charlen(*str);
 
@@ -1251,66 +1437,7 @@ cut_text(char *str,
 		}
 
 		if (_str != NULL)
-		{
-			char		buffer[TEXT_STACK_BUFFER_SIZE];
-			char	   *dynbuf = NULL;
-			char	   *cstr = NULL;
-			int			size;
-			int			dynbuf_size = 0;
-
-			cstr = strndup(_str, after_last_nospc - _str);
-			if (!cstr)
-				leave("out of memory");
-
-			if (force8bit)
-			{
-				*result = cstr;
-				return true;
-			}
-
-			errno = 0;
-			size = strxfrm(buffer, (const char *) cstr, 1024);
-			if (errno != 0)
-			{
-				/* cannot to sort this string */
-				free(cstr);
-				return false;
-			}
-
-			if (size > TEXT_STACK_BUFFER_SIZE - 1)
-			{
-				while (size > dynbuf_size)
-				{
-					if (dynbuf)
-						free(dynbuf);
-
-					dynbuf_size = size + 1;
-					dynbuf = smalloc(dynbuf_size);
-
-					errno = 0;
-					size = strxfrm(dynbuf, cstr, dynbuf_size);
-					if (errno != 0)
-					{
-						/* cannot to sort this string */
-						free(cstr);
-						return false;
-					}
-				}
-			}
-
-			free(cstr);
-
-			if (!dynbuf)
-			{
-				dynbuf = sstrdup(buffer);
-				if (!dynbuf)
-					leave("out of memory");
-			}
-
-			*result = dynbuf;
-
-			return true;
-		}
+			return text_strxfrm(_str, after_last_nospc - _str, force8bit, result);
 	}
 
 	*result = NULL;
@@ -1319,198 +1446,132 @@ cut_text(char *str,
 }
 
 /*
- * Try to cut numeric (double) value from row defined by specified xmin, xmax positions.
- * Units (bytes, kB, MB, GB, TB) are supported. Returns true, when returned value is valid.
+ * Returns not formatted value of field of row starting on lineno,
+ * or NULL when the original data are not available.
  */
-static bool
-cut_numeric_value(char *str, int xmin, int xmax, double *d, bool border0, bool *isnull, char **nullstr)
+static const char *
+get_source_field(DataDesc *desc, int lineno, int colno)
 {
+	int		rowno;
 
-#define BUFFER_MAX_SIZE			101
-
-	char		buffer[BUFFER_MAX_SIZE];
-	char	   *buffptr;
-	char	   *after_last_nospace = NULL;
-	char	   *first_nospace_nodigit = NULL;
-	char		decimal_point = '\0';
-	bool		only_digits = false;
-	bool		only_digits_with_point = false;
-	bool		skip_initial_spaces = true;
-	int			x = 0;
-	long		mp = 1;
-
-	*isnull = false;
-
-	if (str)
-	{
-		after_last_nospace = buffptr = buffer;
-		memset(buffer, 0, BUFFER_MAX_SIZE);
-
-		while (*str)
-		{
-			int		charlen = utf8charlen(*str);
+	if (!desc->colstore)
+		return NULL;
 
-			if (x > xmin || (border0 && x >= xmin))
-			{
-				char	c =  *str;
+	rowno = cs_find_row(desc->colstore, lineno);
+	if (rowno == -1)
+		return NULL;
 
-				if (skip_initial_spaces)
-				{
-					if (c == ' ')
-					{
-						x += 1;
-						str += 1;
-						continue;
-					}
+	return cs_get_value(desc->colstore, rowno, get_source_column(desc, colno), NULL);
+}
 
-					/* first char should be a digit */
-					if (!isdigit(c))
-					{
-						char	   *_nullstr = *nullstr;
-						size_t		len;
-						char	   *saved_str = str;
-
-						after_last_nospace = saved_str;
-
-						/*
-						 * We should to check nullstr if exists, or we should to save
-						 * this string as nullstr.
-						 */
-						while (*str)
-						{
-							if (*str != ' ')
-								after_last_nospace = str + charlen;
-
-							x += utf_dsplen(str);
-							str += charlen;
-
-							if (x >= xmax)
-								break;
-
-							if (*str)
-								charlen = utf8charlen(*str);
-						}
-
-						len = after_last_nospace - saved_str;
-
-						if (_nullstr)
-						{
-							if (strlen(_nullstr) == len)
-								*isnull = strncmp(_nullstr, saved_str, len) == 0;
-							else
-								*isnull = false;
-						}
-						else
-						{
-							_nullstr = smalloc(len + 1);
+/*
+ * Returns type of column of query result, or COLUMN_TYPE_UNKNOWN,
+ * when the type should be detected.
+ */
+static ColumnType
+get_source_type(DataDesc *desc, int colno)
+{
+	colno = get_source_column(desc, colno);
 
-							memcpy(_nullstr, saved_str, len);
-							_nullstr[len] = '\0';
+	/* first row is header */
+	if (!desc->source_types || colno >= desc->colstore->ncolumns)
+		return COLUMN_TYPE_UNKNOWN;
 
-							*isnull = true;
-							*nullstr = _nullstr;
-						}
+	return desc->source_types[colno];
+}
 
-						return false;
-					}
+/*
+ * Returns trimmed part of row, that is displayed on positions from xmin
+ * to xmax (xmax is not included). Returns NULL, when this part is empty.
+ * The str points to char displayed on position x (not after xmin), so
+ * the scan can start on known position inside row.
+ */
+const char *
+get_line_range(const char *str, int x, int xmin, int xmax, bool force8bit, int *size)
+{
+	const char *start = NULL;
+	const char *after_last_nospace = NULL;
 
-					skip_initial_spaces = false;
-					only_digits = true;
-				}
+	while (*str)
+	{
+		int		charlen = force8bit ? 1 : utf8charlen(*str);
 
-				memcpy(buffptr, str, charlen);
+		if (x >= xmin && *str != ' ')
+		{
+			if (!start)
+				start = str;
 
-				/* trim from right */
-				if (c != ' ')
-				{
-					bool	only_digits_prev = only_digits;
-					bool	only_digits_with_point_prev = only_digits_with_point;
+			after_last_nospace = str + charlen;
+		}
 
-					after_last_nospace = buffptr + charlen;
-					if (after_last_nospace - buffer > (BUFFER_MAX_SIZE - 1))
-					{
-						/* too long string - should not be translated to number */
-						return false;
-					}
+		x += force8bit ? 1 : utf_dsplen(str);
+		str += charlen;
 
-					if (c == '.' || c == ',')
-					{
-						if (only_digits)
-						{
-							only_digits = false;
-							only_digits_with_point = true;
-							decimal_point = c;
-						}
-						else
-							return false;
-					}
-					else if (!isdigit(c))
-					{
-						only_digits = false;
-						only_digits_with_point = false;
-					}
+		if (x >= xmax)
+			break;
+	}
 
-					/* Save point of chage between digits and other */
-					if ((only_digits_prev || only_digits_with_point_prev) &&
-					   !(only_digits || only_digits_with_point))
-					{
-						first_nospace_nodigit = buffptr;
-					}
-				}
-				buffptr += charlen;
-			}
+	*size = start ? after_last_nospace - start : 0;
 
-			x += utf_dsplen(str);
-			str += charlen;
+	return start;
+}
 
-			if (x >= xmax)
-				break;
-		} /* while (*str) */
+/*
+ * Returns trimmed field from row defined by specified xmin, xmax positions.
+ * The str points to char displayed on position x (not after xmin). Returns
+ * NULL, when the field is empty.
+ */
+static char *
+cut_field(char *str, int x, int xmin, int xmax, bool border0, int *size)
+{
+	/* without border, there is not vertical line on xmin position */
+	return (char *) get_line_range(str, x, border0 ? xmin : xmin + 1, xmax, false, size);
+}
 
-		/* trim spaces from right */
-		*after_last_nospace = '\0';
+/*
+ * Returns byte offset of display position xpos of row, when it can be
+ * calculated without scan of row (row has only one byte chars), else
+ * returns 0. Fields are cut in utf8 mode always, so in force8bit mode
+ * (when cached widths are in bytes) the row is scanned from start.
+ */
+static int
+get_row_offset(LineBuffer *lb, int rowno, int size, int xpos, bool force8bit)
+{
+	if (xpos > 0 && !force8bit && lb_is_ascii_row(lb, rowno, false, true))
+		return xpos < size ? xpos : size;
 
-		if (first_nospace_nodigit)
-		{
-			if (nstreq(first_nospace_nodigit, "bytes"))
-				mp = 1l;
-			else if (nstreq(first_nospace_nodigit, "kB"))
-				mp = 1024l;
-			else if (nstreq(first_nospace_nodigit, "MB"))
-				mp = 1024l * 1024;
-			else if (nstreq(first_nospace_nodigit, "GB"))
-				mp = 1024l * 1024 * 1024;
-			else if (nstreq(first_nospace_nodigit, "TB"))
-				mp = 1024l * 1024 * 1024 * 1024;
-			else
-				/* unknown unit */
-				return false;
+	return 0;
+}
 
-			*first_nospace_nodigit = '\0';
-		}
+/*
+ * Returns trimmed value of field of row starting on lineno. The not
+ * formatted value of query result is preferred. Returns NULL, when
+ * the field is empty. The line can be NULL (line buffer is not loaded),
+ * when the not formatted values are available.
+ */
+const char *
+get_field_value(DataDesc *desc, const char *line, int lineno, int colno, int *size)
+{
+	const char *field = get_source_field(desc, lineno, colno);
 
-		if (decimal_point == ',')
-		{
-			char   *ptr = buffer;
+	if (field)
+	{
+		*size = strlen(field);
 
-			while (*ptr)
-			{
-				if (*ptr == ',')
-					*ptr = '.';
-				ptr += 1;
-			}
-		}
+		return *field ? field : NULL;
+	}
 
-		errno = 0;
-		*d = strtod(buffer, NULL);
-		if (errno == 0)
-		{
-			*d = *d * mp;
-			return true;
-		}
+	if (!line)
+	{
+		*size = 0;
+		return NULL;
 	}
 
-	return false;
+	return cut_field((char *) line, 0,
+					 desc->cranges[colno].xmin,
+					 desc->cranges[colno].xmax,
+					 desc->border_type == 0,
+					 size);
 }
 
 /*
@@ -1542,7 +1603,11 @@ multilines_detection(Options *opts, DataDesc *desc)
 		int			pos = 0;
 		bool		found_continuation_symbol = false;
 
-		(void) lbm_get_line(&lbm, &str, NULL, &lineno);
+		/* rows rendered from column store are single line rows */
+		if (lbm.lb->colstore)
+			continue;
+
+		(void) lbm_get_line(&lbm, &str, NULL, NULL, &lineno);
 
 		if (lineno < desc->first_data_row || lineno > desc->last_data_row)
 			continue;
@@ -1594,6 +1659,201 @@ multilines_detection(Options *opts, DataDesc *desc)
 	desc->has_multilines = has_multilines;
 }
 
+/*
+ * Detects type of column and returns parsed values. The values are
+ * cached, so next call is cheap. When there is only one string that
+ * cannot be parsed, then this string is used as NULL.
+ */
+ColumnValues *
+get_column_values(Options *opts, DataDesc *desc, int colno)
+{
+	ColumnValues   *cv;
+	ColumnType		source_type;
+	LineBuffer	   *lnb;
+	char		   *nullstr = NULL;
+	int				nullstr_size = 0;
+	bool			border0 = (desc->border_type == 0);
+	bool			continual_line = false;
+	int				xmin, xmax;
+	int				lineno = 0;
+	int				last_data_row;
+	int				i;
+
+	if (!desc->column_values)
+		desc->column_values = smalloc(desc->columns * sizeof(ColumnValues));
+
+	cv = &desc->column_values[colno];
+
+	if (cv->is_valid)
+		return cv;
+
+	/* multilines should be detected first */
+	multilines_detection(opts, desc);
+
+	/* values are indexed by original line numbers */
+	last_data_row = get_unfiltered_last_data_row(desc);
+
+	xmin = desc->cranges[colno].xmin;
+	xmax = desc->cranges[colno].xmax;
+
+	/* type of column of query result is known already */
+	source_type = get_source_type(desc, colno);
+	if (source_type == COLUMN_TYPE_TEXT)
+	{
+		cv->type = COLUMN_TYPE_TEXT;
+		cv->is_valid = true;
+
+		return cv;
+	}
+
+	cv->type = COLUMN_TYPE_UNKNOWN;
+	cv->values = smalloc(desc->total_rows * sizeof(double));
+	cv->isnull = smalloc(desc->total_rows * sizeof(bool));
+
+	for (lnb = &desc->rows; lnb; lnb = lnb->next)
+	{
+		for (i = 0; i < lnb->nrows; i++, lineno++)
+		{
+			char	   *field;
+			int			size;
+			double		d;
+			ColumnType	t;
+
+			if (lineno < desc->first_data_row || lineno > last_data_row)
+				continue;
+
+			if (!continual_line && desc->source_types &&
+				(field = (char *) get_source_field(desc, lineno, colno)))
+			{
+				/* not formatted value of query result, empty string is NULL */
+				if (*field == '\0')
+					cv->isnull[lineno] = true;
+				else if ((t = parse_typed_value(field, strlen(field), &d)) != COLUMN_TYPE_TEXT)
+				{
+					cv->values[lineno] = d;
+					cv->type = merge_column_types(cv->type, t);
+
+					if (t == COLUMN_TYPE_TIMESTAMP && !cv->has_time_zone)
+						cv->has_time_zone = timestamp_has_time_zone(field, strlen(field));
+					else if (t == COLUMN_TYPE_DECIMAL)
+					{
+						int		scale = number_scale(field, strlen(field));
+
+						if (scale > cv->scale)
+							cv->scale = scale;
+					}
+				}
+				else if (source_type != COLUMN_TYPE_UNKNOWN)
+				{
+					/* NaN, infinity or -infinity */
+					cv->values[lineno] = *field == '-' ? -HUGE_VAL : HUGE_VAL;
+				}
+				else
+				{
+					cv->type = COLUMN_TYPE_TEXT;
+					goto text_column;
+				}
+			}
+			else if (!continual_line)
+			{
+				/* not formatted value of csv is used without rendering of row */
+				if ((field = (char *) get_source_field(desc, lineno, colno)))
+				{
+					size = strlen(field);
+					if (size == 0)
+						field = NULL;
+				}
+				else
+				{
+					char	   *row = lb_get_row(lnb, i, &size);
+					int			offset = get_row_offset(lnb, i, size, xmin, opts->force8bit);
+
+					field = cut_field(row + offset, offset, xmin, xmax, border0, &size);
+				}
+
+				if (!field)
+					cv->isnull[lineno] = true;
+				else if ((t = parse_typed_value(field, size, &d)) != COLUMN_TYPE_TEXT)
+				{
+					cv->values[lineno] = d;
+					cv->type = merge_column_types(cv->type, t);
+
+					if (t == COLUMN_TYPE_TIMESTAMP && !cv->has_time_zone)
+						cv->has_time_zone = timestamp_has_time_zone(field, size);
+					else if (t == COLUMN_TYPE_DECIMAL)
+					{
+						int		scale = number_scale(field, size);
+
+						if (scale > cv->scale)
+							cv->scale = scale;
+					}
+				}
+				else if (!nullstr)
+				{
+					/* the row can be released from block cache, copy is necessary */
+					nullstr = sstrndup(field, size);
+					nullstr_size = size;
+					cv->isnull[lineno] = true;
+				}
+				else if (size == nullstr_size && memcmp(nullstr, field, size) == 0)
+					cv->isnull[lineno] = true;
+				else
+					cv->type = COLUMN_TYPE_TEXT;
+
+				if (cv->type == COLUMN_TYPE_TEXT)
+					goto text_column;
+			}
+
+			if (desc->has_multilines)
+				continual_line = (lnb->lineinfo &&
+								  (lnb->lineinfo[i].mask & LINEINFO_CONTINUATION));
+		}
+	}
+
+	/* prefer type of query result's column */
+	if (source_type != COLUMN_TYPE_UNKNOWN)
+		cv->type = source_type;
+
+text_column:
+
+	free(nullstr);
+
+	/* values of text columns are not used */
+	if (cv->type == COLUMN_TYPE_TEXT)
+	{
+		free(cv->values);
+		free(cv->isnull);
+
+		cv->values = NULL;
+		cv->isnull = NULL;
+	}
+
+	cv->is_valid = true;
+
+	return cv;
+}
+
+/*
+ * Release cached parsed values
+ */
+void
+free_column_values(DataDesc *desc)
+{
+	int		i;
+
+	if (!desc->column_values)
+		return;
+
+	for (i = 0; i < desc->columns; i++)
+	{
+		free(desc->column_values[i].values);
+		free(desc->column_values[i].isnull);
+	}
+
+	free(desc->column_values);
+	desc->column_values = NULL;
+}
+
 /*
  * Prepare order map - it is used for printing data in different than
  * original order. "sbcn" - sort by column number
@@ -1602,28 +1862,32 @@ void
 update_order_map(Options *opts, ScrDesc *scrdesc, DataDesc *desc, int sbcn, bool desc_sort)
 {
 	LineBuffer	   *lnb = &desc->rows;
-	char		   *nullstr = NULL;
+	ColumnValues   *cv;
 	int				xmin, xmax;
 	int				lineno = 0;
 	bool			continual_line = false;
-	bool			isnull;
-	bool			detect_string_column = false;
+	bool			is_text_column;
 	bool			border0 = (desc->border_type == 0);
 	SortData	   *sortbuf;
 	int				sortbuf_pos = 0;
+	long long		start_us;
+	bool			is_filtered = desc->row_filter_active;
 	int			i;
 
+	start_us = stats_time_us();
+
+	/* sort all rows, the filter is applied on sorted rows again */
+	if (is_filtered)
+		disable_row_filter(desc);
+
 	xmin = desc->cranges[sbcn - 1].xmin;
 	xmax = desc->cranges[sbcn - 1].xmax;
 
-	sortbuf = smalloc(desc->total_rows * sizeof(SortData));
-
-	/* multilines should be detected first */
-	multilines_detection(opts, desc);
+	/* values are parsed only once, then sort by numeric value is cheap */
+	cv = get_column_values(opts, desc, sbcn - 1);
+	is_text_column = cv->type == COLUMN_TYPE_TEXT;
 
-	lnb = &desc->rows;
-	lineno = 0;
-	sortbuf_pos = 0;
+	sortbuf = smalloc(desc->total_rows * sizeof(SortData));
 
 	if (!desc->order_map)
 	{
@@ -1631,14 +1895,12 @@ update_order_map(Options *opts, ScrDesc *scrdesc, DataDesc *desc, int sbcn, bool
 		desc->order_map_items = desc->total_rows;
 	}
 
+	ddesc_reset_positions(desc);
+
 	/*
 	 * There are two possible sorting methods: numeric or string.
-	 * We can try numeric sort first if all values are numbers or
-	 * just only one type of string value (like NULL string). This
-	 * value can be repeated,
-	 *
-	 * When there are more different strings, then start again and
-	 * use string sort.
+	 * Not text columns (numbers, dates, intervals, booleans) are
+	 * sorted by parsed binary values.
 	 */
 	while (lnb)
 	{
@@ -1651,26 +1913,44 @@ update_order_map(Options *opts, ScrDesc *scrdesc, DataDesc *desc, int sbcn, bool
 			{
 				if (!continual_line)
 				{
+					char	   *source_field;
+
 					sortbuf[sortbuf_pos].lnb = lnb;
 					sortbuf[sortbuf_pos].lnb_row = i;
 					sortbuf[sortbuf_pos].strxfrm = NULL;
+					sortbuf[sortbuf_pos].d = 0.0;
 
-					if (cut_numeric_value(lnb->rows[i],
-										   xmin, xmax,
-										   &sortbuf[sortbuf_pos].d,
-										   border0,
-										   &isnull,
-										   &nullstr))
+					if (is_text_column &&
+						(source_field = (char *) get_source_field(desc, lineno, sbcn - 1)))
+					{
+						if (*source_field &&
+							text_strxfrm(source_field, strlen(source_field), opts->force8bit, &sortbuf[sortbuf_pos].strxfrm))
+							sortbuf[sortbuf_pos++].info = INFO_STRXFRM;
+						else
+							sortbuf[sortbuf_pos++].info = INFO_UNKNOWN;		/* empty string */
+					}
+					else if (is_text_column)
+					{
+						char	   *row;
+						int			size;
+						int			offset;
+
+						row = lb_get_row(lnb, i, &size);
+						offset = get_row_offset(lnb, i, size, xmin, opts->force8bit);
+
+						if (cut_text(row + offset, size - offset, offset, xmin, xmax, border0,
+									 opts->force8bit, &sortbuf[sortbuf_pos].strxfrm))
+							sortbuf[sortbuf_pos++].info = INFO_STRXFRM;
+						else
+							sortbuf[sortbuf_pos++].info = INFO_UNKNOWN;		/* empty string */
+					}
+					else if (!cv->isnull[lineno])
+					{
+						sortbuf[sortbuf_pos].d = cv->values[lineno];
 						sortbuf[sortbuf_pos++].info = INFO_DOUBLE;
+					}
 					else
-					{
 						sortbuf[sortbuf_pos++].info = INFO_UNKNOWN;
-						if (!isnull)
-						{
-							detect_string_column = true;
-							goto sort_by_string;
-						}
-					}
 				}
 
 				if (desc->has_multilines)
@@ -1686,54 +1966,10 @@ update_order_map(Options *opts, ScrDesc *scrdesc, DataDesc *desc, int sbcn, bool
 		lnb = lnb->next;
 	}
 
-sort_by_string:
-
-	free(nullstr);
-
-	if (detect_string_column)
-	{
-		/* read data again and use nls_string */
-		lnb = &desc->rows;
-		lineno = 0;
-		sortbuf_pos = 0;
-		while (lnb)
-		{
-			for (i = 0; i < lnb->nrows; i++)
-			{
-				desc->order_map[lineno].lnb = lnb;
-				desc->order_map[lineno].lnb_row = i;
-
-				if (lineno >= desc->first_data_row && lineno <= desc->last_data_row)
-				{
-					if (!continual_line)
-					{
-						sortbuf[sortbuf_pos].lnb = lnb;
-						sortbuf[sortbuf_pos].lnb_row = i;
-						sortbuf[sortbuf_pos].d = 0.0;
-
-						if (cut_text(lnb->rows[i], xmin, xmax, border0, opts->force8bit, &sortbuf[sortbuf_pos].strxfrm))
-							sortbuf[sortbuf_pos++].info = INFO_STRXFRM;
-						else
-							sortbuf[sortbuf_pos++].info = INFO_UNKNOWN;		/* empty string */
-					}
-
-					if (desc->has_multilines)
-					{
-						continual_line =  (lnb->lineinfo &&
-										   (lnb->lineinfo[i].mask & LINEINFO_CONTINUATION));
-					}
-				}
-
-				lineno += 1;
-			}
-			lnb = lnb->next;
-		}
-	}
-
 	if (lineno != desc->total_rows)
 		leave("unexpected processed rows after sort prepare");
 
-	if (detect_string_column)
+	if (is_text_column)
 		sort_column_text(sortbuf, sortbuf_pos, desc_sort);
 	else
 		sort_column_num(sortbuf, sortbuf_pos, desc_sort);
@@ -1787,4 +2023,9 @@ sort_by_string:
 		free(sortbuf[i].strxfrm);
 
 	free(sortbuf);
+
+	if (is_filtered)
+		enable_row_filter(desc);
+
+	perf_stats.sort_us = stats_time_us() - start_us;
 }
@@ -607,7 +607,7 @@ utf8_nstrstr_with_sizes(const char *haystack,
 
 	while (needle_cur < needle_end)
 	{
-		if (haystack_cur == haystack_end)
+		if (haystack_cur >= haystack_end)
 			return NULL;
 
 		if (needle_prev != needle_cur)
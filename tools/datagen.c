@@ -0,0 +1,960 @@
+/*-------------------------------------------------------------------------
+ *
+ * datagen.c
+ *	  generator of synthetic data sets used for testing and benchmarks
+ *
+ * Produces psql like formatted tables (border 0, 1, 2, ascii or unicode
+ * linestyle, expanded mode, multiline cells) or csv, tsv documents. The
+ * rows are generated and written one by one, so memory usage doesn't
+ * depend on number of rows and we can produce tens of millions rows.
+ *
+ * Portions Copyright (c) 2017-2021 Pavel Stehule
+ *
+ * IDENTIFICATION
+ *	  tools/datagen.c
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include <getopt.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_COLUMNS			1024
+#define MAX_CELL_WIDTH		1000
+#define MAX_CELL_LINES		3
+
+/* enough for MAX_CELL_LINES lines of two bytes chars */
+#define CELL_BUFFER_SIZE	(MAX_CELL_LINES * (MAX_CELL_WIDTH * 2 + 1) + 1)
+
+typedef enum
+{
+	COL_INT,
+	COL_NUMERIC,
+	COL_TEXT,
+	COL_DATE,
+	COL_TIMESTAMP,
+	COL_BOOL
+} ColType;
+
+#define N_COLTYPES		6
+
+typedef struct
+{
+	ColType		type;
+	char		name[32];
+	int			width;				/* display width of column */
+	bool		right_align;
+} ColDesc;
+
+typedef enum
+{
+	FORMAT_PSQL,
+	FORMAT_CSV,
+	FORMAT_TSV
+} OutputFormat;
+
+typedef struct
+{
+	const char *hl;					/* horizontal line */
+	const char *vl;					/* vertical line */
+	const char *nl_mark;			/* continuation mark of multiline cell */
+	const char *top[3];				/* left, inner, right */
+	const char *mid[3];
+	const char *bottom[3];
+} LineStyle;
+
+static const LineStyle ascii_style = {
+	"-", "|", "+",
+	{"+", "+", "+"},
+	{"+", "+", "+"},
+	{"+", "+", "+"}
+};
+
+static const LineStyle unicode_style = {
+	"─", "│", "↵",
+	{"┌", "┬", "┐"},
+	{"├", "┼", "┤"},
+	{"└", "┴", "┘"}
+};
+
+/*
+ * Only chars with display width 1 are used, so display width of generated
+ * string is same as number of chars, and we don't need wcwidth here.
+ */
+static const char *unicode_chars[] = {
+	"á", "č", "ď", "é", "ě", "í", "ň", "ó", "ř", "š", "ť", "ú", "ů", "ý", "ž",
+	"α", "β", "γ", "δ", "λ", "π", "ω", "д", "ж", "ф", "ш", "я", "ß", "ø", "å"
+};
+
+#define N_UNICODE_CHARS		(sizeof(unicode_chars) / sizeof(char *))
+
+typedef struct
+{
+	long		rows;
+	int			columns;
+	int			width;
+	int			unicode_pct;
+	int			multiline_pct;
+	int			null_pct;
+	int			border;
+	bool		unicode_linestyle;
+	bool		expanded;
+	char		csv_separator;
+	OutputFormat format;
+	uint64_t	seed;
+} GenOptions;
+
+static uint64_t rnd_state;
+
+static uint64_t
+rnd(void)
+{
+	/* xorshift64*, deterministic and fast enough */
+	rnd_state ^= rnd_state >> 12;
+	rnd_state ^= rnd_state << 25;
+	rnd_state ^= rnd_state >> 27;
+
+	return rnd_state * 2685821657736338717ULL;
+}
+
+static int
+rnd_range(int n)
+{
+	return (int) (rnd() % (uint64_t) n);
+}
+
+static bool
+rnd_pct(int pct)
+{
+	return pct > 0 && rnd_range(100) < pct;
+}
+
+static void
+repeat(FILE *fp, const char *str, int n)
+{
+	while (n-- > 0)
+		fputs(str, fp);
+}
+
+/*
+ * Returns display width of string. All generated chars have
+ * display width 1, so we can count leading bytes only.
+ */
+static int
+dsplen(const char *str, int bytes)
+{
+	int		result = 0;
+
+	while (bytes-- > 0)
+	{
+		if ((*str++ & 0xC0) != 0x80)
+			result += 1;
+	}
+
+	return result;
+}
+
+static int
+digits(long n)
+{
+	int		result = 1;
+
+	while (n >= 10)
+	{
+		n /= 10;
+		result += 1;
+	}
+
+	return result;
+}
+
+static void
+prepare_columns(GenOptions *gopts, ColDesc *cols)
+{
+	int		i;
+
+	for (i = 0; i < gopts->columns; i++)
+	{
+		ColDesc *col = &cols[i];
+		int		namelen;
+
+		col->type = i == 0 ? COL_INT : (ColType) (i % N_COLTYPES);
+
+		switch (col->type)
+		{
+			case COL_INT:
+				snprintf(col->name, sizeof(col->name), i == 0 ? "id" : "int%d", i + 1);
+				col->width = digits(gopts->rows);
+				col->right_align = true;
+				break;
+			case COL_NUMERIC:
+				snprintf(col->name, sizeof(col->name), "num%d", i + 1);
+				col->width = 14;
+				col->right_align = true;
+				break;
+			case COL_TEXT:
+				snprintf(col->name, sizeof(col->name), "text%d", i + 1);
+				col->width = gopts->width;
+				col->right_align = false;
+				break;
+			case COL_DATE:
+				snprintf(col->name, sizeof(col->name), "date%d", i + 1);
+				col->width = 10;
+				col->right_align = false;
+				break;
+			case COL_TIMESTAMP:
+				snprintf(col->name, sizeof(col->name), "ts%d", i + 1);
+				col->width = 19;
+				col->right_align = false;
+				break;
+			case COL_BOOL:
+				snprintf(col->name, sizeof(col->name), "bool%d", i + 1);
+				col->width = 1;
+				col->right_align = false;
+				break;
+		}
+
+		namelen = strlen(col->name);
+		if (col->width < namelen)
+			col->width = namelen;
+	}
+}
+
+/*
+ * Generate text value. Multiline values contains '\n'.
+ */
+static void
+generate_text(GenOptions *gopts, char *buffer)
+{
+	char   *ptr = buffer;
+	int		nlines = 1;
+	int		i;
+
+	if (rnd_pct(gopts->multiline_pct))
+		nlines = 2 + rnd_range(MAX_CELL_LINES - 1);
+
+	for (i = 0; i < nlines; i++)
+	{
+		int		len = 1 + rnd_range(gopts->width);
+		int		j;
+
+		if (i > 0)
+			*ptr++ = '\n';
+
+		for (j = 0; j < len; j++)
+		{
+			if (rnd_pct(gopts->unicode_pct))
+			{
+				const char *uc = unicode_chars[rnd_range(N_UNICODE_CHARS)];
+
+				while (*uc)
+					*ptr++ = *uc++;
+			}
+			else if (j > 0 && j < len - 1 && rnd_range(6) == 0)
+				*ptr++ = ' ';
+			else
+				*ptr++ = 'a' + rnd_range(26);
+		}
+	}
+
+	*ptr = '\0';
+}
+
+static void
+generate_value(GenOptions *gopts, ColDesc *col, long rowno, char *buffer)
+{
+	if (col->type != COL_INT && rnd_pct(gopts->null_pct))
+	{
+		*buffer = '\0';
+		return;
+	}
+
+	switch (col->type)
+	{
+		case COL_INT:
+			sprintf(buffer, "%ld", rowno);
+			break;
+		case COL_NUMERIC:
+			{
+				long	v = (long) (rnd() % 200000000) - 100000000;
+
+				sprintf(buffer, "%ld.%02d", v / 100 , abs((int) (v % 100)));
+				if (v < 0 && v > -100)
+				{
+					/* keep sign for values between -1 and 0 */
+					memmove(buffer + 1, buffer, strlen(buffer) + 1);
+					*buffer = '-';
+				}
+			}
+			break;
+		case COL_TEXT:
+			generate_text(gopts, buffer);
+			break;
+		case COL_DATE:
+			sprintf(buffer, "%04d-%02d-%02d",
+					1970 + rnd_range(60), 1 + rnd_range(12), 1 + rnd_range(28));
+			break;
+		case COL_TIMESTAMP:
+			sprintf(buffer, "%04d-%02d-%02d %02d:%02d:%02d",
+					1970 + rnd_range(60), 1 + rnd_range(12), 1 + rnd_range(28),
+					rnd_range(24), rnd_range(60), rnd_range(60));
+			break;
+		case COL_BOOL:
+			strcpy(buffer, rnd_range(2) ? "t" : "f");
+			break;
+	}
+}
+
+/*
+ * Returns pointer to n-th line of value and its size in bytes.
+ * Returns NULL when line doesn't exists.
+ */
+static const char *
+get_value_line(const char *value, int n, int *bytes, bool *has_next)
+{
+	const char *ptr = value;
+	const char *end;
+
+	while (n-- > 0)
+	{
+		ptr = strchr(ptr, '\n');
+		if (!ptr)
+			return NULL;
+		ptr += 1;
+	}
+
+	end = strchr(ptr, '\n');
+	if (end)
+	{
+		*bytes = end - ptr;
+		*has_next = true;
+	}
+	else
+	{
+		*bytes = strlen(ptr);
+		*has_next = false;
+	}
+
+	return ptr;
+}
+
+static int
+value_lines(const char *value)
+{
+	int		result = 1;
+
+	while ((value = strchr(value, '\n')) != NULL)
+	{
+		result += 1;
+		value += 1;
+	}
+
+	return result;
+}
+
+static void
+print_aligned_str(FILE *fp, const char *str, int bytes, int width, bool right_align)
+{
+	int		pad = width - dsplen(str, bytes);
+
+	if (right_align)
+		repeat(fp, " ", pad);
+
+	fwrite(str, 1, bytes, fp);
+
+	if (!right_align)
+		repeat(fp, " ", pad);
+}
+
+/*
+ * Print horizontal border line. The part is 0 for top line, 1 for
+ * header separator and 2 for bottom line.
+ */
+static void
+print_hline(FILE *fp, GenOptions *gopts, const LineStyle *ls, ColDesc *cols, int part)
+{
+	const char *const *chars = part == 0 ? ls->top : (part == 1 ? ls->mid : ls->bottom);
+	int		i;
+
+	if (gopts->border == 2)
+		fputs(chars[0], fp);
+
+	for (i = 0; i < gopts->columns; i++)
+	{
+		if (i > 0)
+			fputs(gopts->border == 0 ? " " : chars[1], fp);
+
+		repeat(fp, ls->hl, cols[i].width + (gopts->border == 0 ? 0 : 2));
+	}
+
+	if (gopts->border == 2)
+		fputs(chars[2], fp);
+
+	fputc('\n', fp);
+}
+
+/*
+ * Spaces are not printed immediately, but only when some other
+ * content follows. So trailing spaces can be removed for border 0
+ * and 1 like psql does.
+ */
+static int pending_spaces = 0;
+
+static void
+out_spaces(int n)
+{
+	if (n > 0)
+		pending_spaces += n;
+}
+
+static void
+out_str(FILE *fp, const char *str, int bytes)
+{
+	if (pending_spaces > 0)
+	{
+		repeat(fp, " ", pending_spaces);
+		pending_spaces = 0;
+	}
+
+	fwrite(str, 1, bytes, fp);
+}
+
+static void
+out_newline(FILE *fp)
+{
+	pending_spaces = 0;
+	fputc('\n', fp);
+}
+
+/*
+ * Print one physical line of table.
+ */
+static void
+print_table_line(FILE *fp,
+				 GenOptions *gopts,
+				 const LineStyle *ls,
+				 ColDesc *cols,
+				 char **values,
+				 int lineno,
+				 bool is_header)
+{
+	int			vl_size = strlen(ls->vl);
+	int			i;
+
+	if (gopts->border == 2)
+	{
+		out_str(fp, ls->vl, vl_size);
+		out_spaces(1);
+	}
+	else if (gopts->border == 1)
+		out_spaces(1);
+
+	for (i = 0; i < gopts->columns; i++)
+	{
+		ColDesc *col = &cols[i];
+		bool	has_next = false;
+		bool	is_last = i == gopts->columns - 1;
+
+		if (is_header)
+		{
+			int		namelen = strlen(col->name);
+			int		lpad = (col->width - namelen) / 2;
+
+			out_spaces(lpad);
+			out_str(fp, col->name, namelen);
+			out_spaces(col->width - namelen - lpad);
+		}
+		else
+		{
+			const char *str;
+			int		bytes;
+
+			str = get_value_line(values[i], lineno, &bytes, &has_next);
+			if (str)
+			{
+				int		pad = col->width - dsplen(str, bytes);
+
+				if (col->right_align)
+					out_spaces(pad);
+
+				out_str(fp, str, bytes);
+
+				if (!col->right_align)
+					out_spaces(pad);
+			}
+			else
+				out_spaces(col->width);
+		}
+
+		if (has_next)
+			out_str(fp, ls->nl_mark, strlen(ls->nl_mark));
+		else
+			out_spaces(1);
+
+		if (!is_last)
+		{
+			if (gopts->border != 0)
+			{
+				out_str(fp, ls->vl, vl_size);
+				out_spaces(1);
+			}
+		}
+		else if (gopts->border == 2)
+			out_str(fp, ls->vl, vl_size);
+	}
+
+	out_newline(fp);
+}
+
+static void
+generate_table(FILE *fp, GenOptions *gopts, ColDesc *cols, char **values)
+{
+	const LineStyle *ls = gopts->unicode_linestyle ? &unicode_style : &ascii_style;
+	long		rowno;
+	int			i;
+
+	if (gopts->border == 2)
+		print_hline(fp, gopts, ls, cols, 0);
+
+	print_table_line(fp, gopts, ls, cols, NULL, 0, true);
+	print_hline(fp, gopts, ls, cols, 1);
+
+	for (rowno = 1; rowno <= gopts->rows; rowno++)
+	{
+		int		nlines = 1;
+		int		lineno;
+
+		for (i = 0; i < gopts->columns; i++)
+		{
+			int		n;
+
+			generate_value(gopts, &cols[i], rowno, values[i]);
+
+			n = value_lines(values[i]);
+			if (n > nlines)
+				nlines = n;
+		}
+
+		for (lineno = 0; lineno < nlines; lineno++)
+			print_table_line(fp, gopts, ls, cols, values, lineno, false);
+	}
+
+	if (gopts->border == 2)
+		print_hline(fp, gopts, ls, cols, 2);
+
+	fprintf(fp, "(%ld %s)\n\n", gopts->rows, gopts->rows == 1 ? "row" : "rows");
+}
+
+/*
+ * Print title of record in expanded mode
+ */
+static void
+print_record_header(FILE *fp,
+					GenOptions *gopts,
+					const LineStyle *ls,
+					long rowno,
+					int name_width,
+					int value_width)
+{
+	const char *const *chars = rowno == 1 ? ls->top : ls->mid;
+	char		label[64];
+	int			label_width;
+	int			name_part;
+	int			value_part;
+
+	if (gopts->border == 0)
+	{
+		fprintf(fp, "* Record %ld\n", rowno);
+		return;
+	}
+
+	snprintf(label, sizeof(label), "[ RECORD %ld ]", rowno);
+	label_width = strlen(label);
+
+	name_part = name_width + (gopts->border == 2 ? 2 : 1);
+	value_part = value_width + (gopts->border == 2 ? 2 : 1);
+
+	if (gopts->border == 2)
+		fputs(chars[0], fp);
+
+	fputs(ls->hl, fp);
+	fputs(label, fp);
+
+	if (label_width + 1 < name_part)
+	{
+		repeat(fp, ls->hl, name_part - label_width - 1);
+		fputs(chars[1], fp);
+		repeat(fp, ls->hl, value_part);
+	}
+	else
+		repeat(fp, ls->hl, name_part + value_part + 1 - label_width - 1);
+
+	if (gopts->border == 2)
+		fputs(chars[2], fp);
+
+	fputc('\n', fp);
+}
+
+static void
+generate_expanded(FILE *fp, GenOptions *gopts, ColDesc *cols, char **values)
+{
+	const LineStyle *ls = gopts->unicode_linestyle ? &unicode_style : &ascii_style;
+	int			name_width = 0;
+	int			value_width = 0;
+	long		rowno;
+	int			i;
+
+	for (i = 0; i < gopts->columns; i++)
+	{
+		int		namelen = strlen(cols[i].name);
+
+		if (namelen > name_width)
+			name_width = namelen;
+		if (cols[i].width > value_width)
+			value_width = cols[i].width;
+	}
+
+	for (rowno = 1; rowno <= gopts->rows; rowno++)
+	{
+		print_record_header(fp, gopts, ls, rowno, name_width, value_width);
+
+		for (i = 0; i < gopts->columns; i++)
+		{
+			int		lineno = 0;
+			bool	has_next;
+
+			generate_value(gopts, &cols[i], rowno, values[i]);
+
+			do
+			{
+				const char *str;
+				int		bytes;
+
+				str = get_value_line(values[i], lineno, &bytes, &has_next);
+
+				if (gopts->border == 2)
+					fprintf(fp, "%s ", ls->vl);
+
+				print_aligned_str(fp,
+								  lineno == 0 ? cols[i].name : "",
+								  lineno == 0 ? (int) strlen(cols[i].name) : 0,
+								  name_width, false);
+
+				if (gopts->border == 0)
+					fputc(' ', fp);
+				else
+					fprintf(fp, " %s ", ls->vl);
+
+				if (gopts->border == 2 || has_next)
+				{
+					print_aligned_str(fp, str, bytes, value_width, false);
+					fputs(has_next ? ls->nl_mark : " ", fp);
+
+					if (gopts->border == 2)
+						fputs(ls->vl, fp);
+				}
+				else
+					fwrite(str, 1, bytes, fp);
+
+				fputc('\n', fp);
+				lineno += 1;
+			}
+			while (has_next);
+		}
+	}
+
+	if (gopts->border == 2 && gopts->rows > 0)
+	{
+		fputs(ls->bottom[0], fp);
+		repeat(fp, ls->hl, name_width + 2);
+		fputs(ls->bottom[1], fp);
+		repeat(fp, ls->hl, value_width + 2);
+		fputs(ls->bottom[2], fp);
+		fputc('\n', fp);
+	}
+
+	fputc('\n', fp);
+}
+
+static void
+print_csv_value(FILE *fp, GenOptions *gopts, const char *value)
+{
+	if (strchr(value, gopts->csv_separator) || strchr(value, '"') ||
+		strchr(value, '\n') || strchr(value, ' '))
+	{
+		fputc('"', fp);
+
+		while (*value)
+		{
+			if (*value == '"')
+				fputc('"', fp);
+			fputc(*value++, fp);
+		}
+
+		fputc('"', fp);
+	}
+	else
+		fputs(value, fp);
+}
+
+static void
+print_tsv_value(FILE *fp, const char *value)
+{
+	while (*value)
+	{
+		if (*value == '\n')
+			fputs("\\n", fp);
+		else if (*value == '\t')
+			fputs("\\t", fp);
+		else if (*value == '\\')
+			fputs("\\\\", fp);
+		else
+			fputc(*value, fp);
+
+		value += 1;
+	}
+}
+
+static void
+generate_dsv(FILE *fp, GenOptions *gopts, ColDesc *cols, char **values)
+{
+	char		sep = gopts->format == FORMAT_TSV ? '\t' : gopts->csv_separator;
+	long		rowno;
+	int			i;
+
+	for (i = 0; i < gopts->columns; i++)
+	{
+		if (i > 0)
+			fputc(sep, fp);
+		fputs(cols[i].name, fp);
+	}
+	fputc('\n', fp);
+
+	for (rowno = 1; rowno <= gopts->rows; rowno++)
+	{
+		for (i = 0; i < gopts->columns; i++)
+		{
+			generate_value(gopts, &cols[i], rowno, values[i]);
+
+			if (i > 0)
+				fputc(sep, fp);
+
+			if (gopts->format == FORMAT_TSV)
+				print_tsv_value(fp, values[i]);
+			else
+				print_csv_value(fp, gopts, values[i]);
+		}
+		fputc('\n', fp);
+	}
+}
+
+static void
+usage(const char *progname)
+{
+	fprintf(stdout, "%s generates synthetic data for pspg tests and benchmarks.\n\n", progname);
+	fprintf(stdout, "Usage:\n");
+	fprintf(stdout, "  %s [OPTION]\n\n", progname);
+	fprintf(stdout, "Options:\n");
+	fprintf(stdout, "  -r, --rows=NUM           number of rows (default 1000)\n");
+	fprintf(stdout, "  -c, --columns=NUM        number of columns (default 6, max %d)\n", MAX_COLUMNS);
+	fprintf(stdout, "  -w, --width=NUM          max width of text cells (default 20, max %d)\n", MAX_CELL_WIDTH);
+	fprintf(stdout, "  -u, --unicode=PCT        percent of non ascii chars in text cells (default 0)\n");
+	fprintf(stdout, "  -m, --multiline=PCT      percent of multiline text cells (default 0)\n");
+	fprintf(stdout, "  -n, --nulls=PCT          percent of NULL (empty) cells (default 0)\n");
+	fprintf(stdout, "  -f, --format=FORMAT      psql, csv or tsv (default psql)\n");
+	fprintf(stdout, "  -b, --border=NUM         psql border type 0, 1 or 2 (default 1)\n");
+	fprintf(stdout, "  -l, --linestyle=STYLE    psql linestyle ascii or unicode (default ascii)\n");
+	fprintf(stdout, "  -x, --expanded           psql expanded mode\n");
+	fprintf(stdout, "  --csv-separator=CHAR     char used as csv field separator (default ,)\n");
+	fprintf(stdout, "  -s, --seed=NUM           seed of random generator\n");
+	fprintf(stdout, "  -o, --output=FILE        write to file instead stdout\n");
+	fprintf(stdout, "  --help                   show this help\n");
+}
+
+static long
+parse_num(const char *str, const char *optname, long minval, long maxval)
+{
+	char	   *endptr;
+	long		result;
+
+	result = strtol(str, &endptr, 10);
+	if (*endptr != '\0' || result < minval || result > maxval)
+	{
+		fprintf(stderr, "value of %s should be between %ld and %ld\n",
+				optname, minval, maxval);
+		exit(EXIT_FAILURE);
+	}
+
+	return result;
+}
+
+static struct option long_options[] =
+{
+	{"rows", required_argument, 0, 'r'},
+	{"columns", required_argument, 0, 'c'},
+	{"width", required_argument, 0, 'w'},
+	{"unicode", required_argument, 0, 'u'},
+	{"multiline", required_argument, 0, 'm'},
+	{"nulls", required_argument, 0, 'n'},
+	{"format", required_argument, 0, 'f'},
+	{"border", required_argument, 0, 'b'},
+	{"linestyle", required_argument, 0, 'l'},
+	{"expanded", no_argument, 0, 'x'},
+	{"csv-separator", required_argument, 0, 1},
+	{"seed", required_argument, 0, 's'},
+	{"output", required_argument, 0, 'o'},
+	{"help", no_argument, 0, 2},
+	{0, 0, 0, 0}
+};
+
+int
+main(int argc, char *argv[])
+{
+	GenOptions	gopts;
+	ColDesc	   *cols;
+	char	  **values;
+	FILE	   *fp = stdout;
+	int			opt;
+	int			i;
+
+	memset(&gopts, 0, sizeof(gopts));
+
+	gopts.rows = 1000;
+	gopts.columns = 6;
+	gopts.width = 20;
+	gopts.border = 1;
+	gopts.csv_separator = ',';
+	gopts.format = FORMAT_PSQL;
+	gopts.seed = 1;
+
+	while ((opt = getopt_long(argc, argv, "r:c:w:u:m:n:f:b:l:xs:o:",
+							  long_options, NULL)) != -1)
+	{
+		switch (opt)
+		{
+			case 'r':
+				gopts.rows = parse_num(optarg, "rows", 0, 1000000000L);
+				break;
+			case 'c':
+				gopts.columns = parse_num(optarg, "columns", 1, MAX_COLUMNS);
+				break;
+			case 'w':
+				gopts.width = parse_num(optarg, "width", 1, MAX_CELL_WIDTH);
+				break;
+			case 'u':
+				gopts.unicode_pct = parse_num(optarg, "unicode", 0, 100);
+				break;
+			case 'm':
+				gopts.multiline_pct = parse_num(optarg, "multiline", 0, 100);
+				break;
+			case 'n':
+				gopts.null_pct = parse_num(optarg, "nulls", 0, 100);
+				break;
+			case 'b':
+				gopts.border = parse_num(optarg, "border", 0, 2);
+				break;
+			case 'x':
+				gopts.expanded = true;
+				break;
+			case 's':
+				gopts.seed = parse_num(optarg, "seed", 1, 2147483647L);
+				break;
+			case 'f':
+				if (strcmp(optarg, "psql") == 0)
+					gopts.format = FORMAT_PSQL;
+				else if (strcmp(optarg, "csv") == 0)
+					gopts.format = FORMAT_CSV;
+				else if (strcmp(optarg, "tsv") == 0)
+					gopts.format = FORMAT_TSV;
+				else
+				{
+					fprintf(stderr, "unknown format \"%s\"\n", optarg);
+					exit(EXIT_FAILURE);
+				}
+				break;
+			case 'l':
+				if (strcmp(optarg, "ascii") == 0)
+					gopts.unicode_linestyle = false;
+				else if (strcmp(optarg, "unicode") == 0)
+					gopts.unicode_linestyle = true;
+				else
+				{
+					fprintf(stderr, "unknown linestyle \"%s\"\n", optarg);
+					exit(EXIT_FAILURE);
+				}
+				break;
+			case 1:
+				if (strlen(optarg) != 1)
+				{
+					fprintf(stderr, "csv separator should be one char\n");
+					exit(EXIT_FAILURE);
+				}
+				gopts.csv_separator = *optarg;
+				break;
+			case 'o':
+				fp = fopen(optarg, "w");
+				if (!fp)
+				{
+					perror(optarg);
+					exit(EXIT_FAILURE);
+				}
+				break;
+			case 2:
+				usage(argv[0]);
+				exit(EXIT_SUCCESS);
+			default:
+				fprintf(stderr, "Try %s --help\n", argv[0]);
+				exit(EXIT_FAILURE);
+		}
+	}
+
+	/* use large buffer, output can have gigabytes */
+	setvbuf(fp, NULL, _IOFBF, 1024 * 1024);
+
+	rnd_state = gopts.seed * 0x9E3779B97F4A7C15ULL;
+
+	cols = calloc(gopts.columns, sizeof(ColDesc));
+	values = calloc(gopts.columns, sizeof(char *));
+	if (!cols || !values)
+	{
+		fprintf(stderr, "out of memory\n");
+		exit(EXIT_FAILURE);
+	}
+
+	for (i = 0; i < gopts.columns; i++)
+	{
+		values[i] = malloc(CELL_BUFFER_SIZE);
+		if (!values[i])
+		{
+			fprintf(stderr, "out of memory\n");
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	prepare_columns(&gopts, cols);
+
+	if (gopts.format != FORMAT_PSQL)
+		generate_dsv(fp, &gopts, cols, values);
+	else if (gopts.expanded)
+		generate_expanded(fp, &gopts, cols, values);
+	else
+		generate_table(fp, &gopts, cols, values);
+
+	if (fclose(fp) != 0)
+	{
+		perror("fclose");
+		exit(EXIT_FAILURE);
+	}
+
+	for (i = 0; i < gopts.columns; i++)
+		free(values[i]);
+
+	free(values);
+	free(cols);
+
+	return EXIT_SUCCESS;
+}